@@ -29,6 +29,10 @@
      bits after handling interrupts. This gives you full control, but
      you can't combine it with the first approach.
 
+   Libraries which need a pin interrupt at runtime can set a handler
+   with gpio_set_pin_interrupt() instead, which takes precedence over
+   gpioXX_interrupt_handler() for that pin.
+
 
   Part of esp-open-rtos
   Copyright (C) 2015 Superhouse Automation Pty Ltd
@@ -65,6 +69,9 @@ const gpio_interrupt_handler_t gpio_interrupt_handlers[16] = {
     gpio12_interrupt_handler, gpio13_interrupt_handler, gpio14_interrupt_handler,
     gpio15_interrupt_handler };
 
+/* Handlers set at runtime with gpio_set_pin_interrupt() */
+static gpio_pin_interrupt_handler_t gpio_pin_handlers[16];
+
 void __attribute__((weak)) IRAM gpio_interrupt_handler(void)
 {
     uint32_t status_reg = GPIO.STATUS;
@@ -74,7 +81,20 @@ void __attribute__((weak)) IRAM gpio_interrupt_handler(void)
     {
         gpio_idx--;
         status_reg &= ~BIT(gpio_idx);
-        if(FIELD2VAL(GPIO_CONF_INTTYPE, GPIO.CONF[gpio_idx]))
-            gpio_interrupt_handlers[gpio_idx]();
+        if(FIELD2VAL(GPIO_CONF_INTTYPE, GPIO.CONF[gpio_idx])) {
+            gpio_pin_interrupt_handler_t handler = gpio_pin_handlers[gpio_idx];
+            if(handler)
+                handler(gpio_idx);
+            else
+                gpio_interrupt_handlers[gpio_idx]();
+        }
     }
 }
+
+void gpio_set_pin_interrupt(const uint8_t gpio_num, const gpio_inttype_t int_type, gpio_pin_interrupt_handler_t handler)
+{
+    /* disable the pin's interrupt while the handler changes */
+    gpio_set_interrupt(gpio_num, GPIO_INTTYPE_NONE);
+    gpio_pin_handlers[gpio_num] = handler;
+    gpio_set_interrupt(gpio_num, int_type);
+}
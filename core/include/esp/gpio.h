@@ -137,6 +137,20 @@ static inline void gpio_set_interrupt(const uint8_t gpio_num, const gpio_inttype
     }
 }
 
+typedef void (* gpio_pin_interrupt_handler_t)(uint8_t gpio_num);
+
+/* Set the interrupt type for a given pin, and a handler to call for it
+ *
+ * The handler is called with the pin number from gpio_interrupt_handler,
+ * in place of gpioXX_interrupt_handler() for that pin. The interrupt
+ * status bit has already been cleared. Handlers must be IRAM functions.
+ *
+ * Passing a NULL handler goes back to gpioXX_interrupt_handler().
+ * Handlers set here are not called if the program defines its own
+ * gpio_interrupt_handler().
+ */
+void gpio_set_pin_interrupt(const uint8_t gpio_num, const gpio_inttype_t int_type, gpio_pin_interrupt_handler_t handler);
+
 /* Return the interrupt type set for a pin */
 static inline gpio_inttype_t gpio_get_interrupt(const uint8_t gpio_num)
 {
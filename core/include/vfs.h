@@ -0,0 +1,121 @@
+/*
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+
+#ifndef _VFS_H_
+#define _VFS_H_
+
+#include <sys/reent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <esp/types.h>
+
+/** @file vfs.h
+ *
+ *  File descriptor table for the newlib syscalls.
+ *
+ *  Every file descriptor returned by open(), vfs_pipe() or vfs_socket() is
+ *  an index into one table, so read(), write(), close(), lseek() and
+ *  fstat() go straight to the right backend without searching. File
+ *  descriptors 0, 1 and 2 are the console (UART0).
+ *
+ *  A backend is a vfs_ops_t. Each entry in the table has the backend, a
+ *  context pointer and a backend handle (eg the SPIFFS file handle.) One
+ *  filesystem can be mounted with vfs_mount() to handle open(), stat()
+ *  and unlink().
+ */
+
+#ifndef VFS_MAX_FDS
+#define VFS_MAX_FDS 16
+#endif
+
+/** Backend operations.
+ *
+ *  Functions return -1 and set `r->_errno` on failure, like the newlib
+ *  syscalls. Any function can be NULL if the backend doesn't support it
+ *  (the syscall then fails with ENOTSUP, except close which just frees the
+ *  file descriptor.)
+ */
+typedef struct vfs_ops {
+    ssize_t (*read)(struct _reent *r, void *ctx, int handle, void *buf, size_t len);
+    ssize_t (*write)(struct _reent *r, void *ctx, int handle, const void *buf, size_t len);
+    off_t (*lseek)(struct _reent *r, void *ctx, int handle, off_t offset, int whence);
+    int (*fstat)(struct _reent *r, void *ctx, int handle, struct stat *st);
+    int (*close)(struct _reent *r, void *ctx, int handle);
+
+    /* Only used for the mounted filesystem. open returns the backend
+       handle for the new file descriptor. */
+    int (*open)(struct _reent *r, void *ctx, const char *path, int flags, int mode);
+    int (*stat)(struct _reent *r, void *ctx, const char *path, struct stat *st);
+    int (*unlink)(struct _reent *r, void *ctx, const char *path);
+} vfs_ops_t;
+
+/** Allocate a file descriptor for a backend object.
+ *
+ *  @return the new file descriptor, or -1 with `r->_errno` set to EMFILE
+ *  if the table is full.
+ */
+int vfs_fd_alloc(struct _reent *r, const vfs_ops_t *ops, void *ctx, int handle);
+
+/** Release a file descriptor without calling the backend's close. */
+void vfs_fd_free(int fd);
+
+/** Get the backend of an open file descriptor.
+ *
+ *  @return the backend ops (and context and handle if the pointers are not
+ *  NULL), or NULL if fd is not open.
+ */
+const vfs_ops_t *vfs_fd_get(int fd, void **ctx, int *handle);
+
+/** Set the filesystem used for open(), stat() and unlink(). Passing NULL
+ *  unmounts it (file descriptors that are still open keep working.)
+ */
+void vfs_mount(const vfs_ops_t *ops, void *ctx);
+
+/** Get the mounted filesystem (NULL if none) and its context. */
+const vfs_ops_t *vfs_get_mount(void **ctx);
+
+/** Create a pipe backed by a ring buffer of `size` bytes.
+ *
+ *  `fds[0]` is the read end, `fds[1]` the write end. Reads block until
+ *  there is data (or return 0 once the write end is closed), writes block
+ *  until everything has been written to the buffer.
+ *
+ *  @return 0 on success, -1 with errno set on failure.
+ */
+int vfs_pipe(int fds[2], size_t size);
+
+/** Give an lwIP socket a file descriptor, so read(), write() and close()
+ *  can be used on it alongside files. Closing the file descriptor closes
+ *  the socket. The socket functions (send(), recv() etc.) still need the
+ *  lwIP socket number, except select(), see vfs_select().
+ *
+ *  Note that lwip/sockets.h defines read(), write(), close() and select()
+ *  as macros for the lwIP socket functions (see lwipopts.h), so they can't
+ *  be used on other file descriptors in source files that include it. Use
+ *  _read_r(), _write_r(), _close_r() and vfs_select() there.
+ *
+ *  @return the file descriptor, or -1 with errno set on failure.
+ */
+int vfs_socket(int sock);
+
+/** select() across file descriptors of any kind. Sockets given to
+ *  vfs_socket() are waited on with lwip_select() using their lwIP
+ *  numbers, files, pipes and the console are always reported ready for
+ *  reading and writing (a pipe read may still block) and never have an
+ *  exception pending.
+ *
+ *  This is also what select() calls in source files that don't include
+ *  lwip/sockets.h.
+ *
+ *  @return the number of ready file descriptors, 0 on timeout, or -1 with
+ *  errno set (EBADF for a file descriptor that isn't open).
+ */
+int vfs_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout);
+
+/** Console (UART0) backend, used for file descriptors 0, 1 and 2 */
+extern const vfs_ops_t vfs_console_ops;
+
+#endif /* _VFS_H_ */
@@ -12,6 +12,9 @@
 #include <xtensa_ops.h>
 #include <esp/uart.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <vfs.h>
 
 extern void *xPortSupervisorStackPointer;
 
@@ -40,33 +43,36 @@ IRAM caddr_t _sbrk_r (struct _reent *r, int incr)
     return (caddr_t) prev_heap_end;
 }
 
-/* syscall implementation for stdio write to UART */
-__attribute__((weak)) long _write_r(struct _reent *r, int fd, const char *ptr, int len )
+/* Console write to UART0. Weak so a UART driver can replace it.
+
+   Waits for FIFO space once per batch rather than once per byte, and
+   writes as much as fits. */
+__attribute__((weak)) long _write_stdout_r(struct _reent *r, int fd, const char *ptr, int len )
 {
-    if(fd != r->_stdout->_file) {
-        r->_errno = EBADF;
-        return -1;
-    }
-    for(int i = 0; i < len; i++) {
-        /* Auto convert CR to CRLF, ignore other LFs (compatible with Espressif SDK behaviour) */
-        if(ptr[i] == '\r')
-            continue;
-        if(ptr[i] == '\n')
-            uart_putc(0, '\r');
-        uart_putc(0, ptr[i]);
+    int i = 0;
+    while(i < len) {
+        /* room for at least one character plus CR */
+        int space = uart_txfifo_wait(0, 2);
+        for(; i < len && space >= 2; i++) {
+            /* Auto convert CR to CRLF, ignore other LFs (compatible with Espressif SDK behaviour) */
+            if(ptr[i] == '\r')
+                continue;
+            if(ptr[i] == '\n') {
+                UART(0).FIFO = '\r';
+                space--;
+            }
+            UART(0).FIFO = ptr[i];
+            space--;
+        }
     }
     return len;
 }
 
-/* syscall implementation for stdio read from UART */
-__attribute__((weak)) long _read_r( struct _reent *r, int fd, char *ptr, int len )
+/* Console read from UART0. Weak so a UART driver can replace it. */
+__attribute__((weak)) long _read_stdin_r(struct _reent *r, int fd, char *ptr, int len )
 {
     int ch, i;
 
-    if(fd != r->_stdin->_file) {
-        r->_errno = EBADF;
-        return -1;
-    }
     uart_rxfifo_wait(0, 1);
     for(i = 0; i < len; i++) {
         ch = uart_getc_nowait(0);
@@ -76,32 +82,149 @@ __attribute__((weak)) long _read_r( struct _reent *r, int fd, char *ptr, int len
     return i;
 }
 
-/* Stub syscall implementations follow, to allow compiling newlib functions that
-   pull these in via various codepaths
-*/
-__attribute__((weak, alias("syscall_returns_enosys"))) 
-int _open_r(struct _reent *r, const char *pathname, int flags, int mode);
+static ssize_t console_read(struct _reent *r, void *ctx, int handle, void *buf, size_t len)
+{
+    return _read_stdin_r(r, handle, buf, len);
+}
 
-__attribute__((weak, alias("syscall_returns_enosys"))) 
-int _close_r(struct _reent *r, int fd);
+static ssize_t console_write(struct _reent *r, void *ctx, int handle, const void *buf, size_t len)
+{
+    return _write_stdout_r(r, handle, buf, len);
+}
 
-__attribute__((weak, alias("syscall_returns_enosys"))) 
-int _unlink_r(struct _reent *r, const char *path);
+static int console_fstat(struct _reent *r, void *ctx, int handle, struct stat *st)
+{
+    memset(st, 0, sizeof(struct stat));
+    st->st_mode = S_IFCHR;
+    return 0;
+}
 
-__attribute__((weak, alias("syscall_returns_enosys"))) 
-int _fstat_r(struct _reent *r, int fd, void *buf);
+const vfs_ops_t vfs_console_ops = {
+    .read = console_read,
+    .write = console_write,
+    .fstat = console_fstat,
+};
 
-__attribute__((weak, alias("syscall_returns_enosys"))) 
-int _stat_r(struct _reent *r, const char *pathname, void *buf);
+/* File descriptor syscalls, dispatched through the VFS table (see vfs.h) */
 
-__attribute__((weak, alias("syscall_returns_enosys"))) 
-off_t _lseek_r(struct _reent *r, int fd, off_t offset, int whence);
+static const vfs_ops_t *get_fd(struct _reent *r, int fd, void **ctx, int *handle)
+{
+    const vfs_ops_t *ops = vfs_fd_get(fd, ctx, handle);
+    if(!ops)
+        r->_errno = EBADF;
+    return ops;
+}
+
+__attribute__((weak)) long _write_r(struct _reent *r, int fd, const char *ptr, int len )
+{
+    void *ctx;
+    int handle;
+    const vfs_ops_t *ops = get_fd(r, fd, &ctx, &handle);
+    if(!ops)
+        return -1;
+    if(!ops->write) {
+        r->_errno = ENOTSUP;
+        return -1;
+    }
+    return ops->write(r, ctx, handle, ptr, len);
+}
 
-/* Generic stub for any newlib syscall that fails with errno ENOSYS
-   ("Function not implemented") and a return value equivalent to
-   (int)-1. */
-static int syscall_returns_enosys(struct _reent *r)
+__attribute__((weak)) long _read_r( struct _reent *r, int fd, char *ptr, int len )
+{
+    void *ctx;
+    int handle;
+    const vfs_ops_t *ops = get_fd(r, fd, &ctx, &handle);
+    if(!ops)
+        return -1;
+    if(!ops->read) {
+        r->_errno = ENOTSUP;
+        return -1;
+    }
+    return ops->read(r, ctx, handle, ptr, len);
+}
+
+__attribute__((weak)) off_t _lseek_r(struct _reent *r, int fd, off_t offset, int whence)
 {
-    r->_errno=ENOSYS;
-    return -1;
+    void *ctx;
+    int handle;
+    const vfs_ops_t *ops = get_fd(r, fd, &ctx, &handle);
+    if(!ops)
+        return -1;
+    if(!ops->lseek) {
+        r->_errno = ESPIPE;
+        return -1;
+    }
+    return ops->lseek(r, ctx, handle, offset, whence);
+}
+
+__attribute__((weak)) int _fstat_r(struct _reent *r, int fd, struct stat *st)
+{
+    void *ctx;
+    int handle;
+    const vfs_ops_t *ops = get_fd(r, fd, &ctx, &handle);
+    if(!ops)
+        return -1;
+    if(!ops->fstat) {
+        r->_errno = ENOTSUP;
+        return -1;
+    }
+    return ops->fstat(r, ctx, handle, st);
+}
+
+__attribute__((weak)) int _close_r(struct _reent *r, int fd)
+{
+    void *ctx;
+    int handle;
+    const vfs_ops_t *ops = get_fd(r, fd, &ctx, &handle);
+    if(!ops)
+        return -1;
+    vfs_fd_free(fd);
+    return ops->close ? ops->close(r, ctx, handle) : 0;
+}
+
+__attribute__((weak)) int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout)
+{
+    return vfs_select(nfds, readfds, writefds, exceptfds, timeout);
+}
+
+__attribute__((weak)) int _open_r(struct _reent *r, const char *pathname, int flags, int mode)
+{
+    void *ctx;
+    const vfs_ops_t *fs = vfs_get_mount(&ctx);
+    if(!fs || !fs->open) {
+        r->_errno = ENOENT;
+        return -1;
+    }
+    int handle = fs->open(r, ctx, pathname, flags, mode);
+    if(handle < 0)
+        return -1;
+    int fd = vfs_fd_alloc(r, fs, ctx, handle);
+    if(fd < 0 && fs->close) {
+        int err = r->_errno;
+        fs->close(r, ctx, handle);
+        r->_errno = err;
+    }
+    return fd;
+}
+
+__attribute__((weak)) int _stat_r(struct _reent *r, const char *pathname, struct stat *st)
+{
+    void *ctx;
+    const vfs_ops_t *fs = vfs_get_mount(&ctx);
+    if(!fs || !fs->stat) {
+        r->_errno = ENOENT;
+        return -1;
+    }
+    return fs->stat(r, ctx, pathname, st);
+}
+
+__attribute__((weak)) int _unlink_r(struct _reent *r, const char *path)
+{
+    void *ctx;
+    const vfs_ops_t *fs = vfs_get_mount(&ctx);
+    if(!fs || !fs->unlink) {
+        r->_errno = ENOENT;
+        return -1;
+    }
+    return fs->unlink(r, ctx, path);
 }
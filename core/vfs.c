@@ -0,0 +1,259 @@
+/* vfs.c - file descriptor table and pipes for the newlib syscalls
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <common_macros.h>
+
+#include "vfs.h"
+
+typedef struct {
+    const vfs_ops_t *ops;   /* NULL if the fd is free */
+    void *ctx;
+    int handle;
+} vfs_fd_t;
+
+static vfs_fd_t fd_table[VFS_MAX_FDS] = {
+    { &vfs_console_ops, NULL, 0 },
+    { &vfs_console_ops, NULL, 1 },
+    { &vfs_console_ops, NULL, 2 },
+};
+
+static const vfs_ops_t *mounted_fs;
+static void *mounted_ctx;
+
+int vfs_fd_alloc(struct _reent *r, const vfs_ops_t *ops, void *ctx, int handle)
+{
+    int fd = -1;
+
+    taskENTER_CRITICAL();
+    for(int i = 0; i < VFS_MAX_FDS; i++) {
+        if(!fd_table[i].ops) {
+            fd_table[i].ops = ops;
+            fd_table[i].ctx = ctx;
+            fd_table[i].handle = handle;
+            fd = i;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    if(fd < 0)
+        r->_errno = EMFILE;
+    return fd;
+}
+
+void vfs_fd_free(int fd)
+{
+    if(fd >= 0 && fd < VFS_MAX_FDS)
+        fd_table[fd].ops = NULL;
+}
+
+const vfs_ops_t *vfs_fd_get(int fd, void **ctx, int *handle)
+{
+    if(fd < 0 || fd >= VFS_MAX_FDS)
+        return NULL;
+    vfs_fd_t *entry = &fd_table[fd];
+    if(ctx)
+        *ctx = entry->ctx;
+    if(handle)
+        *handle = entry->handle;
+    return entry->ops;
+}
+
+void vfs_mount(const vfs_ops_t *ops, void *ctx)
+{
+    taskENTER_CRITICAL();
+    mounted_fs = ops;
+    mounted_ctx = ctx;
+    taskEXIT_CRITICAL();
+}
+
+const vfs_ops_t *vfs_get_mount(void **ctx)
+{
+    *ctx = mounted_ctx;
+    return mounted_fs;
+}
+
+/* Pipes */
+
+#define PIPE_READ_END  0
+#define PIPE_WRITE_END 1
+
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t head;            /* next byte to write */
+    size_t count;           /* bytes in the buffer */
+    uint8_t open_ends;      /* bit per end that is still open */
+    xSemaphoreHandle lock;
+    xSemaphoreHandle readable;  /* given when data is written */
+    xSemaphoreHandle writable;  /* given when data is read */
+} vfs_pipe_t;
+
+static void pipe_delete(vfs_pipe_t *pipe)
+{
+    if(pipe->lock)
+        vSemaphoreDelete(pipe->lock);
+    if(pipe->readable)
+        vSemaphoreDelete(pipe->readable);
+    if(pipe->writable)
+        vSemaphoreDelete(pipe->writable);
+    free(pipe->buf);
+    free(pipe);
+}
+
+static ssize_t pipe_read(struct _reent *r, void *ctx, int handle, void *buf, size_t len)
+{
+    vfs_pipe_t *pipe = ctx;
+
+    if(handle != PIPE_READ_END) {
+        r->_errno = EBADF;
+        return -1;
+    }
+    if(len == 0)
+        return 0;
+
+    for(;;) {
+        xSemaphoreTake(pipe->lock, portMAX_DELAY);
+        if(pipe->count > 0) {
+            size_t tail = (pipe->head + pipe->size - pipe->count) % pipe->size;
+            size_t n = pipe->count < len ? pipe->count : len;
+            size_t first = pipe->size - tail;
+            if(first > n)
+                first = n;
+            memcpy(buf, pipe->buf + tail, first);
+            memcpy((uint8_t *)buf + first, pipe->buf, n - first);
+            pipe->count -= n;
+            xSemaphoreGive(pipe->lock);
+            xSemaphoreGive(pipe->writable);
+            return n;
+        }
+        bool eof = !(pipe->open_ends & BIT(PIPE_WRITE_END));
+        xSemaphoreGive(pipe->lock);
+        if(eof)
+            return 0;
+        xSemaphoreTake(pipe->readable, portMAX_DELAY);
+    }
+}
+
+static ssize_t pipe_write(struct _reent *r, void *ctx, int handle, const void *buf, size_t len)
+{
+    vfs_pipe_t *pipe = ctx;
+    size_t written = 0;
+
+    if(handle != PIPE_WRITE_END) {
+        r->_errno = EBADF;
+        return -1;
+    }
+
+    while(written < len) {
+        xSemaphoreTake(pipe->lock, portMAX_DELAY);
+        if(!(pipe->open_ends & BIT(PIPE_READ_END))) {
+            xSemaphoreGive(pipe->lock);
+            if(written)
+                return written;
+            r->_errno = EPIPE;
+            return -1;
+        }
+        size_t n = pipe->size - pipe->count;
+        if(n > len - written)
+            n = len - written;
+        if(n > 0) {
+            size_t first = pipe->size - pipe->head;
+            if(first > n)
+                first = n;
+            memcpy(pipe->buf + pipe->head, (const uint8_t *)buf + written, first);
+            memcpy(pipe->buf, (const uint8_t *)buf + written + first, n - first);
+            pipe->head = (pipe->head + n) % pipe->size;
+            pipe->count += n;
+            written += n;
+        }
+        xSemaphoreGive(pipe->lock);
+        if(n > 0)
+            xSemaphoreGive(pipe->readable);
+        if(written < len)
+            xSemaphoreTake(pipe->writable, portMAX_DELAY);
+    }
+    return written;
+}
+
+static int pipe_fstat(struct _reent *r, void *ctx, int handle, struct stat *st)
+{
+    vfs_pipe_t *pipe = ctx;
+
+    memset(st, 0, sizeof(struct stat));
+    st->st_mode = S_IFIFO;
+    st->st_size = pipe->count;
+    return 0;
+}
+
+static int pipe_close(struct _reent *r, void *ctx, int handle)
+{
+    vfs_pipe_t *pipe = ctx;
+
+    xSemaphoreTake(pipe->lock, portMAX_DELAY);
+    pipe->open_ends &= ~BIT(handle);
+    bool unused = (pipe->open_ends == 0);
+    xSemaphoreGive(pipe->lock);
+
+    if(unused) {
+        pipe_delete(pipe);
+    } else {
+        /* wake up the other end so it sees EOF/EPIPE */
+        xSemaphoreGive(pipe->readable);
+        xSemaphoreGive(pipe->writable);
+    }
+    return 0;
+}
+
+static const vfs_ops_t pipe_ops = {
+    .read = pipe_read,
+    .write = pipe_write,
+    .fstat = pipe_fstat,
+    .close = pipe_close,
+};
+
+int vfs_pipe(int fds[2], size_t size)
+{
+    struct _reent *r = _REENT;
+    vfs_pipe_t *pipe = calloc(1, sizeof(vfs_pipe_t));
+
+    if(!pipe || size == 0 || !(pipe->buf = malloc(size)))
+        goto nomem;
+    pipe->size = size;
+    pipe->open_ends = BIT(PIPE_READ_END) | BIT(PIPE_WRITE_END);
+    pipe->lock = xSemaphoreCreateMutex();
+    vSemaphoreCreateBinary(pipe->readable);
+    vSemaphoreCreateBinary(pipe->writable);
+    if(!pipe->lock || !pipe->readable || !pipe->writable)
+        goto nomem;
+    /* binary semaphores are created 'given' */
+    xSemaphoreTake(pipe->readable, 0);
+    xSemaphoreTake(pipe->writable, 0);
+
+    fds[0] = vfs_fd_alloc(r, &pipe_ops, pipe, PIPE_READ_END);
+    if(fds[0] < 0) {
+        pipe_delete(pipe);
+        return -1;
+    }
+    fds[1] = vfs_fd_alloc(r, &pipe_ops, pipe, PIPE_WRITE_END);
+    if(fds[1] < 0) {
+        vfs_fd_free(fds[0]);
+        pipe_delete(pipe);
+        return -1;
+    }
+    return 0;
+
+ nomem:
+    if(pipe)
+        pipe_delete(pipe);
+    r->_errno = (size == 0) ? EINVAL : ENOMEM;
+    return -1;
+}
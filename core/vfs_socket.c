@@ -0,0 +1,115 @@
+/* vfs_socket.c - file descriptors for lwIP sockets
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <errno.h>
+#include <stdbool.h>
+#include <string.h>
+#include <lwip/sockets.h>
+
+#include "vfs.h"
+
+static ssize_t socket_read(struct _reent *r, void *ctx, int handle, void *buf, size_t len)
+{
+    int res = lwip_read(handle, buf, len);
+    if(res < 0)
+        r->_errno = errno;
+    return res;
+}
+
+static ssize_t socket_write(struct _reent *r, void *ctx, int handle, const void *buf, size_t len)
+{
+    int res = lwip_write(handle, buf, len);
+    if(res < 0)
+        r->_errno = errno;
+    return res;
+}
+
+static int socket_fstat(struct _reent *r, void *ctx, int handle, struct stat *st)
+{
+    memset(st, 0, sizeof(struct stat));
+    st->st_mode = S_IFSOCK;
+    return 0;
+}
+
+static int socket_close(struct _reent *r, void *ctx, int handle)
+{
+    int res = lwip_close(handle);
+    if(res < 0)
+        r->_errno = errno;
+    return res;
+}
+
+static const vfs_ops_t socket_ops = {
+    .read = socket_read,
+    .write = socket_write,
+    .fstat = socket_fstat,
+    .close = socket_close,
+};
+
+int vfs_socket(int sock)
+{
+    if(sock < 0) {
+        errno = EBADF;
+        return -1;
+    }
+    return vfs_fd_alloc(_REENT, &socket_ops, NULL, sock);
+}
+
+int vfs_select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, struct timeval *timeout)
+{
+    fd_set sock_read, sock_write, sock_except;
+    int lwip_nfds = 0, ready = 0;
+
+    FD_ZERO(&sock_read);
+    FD_ZERO(&sock_write);
+    FD_ZERO(&sock_except);
+
+    /* sockets are waited on by their lwIP number, everything else
+       (files, pipes, the console) never blocks select() */
+    for(int fd = 0; fd < nfds; fd++) {
+        bool rd = readfds && FD_ISSET(fd, readfds);
+        bool wr = writefds && FD_ISSET(fd, writefds);
+        bool ex = exceptfds && FD_ISSET(fd, exceptfds);
+        if(!rd && !wr && !ex)
+            continue;
+        int handle;
+        const vfs_ops_t *ops = vfs_fd_get(fd, NULL, &handle);
+        if(!ops) {
+            errno = EBADF;
+            return -1;
+        }
+        if(ops == &socket_ops) {
+            if(rd)
+                FD_SET(handle, &sock_read);
+            if(wr)
+                FD_SET(handle, &sock_write);
+            if(ex)
+                FD_SET(handle, &sock_except);
+            if(handle >= lwip_nfds)
+                lwip_nfds = handle + 1;
+        } else {
+            ready += rd + wr;
+        }
+    }
+
+    struct timeval poll = { 0, 0 };
+    int res = lwip_select(lwip_nfds, &sock_read, &sock_write, &sock_except,
+                          ready ? &poll : timeout);
+    if(res < 0)
+        return -1;
+
+    for(int fd = 0; fd < nfds; fd++) {
+        int handle;
+        const vfs_ops_t *ops = vfs_fd_get(fd, NULL, &handle);
+        bool sock = ops == &socket_ops;
+        if(readfds && FD_ISSET(fd, readfds) && sock && !FD_ISSET(handle, &sock_read))
+            FD_CLR(fd, readfds);
+        if(writefds && FD_ISSET(fd, writefds) && sock && !FD_ISSET(handle, &sock_write))
+            FD_CLR(fd, writefds);
+        if(exceptfds && FD_ISSET(fd, exceptfds) && !(sock && FD_ISSET(handle, &sock_except)))
+            FD_CLR(fd, exceptfds);
+    }
+    return ready + res;
+}
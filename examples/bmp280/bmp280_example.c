@@ -16,6 +16,8 @@
 const uint8_t scl_pin = 0;
 const uint8_t sda_pin = 2;
 
+static i2c_bus_t i2c_bus;
+
 #ifdef MODE_FORCED
 static void bmp280_task_forced(void *pvParameters)
 {
@@ -29,7 +31,7 @@ static void bmp280_task_forced(void *pvParameters)
     bmp280_dev.i2c_addr = BMP280_I2C_ADDRESS_0;
 
     while (1) {
-        while (!bmp280_init(&bmp280_dev, &params)) {
+        while (!bmp280_init_bus(&bmp280_dev, &i2c_bus, &params)) {
             printf("BMP280 initialization failed\n");
             vTaskDelay(1000 / portTICK_RATE_MS);
         }
@@ -70,7 +72,7 @@ static void bmp280_task_normal(void *pvParameters)
     bmp280_dev.i2c_addr = BMP280_I2C_ADDRESS_0;
 
     while (1) {
-        while (!bmp280_init(&bmp280_dev, &params)) {
+        while (!bmp280_init_bus(&bmp280_dev, &i2c_bus, &params)) {
             printf("BMP280 initialization failed\n");
             vTaskDelay(1000 / portTICK_RATE_MS);
         }
@@ -103,7 +105,7 @@ void user_init(void)
     printf("SDK version : %s\n", sdk_system_get_sdk_version());
     printf("GIT version : %s\n", GITSHORTREV);
 
-    i2c_init(scl_pin, sda_pin);
+    i2c_bus_init(&i2c_bus, scl_pin, sda_pin, I2C_FREQ_400K);
 
 #ifdef MODE_FORCED
     xTaskCreate(bmp280_task_forced, (signed char *)"bmp280_task", 256, NULL, 2, NULL);
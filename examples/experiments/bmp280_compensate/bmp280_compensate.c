@@ -0,0 +1,86 @@
+/* Cycle counts of the BMP280 pressure compensation on the ESP8266.
+ *
+ * Times the 64-bit compensate_pressure() and the 32-bit
+ * compensate_pressure_fast() of extras/bmp280 on readings spread over the
+ * sensor's operating range, using the datasheet's calibration data, so no
+ * sensor is needed. The driver is compiled in here to get at its static
+ * functions, don't link the bmp280 component as well.
+ *
+ * extras/bmp280/test has the host test and benchmark of the same code.
+ */
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "bmp280/bmp280.c"
+
+#define READINGS 64
+#define REPEATS 100
+
+static int32_t adc_p[READINGS], fine_temp[READINGS];
+static volatile uint32_t sink;
+
+static inline uint32_t get_ccount(void)
+{
+    uint32_t ccount;
+    asm volatile ("rsr.ccount %0" : "=a" (ccount));
+    return ccount;
+}
+
+static uint32_t pressure_64(bmp280_t *c, int32_t adc, int32_t fine)
+{
+    return compensate_pressure(c, adc, fine);
+}
+
+static uint32_t pressure_fast(bmp280_t *c, int32_t adc, int32_t fine)
+{
+    return compensate_pressure_fast(c, adc, fine);
+}
+
+static uint32_t run(bmp280_t *c, uint32_t (*volatile fn)(bmp280_t *, int32_t, int32_t))
+{
+    uint32_t acc = 0;
+
+    vPortEnterCritical();
+    uint32_t before = get_ccount();
+    for (int r = 0; r < REPEATS; r++) {
+        for (int i = 0; i < READINGS; i++) {
+            acc += fn(c, adc_p[i], fine_temp[i]);
+        }
+    }
+    uint32_t after = get_ccount();
+    vPortExitCritical();
+    sink = acc;
+    return (after - before) / (REPEATS * READINGS);
+}
+
+static void bench_task(void *arg)
+{
+    bmp280_t c = {
+        .dig_T1 = 27504, .dig_T2 = 26435, .dig_T3 = -1000,
+        .dig_P1 = 36477, .dig_P2 = -10685, .dig_P3 = 3024, .dig_P4 = 2855,
+        .dig_P5 = 140, .dig_P6 = -7, .dig_P7 = 15500, .dig_P8 = -14600, .dig_P9 = 6000,
+    };
+    uint32_t seed = 1;
+
+    /* -40..85C and roughly 300..1100hPa */
+    for (int i = 0; i < READINGS; i++) {
+        seed = seed * 1103515245 + 12345;
+        compensate_temperature(&c, 350000 + (seed >> 8) % 300000, &fine_temp[i]);
+        seed = seed * 1103515245 + 12345;
+        adc_p[i] = 150000 + (seed >> 8) % 650000;
+    }
+
+    for (;;) {
+        printf("CPU %dMHz, cycles per call: compensate_pressure %u, compensate_pressure_fast %u\n",
+               sdk_system_get_cpu_freq(), run(&c, pressure_64), run(&c, pressure_fast));
+        vTaskDelay(5000 / portTICK_RATE_MS);
+    }
+}
+
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+    xTaskCreate(bench_task, (signed char *)"bench", 512, NULL, 2, NULL);
+}
@@ -19,7 +19,6 @@
  */
 #include "esp/uart.h"
 #include "FreeRTOS.h"
-#include "queue.h"
 #include "task.h"
 #include "esp8266.h"
 
@@ -44,88 +43,23 @@ typedef struct __attribute__((packed)) {
     uint8_t data[];
 } dumb_wav_header_t;
 
-// When samples are not sent fast enough underrun condition occurs
-volatile uint32_t underrun_counter = 0;
-
 #define DMA_BUFFER_SIZE         2048
 #define DMA_QUEUE_SIZE          8
 
-// Circular list of descriptors
-static dma_descriptor_t dma_block_list[DMA_QUEUE_SIZE];
-
-// Array of buffers for circular list of descriptors
-static uint8_t dma_buffer[DMA_QUEUE_SIZE][DMA_BUFFER_SIZE];
-
-// Queue of empty DMA blocks
-static xQueueHandle dma_queue;
-
-/**
- * Create a circular list of DMA descriptors
- */
-static inline void init_descriptors_list()
-{
-    memset(dma_buffer, 0, DMA_QUEUE_SIZE * DMA_BUFFER_SIZE);
-
-    for (int i = 0; i < DMA_QUEUE_SIZE; i++) {
-        dma_block_list[i].owner = 1;
-        dma_block_list[i].eof = 1;
-        dma_block_list[i].sub_sof = 0;
-        dma_block_list[i].unused = 0;
-        dma_block_list[i].buf_ptr = dma_buffer[i];
-        dma_block_list[i].datalen = DMA_BUFFER_SIZE;
-        dma_block_list[i].blocksize = DMA_BUFFER_SIZE;
-        if (i == (DMA_QUEUE_SIZE - 1)) {
-            dma_block_list[i].next_link_ptr = &dma_block_list[0];
-        } else {
-            dma_block_list[i].next_link_ptr = &dma_block_list[i + 1];
-        }
-    }
-
-    // The queue depth is one smaller than the amount of buffers we have,
-    // because there's always a buffer that is being used by the DMA subsystem
-    // *right now* and we don't want to be able to write to that simultaneously
-    dma_queue = xQueueCreate(DMA_QUEUE_SIZE - 1, sizeof(uint8_t*));
-}
-
-// DMA interrupt handler. It is called each time a DMA block is finished processing.
-static void dma_isr_handler(void)
-{
-    portBASE_TYPE task_awoken = pdFALSE;
-
-    if (i2s_dma_is_eof_interrupt()) {
-        dma_descriptor_t *descr = i2s_dma_get_eof_descriptor();
-
-        if (xQueueIsQueueFullFromISR(dma_queue)) {
-            // List of empty blocks is full. Sender don't send data fast enough.
-            int dummy;
-            underrun_counter++;
-            // Discard top of the queue
-            xQueueReceiveFromISR(dma_queue, &dummy, &task_awoken);
-        }
-        // Push the processed buffer to the queue so sender can refill it.
-        xQueueSendFromISR(dma_queue, (void*)(&descr->buf_ptr), &task_awoken);
-    }
-    i2s_dma_clear_interrupt();
-
-    portEND_SWITCHING_ISR(task_awoken);
-}
-
 static bool play_data(int fd)
 {
-    uint8_t *curr_dma_buf;
+    uint8_t buf[512];
 
-    // Get a free block from the DMA queue. This call will suspend the task
-    // until a free block is available in the queue.
-    if (xQueueReceive(dma_queue, &curr_dma_buf, portMAX_DELAY) == pdFALSE) {
-        // Or timeout occurs
-        printf("Cound't get free blocks to push data\n");
-    }
-
-    int read_bytes = read(fd, curr_dma_buf, DMA_BUFFER_SIZE);
+    int read_bytes = read(fd, buf, sizeof(buf));
     if (read_bytes <= 0) {
         return false;
     }
 
+    // This call will suspend the task until there is space in the DMA ring
+    if (i2s_dma_write(buf, read_bytes, portMAX_DELAY) != read_bytes) {
+        printf("Cound't push data\n");
+    }
+
     return true;
 }
 
@@ -160,28 +94,32 @@ void play_task(void *pvParameters)
         return;
     }
 
-    i2s_clock_div_t clock_div = i2s_get_clock_div(
-            wav_header.sample_rate * 2 * 16);
+    i2s_clock_div_t clock_div = i2s_get_sample_rate_div(wav_header.sample_rate);
 
-    printf("i2s clock dividers, bclk=%d, clkm=%d\n",
-            clock_div.bclk_div, clock_div.clkm_div);
+    printf("i2s clock dividers, bclk=%d, clkm=%d, sample rate %d\n",
+            clock_div.bclk_div, clock_div.clkm_div, i2s_get_sample_rate(clock_div));
 
     i2s_pins_t i2s_pins = {.data = true, .clock = true, .ws = true};
 
-    i2s_dma_init(dma_isr_handler, clock_div, i2s_pins);
+    if (!i2s_dma_stream_init(clock_div, i2s_pins, DMA_BUFFER_SIZE, DMA_QUEUE_SIZE)) {
+        printf("Not enough memory for DMA buffers\n");
+        return;
+    }
 
     while (1) {
-        init_descriptors_list();
-
-        i2s_dma_start(dma_block_list);
         lseek(fd, sizeof(dumb_wav_header_t), SEEK_SET);
 
         while (play_data(fd)) {};
-        i2s_dma_stop();
+        i2s_dma_flush();
+
+        i2s_dma_stats_t stats;
+        i2s_dma_get_stats(&stats, true);
 
-        vQueueDelete(dma_queue);
+        // Let the last blocks play out
+        vTaskDelay(DMA_QUEUE_SIZE * DMA_BUFFER_SIZE / (wav_header.sample_rate * 4 / 1000) / portTICK_RATE_MS);
+        i2s_dma_stream_stop();
 
-        printf("underrun counter: %d\n", underrun_counter);
+        printf("blocks played: %d, underruns: %d\n", stats.blocks, stats.underruns);
 
         vTaskDelay(1000 / portTICK_RATE_MS);
     }
@@ -0,0 +1,189 @@
+/* mbedtls_benchmark - time the public key operations of a TLS handshake.
+ *
+ * Reports CPU cycles and milliseconds for ECDHE key exchange on P-256 and
+ * Curve25519, both on a newly loaded group as in a handshake and on one
+ * whose fixed-point table is already built, and RSA-2048 public/private
+ * key operations, so the mbedtls configuration can be compared. Build with
+ * MBEDTLS_PROFILE=fast to try the performance profile (see
+ * extras/mbedtls/include/mbedtls/config.h).
+ *
+ * This sample code is in the public domain.
+ */
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "xtensa_ops.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#include "mbedtls/config.h"
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/rsa.h"
+#include "mbedtls/certs.h"
+
+#define ROUNDS 3
+
+static mbedtls_ctr_drbg_context ctr_drbg;
+
+static inline uint32_t get_ccount(void)
+{
+    uint32_t ccount;
+    RSR(ccount, ccount);
+    return ccount;
+}
+
+static void report(const char *name, uint32_t cycles, int rounds)
+{
+    printf("%-36s %10u cycles %6u ms\n", name, cycles / rounds,
+           cycles / rounds / (sdk_system_get_cpu_freq() * 1000));
+}
+
+/* One side of an ECDHE key exchange: generate a key pair and compute the
+   shared secret with the peer's public key. */
+static int ecdh_exchange(mbedtls_ecp_group *grp, const mbedtls_ecp_point *peer_Q, uint32_t *cycles)
+{
+    mbedtls_mpi d, z;
+    mbedtls_ecp_point Q;
+    int ret;
+
+    mbedtls_mpi_init(&d);
+    mbedtls_mpi_init(&z);
+    mbedtls_ecp_point_init(&Q);
+    uint32_t start = get_ccount();
+    ret = mbedtls_ecdh_gen_public(grp, &d, &Q, mbedtls_ctr_drbg_random, &ctr_drbg);
+    if (!ret)
+        ret = mbedtls_ecdh_compute_shared(grp, &z, peer_Q, &d,
+                                          mbedtls_ctr_drbg_random, &ctr_drbg);
+    *cycles += get_ccount() - start;
+    mbedtls_mpi_free(&d);
+    mbedtls_mpi_free(&z);
+    mbedtls_ecp_point_free(&Q);
+    return ret;
+}
+
+/* With MBEDTLS_ECP_FIXED_POINT_OPTIM the first multiplication of the
+   generator builds a comb table in the group, which later ones reuse.
+   A TLS handshake loads the group afresh, so pays for the table every
+   time: "new group" is what a handshake costs, "table built" the cost
+   with the table already there, and the difference the table itself. */
+static void bench_ecdh(const char *name, mbedtls_ecp_group_id id)
+{
+    mbedtls_ecp_group grp, peer_grp;
+    mbedtls_ecp_point peer_Q;
+    mbedtls_mpi peer_d;
+    uint32_t fresh_cycles = 0, cycles = 0;
+    char label[40];
+    int ret;
+
+    mbedtls_ecp_group_init(&peer_grp);
+    mbedtls_ecp_point_init(&peer_Q);
+    mbedtls_mpi_init(&peer_d);
+    ret = mbedtls_ecp_group_load(&peer_grp, id);
+    if (!ret)
+        ret = mbedtls_ecdh_gen_public(&peer_grp, &peer_d, &peer_Q,
+                                      mbedtls_ctr_drbg_random, &ctr_drbg);
+
+    for (int i = 0; i < ROUNDS && !ret; i++) {
+        mbedtls_ecp_group_init(&grp);
+        ret = mbedtls_ecp_group_load(&grp, id);
+        if (!ret)
+            ret = ecdh_exchange(&grp, &peer_Q, &fresh_cycles);
+        /* grp now has the table (if enabled) */
+        if (!ret)
+            ret = ecdh_exchange(&grp, &peer_Q, &cycles);
+        mbedtls_ecp_group_free(&grp);
+        taskYIELD();
+    }
+
+    if (ret) {
+        printf("%s failed: -0x%x\n", name, -ret);
+    } else {
+        snprintf(label, sizeof(label), "%s, new group", name);
+        report(label, fresh_cycles, ROUNDS);
+        snprintf(label, sizeof(label), "%s, table built", name);
+        report(label, cycles, ROUNDS);
+    }
+    mbedtls_ecp_group_free(&peer_grp);
+    mbedtls_ecp_point_free(&peer_Q);
+    mbedtls_mpi_free(&peer_d);
+}
+
+static void bench_rsa(void)
+{
+    mbedtls_pk_context pk;
+    unsigned char in[256], out[256];
+    uint32_t pub_cycles = 0, priv_cycles = 0;
+    int ret;
+
+    mbedtls_pk_init(&pk);
+    ret = mbedtls_pk_parse_key(&pk, (const unsigned char *)mbedtls_test_srv_key,
+                               mbedtls_test_srv_key_len, NULL, 0);
+    if (ret || mbedtls_pk_get_type(&pk) != MBEDTLS_PK_RSA) {
+        printf("RSA key parse failed: -0x%x\n", -ret);
+        return;
+    }
+    mbedtls_rsa_context *rsa = mbedtls_pk_rsa(pk);
+    char name[32];
+    snprintf(name, sizeof(name), "RSA-%u public", (unsigned)mbedtls_pk_get_bitlen(&pk));
+
+    memset(in, 0x5a, sizeof(in));
+    in[0] = 0;
+    for (int i = 0; i < ROUNDS && !ret; i++) {
+        uint32_t start = get_ccount();
+        ret = mbedtls_rsa_public(rsa, in, out);
+        pub_cycles += get_ccount() - start;
+
+        start = get_ccount();
+        if (!ret)
+            ret = mbedtls_rsa_private(rsa, mbedtls_ctr_drbg_random, &ctr_drbg, in, out);
+        priv_cycles += get_ccount() - start;
+        taskYIELD();
+    }
+    if (ret) {
+        printf("RSA failed: -0x%x\n", -ret);
+    } else {
+        report(name, pub_cycles, ROUNDS);
+        name[strlen(name) - strlen("public")] = 0;
+        strcat(name, "private");
+        report(name, priv_cycles, ROUNDS);
+    }
+    mbedtls_pk_free(&pk);
+}
+
+void benchmark_task(void *pvParameters)
+{
+    mbedtls_entropy_context entropy;
+    const char *pers = "benchmark";
+
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+    if (mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
+                              (const unsigned char *)pers, strlen(pers)) != 0) {
+        printf("mbedtls_ctr_drbg_seed failed\n");
+        vTaskDelete(NULL);
+    }
+
+    while (1) {
+        printf("\nMPI window %d, ECP window %d, fixed point %d, free heap %u\n",
+               MBEDTLS_MPI_WINDOW_SIZE, MBEDTLS_ECP_WINDOW_SIZE,
+               MBEDTLS_ECP_FIXED_POINT_OPTIM, xPortGetFreeHeapSize());
+        bench_ecdh("ECDHE P-256", MBEDTLS_ECP_DP_SECP256R1);
+        bench_ecdh("ECDHE Curve25519", MBEDTLS_ECP_DP_CURVE25519);
+        bench_rsa();
+        vTaskDelay(10000 / portTICK_RATE_MS);
+    }
+}
+
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+    printf("SDK version:%s\n", sdk_system_get_sdk_version());
+
+    /* public key operations need a lot of stack */
+    xTaskCreate(&benchmark_task, (signed char *)"benchmark", 2048, NULL, 2, NULL);
+}
@@ -34,32 +34,25 @@ static const char *FIRMWARE1_SHA256 = "88199daff8b9e76975f685ec7f95bc1df3c61bd94
 static void tftpclient_download_and_verify_file1(int slot, rboot_config *conf)
 {
     printf("Downloading %s to slot %d...\n", TFTP_IMAGE_FILENAME1, slot);
-    int res = ota_tftp_download(TFTP_IMAGE_SERVER, TFTP_PORT+1, TFTP_IMAGE_FILENAME1, 1000, slot, NULL);
-    printf("ota_tftp_download %s result %d\n", TFTP_IMAGE_FILENAME1, res);
-
-    if (res != 0) {
-        return;
-    }
-
-    printf("Looks valid, calculating SHA256...\n");
-    uint32_t length;
-    bool valid = rboot_verify_image(conf->roms[slot], &length, NULL);
+    /* The SHA256 is calculated as the image is received, so it doesn't
+       need to be read back from flash afterwards. */
     static mbedtls_sha256_context ctx;
     mbedtls_sha256_init(&ctx);
     mbedtls_sha256_starts(&ctx, 0);
-    valid = valid && rboot_digest_image(conf->roms[slot], length, (rboot_digest_update_fn)mbedtls_sha256_update, &ctx);
+    int res = ota_tftp_download_digest(TFTP_IMAGE_SERVER, TFTP_PORT+1, TFTP_IMAGE_FILENAME1, 1000, slot, NULL,
+                                       (rboot_digest_update_fn)mbedtls_sha256_update, &ctx);
+    printf("ota_tftp_download %s result %d\n", TFTP_IMAGE_FILENAME1, res);
+
     static uint8_t hash_result[32];
     mbedtls_sha256_finish(&ctx, hash_result);
     mbedtls_sha256_free(&ctx);
 
-    if(!valid)
-    {
-        printf("Not valid after all :(\n");
+    if (res != 0) {
         return;
     }
 
     printf("Image SHA256 = ");
-    valid = true;
+    bool valid = true;
     for(int i = 0; i < sizeof(hash_result); i++) {
         char hexbuf[3];
         snprintf(hexbuf, 3, "%02x", hash_result[i]);
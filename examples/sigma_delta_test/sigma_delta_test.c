@@ -0,0 +1,92 @@
+/* Fade an LED with the sigma-delta modulator, and compare the CPU time
+ * left for tasks with that left while extras/pwm dims the same LED.
+ *
+ * Hook up an LED to GPIO14.
+ *
+ * What to expect: the modulator runs in hardware without interrupts, so
+ * the loop count stays within about 1% of idle. extras/pwm takes two FRC1
+ * interrupts per period, 20000 a second at 10kHz. Their cost is printed in
+ * CPU cycles per interrupt, the handler plus the interrupt entry and exit;
+ * at 80MHz each 40 cycles per interrupt take 1% of the CPU.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include "espressif/esp_common.h"
+#include "esp/uart.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "pwm.h"
+#include "sigma_delta/sigma_delta.h"
+
+#define LED_PIN 14
+#define PWM_FREQ 10000
+
+/* Count loop iterations for one second. Interrupt handlers (and higher
+   priority tasks) take time away from the loop, so the count drops with
+   interrupt load. */
+static uint32_t spin_count(void)
+{
+    uint32_t count = 0;
+    portTickType end;
+
+    vTaskDelay(1);
+    end = xTaskGetTickCount() + 1000 / portTICK_RATE_MS;
+    while ((int32_t)(xTaskGetTickCount() - end) < 0) {
+        count++;
+    }
+    return count;
+}
+
+/* Print the count relative to idle. If the difference is down to
+   'interrupts' interrupts a second, also print what each one costs. */
+static void report(const char *name, uint32_t count, uint32_t idle,
+                   uint32_t interrupts)
+{
+    printf("%-28s %8u loops, %3u%% of idle", name, count, count * 100 / idle);
+    if (interrupts && count < idle) {
+        uint64_t cycles = (uint64_t)(idle - count) * sdk_system_get_cpu_freq() * 1000000;
+        printf(", %u cycles per interrupt", (uint32_t)(cycles / idle / interrupts));
+    }
+    printf("\n");
+}
+
+static void bench_task(void *pvParameters)
+{
+    uint8_t pins[1] = { LED_PIN };
+    uint32_t idle, count;
+
+    idle = spin_count();
+    report("nothing running", idle, idle, 0);
+
+    pwm_init(1, pins);
+    pwm_set_freq(PWM_FREQ);
+    pwm_set_duty(UINT16_MAX / 2);
+    pwm_start();
+    count = spin_count();
+    pwm_stop();
+    report("pwm, 10kHz", count, idle, 2 * PWM_FREQ);
+
+    sigma_delta_init(1, pins);
+    sigma_delta_set_duty(UINT16_MAX / 2);
+    sigma_delta_start();
+    count = spin_count();
+    report("sigma-delta", count, idle, 0);
+
+    while (1) {
+        for (uint32_t duty = 0; duty <= UINT16_MAX; duty += 256) {
+            sigma_delta_set_duty(duty);
+            vTaskDelay(10 / portTICK_RATE_MS);
+        }
+        sigma_delta_set_duty(UINT16_MAX);
+        vTaskDelay(500 / portTICK_RATE_MS);
+    }
+}
+
+void user_init(void)
+{
+    uart_set_baud(0, 115200);
+    printf("SDK version:%s\n", sdk_system_get_sdk_version());
+
+    xTaskCreate(bench_task, (signed char *)"bench", 256, NULL, 2, NULL);
+}
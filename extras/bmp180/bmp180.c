@@ -39,33 +39,52 @@
 //
 #define BMP180_RESET_VALUE        0xB6
 
+// NULL is the bus set up by i2c_init()
+static i2c_bus_t *bmp180_bus;
+
+void bmp180_set_bus(i2c_bus_t *bus)
+{
+    bmp180_bus = bus;
+}
+
+static bool bmp180_readRegisters(uint8_t reg, uint8_t *d, uint8_t len)
+{
+    return i2c_bus_read_regs(bmp180_bus, BMP180_DEVICE_ADDRESS, reg, d, len);
+}
+
+static inline int16_t be16(const uint8_t *d)
+{
+    return ((int16_t)d[0] << 8) | (d[1]);
+}
+
 static bool bmp180_readRegister16(uint8_t reg, int16_t *r)
 {
     uint8_t d[] = { 0, 0 };
 
-    if (!i2c_slave_read(BMP180_DEVICE_ADDRESS, reg, d, 2))
+    if (!bmp180_readRegisters(reg, d, 2))
         return false;
 
-    *r = ((int16_t)d[0] << 8) | (d[1]);
+    *r = be16(d);
     return true;
 }
 
 static bool bmp180_start_Messurement(uint8_t cmd)
 {
-    uint8_t d[] = { BMP180_CONTROL_REG, cmd };
-
-    return i2c_slave_write(BMP180_DEVICE_ADDRESS, d, 2);
+    return i2c_bus_write_regs(bmp180_bus, BMP180_DEVICE_ADDRESS, BMP180_CONTROL_REG, &cmd, 1);
 }
 
-static bool bmp180_get_uncompensated_temperature(int32_t *ut)
+uint32_t bmp180_start_temperature(void)
 {
     // Write Start Code into reg 0xF4.
     if (!bmp180_start_Messurement(BMP180_MEASURE_TEMP))
-        return false;
+        return 0;
 
     // Wait 5ms, datasheet states 4.5ms
-    sdk_os_delay_us(5000);
+    return 5000;
+}
 
+bool bmp180_read_raw_temperature(int32_t *ut)
+{
     int16_t v;
     if (!bmp180_readRegister16(BMP180_OUT_MSB_REG, &v))
         return false;
@@ -74,51 +93,76 @@ static bool bmp180_get_uncompensated_temperature(int32_t *ut)
     return true;
 }
 
-static bool bmp180_get_uncompensated_pressure(uint8_t oss, uint32_t *up)
+static inline uint8_t bmp180_limit_oss(uint8_t oss)
 {
-    uint16_t us;
-
-    // Limit oss and set the measurement wait time. The datasheet
-    // states 4.5, 7.5, 13.5, 25.5ms for oss 0 to 3.
-    switch (oss) {
-      case 0: us = 5000; break;
-      case 1: us = 8000; break;
-      case 2: us = 14000; break;
-      default: oss = 3; us = 26000; break;
-    }
+    return oss > 3 ? 3 : oss;
+}
+
+uint32_t bmp180_start_pressure(uint8_t oss)
+{
+    oss = bmp180_limit_oss(oss);
 
     // Write Start Code into reg 0xF4
     if (!bmp180_start_Messurement(BMP180_MEASURE_PRESS | (oss << 6)))
-        return false;
+        return 0;
 
-    sdk_os_delay_us(us);
+    // The datasheet states 4.5, 7.5, 13.5, 25.5ms for oss 0 to 3.
+    static const uint16_t us[] = { 5000, 8000, 14000, 26000 };
+    return us[oss];
+}
 
+bool bmp180_read_raw_pressure(uint8_t oss, uint32_t *up)
+{
     uint8_t d[] = { 0, 0, 0 };
-    if (!i2c_slave_read(BMP180_DEVICE_ADDRESS, BMP180_OUT_MSB_REG, d, 3))
+    if (!bmp180_readRegisters(BMP180_OUT_MSB_REG, d, 3))
         return false;
 
     uint32_t r = ((uint32_t)d[0] << 16) | ((uint32_t)d[1] << 8) | d[2];
-    r >>= 8 - oss;
+    r >>= 8 - bmp180_limit_oss(oss);
     *up = r;
     return true;
 }
 
+static bool bmp180_get_uncompensated_temperature(int32_t *ut)
+{
+    uint32_t us = bmp180_start_temperature();
+    if (!us)
+        return false;
+
+    sdk_os_delay_us(us);
+    return bmp180_read_raw_temperature(ut);
+}
+
+static bool bmp180_get_uncompensated_pressure(uint8_t oss, uint32_t *up)
+{
+    uint32_t us = bmp180_start_pressure(oss);
+    if (!us)
+        return false;
+
+    sdk_os_delay_us(us);
+    return bmp180_read_raw_pressure(oss, up);
+}
+
 // Returns true of success else false.
 bool bmp180_fillInternalConstants(bmp180_constants_t *c)
 {
-    if (!bmp180_readRegister16(BMP180_CALIBRATION_REG+0, &c->AC1) ||
-        !bmp180_readRegister16(BMP180_CALIBRATION_REG+2, &c->AC2) ||
-        !bmp180_readRegister16(BMP180_CALIBRATION_REG+4, &c->AC3) ||
-        !bmp180_readRegister16(BMP180_CALIBRATION_REG+6, (int16_t *)&c->AC4) ||
-        !bmp180_readRegister16(BMP180_CALIBRATION_REG+8, (int16_t *)&c->AC5) ||
-        !bmp180_readRegister16(BMP180_CALIBRATION_REG+10, (int16_t *)&c->AC6) ||
-        !bmp180_readRegister16(BMP180_CALIBRATION_REG+12, &c->B1) ||
-        !bmp180_readRegister16(BMP180_CALIBRATION_REG+14, &c->B2) ||
-        !bmp180_readRegister16(BMP180_CALIBRATION_REG+16, &c->MB) ||
-        !bmp180_readRegister16(BMP180_CALIBRATION_REG+18, &c->MC) ||
-        !bmp180_readRegister16(BMP180_CALIBRATION_REG+20, &c->MD)) {
+    uint8_t d[22];
+
+    // All 11 constants in one transfer
+    if (!bmp180_readRegisters(BMP180_CALIBRATION_REG, d, sizeof(d)))
         return false;
-    }
+
+    c->AC1 = be16(d);
+    c->AC2 = be16(d + 2);
+    c->AC3 = be16(d + 4);
+    c->AC4 = be16(d + 6);
+    c->AC5 = be16(d + 8);
+    c->AC6 = be16(d + 10);
+    c->B1 = be16(d + 12);
+    c->B2 = be16(d + 14);
+    c->MB = be16(d + 16);
+    c->MC = be16(d + 18);
+    c->MD = be16(d + 20);
 
 #ifdef BMP180_DEBUG
     printf("%s: AC1:=%d AC2:=%d AC3:=%d AC4:=%u AC5:=%u AC6:=%u \n", __FUNCTION__, c->AC1, c->AC2, c->AC3, c->AC4, c->AC5, c->AC6);
@@ -140,24 +184,19 @@ bool bmp180_fillInternalConstants(bmp180_constants_t *c)
 bool bmp180_is_available()
 {
     uint8_t id;
-    return i2c_slave_read(BMP180_DEVICE_ADDRESS, BMP180_VERSION_REG, &id, 1) &&
+    return bmp180_readRegisters(BMP180_VERSION_REG, &id, 1) &&
         id == BMP180_CHIP_ID;
 }
 
-bool bmp180_measure(bmp180_constants_t *c, int32_t *temperature,
-                    uint32_t *pressure, uint8_t oss)
+void bmp180_compensate(bmp180_constants_t *c, int32_t UT, uint32_t UP,
+                       uint8_t oss, int32_t *temperature, uint32_t *pressure)
 {
     int32_t T, P;
 
-    if (!temperature && !pressure)
-        return false;
+    oss = bmp180_limit_oss(oss);
 
-    // Temperature is always needed, allso required for pressure only.
-    //
     // Calculation taken from BMP180 Datasheet
-    int32_t UT, X1, X2, B5;
-    if (!bmp180_get_uncompensated_temperature(&UT))
-        return false;
+    int32_t X1, X2, B5;
 
     X1 = ((UT - (int32_t)c->AC6) * (int32_t)c->AC5) >> 15;
     X2 = ((int32_t)c->MC << 11) / (X1 + (int32_t)c->MD);
@@ -171,10 +210,7 @@ bool bmp180_measure(bmp180_constants_t *c, int32_t *temperature,
 
     if (pressure) {
         int32_t X3, B3, B6;
-        uint32_t B4, B7, UP;
-
-        if (!bmp180_get_uncompensated_pressure(oss, &UP))
-            return false;
+        uint32_t B4, B7;
 
         // Calculation taken from BMP180 Datasheet
         B6 = B5 - 4000;
@@ -199,16 +235,34 @@ bool bmp180_measure(bmp180_constants_t *c, int32_t *temperature,
         X1 = (X1 * 3038) >> 16;
         X2 = (-7357 * P) >> 16;
         P = P + ((X1 + X2 + (int32_t)3791) >> 4);
-        if (pressure)
-            *pressure = P;
+        *pressure = P;
 #ifdef BMP180_DEBUG
         printf("%s: P:= %ld\n", __FUNCTION__, P);
 #endif
     }
+}
+
+bool bmp180_measure(bmp180_constants_t *c, int32_t *temperature,
+                    uint32_t *pressure, uint8_t oss)
+{
+    int32_t UT;
+    uint32_t UP = 0;
+
+    if (!temperature && !pressure)
+        return false;
+
+    // Temperature is always needed, allso required for pressure only.
+    if (!bmp180_get_uncompensated_temperature(&UT))
+        return false;
+
+    if (pressure && !bmp180_get_uncompensated_pressure(oss, &UP))
+        return false;
+
+    bmp180_compensate(c, UT, UP, oss, temperature, pressure);
     return true;
 }
 
-
+
 
 // BMP180_Event_Command
 typedef struct
@@ -307,14 +361,14 @@ static bool bmp180_informUser_Impl(const xQueueHandle* resultQueue, uint8_t cmd,
 }
 
 // Just init all needed queues
-bool bmp180_init(uint8_t scl, uint8_t sda)
+bool bmp180_init_bus(i2c_bus_t *bus)
 {
     // 1. Create required queues
     bool result = false;
 
     if (bmp180_create_communication_queues()) {
-        // 2. Init i2c driver
-        i2c_init(scl, sda);
+        // 2. Use the given i2c bus
+        bmp180_set_bus(bus);
         // 3. Check for bmp180 ...
         if (bmp180_is_available()) {
             // 4. Start driver task
@@ -328,6 +382,12 @@ bool bmp180_init(uint8_t scl, uint8_t sda)
     return result;
 }
 
+bool bmp180_init(uint8_t scl, uint8_t sda)
+{
+    i2c_init(scl, sda);
+    return bmp180_init_bus(NULL);
+}
+
 void bmp180_trigger_measurement(const xQueueHandle* resultQueue)
 {
     bmp180_command_t c;
@@ -13,6 +13,7 @@
 
 #include "FreeRTOS.h"
 #include "queue.h"
+#include "i2c/i2c.h"
 
 // Uncomment to enable debug output
 //#define BMP180_DEBUG
@@ -40,6 +41,9 @@ typedef struct
 // Init bmp180 driver ...
 bool bmp180_init(uint8_t scl, uint8_t sda);
 
+// Init bmp180 driver on a bus set up with i2c_bus_init()
+bool bmp180_init_bus(i2c_bus_t *bus);
+
 // Trigger a "complete" measurement (temperature and pressure will be valid when given to "bmp180_informUser)
 void bmp180_trigger_measurement(const xQueueHandle* resultQueue);
 
@@ -53,7 +57,7 @@ void bmp180_trigger_pressure_measurement(const xQueueHandle* resultQueue);
 extern bool (*bmp180_informUser)(const xQueueHandle* resultQueue, uint8_t cmd, bmp180_temp_t temperature, bmp180_press_t pressure);
 
 // Calibration constants
-typedef struct
+typedef struct bmp180_constants
 {
     int16_t  AC1;
     int16_t  AC2;
@@ -70,6 +74,9 @@ typedef struct
     int16_t  MD;
 } bmp180_constants_t;
 
+// Select the bus for the functions below, NULL (the default) for the bus
+// set up by i2c_init().
+void bmp180_set_bus(i2c_bus_t *bus);
 // Returns true if the bmp180 is detected.
 bool bmp180_is_available();
 // Reads all the internal constants, returning true on success.
@@ -79,4 +86,19 @@ bool bmp180_fillInternalConstants(bmp180_constants_t *c);
 bool bmp180_measure(bmp180_constants_t *c, int32_t *temperature,
                     uint32_t *pressure, uint8_t oss);
 
+// The steps of bmp180_measure(), which busy waits for the conversions,
+// for callers that sleep or do other work in the meantime. The start
+// functions return the conversion time in microseconds, or 0 on error;
+// read the raw value after that time, then pass the raw temperature and
+// pressure to bmp180_compensate().
+uint32_t bmp180_start_temperature(void);
+bool bmp180_read_raw_temperature(int32_t *ut);
+uint32_t bmp180_start_pressure(uint8_t oss);
+bool bmp180_read_raw_pressure(uint8_t oss, uint32_t *up);
+// Compensated temperature in 0.1 degrees Celsius and pressure in Pa, as
+// from bmp180_measure(). Either pointer may be NULL, up is only used for
+// the pressure.
+void bmp180_compensate(bmp180_constants_t *c, int32_t ut, uint32_t up,
+                       uint8_t oss, int32_t *temperature, uint32_t *pressure);
+
 #endif /* DRIVER_BMP180_H_ */
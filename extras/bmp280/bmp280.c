@@ -50,7 +50,7 @@
 #define BMP280_REG_RESET       0xE0
 #define BMP280_REG_ID          0xD0
 #define BMP280_REG_CALIB       0x88
-#define BMP280_REG_HUM_CALIB   0x88
+#define BMP280_REG_HUM_CALIB   0xE1
 
 
 #define BMP280_RESET_VALUE     0xB6
@@ -65,32 +65,34 @@ void bmp280_init_default_params(bmp280_params_t *params)
     params->standby = BMP280_STANDBY_250;
 }
 
-static bool read_register16(uint8_t i2c_addr, uint8_t addr, uint16_t *value)
+static bool read_data(bmp280_t *dev, uint8_t addr, uint8_t *value, uint8_t len)
 {
-    uint8_t d[] = {0, 0};
-    if (i2c_slave_read(i2c_addr, addr, d, sizeof(d))) {
-        *value = d[0] | (d[1] << 8);
-        return true;
-    }
-    return false;
+    return i2c_bus_read_regs(dev->bus, dev->i2c_addr, addr, value, len);
+}
+
+static inline uint16_t le16(const uint8_t *d)
+{
+    return d[0] | (d[1] << 8);
 }
 
 static bool read_calibration_data(bmp280_t *dev)
 {
-    uint8_t i2c_addr = dev->i2c_addr;
-
-    if (read_register16(i2c_addr, 0x88, &dev->dig_T1) &&
-        read_register16(i2c_addr, 0x8a, (uint16_t *)&dev->dig_T2) &&
-        read_register16(i2c_addr, 0x8c, (uint16_t *)&dev->dig_T3) &&
-        read_register16(i2c_addr, 0x8e, &dev->dig_P1) &&
-        read_register16(i2c_addr, 0x90, (uint16_t *)&dev->dig_P2) &&
-        read_register16(i2c_addr, 0x92, (uint16_t *)&dev->dig_P3) &&
-        read_register16(i2c_addr, 0x94, (uint16_t *)&dev->dig_P4) &&
-        read_register16(i2c_addr, 0x96, (uint16_t *)&dev->dig_P5) &&
-        read_register16(i2c_addr, 0x98, (uint16_t *)&dev->dig_P6) &&
-        read_register16(i2c_addr, 0x9a, (uint16_t *)&dev->dig_P7) &&
-        read_register16(i2c_addr, 0x9c, (uint16_t *)&dev->dig_P8) &&
-        read_register16(i2c_addr, 0x9e, (uint16_t *)&dev->dig_P9)) {
+    uint8_t d[24];
+
+    // All 12 coefficients in one transfer
+    if (read_data(dev, BMP280_REG_CALIB, d, sizeof(d))) {
+        dev->dig_T1 = le16(d);
+        dev->dig_T2 = le16(d + 2);
+        dev->dig_T3 = le16(d + 4);
+        dev->dig_P1 = le16(d + 6);
+        dev->dig_P2 = le16(d + 8);
+        dev->dig_P3 = le16(d + 10);
+        dev->dig_P4 = le16(d + 12);
+        dev->dig_P5 = le16(d + 14);
+        dev->dig_P6 = le16(d + 16);
+        dev->dig_P7 = le16(d + 18);
+        dev->dig_P8 = le16(d + 20);
+        dev->dig_P9 = le16(d + 22);
 
         debug("Calibration data received:");
         debug("dig_T1=%d", dev->dig_T1);
@@ -114,17 +116,16 @@ static bool read_calibration_data(bmp280_t *dev)
 
 static bool read_hum_calibration_data(bmp280_t *dev)
 {
-    uint8_t i2c_addr = dev->i2c_addr;
-    uint16_t h4, h5;
-
-    if (i2c_slave_read(i2c_addr, 0xa1, &dev->dig_H1, 1) &&
-        read_register16(i2c_addr, 0xe1, (uint16_t *)&dev->dig_H2) &&
-        i2c_slave_read(i2c_addr, 0xe3, &dev->dig_H3, 1) &&
-        read_register16(i2c_addr, 0xe4, &h4) &&
-        read_register16(i2c_addr, 0xe5, &h5) &&
-        i2c_slave_read(i2c_addr, 0xe7, (uint8_t *)&dev->dig_H6, 1)) {
-        dev->dig_H4 = (h4 & 0x00ff) << 4 | (h4 & 0x0f00) >> 8;
-        dev->dig_H5 = h5 >> 4;
+    uint8_t d[7];
+
+    // H1 at 0xa1, H2..H6 packed into 0xe1..0xe7
+    if (read_data(dev, 0xa1, &dev->dig_H1, 1) &&
+        read_data(dev, BMP280_REG_HUM_CALIB, d, sizeof(d))) {
+        dev->dig_H2 = le16(d);
+        dev->dig_H3 = d[2];
+        dev->dig_H4 = d[3] << 4 | (d[4] & 0x0f);
+        dev->dig_H5 = le16(d + 4) >> 4;
+        dev->dig_H6 = d[6];
         debug("Calibration data received:");
         debug("dig_H1=%d", dev->dig_H1);
         debug("dig_H2=%d", dev->dig_H2);
@@ -138,23 +139,25 @@ static bool read_hum_calibration_data(bmp280_t *dev)
     return false;
 }
 
-static bool write_register8(uint8_t i2c_addr, uint8_t addr, uint8_t value)
+static bool write_register8(bmp280_t *dev, uint8_t addr, uint8_t value)
 {
-    uint8_t d[] = {addr, value};
-
-    return i2c_slave_write(i2c_addr, d, 2);
+    return i2c_bus_write_regs(dev->bus, dev->i2c_addr, addr, &value, 1);
 }
 
 bool bmp280_init(bmp280_t *dev, bmp280_params_t *params)
 {
-    uint8_t i2c_addr = dev->i2c_addr;
+    return bmp280_init_bus(dev, NULL, params);
+}
 
-    if (i2c_addr != BMP280_I2C_ADDRESS_0 && i2c_addr != BMP280_I2C_ADDRESS_1) {
+bool bmp280_init_bus(bmp280_t *dev, i2c_bus_t *bus, bmp280_params_t *params)
+{
+    dev->bus = bus;
+    if (dev->i2c_addr != BMP280_I2C_ADDRESS_0 && dev->i2c_addr != BMP280_I2C_ADDRESS_1) {
         debug("Invalid I2C address");
         return false;
     }
 
-    if (!i2c_slave_read(i2c_addr, BMP280_REG_ID, &dev->id, 1)) {
+    if (!read_data(dev, BMP280_REG_ID, &dev->id, 1)) {
         debug("Sensor not found");
         return false;
     }
@@ -165,7 +168,7 @@ bool bmp280_init(bmp280_t *dev, bmp280_params_t *params)
     }
 
     // Soft reset.
-    if (!write_register8(i2c_addr, BMP280_REG_RESET, BMP280_RESET_VALUE)) {
+    if (!write_register8(dev, BMP280_REG_RESET, BMP280_RESET_VALUE)) {
         debug("Failed resetting sensor");
         return false;
     }
@@ -173,7 +176,7 @@ bool bmp280_init(bmp280_t *dev, bmp280_params_t *params)
     // Wait until finished copying over the NVP data.
     while (1) {
         uint8_t status;
-        if (i2c_slave_read(i2c_addr, BMP280_REG_STATUS, &status, 1) && (status & 1) == 0)
+        if (read_data(dev, BMP280_REG_STATUS, &status, 1) && (status & 1) == 0)
             break;
     }
 
@@ -189,7 +192,7 @@ bool bmp280_init(bmp280_t *dev, bmp280_params_t *params)
 
     uint8_t config = (params->standby << 5) | (params->filter << 2);
     debug("Writing config reg=%x", config);
-    if (!write_register8(i2c_addr, BMP280_REG_CONFIG, config)) {
+    if (!write_register8(dev, BMP280_REG_CONFIG, config)) {
         debug("Failed configuring sensor");
         return false;
     }
@@ -209,14 +212,14 @@ bool bmp280_init(bmp280_t *dev, bmp280_params_t *params)
         // Write crtl hum reg first, only active after write to BMP280_REG_CTRL.
         uint8_t ctrl_hum = params->oversampling_humidity;
         debug("Writing ctrl hum reg=%x", ctrl_hum);
-        if (!write_register8(i2c_addr, BMP280_REG_CTRL_HUM, ctrl_hum)) {
+        if (!write_register8(dev, BMP280_REG_CTRL_HUM, ctrl_hum)) {
             debug("Failed controlling sensor");
             return false;
         }
     }
 
     debug("Writing ctrl reg=%x", ctrl);
-    if (!write_register8(i2c_addr, BMP280_REG_CTRL, ctrl)) {
+    if (!write_register8(dev, BMP280_REG_CTRL, ctrl)) {
         debug("Failed controlling sensor");
         return false;
     }
@@ -227,12 +230,12 @@ bool bmp280_init(bmp280_t *dev, bmp280_params_t *params)
 bool bmp280_force_measurement(bmp280_t *dev)
 {
     uint8_t ctrl;
-    if (!i2c_slave_read(dev->i2c_addr, BMP280_REG_CTRL, &ctrl, 1))
+    if (!read_data(dev, BMP280_REG_CTRL, &ctrl, 1))
         return false;
     ctrl &= ~0b11;  // clear two lower bits
     ctrl |= BMP280_MODE_FORCED;
     debug("Writing ctrl reg=%x", ctrl);
-    if (!write_register8(dev->i2c_addr, BMP280_REG_CTRL, ctrl)) {
+    if (!write_register8(dev, BMP280_REG_CTRL, ctrl)) {
         debug("Failed starting forced mode");
         return false;
     }
@@ -242,7 +245,7 @@ bool bmp280_force_measurement(bmp280_t *dev)
 bool bmp280_is_measuring(bmp280_t *dev)
 {
     uint8_t status;
-    if (!i2c_slave_read(dev->i2c_addr, BMP280_REG_STATUS, &status, 1))
+    if (!read_data(dev, BMP280_REG_STATUS, &status, 1))
         return false;
     if (status & (1 << 3)) {
         debug("Status: measuring");
@@ -303,6 +306,52 @@ static inline uint32_t compensate_pressure(bmp280_t *dev,
     return p;
 }
 
+/**
+ * Pressure compensation in 32-bit integer arithmetic.
+ *
+ * This is the 32-bit algorithm from the BMP280 datasheet with two changes
+ * that keep it within 0.7Pa of compensate_pressure() (the datasheet version
+ * is up to 7Pa off): the divisor keeps 4 more bits, and the division is
+ * done in two steps to get 8 fractional bits in the result. test/ checks
+ * this over the sensor's operating range.
+ *
+ * The lx106 has neither 64-bit multiplication nor division in hardware, so
+ * this avoids the library calls for 64-bit multiplies and the 64-bit
+ * division of compensate_pressure().
+ *
+ * Return value is in Pa, 24 integer bits and 8 fractional bits.
+ */
+static inline uint32_t compensate_pressure_fast(bmp280_t *dev,
+                                                int32_t adc_press, int32_t fine_temp)
+{
+    int32_t var1, var2;
+    uint32_t u, n, d, q, r, p;
+
+    var1 = (fine_temp >> 1) - 64000;
+    var2 = (((var1 >> 2) * (var1 >> 2)) >> 11) * (int32_t)dev->dig_P6;
+    var2 = var2 + ((var1 * (int32_t)dev->dig_P5) << 1);
+    var2 = (var2 >> 2) + ((int32_t)dev->dig_P4 << 16);
+    var1 = ((((int32_t)dev->dig_P3 * (((var1 >> 2) * (var1 >> 2)) >> 13)) >> 3) +
+            (((int32_t)dev->dig_P2 * var1) >> 1)) >> 14;
+
+    // d = ((1 << 19) + var1) * dig_P1 >> 15 without overflowing
+    u = 524288 + var1;
+    d = (u >> 15) * dev->dig_P1 + (((u & 0x7fff) * dev->dig_P1) >> 15);
+    if (d == 0) {
+        return 0;  // avoid exception caused by division by zero
+    }
+
+    n = ((uint32_t)(1048576 - adc_press) - (var2 >> 12)) * 3125;
+    q = n / d;
+    r = n % d;
+    p = ((q << 12) + ((r << 12) / d)) << 1;
+
+    var1 = ((int32_t)dev->dig_P9 *
+            (int32_t)((((p >> 11) * (p >> 11)) >> 13))) >> 12;
+    var2 = ((int32_t)(p >> 10) * (int32_t)dev->dig_P8) >> 13;
+    return (int32_t)p + (var1 + var2 + (int32_t)dev->dig_P7) * 16;
+}
+
 /**
  * Compensation algorithm is taken from BME280 datasheet.
  *
@@ -328,8 +377,8 @@ static inline uint32_t compensate_humidity(bmp280_t *dev,
     return v_x1_u32r >> 12;
 }
 
-bool bmp280_read_fixed(bmp280_t *dev, int32_t *temperature,
-                       uint32_t *pressure, uint32_t *humidity)
+static bool read_fixed(bmp280_t *dev, int32_t *temperature,
+                       uint32_t *pressure, uint32_t *humidity, bool fast)
 {
     int32_t adc_pressure;
     int32_t adc_temp;
@@ -344,7 +393,7 @@ bool bmp280_read_fixed(bmp280_t *dev, int32_t *temperature,
 
     // Need to read in one sequence to ensure they match.
     size_t size = humidity ? 8 : 6;
-    if (!i2c_slave_read(dev->i2c_addr, 0xf7, data, size)) {
+    if (!read_data(dev, 0xf7, data, size)) {
         debug("Failed reading");
         return false;
     }
@@ -356,7 +405,11 @@ bool bmp280_read_fixed(bmp280_t *dev, int32_t *temperature,
 
     int32_t fine_temp;
     *temperature = compensate_temperature(dev, adc_temp, &fine_temp);
-    *pressure = compensate_pressure(dev, adc_pressure, fine_temp);
+    if (fast) {
+        *pressure = compensate_pressure_fast(dev, adc_pressure, fine_temp);
+    } else {
+        *pressure = compensate_pressure(dev, adc_pressure, fine_temp);
+    }
 
     if (humidity) {
         int32_t adc_humidity = data[6] << 8 | data[7];
@@ -367,6 +420,18 @@ bool bmp280_read_fixed(bmp280_t *dev, int32_t *temperature,
     return true;
 }
 
+bool bmp280_read_fixed(bmp280_t *dev, int32_t *temperature,
+                       uint32_t *pressure, uint32_t *humidity)
+{
+    return read_fixed(dev, temperature, pressure, humidity, false);
+}
+
+bool bmp280_read_fixed_fast(bmp280_t *dev, int32_t *temperature,
+                            uint32_t *pressure, uint32_t *humidity)
+{
+    return read_fixed(dev, temperature, pressure, humidity, true);
+}
+
 bool bmp280_read_float(bmp280_t *dev, float *temperature,
                        float *pressure, float *humidity)
 {
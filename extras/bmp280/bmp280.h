@@ -26,6 +26,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "i2c/i2c.h"
 
 /**
  * Uncomment to enable debug output.
@@ -121,6 +122,7 @@ typedef struct {
     int16_t  dig_H5;
     int8_t   dig_H6;
 
+    i2c_bus_t *bus;     /* I2C bus, set by bmp280_init()/bmp280_init_bus() */
     uint8_t  i2c_addr;  /* I2C address. */
     uint8_t  id;        /* Chip ID */
 } bmp280_t;
@@ -145,9 +147,18 @@ void bmp280_init_default_params(bmp280_params_t *params);
  * address is unknown then try initializing each in turn.
  *
  * This may be called again to soft reset the device and initialize it again.
+ *
+ * The device is used on the I2C bus set up by i2c_init(), dev->bus is set
+ * to NULL for that.
  */
 bool bmp280_init(bmp280_t *dev, bmp280_params_t *params);
 
+/**
+ * Same as bmp280_init(), for a device on a bus set up with i2c_bus_init().
+ * Re-initialize the device with this function too, to stay on that bus.
+ */
+bool bmp280_init_bus(bmp280_t *dev, i2c_bus_t *bus, bmp280_params_t *params);
+
 /**
  * Start measurement in forced mode.
  * The module remains in forced mode after this call.
@@ -174,6 +185,18 @@ bool bmp280_is_measuring(bmp280_t *dev);
 bool bmp280_read_fixed(bmp280_t *dev, int32_t *temperature,
                        uint32_t *pressure, uint32_t *humidity);
 
+/**
+ * Same as bmp280_read_fixed(), but the pressure is compensated with 32-bit
+ * integer arithmetic instead of the 64-bit multiplications and division,
+ * which the ESP8266 has to do in software.
+ *
+ * The pressure is within 0.53Pa of bmp280_read_fixed() with the
+ * datasheet's example calibration data, and within 0.7Pa with other
+ * calibration data tested (the sensor's relative accuracy is 12Pa).
+ */
+bool bmp280_read_fixed_fast(bmp280_t *dev, int32_t *temperature,
+                            uint32_t *pressure, uint32_t *humidity);
+
 /**
  * Read compensated temperature and pressure data:
  *  Temperature in degrees Celsius.
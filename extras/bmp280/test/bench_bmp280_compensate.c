@@ -0,0 +1,102 @@
+/* Host benchmark of the BMP280 pressure compensation.
+ *
+ * Times compensate_pressure() (64-bit), compensate_pressure_fast() and the
+ * datasheet's 32-bit version over readings spread across the operating
+ * range, and prints the time and TSC cycles per call (the best of several
+ * samples). A 64-bit PC has 64-bit multiply and divide instructions, the
+ * lx106 does them in library calls, so the difference on the ESP8266 is
+ * larger than here.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <x86intrin.h>
+
+#include "../bmp280.c"
+#include "bosch.h"
+
+#define READINGS 4096
+#define ROUNDS 2000
+#define SAMPLES 5
+
+static const bmp280_t datasheet = {
+    .dig_T1 = 27504, .dig_T2 = 26435, .dig_T3 = -1000,
+    .dig_P1 = 36477, .dig_P2 = -10685, .dig_P3 = 3024, .dig_P4 = 2855,
+    .dig_P5 = 140, .dig_P6 = -7, .dig_P7 = 15500, .dig_P8 = -14600, .dig_P9 = 6000,
+};
+
+static int32_t adc_p[READINGS], fine_temp[READINGS];
+static volatile uint32_t sink;
+
+static uint32_t pressure_64(bmp280_t *c, int32_t adc, int32_t fine)
+{
+    return compensate_pressure(c, adc, fine);
+}
+
+static uint32_t pressure_fast(bmp280_t *c, int32_t adc, int32_t fine)
+{
+    return compensate_pressure_fast(c, adc, fine);
+}
+
+static uint32_t pressure_datasheet_32(bmp280_t *c, int32_t adc, int32_t fine)
+{
+    t_fine = fine;
+    return bmp280_compensate_P_int32(c, adc);
+}
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* Called through a pointer so it isn't inlined into the loop */
+static void bench(const char *name, uint32_t (*volatile fn)(bmp280_t *, int32_t, int32_t))
+{
+    bmp280_t c = datasheet;
+    double best = 0;
+    uint64_t best_cycles = 0;
+
+    for (int n = 0; n < SAMPLES; n++) {
+        uint32_t acc = 0;
+        double start = now();
+        uint64_t cycles = __rdtsc();
+        for (int r = 0; r < ROUNDS; r++) {
+            for (int i = 0; i < READINGS; i++) {
+                acc += fn(&c, adc_p[i], fine_temp[i]);
+            }
+        }
+        cycles = __rdtsc() - cycles;
+        double elapsed = now() - start;
+        sink = acc;
+        if (n == 0 || elapsed < best) {
+            best = elapsed;
+            best_cycles = cycles;
+        }
+    }
+    printf("%-24s %6.1f ns %6.1f cycles\n", name, best * 1e9 / ROUNDS / READINGS,
+           (double)best_cycles / ROUNDS / READINGS);
+}
+
+int main(void)
+{
+    bmp280_t c = datasheet;
+    uint32_t seed = 1;
+
+    /* -40..85C and roughly 300..1100hPa with the datasheet calibration */
+    for (int i = 0; i < READINGS; i++) {
+        seed = seed * 1103515245 + 12345;
+        compensate_temperature(&c, 350000 + (seed >> 8) % 300000, &fine_temp[i]);
+        seed = seed * 1103515245 + 12345;
+        adc_p[i] = 150000 + (seed >> 8) % 650000;
+    }
+    bench("compensate_pressure", pressure_64);
+    bench("compensate_pressure_fast", pressure_fast);
+    bench("datasheet 32-bit", pressure_datasheet_32);
+    return 0;
+}
@@ -0,0 +1,85 @@
+/* The compensation formulas of the BMP280 datasheet (BST-BMP280-DS001,
+ * section 8.2), as references for the host tests. Kept as in the datasheet
+ * apart from taking the calibration from a bmp280_t.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _BOSCH_H
+#define _BOSCH_H
+
+#include <stdint.h>
+#include "../bmp280.h"
+
+typedef int32_t BMP280_S32_t;
+typedef uint32_t BMP280_U32_t;
+typedef int64_t BMP280_S64_t;
+
+static BMP280_S32_t t_fine;
+
+// Returns temperature in DegC, resolution is 0.01 DegC. Output value of "5123" equals 51.23 DegC.
+static inline BMP280_S32_t bmp280_compensate_T_int32(const bmp280_t *c, BMP280_S32_t adc_T)
+{
+    BMP280_S32_t var1, var2, T;
+    var1 = ((((adc_T>>3) - ((BMP280_S32_t)c->dig_T1<<1))) * ((BMP280_S32_t)c->dig_T2)) >> 11;
+    var2 = (((((adc_T>>4) - ((BMP280_S32_t)c->dig_T1)) * ((adc_T>>4) - ((BMP280_S32_t)c->dig_T1))) >> 12) *
+            ((BMP280_S32_t)c->dig_T3)) >> 14;
+    t_fine = var1 + var2;
+    T = (t_fine * 5 + 128) >> 8;
+    return T;
+}
+
+// Returns pressure in Pa as unsigned 32 bit integer in Q24.8 format (24 integer bits and 8 fractional bits).
+// Output value of "24674867" represents 24674867/256 = 96386.2 Pa = 963.862 hPa
+static inline BMP280_U32_t bmp280_compensate_P_int64(const bmp280_t *c, BMP280_S32_t adc_P)
+{
+    BMP280_S64_t var1, var2, p;
+    var1 = ((BMP280_S64_t)t_fine) - 128000;
+    var2 = var1 * var1 * (BMP280_S64_t)c->dig_P6;
+    var2 = var2 + ((var1*(BMP280_S64_t)c->dig_P5)<<17);
+    var2 = var2 + (((BMP280_S64_t)c->dig_P4)<<35);
+    var1 = ((var1 * var1 * (BMP280_S64_t)c->dig_P3)>>8) + ((var1 * (BMP280_S64_t)c->dig_P2)<<12);
+    var1 = (((((BMP280_S64_t)1)<<47)+var1))*((BMP280_S64_t)c->dig_P1)>>33;
+    if (var1 == 0)
+    {
+        return 0; // avoid exception caused by division by zero
+    }
+    p = 1048576-adc_P;
+    p = (((p<<31)-var2)*3125)/var1;
+    var1 = (((BMP280_S64_t)c->dig_P9) * (p>>13) * (p>>13)) >> 25;
+    var2 = (((BMP280_S64_t)c->dig_P8) * p) >> 19;
+    p = ((p + var1 + var2) >> 8) + (((BMP280_S64_t)c->dig_P7)<<4);
+    return (BMP280_U32_t)p;
+}
+
+// Returns pressure in Pa as unsigned 32 bit integer. Output value of "96386" equals 96386 Pa = 963.86 hPa
+static inline BMP280_U32_t bmp280_compensate_P_int32(const bmp280_t *c, BMP280_S32_t adc_P)
+{
+    BMP280_S32_t var1, var2;
+    BMP280_U32_t p;
+    var1 = (((BMP280_S32_t)t_fine)>>1) - (BMP280_S32_t)64000;
+    var2 = (((var1>>2) * (var1>>2)) >> 11 ) * ((BMP280_S32_t)c->dig_P6);
+    var2 = var2 + ((var1*((BMP280_S32_t)c->dig_P5))<<1);
+    var2 = (var2>>2)+(((BMP280_S32_t)c->dig_P4)<<16);
+    var1 = (((c->dig_P3 * (((var1>>2) * (var1>>2)) >> 13 )) >> 3) + ((((BMP280_S32_t)c->dig_P2) * var1)>>1))>>18;
+    var1 =((((32768+var1))*((BMP280_S32_t)c->dig_P1))>>15);
+    if (var1 == 0)
+    {
+        return 0; // avoid exception caused by division by zero
+    }
+    p = (((BMP280_U32_t)(((BMP280_S32_t)1048576)-adc_P)-(var2>>12)))*3125;
+    if (p < 0x80000000)
+    {
+        p = (p << 1) / ((BMP280_U32_t)var1);
+    }
+    else
+    {
+        p = (p / (BMP280_U32_t)var1) * 2;
+    }
+    var1 = (((BMP280_S32_t)c->dig_P9) * ((BMP280_S32_t)(((p>>3) * (p>>3))>>13)))>>12;
+    var2 = (((BMP280_S32_t)(p>>2)) * ((BMP280_S32_t)c->dig_P8))>>13;
+    p = (BMP280_U32_t)((BMP280_S32_t)p + ((var1 + var2 + c->dig_P7) >> 4));
+    return p;
+}
+
+#endif
@@ -0,0 +1,200 @@
+/* Host test of the BMP280 fixed point compensation against the datasheet's
+ * 64-bit reference.
+ *
+ * Over the sensor's operating range (-40..85C, 300..1100hPa), for the
+ * calibration data of the datasheet's example and for randomised
+ * calibration data around it, compensate_pressure() has to give the same
+ * result as the reference. compensate_pressure_fast() has to be within
+ * 0.53Pa of it with the datasheet's calibration data, and within 0.7Pa
+ * with the random ones.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "../bmp280.c"
+#include "bosch.h"
+
+#define CALIBRATIONS 50
+#define TEMPERATURES 500
+#define PRESSURES 5000
+#define T_MIN -4000
+#define T_MAX 8500
+#define P_MIN (30000 * 256)
+#define P_MAX (110000 * 256)
+#define MAX_ERROR_DATASHEET 136   // 0.53Pa in Q24.8
+#define MAX_ERROR 179             // 0.7Pa
+
+static const bmp280_t datasheet = {
+    .dig_T1 = 27504, .dig_T2 = 26435, .dig_T3 = -1000,
+    .dig_P1 = 36477, .dig_P2 = -10685, .dig_P3 = 3024, .dig_P4 = 2855,
+    .dig_P5 = 140, .dig_P6 = -7, .dig_P7 = 15500, .dig_P8 = -14600, .dig_P9 = 6000,
+};
+
+static uint32_t seed = 1;
+
+static uint32_t lcg(void)
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+/* v changed by up to +-percent */
+static int32_t vary(int32_t v, int percent)
+{
+    return v + (int64_t)v * ((int32_t)(lcg() % (2 * percent * 100 + 1)) - percent * 100) / 10000;
+}
+
+static void random_calibration(bmp280_t *c)
+{
+    *c = datasheet;
+    c->dig_T1 = vary(c->dig_T1, 5);
+    c->dig_T2 = vary(c->dig_T2, 5);
+    c->dig_T3 = vary(c->dig_T3, 50);
+    c->dig_P1 = vary(c->dig_P1, 10);
+    c->dig_P2 = vary(c->dig_P2, 20);
+    c->dig_P3 = vary(c->dig_P3, 50);
+    c->dig_P4 = vary(c->dig_P4, 100);
+    c->dig_P5 = vary(c->dig_P5, 100);
+    c->dig_P6 = vary(c->dig_P6, 100);
+    c->dig_P7 = vary(c->dig_P7, 50);
+    c->dig_P8 = vary(c->dig_P8, 50);
+    c->dig_P9 = vary(c->dig_P9, 50);
+}
+
+static int max_error;
+static double error_sum;
+static long points;
+
+/* First adc_p at or above lo whose pressure is at most p (the pressure
+   falls as adc_p rises) */
+static int32_t find_adc_p(bmp280_t *c, uint32_t p, int32_t lo)
+{
+    int32_t hi = 1 << 20;
+
+    while (lo < hi) {
+        int32_t mid = lo + (hi - lo) / 2;
+        if (bmp280_compensate_P_int64(c, mid) <= p) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+/* TEMPERATURES readings spread over the temperature range, and for each
+   PRESSURES spread over the pressure range */
+static int check_calibration(bmp280_t *c)
+{
+    int32_t adc_t_min = -1, adc_t_max = 0;
+
+    for (int32_t adc_t = 0; adc_t < (1 << 20); adc_t += 16) {
+        int32_t fine_temp;
+        int32_t t = compensate_temperature(c, adc_t, &fine_temp);
+        check(t == bmp280_compensate_T_int32(c, adc_t));
+        check(fine_temp == t_fine);
+        if (t >= T_MIN && t <= T_MAX) {
+            if (adc_t_min < 0) {
+                adc_t_min = adc_t;
+            }
+            adc_t_max = adc_t;
+        }
+    }
+    check(adc_t_min >= 0);
+
+    for (int i = 0; i < TEMPERATURES; i++) {
+        int32_t adc_t = adc_t_min + (int64_t)(adc_t_max - adc_t_min) * i / (TEMPERATURES - 1);
+        int32_t fine_temp;
+        compensate_temperature(c, adc_t, &fine_temp);
+        bmp280_compensate_T_int32(c, adc_t);
+
+        int32_t adc_p_min = find_adc_p(c, P_MAX, 0);
+        int32_t adc_p_max = find_adc_p(c, P_MIN, adc_p_min);
+        check(adc_p_max - adc_p_min > PRESSURES);
+        for (int j = 0; j < PRESSURES; j++) {
+            int32_t adc_p = adc_p_min + (adc_p_max - adc_p_min) * j / PRESSURES + lcg() % 16;
+            uint32_t ref = bmp280_compensate_P_int64(c, adc_p);
+            check(compensate_pressure(c, adc_p, fine_temp) == ref);
+            int error = abs((int32_t)(compensate_pressure_fast(c, adc_p, fine_temp) - ref));
+            if (error > max_error) {
+                max_error = error;
+            }
+            error_sum += error;
+            points++;
+        }
+    }
+    return 0;
+}
+
+int test_datasheet_example(void)
+{
+    bmp280_t c = datasheet;
+    int32_t fine_temp;
+
+    check(compensate_temperature(&c, 519888, &fine_temp) == 2508);
+    check(fine_temp == 128422);
+    check(compensate_pressure(&c, 415148, fine_temp) == 25767233);
+    check(abs((int32_t)(compensate_pressure_fast(&c, 415148, fine_temp) - 25767233)) <= MAX_ERROR_DATASHEET);
+    done();
+}
+
+/* Largest difference of compensate_pressure_fast() for calibration data c */
+static int range_error(bmp280_t *c, int *error)
+{
+    int r;
+
+    max_error = 0;
+    if ((r = check_calibration(c)) != 0) {
+        printf("calibration P1..P9 %u %d %d %d %d %d %d %d %d\n",
+               c->dig_P1, c->dig_P2, c->dig_P3, c->dig_P4, c->dig_P5,
+               c->dig_P6, c->dig_P7, c->dig_P8, c->dig_P9);
+        return r;
+    }
+    *error = max_error;
+    return 0;
+}
+
+int test_datasheet_range(void)
+{
+    bmp280_t c = datasheet;
+    int error;
+
+    check(range_error(&c, &error) == 0);
+    printf("datasheet calibration: max error %.3f Pa\n", error / 256.0);
+    check(error <= MAX_ERROR_DATASHEET);
+    done();
+}
+
+int test_random_range(void)
+{
+    bmp280_t c;
+    int error, worst = 0;
+
+    points = 0;
+    error_sum = 0;
+    for (int i = 0; i < CALIBRATIONS; i++) {
+        random_calibration(&c);
+        check(range_error(&c, &error) == 0);
+        if (error > worst) {
+            worst = error;
+        }
+    }
+    printf("%d random calibrations, %ld points: max error %.3f Pa, mean %.3f Pa\n",
+           CALIBRATIONS, points, worst / 256.0, error_sum / points / 256.0);
+    check(worst <= MAX_ERROR);
+    done();
+}
+
+int main(void)
+{
+    test(test_datasheet_example, "datasheet example");
+    test(test_datasheet_range, "pressure over the operating range, datasheet calibration");
+    test(test_random_range, "pressure over the operating range, random calibrations");
+    printf("\nPASSED: %d\nFAILED: %d\n", test_passed, test_failed);
+    return (test_failed > 0);
+}
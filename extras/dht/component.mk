@@ -8,3 +8,10 @@ extras/dht_SRC_DIR =  $(ROOT)extras/dht
 
 $(eval $(call component_compile_rules,extras/dht))
 
+
+# dht_read_data() uses extras/gpio_capture, so add it unless the program
+# lists it in EXTRA_COMPONENTS itself. Included last, as component.mk files
+# find their own directory from the last makefile read.
+ifeq ($(filter %gpio_capture,$(COMPONENTS)),)
+include $(ROOT)extras/gpio_capture/component.mk
+endif
@@ -10,13 +10,17 @@
 #include "string.h"
 #include "task.h"
 #include "esp/gpio.h"
+#include "gpio_capture/gpio_capture.h"
 
-#include <espressif/esp_misc.h> // sdk_os_delay_us
-
-// DHT timer precision in microseconds
-#define DHT_TIMER_INTERVAL   2
 #define DHT_DATA_BITS  40
 
+// Edges after releasing the line: the release itself, the response (C and
+// D), two per data bit and the final low pulse.
+#define DHT_EDGES      (1 + 2 + DHT_DATA_BITS * 2 + 1)
+
+// The whole transmission takes about 5ms
+#define DHT_TIMEOUT_MS 10
+
 // #define DEBUG_DHT
 
 #ifdef DEBUG_DHT
@@ -55,73 +59,53 @@
 
 
 /**
- * Wait specified time for pin to go to a specified state.
- * If timeout is reached and pin doesn't go to a requested state
- * false is returned.
- * The elapsed time is returned in pointer 'duration' if it is not NULL.
+ * Request data from DHT and capture the edges of the reply.
+ * Return the number of edges captured.
  */
-static bool dht_await_pin_state(uint8_t pin, uint32_t timeout,
-        bool expected_pin_state, uint32_t *duration)
+static uint16_t dht_capture(uint8_t pin, gpio_capture_t *cap)
 {
-    for (uint32_t i = 0; i < timeout; i += DHT_TIMER_INTERVAL) {
-        // need to wait at least a single interval to prevent reading a jitter
-        sdk_os_delay_us(DHT_TIMER_INTERVAL);
-        if (gpio_read(pin) == expected_pin_state) {
-            if (duration) {
-                *duration = i;
-            }
-            return true;
-        }
-    }
+    // Phase 'A' pulling signal low to initiate read sequence. Task
+    // switching is fine here, the sensor only needs at least 18ms.
+    gpio_write(pin, 0);
+    vTaskDelay((20 + portTICK_RATE_MS - 1) / portTICK_RATE_MS + 1);
 
-    return false;
+    // Phases 'B' to 'D' and the data bits are timestamped by the GPIO
+    // interrupt, the task just waits for them.
+    gpio_capture_start(cap, DHT_EDGES);
+    gpio_write(pin, 1);
+    gpio_capture_wait(cap, DHT_TIMEOUT_MS / portTICK_RATE_MS + 1);
+    return gpio_capture_stop(cap);
 }
 
 /**
- * Request data from DHT and read raw bit stream.
- * The function call should be protected from task switching.
- * Return false if error occurred.
+ * Decode the bit stream from the captured edges.
+ *
+ * Each bit is a ~50us low pulse followed by a high pulse which is shorter
+ * than that for a '0' and longer for a '1'. The bits are the last 40
+ * complete high pulses, anything before them is the start sequence.
+ * Return false if there are not enough pulses.
  */
-static inline bool dht_fetch_data(uint8_t pin, bool bits[DHT_DATA_BITS])
+static bool dht_decode(const gpio_capture_t *cap, uint16_t count, bool bits[DHT_DATA_BITS])
 {
-    uint32_t low_duration;
-    uint32_t high_duration;
-
-    // Phase 'A' pulling signal low to initiate read sequence
-    gpio_write(pin, 0);
-    sdk_os_delay_us(20000);
-    gpio_write(pin, 1);
-
-    // Step through Phase 'B', 40us
-    if (!dht_await_pin_state(pin, 40, false, NULL)) {
-        debug("Initialization error, problem in phase 'B'\n");
-        return false;
-    }
-
-    // Step through Phase 'C', 88us
-    if (!dht_await_pin_state(pin, 88, true, NULL)) {
-        debug("Initialization error, problem in phase 'C'\n");
-        return false;
+    int n = 0;
+
+    // Walk backwards from the last falling edge
+    for (int i = count - 1; i >= 2 && n < DHT_DATA_BITS; i--) {
+        if (gpio_capture_level(cap, i) || !gpio_capture_level(cap, i - 1)
+                || gpio_capture_level(cap, i - 2)) {
+            // Not a low -> high -> low sequence (a missed edge)
+            continue;
+        }
+        uint32_t high_duration = gpio_capture_us(cap, i - 1, i);
+        uint32_t low_duration = gpio_capture_us(cap, i - 2, i - 1);
+        n++;
+        bits[DHT_DATA_BITS - n] = high_duration > low_duration;
+        i--;
     }
-
-    // Step through Phase 'D', 88us
-    if (!dht_await_pin_state(pin, 88, false, NULL)) {
-        debug("Initialization error, problem in phase 'D'\n");
+    if (n < DHT_DATA_BITS) {
+        debug("Only %d bits received\n", n);
         return false;
     }
-
-    // Read in each of the 40 bits of data...
-    for (int i = 0; i < DHT_DATA_BITS; i++) {
-        if (!dht_await_pin_state(pin, 65, true, &low_duration)) {
-            debug("LOW bit timeout\n");
-            return false;
-        }
-        if (!dht_await_pin_state(pin, 75, false, &high_duration)){
-            debug("HIGHT bit timeout\n");
-            return false;
-        }
-        bits[i] = high_duration > low_duration;
-    }
     return true;
 }
 
@@ -152,13 +136,19 @@ bool dht_read_data(uint8_t pin, int16_t *humidity, int16_t *temperature)
 {
     bool bits[DHT_DATA_BITS];
     uint8_t data[DHT_DATA_BITS/8] = {0};
+    uint32_t edges[DHT_EDGES + 4];
+    gpio_capture_t cap;
+    uint16_t count;
     bool result;
 
     gpio_enable(pin, GPIO_OUT_OPEN_DRAIN);
 
-    taskENTER_CRITICAL();
-    result = dht_fetch_data(pin, bits);
-    taskEXIT_CRITICAL();
+    if (!gpio_capture_init(&cap, pin, edges, sizeof(edges) / sizeof(edges[0]))) {
+        return false;
+    }
+    count = dht_capture(pin, &cap);
+    result = dht_decode(&cap, count, bits);
+    gpio_capture_free(&cap);
 
     if (!result) {
         return false;
@@ -1,38 +1,42 @@
-/*
- * Part of esp-open-rtos
- * Copyright (C) 2016 Jonathan Hartsuiker (https://github.com/jsuiker)
- * BSD Licensed as described in the file LICENSE
- *
- */
-
-#ifndef __DHT_H__
-#define __DHT_H__
-
-#include <stdint.h>
-#include <stdbool.h>
-
-#define DHT11       11
-#define DHT22       22
-
-// Type of sensor to use
-#define DHT_TYPE    DHT22
-
-/**
- * Read data from sensor on specified pin.
- *
- * Humidity and temperature is returned as integers.
- * For example: humidity=625 is 62.5 %
- *              temperature=24.4 is 24.4 degrees Celsius
- *
- */
-bool dht_read_data(uint8_t pin, int16_t *humidity, int16_t *temperature);
-
-
-/**
- * Float version of dht_read_data.
- *
- * Return values as floating point values.
- */
-bool dht_read_float_data(uint8_t pin, float *humidity, float *temperature);
-
-#endif  // __DHT_H__
+/*
+ * Part of esp-open-rtos
+ * Copyright (C) 2016 Jonathan Hartsuiker (https://github.com/jsuiker)
+ * BSD Licensed as described in the file LICENSE
+ *
+ */
+
+#ifndef __DHT_H__
+#define __DHT_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define DHT11       11
+#define DHT22       22
+
+// Type of sensor to use
+#define DHT_TYPE    DHT22
+
+/**
+ * Read data from sensor on specified pin.
+ *
+ * Humidity and temperature is returned as integers.
+ * For example: humidity=625 is 62.5 %
+ *              temperature=24.4 is 24.4 degrees Celsius
+ *
+ * Must be called from a task with the scheduler running (not from
+ * user_init() or an interrupt handler): the start signal is timed with
+ * vTaskDelay() and the reply is captured by extras/gpio_capture, whose
+ * interrupt wakes the task.
+ */
+bool dht_read_data(uint8_t pin, int16_t *humidity, int16_t *temperature);
+
+
+/**
+ * Float version of dht_read_data.
+ *
+ * Return values as floating point values. The same restrictions apply.
+ */
+bool dht_read_float_data(uint8_t pin, float *humidity, float *temperature);
+
+#endif  // __DHT_H__
@@ -18,10 +18,106 @@
 
 #define os_sleep_ms(x) vTaskDelay(((x) + portTICK_RATE_MS - 1) / portTICK_RATE_MS)
 
+// How often to poll externally powered sensors for the end of a conversion
+#define DS18B20_POLL_MS          10
+
+// Conversion time in ms for 9 to 12 bits resolution
+static const uint16_t conversion_ms[] = { 94, 188, 375, 750 };
+
+static inline uint32_t conversion_time(uint8_t resolution) {
+    return conversion_ms[resolution - 9];
+}
+
+// True if any sensor on the bus is parasitically powered (they pull the
+// read slot after READ POWER SUPPLY low).
+static bool ds18b20_is_parasite(int pin) {
+    if (!onewire_reset(pin)) {
+        return false;
+    }
+    onewire_skip_rom(pin);
+    onewire_write(pin, DS18B20_READ_PWRSUPPLY);
+    return !(onewire_read(pin) & 1);
+}
+
+// Start a conversion on all sensors of a bus. Parasitic sensors need the bus
+// driven high within 10us of the command.
+static bool ds18b20_start_conversion(ds18b20_bus_t *bus) {
+    bool result;
+
+    if (!onewire_reset(bus->pin)) {
+        return false;
+    }
+    onewire_skip_rom(bus->pin);
+    taskENTER_CRITICAL();
+    result = onewire_write(bus->pin, DS18B20_CONVERT_T);
+    if (result && bus->parasite) {
+        onewire_power(bus->pin);
+    }
+    taskEXIT_CRITICAL();
+    return result;
+}
+
+// Start conversions on all buses and wait until they are complete. Returns
+// false if any bus failed, `failed` gets a bit set for each of them.
+static bool ds18b20_convert_buses(ds18b20_bus_t *buses, int bus_count, uint32_t *failed) {
+    uint32_t all = (bus_count == 32) ? 0xffffffff : (1u << bus_count) - 1;
+    uint32_t done = 0;
+    portTickType start;
+
+    *failed = 0;
+    for (int i = 0; i < bus_count; i++) {
+        if (!ds18b20_start_conversion(&buses[i])) {
+            *failed |= 1u << i;
+        }
+    }
+    done = *failed;
+    start = xTaskGetTickCount();
+
+    while (done != all) {
+        os_sleep_ms(DS18B20_POLL_MS);
+        uint32_t elapsed = (xTaskGetTickCount() - start) * portTICK_RATE_MS;
+
+        for (int i = 0; i < bus_count; i++) {
+            ds18b20_bus_t *bus = &buses[i];
+            uint32_t time = conversion_time(bus->resolution);
+
+            if (done & (1u << i)) {
+                continue;
+            }
+            if (bus->parasite) {
+                // can't poll while powering the bus, wait for the worst case
+                if (elapsed >= time) {
+                    onewire_depower(bus->pin);
+                    done |= 1u << i;
+                }
+            } else if (onewire_read(bus->pin) > 0) {
+                // read slots return 1 once all sensors have finished
+                done |= 1u << i;
+            } else if (elapsed > time + time / 4) {
+                *failed |= 1u << i;
+                done |= 1u << i;
+            }
+        }
+    }
+    return *failed == 0;
+}
+
 uint8_t ds18b20_read_all(uint8_t pin, ds_sensor_t *result) {
     onewire_addr_t addr;
     onewire_search_t search;
     uint8_t sensor_id = 0;
+    uint32_t failed;
+    ds18b20_bus_t bus = {
+        .pin = pin,
+        .parasite = ds18b20_is_parasite(pin),
+        .resolution = 12,
+    };
+
+    // Convert on all sensors at once, then read them one by one while
+    // searching the bus.
+    if (!ds18b20_convert_buses(&bus, 1, &failed)) {
+        return 0;
+    }
 
     onewire_search_start(&search);
     
@@ -32,39 +128,10 @@ uint8_t ds18b20_read_all(uint8_t pin, ds_sensor_t *result) {
             return 0;
         }
 
-        onewire_reset(pin);
-        onewire_select(pin, addr);
-        onewire_write(pin, DS18B20_CONVERT_T);
-        
-        onewire_power(pin);
-        vTaskDelay(750 / portTICK_RATE_MS);
-        
-        onewire_reset(pin);
-        onewire_select(pin, addr);
-        onewire_write(pin, DS18B20_READ_SCRATCHPAD);
-
-        uint8_t get[10];
-
-        for (int k=0;k<9;k++){
-            get[k]=onewire_read(pin);
-        }
-        
-        //printf("\n ScratchPAD DATA = %X %X %X %X %X %X %X %X %X\n",get[8],get[7],get[6],get[5],get[4],get[3],get[2],get[1],get[0]);
-        crc = onewire_crc8(get, 8);
-
-        if (crc != get[8]){
-            printf("CRC check failed: %02X %02X\n", get[8], crc);
+        float temperature = ds18b20_read_temperature(pin, addr);
+        if (isnan(temperature)) {
             return 0;
         }
-
-        uint8_t temp_msb = get[1]; // Sign byte + lsbit
-        uint8_t temp_lsb = get[0]; // Temp data plus lsb
-        uint16_t temp = temp_msb << 8 | temp_lsb;
-        
-        float temperature;
-
-        temperature = (temp * 625.0)/10000;
-        //printf("Got a DS18B20 Reading: %d.%02d\n", (int)temperature, (int)(temperature - (int)temperature) * 100);
         result[sensor_id].id = sensor_id;
         result[sensor_id].value = temperature;
         sensor_id++;
@@ -171,7 +238,7 @@ float ds18b20_read_temperature(int pin, ds18b20_addr_t addr) {
         return NAN;
     }
 
-    temp = scratchpad[1] << 8 | scratchpad[0];
+    temp = (int16_t)(scratchpad[1] << 8 | scratchpad[0]);
     
     return ((float)temp * 625.0)/10000;
 }
@@ -184,13 +251,14 @@ float ds18b20_measure_and_read(int pin, ds18b20_addr_t addr) {
 }
 
 bool ds18b20_measure_and_read_multi(int pin, ds18b20_addr_t *addr_list, int addr_count, float *result_list) {
-    if (!ds18b20_measure(pin, DS18B20_ANY, true)) {
-        for (int i=0; i < addr_count; i++) {
-            result_list[i] = NAN;
-        }
-        return false;
-    }
-    return ds18b20_read_temp_multi(pin, addr_list, addr_count, result_list);
+    ds18b20_bus_t bus = {
+        .pin = pin,
+        .addr_list = addr_list,
+        .addr_count = addr_count,
+        .parasite = ds18b20_is_parasite(pin),
+        .resolution = 12,
+    };
+    return ds18b20_measure_and_read_buses(&bus, 1, result_list);
 }
 
 int ds18b20_scan_devices(int pin, ds18b20_addr_t *addr_list, int addr_count) {
@@ -220,4 +288,48 @@ bool ds18b20_read_temp_multi(int pin, ds18b20_addr_t *addr_list, int addr_count,
     return result;
 }
 
+int ds18b20_bus_init(ds18b20_bus_t *bus, int pin, ds18b20_addr_t *addr_list, int addr_count) {
+    uint8_t scratchpad[8];
+    int found = ds18b20_scan_devices(pin, addr_list, addr_count);
+
+    bus->pin = pin;
+    bus->addr_list = addr_list;
+    bus->addr_count = (found < addr_count) ? found : addr_count;
+    bus->parasite = ds18b20_is_parasite(pin);
+    bus->resolution = 9;
+
+    for (int i = 0; i < bus->addr_count; i++) {
+        uint8_t resolution = 12;  // assume the worst if it can't be read
+        if (ds18b20_read_scratchpad(pin, addr_list[i], scratchpad)) {
+            // configuration register, R1 R0 in bits 6 and 5
+            resolution = 9 + ((scratchpad[4] >> 5) & 3);
+        }
+        if (resolution > bus->resolution) {
+            bus->resolution = resolution;
+        }
+    }
+    return bus->addr_count;
+}
+
+bool ds18b20_measure_and_read_buses(ds18b20_bus_t *buses, int bus_count, float *result_list) {
+    uint32_t failed;
+    bool result;
 
+    if (bus_count > 32) {
+        return false;
+    }
+    result = ds18b20_convert_buses(buses, bus_count, &failed);
+
+    for (int i = 0; i < bus_count; i++) {
+        ds18b20_bus_t *bus = &buses[i];
+        if (failed & (1u << i)) {
+            for (int j = 0; j < bus->addr_count; j++) {
+                result_list[j] = NAN;
+            }
+        } else if (!ds18b20_read_temp_multi(bus->pin, bus->addr_list, bus->addr_count, result_list)) {
+            result = false;
+        }
+        result_list += bus->addr_count;
+    }
+    return result;
+}
@@ -102,7 +102,12 @@ bool ds18b20_read_temp_multi(int pin, ds18b20_addr_t *addr_list, int addr_count,
  */
 float ds18b20_measure_and_read(int pin, ds18b20_addr_t addr);
 
-/** Perform a ds18b20_measure() followed by ds18b20_read_temp_multi()
+/** Measure on all sensors of a bus at once, followed by
+ *  ds18b20_read_temp_multi()
+ *
+ *  Like ds18b20_measure_and_read_buses() for a single bus, but it doesn't
+ *  know the resolution of the sensors. So if they are parasitically powered
+ *  it always waits 750ms, otherwise it polls for the end of the conversion.
  *
  *  @param pin         The GPIO pin connected to the DS18B20 bus
  *  @param addr_list   A list of addresses for devices to read.
@@ -132,6 +137,54 @@ bool ds18b20_measure_and_read_multi(int pin, ds18b20_addr_t *addr_list, int addr
  */
 bool ds18b20_read_scratchpad(int pin, ds18b20_addr_t addr, uint8_t *buffer);
 
+/** A DS18B20 bus for ds18b20_measure_and_read_buses(), set up with
+ *  ds18b20_bus_init().
+ */
+typedef struct {
+    int pin;                    ///< GPIO pin of the bus
+    ds18b20_addr_t *addr_list;  ///< addresses of the sensors on the bus
+    int addr_count;             ///< number of entries in `addr_list`
+    bool parasite;              ///< a sensor is parasitically powered
+    uint8_t resolution;         ///< highest sensor resolution, 9 to 12 bits
+} ds18b20_bus_t;
+
+/** Scan a bus once and record what is needed to time conversions on it.
+ *
+ *  Finds the sensors (like ds18b20_scan_devices()), checks whether any of
+ *  them is parasitically powered and reads their resolution.
+ *
+ *  @param bus         The bus to set up
+ *  @param pin         The GPIO pin connected to the DS18B20 bus
+ *  @param addr_list   An array to hold the addresses of the sensors
+ *  @param addr_count  Number of slots in the `addr_list` array
+ *
+ *  @returns The number of sensors found and recorded in `bus->addr_count`
+ *  (at most `addr_count`).
+ */
+int ds18b20_bus_init(ds18b20_bus_t *bus, int pin, ds18b20_addr_t *addr_list, int addr_count);
+
+/** Measure and read all sensors on one or more buses at the same time.
+ *
+ *  A single SKIP ROM + CONVERT_T starts the conversion on all sensors of a
+ *  bus, and all buses convert in parallel. On externally powered buses the
+ *  sensors are then polled until they report the conversion is complete;
+ *  parasitically powered buses are held high for the conversion time of
+ *  their resolution (93.75ms at 9 bits up to 750ms at 12 bits). So the
+ *  whole poll takes one conversion time plus the time to read the
+ *  scratchpads, regardless of the number of sensors.
+ *
+ *  @param buses        Array of buses set up with ds18b20_bus_init()
+ *  @param bus_count    Number of entries in `buses`, at most 32
+ *  @param result_list  Array to hold the temperatures of all sensors, the
+ *                      sensors of the first bus first. It should have as many
+ *                      entries as the sum of `addr_count` of all buses.
+ *
+ *  @returns `true` if all temperatures were fetched successfully, or `false`
+ *  if one or more had errors (the temperature for erroring devices will be
+ *  returned as NaN).
+ */
+bool ds18b20_measure_and_read_buses(ds18b20_bus_t *buses, int bus_count, float *result_list);
+
 // The following are obsolete/deprecated APIs
 
 typedef struct {
@@ -25,12 +25,15 @@ static inline uint8_t  bcdToDec(uint8_t bcd)
     return(((bcd / 16) * 10) + (bcd % 16));
 }
 
+/* I2C bus of the rtc, NULL for the bus set up by i2c_init() */
+static i2c_bus_t *ds3231_bus;
+
 /* Send a number of bytes to the rtc over i2c
  * returns true to indicate success
  */
 static inline bool ds3231_send(uint8_t *data, uint8_t len)
 {
-    return i2c_slave_write(DS3231_ADDR, data, len);
+    return i2c_bus_slave_write(ds3231_bus, DS3231_ADDR, data, len);
 }
 
 /* Read a number of bytes from the rtc over i2c
@@ -38,7 +41,7 @@ static inline bool ds3231_send(uint8_t *data, uint8_t len)
  */
 static inline bool ds3231_recv(uint8_t *data, uint8_t len)
 {
-    return i2c_slave_read(DS3231_ADDR, data[0], data, len);
+    return i2c_bus_read_regs(ds3231_bus, DS3231_ADDR, data[0], data, len);
 }
 
 bool ds3231_setTime(struct tm *time)
@@ -293,4 +296,10 @@ bool ds3231_getTime(struct tm *time)
 void ds3231_Init(uint8_t scl, uint8_t sda)
 {
     i2c_init(scl, sda);
+    ds3231_bus = NULL;
+}
+
+void ds3231_setBus(i2c_bus_t *bus)
+{
+    ds3231_bus = bus;
 }
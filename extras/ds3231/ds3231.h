@@ -12,6 +12,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <time.h>
+#include "i2c/i2c.h"
 
 #define DS3231_ADDR            0x68
 
@@ -184,4 +185,8 @@ bool ds3231_getTempFloat(float *temp);
 bool ds3231_getTime(struct tm *time);
 void ds3231_Init(uint8_t scl, uint8_t sda);
 
+/* Use a bus set up with i2c_bus_init() instead of calling ds3231_Init()
+ */
+void ds3231_setBus(i2c_bus_t *bus);
+
 #endif
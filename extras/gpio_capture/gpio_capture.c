@@ -0,0 +1,94 @@
+/**
+ * Edge capture on GPIO pins.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include "gpio_capture.h"
+#include <string.h>
+#include "esp/gpio.h"
+#include "xtensa_ops.h"
+#include "espressif/esp_system.h"
+
+static gpio_capture_t *captures[16];
+
+static IRAM void capture_interrupt(uint8_t pin)
+{
+    uint32_t now;
+    RSR(now, ccount);
+    uint32_t level = (GPIO.IN >> pin) & 1;
+
+    gpio_capture_t *cap = captures[pin];
+    if (!cap || cap->count >= cap->size) {
+        return;
+    }
+
+    cap->edges[cap->count++] = (now & ~1) | level;
+
+    if (cap->count == cap->size) {
+        GPIO.CONF[pin] = SET_FIELD(GPIO.CONF[pin], GPIO_CONF_INTTYPE, GPIO_INTTYPE_NONE);
+    }
+    if (cap->count == cap->notify_count || cap->count == cap->size) {
+        portBASE_TYPE woken = pdFALSE;
+        xSemaphoreGiveFromISR(cap->done, &woken);
+        portEND_SWITCHING_ISR(woken);
+    }
+}
+
+bool gpio_capture_init(gpio_capture_t *cap, uint8_t pin, uint32_t *buf, uint16_t size)
+{
+    memset(cap, 0, sizeof(gpio_capture_t));
+    cap->pin = pin;
+    cap->edges = buf;
+    cap->size = size;
+    vSemaphoreCreateBinary(cap->done);
+    if (!cap->done) {
+        return false;
+    }
+    // binary semaphores are created 'given'
+    xSemaphoreTake(cap->done, 0);
+    return true;
+}
+
+void gpio_capture_free(gpio_capture_t *cap)
+{
+    if (captures[cap->pin] == cap) {
+        gpio_capture_stop(cap);
+    }
+    if (cap->done) {
+        vSemaphoreDelete(cap->done);
+        cap->done = NULL;
+    }
+}
+
+void gpio_capture_start(gpio_capture_t *cap, uint16_t notify_count)
+{
+    gpio_set_interrupt(cap->pin, GPIO_INTTYPE_NONE);
+    xSemaphoreTake(cap->done, 0);
+    cap->count = 0;
+    cap->notify_count = notify_count;
+    captures[cap->pin] = cap;
+    GPIO.STATUS_CLEAR = BIT(cap->pin);
+    gpio_set_pin_interrupt(cap->pin, GPIO_INTTYPE_EDGE_ANY, capture_interrupt);
+}
+
+uint16_t gpio_capture_wait(gpio_capture_t *cap, portTickType timeout)
+{
+    if (cap->count < cap->notify_count && cap->count < cap->size) {
+        xSemaphoreTake(cap->done, timeout);
+    }
+    return cap->count;
+}
+
+uint16_t gpio_capture_stop(gpio_capture_t *cap)
+{
+    gpio_set_pin_interrupt(cap->pin, GPIO_INTTYPE_NONE, NULL);
+    captures[cap->pin] = NULL;
+    return cap->count;
+}
+
+uint32_t gpio_capture_us(const gpio_capture_t *cap, uint16_t from, uint16_t to)
+{
+    uint32_t cycles = (cap->edges[to] & ~1) - (cap->edges[from] & ~1);
+    return cycles / sdk_system_get_cpu_freq();
+}
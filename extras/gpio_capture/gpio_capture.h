@@ -0,0 +1,80 @@
+/**
+ * Edge capture on GPIO pins.
+ *
+ * Records a timestamp (the CPU cycle counter, CCOUNT) and the pin level on
+ * every edge from the GPIO interrupt, so pulse trains from DHT sensors,
+ * IR remotes, 433MHz receivers etc. can be decoded from the pulse widths
+ * afterwards instead of polling the pin with interrupts disabled.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __GPIO_CAPTURE_H__
+#define __GPIO_CAPTURE_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+typedef struct {
+    uint32_t *edges;          ///< CCOUNT of each edge, bit 0 is the level after it
+    uint16_t size;            ///< number of entries in edges
+    volatile uint16_t count;  ///< number of edges captured so far
+    uint16_t notify_count;
+    uint8_t pin;
+    xSemaphoreHandle done;
+} gpio_capture_t;
+
+/**
+ * Initialise a capture for a pin, using `buf` to store up to `size` edges.
+ *
+ * The pin has to be set up as input (or open drain output) by the caller.
+ *
+ * @return false if the semaphore couldn't be allocated.
+ */
+bool gpio_capture_init(gpio_capture_t *cap, uint8_t pin, uint32_t *buf, uint16_t size);
+
+/**
+ * Stop the capture if it is running and free its resources.
+ */
+void gpio_capture_free(gpio_capture_t *cap);
+
+/**
+ * Clear the buffer and start recording edges.
+ *
+ * @param notify_count Number of edges after which gpio_capture_wait()
+ *                     returns. The capture continues until the buffer is
+ *                     full or gpio_capture_stop() is called.
+ */
+void gpio_capture_start(gpio_capture_t *cap, uint16_t notify_count);
+
+/**
+ * Wait until `notify_count` edges have been captured, the buffer is full or
+ * the timeout expires.
+ *
+ * @return Number of edges captured so far.
+ */
+uint16_t gpio_capture_wait(gpio_capture_t *cap, portTickType timeout);
+
+/**
+ * Stop recording edges.
+ *
+ * @return Number of edges captured.
+ */
+uint16_t gpio_capture_stop(gpio_capture_t *cap);
+
+/**
+ * Pin level after edge `i`.
+ */
+static inline bool gpio_capture_level(const gpio_capture_t *cap, uint16_t i)
+{
+    return cap->edges[i] & 1;
+}
+
+/**
+ * Time in microseconds between edges `from` and `to`.
+ */
+uint32_t gpio_capture_us(const gpio_capture_t *cap, uint16_t from, uint16_t to);
+
+#endif  // __GPIO_CAPTURE_H__
@@ -23,236 +23,318 @@
  */
 
 #include <esp8266.h>
-#include <espressif/esp_misc.h> // sdk_os_delay_us
+#include <espressif/esp_system.h> // sdk_system_get_cpu_freq
+#include <xtensa_ops.h>
+#include <stdio.h>
 #include "i2c.h"
 
 
 // I2C driver for ESP8266 written for use with esp-open-rtos
 // Based on https://en.wikipedia.org/wiki/I²C#Example_of_bit-banging_the_I.C2.B2C_Master_protocol
+//
+// The lines are driven open drain by leaving the output latch at 0 and
+// switching the output enable through the GPIO registers: enabled pulls the
+// line low, disabled lets it float high. Every SCL half period is timed
+// against the CPU cycle counter from the previous edge, so the time spent
+// in the code between edges counts towards it instead of adding to it.
 
-// With calling overhead, we end up at ~100kbit/s
-#define CLK_HALF_PERIOD_US (1)
+// How long a slave may stretch the clock
+#define CLK_STRETCH_US (1000)
 
-#define CLK_STRETCH  (10)
+static const uint32_t bus_freq[] = {
+    [I2C_FREQ_100K] = 100000,
+    [I2C_FREQ_400K] = 400000,
+    [I2C_FREQ_1M] = 1000000,
+};
 
-static bool started;
-static uint8_t g_scl_pin;
-static uint8_t g_sda_pin;
+static i2c_bus_t default_bus;
 
-void i2c_init(uint8_t scl_pin, uint8_t sda_pin)
+static inline uint32_t get_ccount(void)
 {
-    started = false;
-    g_scl_pin = scl_pin;
-    g_sda_pin = sda_pin;
+    uint32_t ccount;
+    RSR(ccount, ccount);
+    return ccount;
+}
+
+void i2c_bus_init(i2c_bus_t *bus, uint8_t scl_pin, uint8_t sda_pin, i2c_freq_t freq)
+{
+    uint32_t cpu_freq = sdk_system_get_cpu_freq() * 1000000;
+
+    bus->scl_mask = BIT(scl_pin);
+    bus->sda_mask = BIT(sda_pin);
+    bus->half_period = cpu_freq / bus_freq[freq] / 2;
+    bus->stretch_timeout = cpu_freq / 1000000 * CLK_STRETCH_US;
+    bus->started = false;
 
     // Just to prevent these pins floating too much if not connected.
-    gpio_set_pullup(g_scl_pin, 1, 1);
-    gpio_set_pullup(g_sda_pin, 1, 1);
+    gpio_set_pullup(scl_pin, 1, 1);
+    gpio_set_pullup(sda_pin, 1, 1);
 
     // I2C bus idle state.
-    gpio_enable(g_scl_pin, GPIO_INPUT);
-    gpio_enable(g_scl_pin, GPIO_INPUT);
+    gpio_enable(scl_pin, GPIO_INPUT);
+    gpio_enable(sda_pin, GPIO_INPUT);
 
     // Set the pins to a low output state for when they are configured
     // as outputs.
-    gpio_write(g_scl_pin, 0);
-    gpio_write(g_sda_pin, 0);
+    gpio_write(scl_pin, 0);
+    gpio_write(sda_pin, 0);
+}
+
+static inline i2c_bus_t *get_bus(i2c_bus_t *bus)
+{
+    return bus ? bus : &default_bus;
+}
+
+// Wait until half a clock period has passed since the last edge
+static inline void i2c_delay(i2c_bus_t *bus)
+{
+    uint32_t now;
+    do {
+        now = get_ccount();
+    } while (now - bus->edge < bus->half_period);
+    bus->edge = now;
 }
 
-static void i2c_delay(void)
+// Let SCL float high and wait (up to CLK_STRETCH_US) for slaves stretching
+// the clock
+static inline void release_scl(i2c_bus_t *bus)
 {
-    sdk_os_delay_us(CLK_HALF_PERIOD_US);
+    GPIO.ENABLE_OUT_CLEAR = bus->scl_mask;
+    if (!(GPIO.IN & bus->scl_mask)) {
+        uint32_t start = get_ccount();
+        while (!(GPIO.IN & bus->scl_mask)) {
+            if (get_ccount() - start > bus->stretch_timeout)
+                return;
+        }
+        // the high period starts now
+        bus->edge = get_ccount();
+    }
 }
 
-// Set SCL as input, allowing it to float high, and return current
-// level of line, 0 or 1
-static bool read_scl(void)
+// Let SDA float high
+static inline void release_sda(i2c_bus_t *bus)
 {
-    gpio_enable(g_scl_pin, GPIO_INPUT);
-    return gpio_read(g_scl_pin); // Clock high, valid ACK
+    GPIO.ENABLE_OUT_CLEAR = bus->sda_mask;
 }
 
-// Set SDA as input and return current level of line, 0 or 1
-static bool read_sda(void)
+static inline bool read_sda(i2c_bus_t *bus)
 {
-    gpio_enable(g_sda_pin, GPIO_INPUT);
-    // TODO: Without this delay we get arbitration lost in i2c_stop
-    i2c_delay();
-    return gpio_read(g_sda_pin); // Clock high, valid ACK
+    return (GPIO.IN & bus->sda_mask) != 0;
 }
 
 // Actively drive SCL signal low
-static void clear_scl(void)
+static inline void clear_scl(i2c_bus_t *bus)
 {
-    gpio_enable(g_scl_pin, GPIO_OUT_OPEN_DRAIN);
+    GPIO.ENABLE_OUT_SET = bus->scl_mask;
 }
 
 // Actively drive SDA signal low
-static void clear_sda(void)
+static inline void clear_sda(i2c_bus_t *bus)
 {
-    gpio_enable(g_sda_pin, GPIO_OUT_OPEN_DRAIN);
+    GPIO.ENABLE_OUT_SET = bus->sda_mask;
 }
 
 // Output start condition
-void i2c_start(void)
+void i2c_bus_start(i2c_bus_t *bus)
 {
-    uint32_t clk_stretch = CLK_STRETCH;
-    if (started) { // if started, do a restart cond
+    bus = get_bus(bus);
+    if (bus->started) { // if started, do a restart cond
         // Set SDA to 1
-        (void) read_sda();
-        i2c_delay();
-        while (read_scl() == 0 && clk_stretch--) ;
-        // Repeated start setup time, minimum 4.7us
-        i2c_delay();
+        release_sda(bus);
+        i2c_delay(bus);
+        release_scl(bus);
+        // Repeated start setup time
+        i2c_delay(bus);
+    } else {
+        bus->edge = get_ccount();
     }
-    if (read_sda() == 0) {
+    if (!read_sda(bus)) {
         printf("I2C: arbitration lost in i2c_start\n");
     }
     // SCL is high, set SDA from 1 to 0.
-    clear_sda();
-    i2c_delay();
-    clear_scl();
-    started = true;
+    clear_sda(bus);
+    i2c_delay(bus);
+    clear_scl(bus);
+    bus->started = true;
 }
 
 // Output stop condition
-void i2c_stop(void)
+void i2c_bus_stop(i2c_bus_t *bus)
 {
-    uint32_t clk_stretch = CLK_STRETCH;
+    bus = get_bus(bus);
     // Set SDA to 0
-    clear_sda();
-    i2c_delay();
-    // Clock stretching
-    while (read_scl() == 0 && clk_stretch--) ;
-    // Stop bit setup time, minimum 4us
-    i2c_delay();
+    clear_sda(bus);
+    i2c_delay(bus);
+    release_scl(bus);
+    // Stop bit setup time
+    i2c_delay(bus);
     // SCL is high, set SDA from 0 to 1
-    if (read_sda() == 0) {
+    release_sda(bus);
+    i2c_delay(bus);
+    if (!read_sda(bus)) {
         printf("I2C: arbitration lost in i2c_stop\n");
     }
-    i2c_delay();
-    started = false;
+    bus->started = false;
 }
 
 // Write a bit to I2C bus
-static void i2c_write_bit(bool bit)
+static inline void i2c_write_bit(i2c_bus_t *bus, bool bit)
 {
-    uint32_t clk_stretch = CLK_STRETCH;
     if (bit) {
-        (void) read_sda();
+        release_sda(bus);
     } else {
-        clear_sda();
+        clear_sda(bus);
     }
-    i2c_delay();
-    // Clock stretching
-    while (read_scl() == 0 && clk_stretch--) ;
+    i2c_delay(bus);
+    release_scl(bus);
+    i2c_delay(bus);
     // SCL is high, now data is valid
     // If SDA is high, check that nobody else is driving SDA
-    if (bit && read_sda() == 0) {
+    if (bit && !read_sda(bus)) {
         printf("I2C: arbitration lost in i2c_write_bit\n");
     }
-    i2c_delay();
-    clear_scl();
+    clear_scl(bus);
 }
 
 // Read a bit from I2C bus
-static bool i2c_read_bit(void)
+static inline bool i2c_read_bit(i2c_bus_t *bus)
 {
-    uint32_t clk_stretch = CLK_STRETCH;
     bool bit;
     // Let the slave drive data
-    (void) read_sda();
-    i2c_delay();
-    // Clock stretching
-    while (read_scl() == 0 && clk_stretch--) ;
+    release_sda(bus);
+    i2c_delay(bus);
+    release_scl(bus);
+    i2c_delay(bus);
     // SCL is high, now data is valid
-    bit = read_sda();
-    i2c_delay();
-    clear_scl();
+    bit = read_sda(bus);
+    clear_scl(bus);
     return bit;
 }
 
-bool i2c_write(uint8_t byte)
+bool i2c_bus_write(i2c_bus_t *bus, uint8_t byte)
 {
-    bool nack;
-    uint8_t bit;
-    for (bit = 0; bit < 8; bit++) {
-        i2c_write_bit((byte & 0x80) != 0);
+    bus = get_bus(bus);
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        i2c_write_bit(bus, (byte & 0x80) != 0);
         byte <<= 1;
     }
-    nack = i2c_read_bit();
-    return !nack;
+    return !i2c_read_bit(bus);
 }
 
-uint8_t i2c_read(bool ack)
+uint8_t i2c_bus_read(i2c_bus_t *bus, bool last)
 {
     uint8_t byte = 0;
-    uint8_t bit;
-    for (bit = 0; bit < 8; bit++) {
-        byte = (byte << 1) | i2c_read_bit();
+
+    bus = get_bus(bus);
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        byte = (byte << 1) | i2c_read_bit(bus);
     }
-    i2c_write_bit(ack);
+    i2c_write_bit(bus, last);
     return byte;
 }
 
-bool i2c_slave_write(uint8_t slave_addr, uint8_t *data, uint8_t len)
+// Write 'out' followed by 'data' to the slave, then read 'in_len' bytes
+// after a repeated start (if 'in_len' isn't 0)
+static bool transfer(i2c_bus_t *bus, uint8_t slave_addr,
+                     const uint8_t *out, size_t out_len,
+                     const uint8_t *data, size_t data_len,
+                     uint8_t *in, size_t in_len)
 {
     bool success = false;
+
+    bus = get_bus(bus);
     do {
-        i2c_start();
-        if (!i2c_write(slave_addr << 1))
-            break;
-        while (len--) {
-            if (!i2c_write(*data++))
+        if (out_len || data_len || !in_len) {
+            i2c_bus_start(bus);
+            if (!i2c_bus_write(bus, slave_addr << 1))
+                break;
+            while (out_len && i2c_bus_write(bus, *out)) {
+                out++;
+                out_len--;
+            }
+            while (data_len && i2c_bus_write(bus, *data)) {
+                data++;
+                data_len--;
+            }
+            if (out_len || data_len)
+                break;
+        }
+        if (in_len) {
+            i2c_bus_start(bus);
+            if (!i2c_bus_write(bus, slave_addr << 1 | 1)) // Slave address + read
                 break;
+            while (in_len) {
+                *in++ = i2c_bus_read(bus, in_len == 1);
+                in_len--;
+            }
         }
-        i2c_stop();
         success = true;
-    } while(0);
+    } while (0);
+    i2c_bus_stop(bus);
     return success;
 }
 
+bool i2c_bus_slave_write(i2c_bus_t *bus, uint8_t slave_addr, const uint8_t *buf, size_t len)
+{
+    return transfer(bus, slave_addr, buf, len, NULL, 0, NULL, 0);
+}
+
+bool i2c_bus_slave_read(i2c_bus_t *bus, uint8_t slave_addr, uint8_t *buf, size_t len)
+{
+    return transfer(bus, slave_addr, NULL, 0, NULL, 0, buf, len);
+}
+
+bool i2c_bus_write_regs(i2c_bus_t *bus, uint8_t slave_addr, uint8_t reg, const uint8_t *buf, size_t len)
+{
+    return transfer(bus, slave_addr, &reg, 1, buf, len, NULL, 0);
+}
+
+bool i2c_bus_read_regs(i2c_bus_t *bus, uint8_t slave_addr, uint8_t reg, uint8_t *buf, size_t len)
+{
+    return transfer(bus, slave_addr, &reg, 1, NULL, 0, buf, len);
+}
+
+// Single bus API
+
+void i2c_init(uint8_t scl_pin, uint8_t sda_pin)
+{
+    i2c_bus_init(&default_bus, scl_pin, sda_pin, I2C_FREQ_100K);
+}
+
+void i2c_start(void)
+{
+    i2c_bus_start(&default_bus);
+}
+
+void i2c_stop(void)
+{
+    i2c_bus_stop(&default_bus);
+}
+
+bool i2c_write(uint8_t byte)
+{
+    return i2c_bus_write(&default_bus, byte);
+}
+
+uint8_t i2c_read(bool ack)
+{
+    return i2c_bus_read(&default_bus, ack);
+}
+
+bool i2c_slave_write(uint8_t slave_addr, uint8_t *data, uint8_t len)
+{
+    return transfer(&default_bus, slave_addr, data, len, NULL, 0, NULL, 0);
+}
+
 bool i2c_slave_word_write(uint16_t slave_addr, uint16_t regID, uint8_t *data, uint8_t len)
 {
-    bool success = false;
-    do {
-        i2c_start();
-        if (!i2c_write((slave_addr << 1) & 0xFE))
-            break;
-        i2c_write(regID >> 8);
-        i2c_write(regID & 0x00FF);
-        while (len--) {
-            if (!i2c_write(*data++))
-                break;
-        }
-        i2c_stop();
-        success = true;
-    } while(0);
-    return success;
+    uint8_t reg[] = { regID >> 8, regID & 0xFF };
+    return transfer(&default_bus, slave_addr, reg, 2, data, len, NULL, 0);
 }
 
 bool i2c_slave_read(uint8_t slave_addr, uint8_t data, uint8_t *buf, uint32_t len)
 {
-    bool success = false;
-    do {
-        i2c_start();
-        if (!i2c_write(slave_addr << 1)) {
-            break;
-        }
-        i2c_write(data);
-        i2c_stop();
-        i2c_start();
-        if (!i2c_write(slave_addr << 1 | 1)) { // Slave address + read
-            break;
-        }
-        while(len) {
-            *buf = i2c_read(len == 1);
-            buf++;
-            len--;
-        }
-        success = true;
-    } while(0);
-    i2c_stop();
+    bool success = transfer(&default_bus, slave_addr, &data, 1, NULL, 0, buf, len);
     if (!success) {
         printf("I2C: write error\n");
     }
@@ -261,27 +343,8 @@ bool i2c_slave_read(uint8_t slave_addr, uint8_t data, uint8_t *buf, uint32_t len
 
 bool i2c_slave_word_read(uint8_t slave_addr, uint16_t data, uint8_t *buf, uint32_t len)
 {
-    bool success = false;
-    do {
-        i2c_start();
-        if (!i2c_write(slave_addr << 1)) {
-            break;
-        }
-        i2c_write(data >> 8);
-        i2c_write(data & 0x00FF);
-        i2c_stop();
-        i2c_start();
-        if (!i2c_write(slave_addr << 1 | 1)) { // Slave address + read
-            break;
-        }
-        while(len) {
-            *buf = i2c_read(len == 1);
-            buf++;
-            len--;
-        }
-        success = true;
-    } while(0);
-    i2c_stop();
+    uint8_t reg[] = { data >> 8, data & 0xFF };
+    bool success = transfer(&default_bus, slave_addr, reg, 2, NULL, 0, buf, len);
     if (!success) {
         printf("I2C: write error\n");
     }
@@ -24,10 +24,59 @@
 
 #ifndef __I2C_H__
 #define __I2C_H__
-#endif
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    I2C_FREQ_100K,  // standard mode
+    I2C_FREQ_400K,  // fast mode
+    I2C_FREQ_1M,    // fast mode plus, ~1MHz at 160MHz CPU clock
+} i2c_freq_t;
+
+// One I2C bus on a pair of GPIO pins. Set up with i2c_bus_init(), the
+// fields are private to the driver. Several buses can be used, but access
+// to each one has to be serialised by the caller.
+typedef struct {
+    uint32_t scl_mask;
+    uint32_t sda_mask;
+    uint32_t half_period;       // CPU cycles per half SCL period
+    uint32_t stretch_timeout;   // CPU cycles to wait for clock stretching
+    uint32_t edge;              // CCOUNT at the last SCL edge
+    bool started;
+} i2c_bus_t;
+
+// Init bitbanging I2C bus on given pins. The clock is timed with the CPU
+// cycle counter, so call this again if the CPU frequency is changed.
+void i2c_bus_init(i2c_bus_t *bus, uint8_t scl_pin, uint8_t sda_pin, i2c_freq_t freq);
+
+// All i2c_bus_* functions accept NULL for the bus set up by i2c_init().
+
+// Write 'len' bytes from 'buf' to slave. Return true if slave acked all.
+bool i2c_bus_slave_write(i2c_bus_t *bus, uint8_t slave_addr, const uint8_t *buf, size_t len);
+
+// Read 'len' bytes from slave into 'buf'. Return true if slave acked.
+bool i2c_bus_slave_read(i2c_bus_t *bus, uint8_t slave_addr, uint8_t *buf, size_t len);
+
+// Write register address 'reg' followed by 'len' bytes from 'buf', e.g. to
+// fill a block of consecutive registers. Return true if slave acked all.
+bool i2c_bus_write_regs(i2c_bus_t *bus, uint8_t slave_addr, uint8_t reg, const uint8_t *buf, size_t len);
+
+// Write register address 'reg', then read 'len' bytes from consecutive
+// registers into 'buf' after a repeated start. Return true if slave acked.
+bool i2c_bus_read_regs(i2c_bus_t *bus, uint8_t slave_addr, uint8_t reg, uint8_t *buf, size_t len);
+
+// Low level access, for protocols the functions above don't cover.
+void i2c_bus_start(i2c_bus_t *bus);
+void i2c_bus_stop(i2c_bus_t *bus);
+// Write a byte to I2C bus. Return true if slave acked.
+bool i2c_bus_write(i2c_bus_t *bus, uint8_t byte);
+// Read a byte from I2C bus. Set 'last' for the last byte of a read, the
+// master then sends NACK instead of ACK.
+uint8_t i2c_bus_read(i2c_bus_t *bus, bool last);
+
+// Single bus API, on a bus at 100kHz set up by i2c_init().
 
 // Init bitbanging I2C driver on given pins
 void i2c_init(uint8_t scl_pin, uint8_t sda_pin);
@@ -35,7 +84,8 @@ void i2c_init(uint8_t scl_pin, uint8_t sda_pin);
 // Write a byte to I2C bus. Return true if slave acked.
 bool i2c_write(uint8_t byte);
 
-// Read a byte from I2C bus. Return true if slave acked.
+// Read a byte from I2C bus. Sends NACK if 'ack' is true (last byte), ACK
+// otherwise.
 uint8_t i2c_read(bool ack);
 
 // Write 'len' bytes from 'buf' to slave. Return true if slave acked.
@@ -53,3 +103,5 @@ bool i2c_slave_word_write(uint16_t slave_addr, uint16_t regID, uint8_t *data, ui
 // devices where the i2c_slave_[read|write] functions above are of no use.
 void i2c_start(void);
 void i2c_stop(void);
+
+#endif // __I2C_H__
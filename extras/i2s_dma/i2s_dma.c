@@ -27,8 +27,12 @@
 #include "esp/i2s_regs.h"
 #include "esp/interrupts.h"
 #include "common_macros.h"
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "task.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 // #define I2S_DMA_DEBUG
 
@@ -61,18 +65,61 @@ void sdk_rom_i2c_writeReg_Mask(uint32_t block, uint32_t host_id,
             reg_add##_lsb,  indata)
 
 
+// Transmit and receive share the I2S DMA enable bit, so it stays set while
+// either of them is running. Each side only resets its own half of I2S and
+// of the DMA, so one can be started and stopped while the other runs.
+static volatile bool tx_running;
+static volatile bool rx_running;
+
+static void update_dma_enable()
+{
+    if (tx_running || rx_running) {
+        SET_MASK_BITS(I2S.FIFO_CONF, I2S_FIFO_CONF_DESCRIPTOR_ENABLE);
+    } else {
+        CLEAR_MASK_BITS(I2S.FIFO_CONF, I2S_FIFO_CONF_DESCRIPTOR_ENABLE);
+    }
+}
+
+// Enable the I2S clock and set the configuration shared by transmit and
+// receive
+static void i2s_config(i2s_clock_div_t clock_div)
+{
+    // enable clock to i2s subsystem
+    i2c_writeReg_Mask_def(i2c_bbpll, i2c_bbpll_en_audio_clock_out, 1);
+
+    // 16 bits per channel, right_first, msb right
+    I2S.CONF = SET_FIELD(I2S.CONF, I2S_CONF_BITS_MOD, 0);
+    SET_MASK_BITS(I2S.CONF, I2S_CONF_RIGHT_FIRST | I2S_CONF_MSB_RIGHT);
+    I2S.CONF = SET_FIELD(I2S.CONF, I2S_CONF_BCK_DIV, clock_div.bclk_div);
+    I2S.CONF = SET_FIELD(I2S.CONF, I2S_CONF_CLKM_DIV, clock_div.clkm_div);
+}
+
+// Reset the transmit side of I2S and configure it as master, 16 bits per
+// channel (FIFO_MOD=0), MSB shift
+static void tx_config()
+{
+    SET_MASK_BITS(I2S.CONF, I2S_CONF_TX_RESET | I2S_CONF_TX_FIFO_RESET);
+    CLEAR_MASK_BITS(I2S.CONF, I2S_CONF_TX_RESET | I2S_CONF_TX_FIFO_RESET);
+
+    I2S.FIFO_CONF = SET_FIELD(I2S.FIFO_CONF, I2S_FIFO_CONF_TX_FIFO_MOD, 0);
+    CLEAR_MASK_BITS(I2S.CONF, I2S_CONF_TX_SLAVE_MOD);
+    SET_MASK_BITS(I2S.CONF, I2S_CONF_TX_MSB_SHIFT);
+}
+
 void i2s_dma_init(i2s_dma_isr_t isr, i2s_clock_div_t clock_div, i2s_pins_t pins)
 {
-    // reset DMA
+    // reset transmit DMA
     SET_MASK_BITS(SLC.CONF0, SLC_CONF0_RX_LINK_RESET);
     CLEAR_MASK_BITS(SLC.CONF0, SLC_CONF0_RX_LINK_RESET);
 
-    // clear DMA int flags
-    SLC.INT_CLEAR = 0xFFFFFFFF;
+    // clear DMA int flags, except for blocks received meanwhile
+    SLC.INT_CLEAR = rx_running ? ~SLC_INT_CLEAR_TX_EOF : 0xFFFFFFFF;
     SLC.INT_CLEAR = 0;
 
     // Enable and configure DMA
-    SLC.CONF0 = SET_FIELD(SLC.CONF0, SLC_CONF0_MODE, 0);   // does it really needed?
+    if (!rx_running) {
+        SLC.CONF0 = SET_FIELD(SLC.CONF0, SLC_CONF0_MODE, 0);   // does it really needed?
+    }
     SLC.CONF0 = SET_FIELD(SLC.CONF0, SLC_CONF0_MODE, 1);
 
     // Do we really need to set and clear?
@@ -101,29 +148,8 @@ void i2s_dma_init(i2s_dma_isr_t isr, i2s_clock_div_t clock_div, i2s_pins_t pins)
         iomux_set_function(gpio_to_iomux(2), IOMUX_GPIO2_FUNC_I2SO_WS);
     }
 
-    // enable clock to i2s subsystem
-    i2c_writeReg_Mask_def(i2c_bbpll, i2c_bbpll_en_audio_clock_out, 1);
-
-    // reset I2S subsystem
-    CLEAR_MASK_BITS(I2S.CONF, I2S_CONF_RESET_MASK);
-    SET_MASK_BITS(I2S.CONF, I2S_CONF_RESET_MASK);
-    CLEAR_MASK_BITS(I2S.CONF, I2S_CONF_RESET_MASK);
-
-    // select 16bits per channel (FIFO_MOD=0), no DMA access (FIFO only)
-    CLEAR_MASK_BITS(I2S.FIFO_CONF, I2S_FIFO_CONF_DESCRIPTOR_ENABLE);
-    I2S.FIFO_CONF = SET_FIELD(I2S.FIFO_CONF, I2S_FIFO_CONF_RX_FIFO_MOD, 0);
-    I2S.FIFO_CONF = SET_FIELD(I2S.FIFO_CONF, I2S_FIFO_CONF_TX_FIFO_MOD, 0);
-
-    //trans master&rece slave,MSB shift,right_first,msb right
-    CLEAR_MASK_BITS(I2S.CONF, I2S_CONF_TX_SLAVE_MOD);
-    I2S.CONF = SET_FIELD(I2S.CONF, I2S_CONF_BITS_MOD, 0);
-    I2S.CONF = SET_FIELD(I2S.CONF, I2S_CONF_BCK_DIV, 0);
-    I2S.CONF = SET_FIELD(I2S.CONF, I2S_CONF_CLKM_DIV, 0);
-
-    SET_MASK_BITS(I2S.CONF, I2S_CONF_RIGHT_FIRST | I2S_CONF_MSB_RIGHT |
-            I2S_CONF_RX_SLAVE_MOD | I2S_CONF_RX_MSB_SHIFT | I2S_CONF_TX_MSB_SHIFT);
-    I2S.CONF = SET_FIELD(I2S.CONF, I2S_CONF_BCK_DIV, clock_div.bclk_div);
-    I2S.CONF = SET_FIELD(I2S.CONF, I2S_CONF_CLKM_DIV, clock_div.clkm_div);
+    i2s_config(clock_div);
+    tx_config();
 }
 
 // Base frequency for I2S subsystem is independent from CPU clock.
@@ -151,14 +177,30 @@ i2s_clock_div_t i2s_get_clock_div(int32_t freq)
     return div;
 }
 
+i2s_clock_div_t i2s_get_sample_rate_div(uint32_t sample_rate)
+{
+    // 16 bits per channel, 2 channels
+    return i2s_get_clock_div(sample_rate * 2 * 16);
+}
+
+uint32_t i2s_get_sample_rate(i2s_clock_div_t clock_div)
+{
+    if (!clock_div.bclk_div || !clock_div.clkm_div) {
+        return 0;
+    }
+    return BASE_FREQ / (clock_div.bclk_div * clock_div.clkm_div) / (2 * 16);
+}
+
 void i2s_dma_start(dma_descriptor_t *descr)
 {
-    // configure DMA descriptor
+    // configure DMA descriptor, the field only takes the low bits of the address
     SLC.RX_LINK = SET_FIELD(SLC.RX_LINK, SLC_RX_LINK_DESCRIPTOR_ADDR, 0);
-    SLC.RX_LINK = SET_FIELD(SLC.RX_LINK, SLC_RX_LINK_DESCRIPTOR_ADDR, (uint32_t)descr);
+    SLC.RX_LINK = SET_FIELD_M(SLC.RX_LINK, SLC_RX_LINK_DESCRIPTOR_ADDR, (uint32_t)descr);
+    SET_MASK_BITS(SLC.RX_LINK, SLC_RX_LINK_START);
 
     // enable DMA in i2s subsystem
-    SET_MASK_BITS(I2S.FIFO_CONF, I2S_FIFO_CONF_DESCRIPTOR_ENABLE);
+    tx_running = true;
+    update_dma_enable();
 
     //Start transmission
     SET_MASK_BITS(I2S.CONF, I2S_CONF_TX_START);
@@ -167,5 +209,487 @@ void i2s_dma_start(dma_descriptor_t *descr)
 void i2s_dma_stop()
 {
     SLC.RX_LINK = SET_FIELD(SLC.RX_LINK, SLC_RX_LINK_DESCRIPTOR_ADDR, 0);
-    CLEAR_MASK_BITS(I2S.FIFO_CONF, I2S_FIFO_CONF_DESCRIPTOR_ENABLE);
+    tx_running = false;
+    update_dma_enable();
+}
+
+// Maximum length of a DMA block, limited by the descriptor's 12 bit fields
+#define MAX_BLOCK_SIZE  4092
+
+// States of an output block. The descriptor of a block only points at its
+// buffer while the block is armed, otherwise at a shared block of silence, so
+// the DMA never plays a block the writer is still filling.
+enum {
+    BLOCK_FREE,     // with the writer, or in the free queue
+    BLOCK_FILLED,   // has data, waiting to be armed
+    BLOCK_ARMED,    // descriptor points at the data, to be played
+};
+
+static struct {
+    dma_descriptor_t *descr;   // circular list of descriptors
+    uint8_t *buf;              // block_count buffers of block_size
+    uint8_t *silence;          // block_size of zeroes
+    volatile uint8_t *state;   // BLOCK_* of each block
+    uint16_t block_size;
+    uint8_t block_count;
+    uint8_t done;              // next block the DMA will finish
+    uint8_t arm_next;          // next block to be armed, in writing order
+    int16_t cur;               // block being filled by the writer, -1 if none
+    uint16_t cur_len;          // bytes written into the current block
+    bool running;
+    xQueueHandle free_queue;   // indexes of blocks available to the writer
+    volatile uint32_t blocks;
+    volatile uint32_t underruns;
+} stream;
+
+// Received blocks are numbered from 0 when receiving starts, block number n
+// is in buffer n % block_count.
+static struct {
+    dma_descriptor_t *descr;   // circular list of descriptors
+    uint8_t *buf;              // block_count buffers of block_size
+    uint16_t block_size;
+    uint8_t block_count;
+    volatile uint32_t seq;     // number of blocks received, the DMA fills this one
+    bool reading;              // the reader has a block
+    uint32_t cur;              // number of the block being read
+    uint16_t cur_len;          // bytes already read from the current block
+    i2s_dma_rx_cb_t callback;
+    xQueueHandle ready_queue;  // numbers of blocks ready for reading
+    volatile uint32_t blocks;
+    volatile uint32_t overruns;
+} rx;
+
+// Handle blocks received from I2S, called from the DMA interrupt handler
+static void rx_isr(portBASE_TYPE *task_awoken)
+{
+    uint8_t last = (dma_descriptor_t*)SLC.TX_EOF_DESCRIPTOR_ADDR - rx.descr;
+
+    uint8_t block;
+    do {
+        uint32_t seq = rx.seq++;
+        block = seq % rx.block_count;
+        // Hand the descriptor straight back to the DMA, the ring keeps going
+        rx.descr[block].owner = 1;
+        rx.blocks++;
+        if (rx.callback) {
+            rx.callback(rx.buf + block * rx.block_size, rx.block_size);
+            continue;
+        }
+        if (xQueueIsQueueFullFromISR(rx.ready_queue)) {
+            // Reader is too slow, drop the oldest block as the DMA is about
+            // to overwrite it
+            uint32_t dummy;
+            xQueueReceiveFromISR(rx.ready_queue, &dummy, task_awoken);
+            rx.overruns++;
+        }
+        xQueueSendFromISR(rx.ready_queue, &seq, task_awoken);
+    } while (block != last);
+}
+
+// Point the descriptors of filled blocks at their data, in the order they
+// were written. Not the block being played, the DMA has already read its
+// descriptor: if it missed its turn it waits for the next round, and so do
+// the blocks after it.
+static void stream_arm(uint8_t playing)
+{
+    while (stream.state[stream.arm_next] == BLOCK_FILLED && stream.arm_next != playing) {
+        uint8_t block = stream.arm_next;
+        stream.descr[block].buf_ptr = stream.buf + block * stream.block_size;
+        stream.state[block] = BLOCK_ARMED;
+        stream.arm_next = (block + 1) % stream.block_count;
+    }
+}
+
+// DMA interrupt handler for streaming. It is called each time a DMA block is
+// finished playing or receiving.
+static void stream_isr_handler(void)
+{
+    portBASE_TYPE task_awoken = pdFALSE;
+
+    if (rx.descr && (SLC.INT_STATUS & SLC_INT_STATUS_TX_EOF)) {
+        rx_isr(&task_awoken);
+    }
+
+    if (stream.descr && i2s_dma_is_eof_interrupt()) {
+        uint8_t last = i2s_dma_get_eof_descriptor() - stream.descr;
+
+        // If the interrupt was delayed more than one block may have finished
+        uint8_t block;
+        do {
+            block = stream.done;
+            stream.done = (block + 1) % stream.block_count;
+            if (stream.state[block] == BLOCK_ARMED) {
+                // Played, back to silence until the writer has refilled it
+                stream.state[block] = BLOCK_FREE;
+                stream.descr[block].buf_ptr = stream.silence;
+                stream.blocks++;
+                xQueueSendFromISR(stream.free_queue, &block, &task_awoken);
+            } else {
+                // Writer didn't fill the block in time, it played as silence
+                stream.underruns++;
+            }
+        } while (block != last);
+        stream_arm(stream.done);
+    }
+    i2s_dma_clear_interrupt();
+
+    portEND_SWITCHING_ISR(task_awoken);
+}
+
+static void stream_reset()
+{
+    xQueueReset(stream.free_queue);
+    for (uint8_t i = 0; i < stream.block_count; i++) {
+        stream.state[i] = BLOCK_FREE;
+        stream.descr[i].buf_ptr = stream.silence;
+        xQueueSend(stream.free_queue, &i, 0);
+    }
+    stream.done = 0;
+    stream.arm_next = 0;
+    stream.cur = -1;
+    stream.cur_len = 0;
+}
+
+bool i2s_dma_stream_init(i2s_clock_div_t clock_div, i2s_pins_t pins,
+        uint16_t block_size, uint8_t block_count)
+{
+    if (stream.descr || block_size == 0 || block_size > MAX_BLOCK_SIZE ||
+            (block_size & 3) || block_count < 2) {
+        return false;
+    }
+
+    // One allocation for descriptors, buffers, silence and states
+    size_t descr_len = block_count * sizeof(dma_descriptor_t);
+    uint8_t *mem = malloc(descr_len + block_size * (block_count + 1) + block_count);
+    if (!mem) {
+        return false;
+    }
+    stream.free_queue = xQueueCreate(block_count, sizeof(uint8_t));
+    if (!stream.free_queue) {
+        free(mem);
+        return false;
+    }
+    stream.descr = (dma_descriptor_t *)mem;
+    stream.buf = mem + descr_len;
+    stream.silence = stream.buf + block_size * block_count;
+    stream.state = stream.silence + block_size;
+    memset(stream.silence, 0, block_size);
+    stream.block_size = block_size;
+    stream.block_count = block_count;
+    stream.running = false;
+    stream.blocks = 0;
+    stream.underruns = 0;
+
+    for (int i = 0; i < block_count; i++) {
+        stream.descr[i].owner = 1;
+        stream.descr[i].eof = 1;
+        stream.descr[i].sub_sof = 0;
+        stream.descr[i].unused = 0;
+        stream.descr[i].datalen = block_size;
+        stream.descr[i].blocksize = block_size;
+        stream.descr[i].next_link_ptr = &stream.descr[(i + 1) % block_count];
+    }
+    stream_reset();
+
+    i2s_dma_init(stream_isr_handler, clock_div, pins);
+    return true;
+}
+
+void i2s_dma_stream_deinit()
+{
+    if (!stream.descr) {
+        return;
+    }
+    i2s_dma_stream_stop();
+    CLEAR_MASK_BITS(SLC.INT_ENABLE, SLC_INT_ENABLE_RX_EOF);
+    if (!rx.descr) {
+        _xt_isr_mask(1<<INUM_SLC);
+    }
+    vQueueDelete(stream.free_queue);
+    free(stream.descr);
+    stream.descr = NULL;
+}
+
+static void stream_start()
+{
+    if (!stream.running) {
+        // Nothing is being played yet
+        stream_arm(stream.block_count);
+        stream.running = true;
+        i2s_dma_start(stream.descr);
+    }
+}
+
+// Queue the current block for playing
+static void stream_commit()
+{
+    stream.state[stream.cur] = BLOCK_FILLED;
+    stream.cur = -1;
+}
+
+size_t i2s_dma_write(const void *data, size_t len, portTickType timeout)
+{
+    const uint8_t *src = data;
+    size_t written = 0;
+
+    while (written < len) {
+        if (stream.cur < 0) {
+            uint8_t block;
+            if (xQueueReceive(stream.free_queue, &block, 0) != pdTRUE) {
+                // Ring is full, time to start playing it
+                stream_start();
+                if (xQueueReceive(stream.free_queue, &block, timeout) != pdTRUE) {
+                    break;
+                }
+            }
+            stream.cur = block;
+            stream.cur_len = 0;
+        }
+
+        size_t n = stream.block_size - stream.cur_len;
+        if (n > len - written) {
+            n = len - written;
+        }
+        memcpy(stream.buf + stream.cur * stream.block_size + stream.cur_len,
+                src + written, n);
+        stream.cur_len += n;
+        written += n;
+
+        if (stream.cur_len == stream.block_size) {
+            stream_commit();
+        }
+    }
+    return written;
+}
+
+size_t i2s_dma_writev(const i2s_dma_iovec_t *iov, int iovcnt, portTickType timeout)
+{
+    size_t written = 0;
+
+    for (int i = 0; i < iovcnt; i++) {
+        size_t n = i2s_dma_write(iov[i].data, iov[i].len, timeout);
+        written += n;
+        if (n < iov[i].len) {
+            break;
+        }
+    }
+    return written;
+}
+
+void i2s_dma_flush()
+{
+    if (stream.cur >= 0 && stream.cur_len > 0) {
+        memset(stream.buf + stream.cur * stream.block_size + stream.cur_len, 0,
+                stream.block_size - stream.cur_len);
+        stream_commit();
+    }
+    stream_start();
+}
+
+void i2s_dma_stream_stop()
+{
+    i2s_dma_stop();
+    stream.running = false;
+    stream_reset();
+}
+
+void i2s_dma_get_stats(i2s_dma_stats_t *stats, bool reset)
+{
+    taskENTER_CRITICAL();
+    stats->blocks = stream.blocks;
+    stats->underruns = stream.underruns;
+    if (reset) {
+        stream.blocks = 0;
+        stream.underruns = 0;
+    }
+    taskEXIT_CRITICAL();
+    stats->free_blocks = uxQueueMessagesWaiting(stream.free_queue);
+    if (stream.cur >= 0) {
+        stats->free_blocks++;
+    }
+}
+
+// Reset the receive side of I2S and configure it as master, 16 bits per
+// channel, 2 channels, MSB shift
+static void rx_config()
+{
+    SET_MASK_BITS(I2S.CONF, I2S_CONF_RX_RESET | I2S_CONF_RX_FIFO_RESET);
+    CLEAR_MASK_BITS(I2S.CONF, I2S_CONF_RX_RESET | I2S_CONF_RX_FIFO_RESET);
+
+    CLEAR_MASK_BITS(I2S.CONF, I2S_CONF_RX_SLAVE_MOD);
+    SET_MASK_BITS(I2S.CONF, I2S_CONF_RX_MSB_SHIFT);
+    I2S.FIFO_CONF = SET_FIELD(I2S.FIFO_CONF, I2S_FIFO_CONF_RX_FIFO_MOD, 0);
+    I2S.CONF_CHANNELS = SET_FIELD(I2S.CONF_CHANNELS, I2S_CONF_CHANNELS_RX_CHANNEL_MOD, 0);
+    // EOF after each block, counted in 32 bit words
+    I2S.RX_EOF_NUM = rx.block_size / 4;
+}
+
+bool i2s_dma_rx_init(i2s_clock_div_t clock_div, i2s_pins_t pins,
+        uint16_t block_size, uint8_t block_count, i2s_dma_rx_cb_t callback)
+{
+    if (rx.descr || block_size == 0 || block_size > MAX_BLOCK_SIZE ||
+            (block_size & 3) || block_count < 3) {
+        return false;
+    }
+
+    size_t descr_len = block_count * sizeof(dma_descriptor_t);
+    uint8_t *mem = malloc(descr_len + block_size * block_count);
+    if (!mem) {
+        return false;
+    }
+    rx.ready_queue = NULL;
+    if (!callback) {
+        // One block is being filled by the DMA and one may be being read
+        rx.ready_queue = xQueueCreate(block_count - 2, sizeof(uint32_t));
+        if (!rx.ready_queue) {
+            free(mem);
+            return false;
+        }
+    }
+    rx.descr = (dma_descriptor_t *)mem;
+    rx.buf = mem + descr_len;
+    rx.block_size = block_size;
+    rx.block_count = block_count;
+    rx.callback = callback;
+    rx.blocks = 0;
+    rx.overruns = 0;
+
+    for (int i = 0; i < block_count; i++) {
+        rx.descr[i].owner = 1;
+        rx.descr[i].eof = 1;
+        rx.descr[i].sub_sof = 0;
+        rx.descr[i].unused = 0;
+        rx.descr[i].buf_ptr = rx.buf + i * block_size;
+        rx.descr[i].datalen = block_size;
+        rx.descr[i].blocksize = block_size;
+        rx.descr[i].next_link_ptr = &rx.descr[(i + 1) % block_count];
+    }
+
+    // reset receive DMA
+    SET_MASK_BITS(SLC.CONF0, SLC_CONF0_TX_LINK_RESET);
+    CLEAR_MASK_BITS(SLC.CONF0, SLC_CONF0_TX_LINK_RESET);
+    SLC.CONF0 = SET_FIELD(SLC.CONF0, SLC_CONF0_MODE, 1);
+
+    i2s_config(clock_div);
+    rx_config();
+
+    _xt_isr_attach(INUM_SLC, stream_isr_handler);
+    SLC.INT_CLEAR = SLC_INT_CLEAR_TX_EOF;
+    SET_MASK_BITS(SLC.INT_ENABLE, SLC_INT_ENABLE_TX_EOF);
+    _xt_isr_unmask(1<<INUM_SLC);
+
+    if (pins.data) {
+        iomux_set_function(gpio_to_iomux(12), IOMUX_GPIO12_FUNC_I2SI_DATA);
+    }
+    if (pins.clock) {
+        iomux_set_function(gpio_to_iomux(13), IOMUX_GPIO13_FUNC_I2SI_BCK);
+    }
+    if (pins.ws) {
+        iomux_set_function(gpio_to_iomux(14), IOMUX_GPIO14_FUNC_I2SI_WS);
+    }
+    return true;
+}
+
+void i2s_dma_rx_deinit()
+{
+    if (!rx.descr) {
+        return;
+    }
+    i2s_dma_rx_stop();
+    CLEAR_MASK_BITS(SLC.INT_ENABLE, SLC_INT_ENABLE_TX_EOF);
+    if (!stream.descr) {
+        _xt_isr_mask(1<<INUM_SLC);
+    }
+    if (rx.ready_queue) {
+        vQueueDelete(rx.ready_queue);
+    }
+    free(rx.descr);
+    rx.descr = NULL;
+}
+
+void i2s_dma_rx_start()
+{
+    rx.seq = 0;
+    rx.reading = false;
+    if (rx.ready_queue) {
+        xQueueReset(rx.ready_queue);
+    }
+
+    SLC.TX_LINK = SET_FIELD(SLC.TX_LINK, SLC_TX_LINK_DESCRIPTOR_ADDR, 0);
+    SLC.TX_LINK = SET_FIELD_M(SLC.TX_LINK, SLC_TX_LINK_DESCRIPTOR_ADDR, (uint32_t)rx.descr);
+    SET_MASK_BITS(SLC.TX_LINK, SLC_TX_LINK_START);
+
+    // reset receive FIFO, enable DMA in i2s subsystem and start receiving
+    SET_MASK_BITS(I2S.CONF, I2S_CONF_RX_FIFO_RESET);
+    CLEAR_MASK_BITS(I2S.CONF, I2S_CONF_RX_FIFO_RESET);
+    rx_running = true;
+    update_dma_enable();
+    SET_MASK_BITS(I2S.CONF, I2S_CONF_RX_START);
+}
+
+void i2s_dma_rx_stop()
+{
+    CLEAR_MASK_BITS(I2S.CONF, I2S_CONF_RX_START);
+    SET_MASK_BITS(SLC.TX_LINK, SLC_TX_LINK_STOP);
+    SLC.TX_LINK = SET_FIELD(SLC.TX_LINK, SLC_TX_LINK_DESCRIPTOR_ADDR, 0);
+    rx_running = false;
+    update_dma_enable();
+}
+
+size_t i2s_dma_read(void *data, size_t len, portTickType timeout)
+{
+    uint8_t *dst = data;
+    size_t read = 0;
+
+    if (!rx.ready_queue) {
+        return 0;
+    }
+
+    while (read < len) {
+        if (!rx.reading) {
+            if (xQueueReceive(rx.ready_queue, &rx.cur, timeout) != pdTRUE) {
+                break;
+            }
+            rx.reading = true;
+            rx.cur_len = 0;
+        }
+
+        size_t n = rx.block_size - rx.cur_len;
+        if (n > len - read) {
+            n = len - read;
+        }
+        uint8_t block = rx.cur % rx.block_count;
+        memcpy(dst + read, rx.buf + block * rx.block_size + rx.cur_len, n);
+
+        // The DMA doesn't wait for the reader. If it has come round the ring
+        // to this block (it may be a block further on than the interrupt
+        // handler has seen) what was just copied can be partly overwritten.
+        if (rx.seq - rx.cur >= rx.block_count - 1) {
+            taskENTER_CRITICAL();
+            rx.overruns++;
+            taskEXIT_CRITICAL();
+            rx.reading = false;
+            continue;
+        }
+        rx.cur_len += n;
+        read += n;
+
+        if (rx.cur_len == rx.block_size) {
+            rx.reading = false;
+        }
+    }
+    return read;
+}
+
+void i2s_dma_get_rx_stats(i2s_dma_rx_stats_t *stats, bool reset)
+{
+    taskENTER_CRITICAL();
+    stats->blocks = rx.blocks;
+    stats->overruns = rx.overruns;
+    if (reset) {
+        rx.blocks = 0;
+        rx.overruns = 0;
+    }
+    taskEXIT_CRITICAL();
+    stats->ready_blocks = rx.ready_queue ? uxQueueMessagesWaiting(rx.ready_queue) : 0;
 }
@@ -26,6 +26,8 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include "FreeRTOS.h"
 #include "esp/slc_regs.h"
 
 typedef void (*i2s_dma_isr_t)(void);
@@ -70,6 +72,21 @@ void i2s_dma_init(i2s_dma_isr_t isr, i2s_clock_div_t clock_div, i2s_pins_t pins)
  */
 i2s_clock_div_t i2s_get_clock_div(int32_t freq);
 
+/**
+ * Calculate I2S dividers for the specified sample rate.
+ *
+ * I2S is configured for 16 bits per channel, 2 channels, so the bit clock
+ * is 32 times the sample rate.
+ */
+i2s_clock_div_t i2s_get_sample_rate_div(uint32_t sample_rate);
+
+/**
+ * Get the actual sample rate the specified dividers give.
+ *
+ * Only some rates can be set exactly, e.g. 44100 Hz becomes 44191 Hz.
+ */
+uint32_t i2s_get_sample_rate(i2s_clock_div_t clock_div);
+
 /**
  * Start I2S transmittion.
  *
@@ -113,4 +130,169 @@ inline dma_descriptor_t *i2s_dma_get_eof_descriptor()
     return (dma_descriptor_t*)SLC.RX_EOF_DESCRIPTOR_ADDR;
 }
 
+/*
+ * Streaming output
+ *
+ * Instead of managing DMA descriptors directly, data can be streamed with
+ * i2s_dma_write(). The driver keeps a circular ring of DMA blocks that the
+ * hardware plays continuously. A block's DMA descriptor only points at its
+ * data from when the writer has filled it until it has been played, at other
+ * times it plays a shared block of silence. So if the writer falls behind the
+ * output is silence (counted as an underrun) rather than repeated old data or
+ * a partly written block. After an underrun, output resumes when the DMA
+ * gets round the ring to the late block.
+ *
+ * Output starts when the ring is full, or on i2s_dma_flush(). Only one task
+ * should write to the stream.
+ */
+
+typedef struct {
+    uint32_t blocks;       // blocks played with data
+    uint32_t underruns;    // blocks played as silence because no data was ready
+    uint32_t free_blocks;  // blocks currently available to the writer
+} i2s_dma_stats_t;
+
+typedef struct {
+    const void *data;
+    size_t len;
+} i2s_dma_iovec_t;
+
+/**
+ * Initialize I2S for streaming and allocate the ring of DMA blocks.
+ *
+ * Latency is block_size * block_count bytes, smaller blocks mean more
+ * interrupts.
+ *
+ * @param clock_div I2S clock configuration, see i2s_get_sample_rate_div.
+ * @param pins I2S pin configuration.
+ * @param block_size Size of a DMA block in bytes. Multiple of 4, up to 4092.
+ * @param block_count Number of blocks in the ring, from 2 to 255.
+ * @return false if the arguments are invalid or out of memory.
+ */
+bool i2s_dma_stream_init(i2s_clock_div_t clock_div, i2s_pins_t pins,
+        uint16_t block_size, uint8_t block_count);
+
+/**
+ * Stop output and free the ring allocated by i2s_dma_stream_init.
+ */
+void i2s_dma_stream_deinit();
+
+/**
+ * Write data to the stream.
+ *
+ * Blocks until there is space in the ring for the data, or timeout.
+ *
+ * @param data Samples to write, for 16 bit stereo each sample is 4 bytes.
+ * @param len Length of the data in bytes.
+ * @param timeout Maximum time to wait for a free block, in ticks.
+ * @return Number of bytes written, less than len if timed out.
+ */
+size_t i2s_dma_write(const void *data, size_t len, portTickType timeout);
+
+/**
+ * Write data from several buffers to the stream, as i2s_dma_write.
+ */
+size_t i2s_dma_writev(const i2s_dma_iovec_t *iov, int iovcnt, portTickType timeout);
+
+/**
+ * Queue a partially filled block (padded with silence) and start output if
+ * not started yet.
+ */
+void i2s_dma_flush();
+
+/**
+ * Stop output and discard any data in the ring.
+ *
+ * The stream can be written again afterwards.
+ */
+void i2s_dma_stream_stop();
+
+/**
+ * Get stream statistics.
+ *
+ * @param reset Reset blocks and underruns counters after reading them.
+ */
+void i2s_dma_get_stats(i2s_dma_stats_t *stats, bool reset);
+
+/*
+ * Receiving
+ *
+ * Data from the I2S input pins (GPIO12 data, GPIO13 clock, GPIO14 word
+ * select) is received by DMA into a circular ring of blocks. ESP8266 is the
+ * bus master, generating clock and word select, e.g. for an I2S MEMS
+ * microphone. Format is 16 bits per channel, 2 channels, at the rate set by
+ * the clock dividers. Transmit and receive share the dividers.
+ *
+ * Received blocks are either passed to a callback from the interrupt handler
+ * or queued for i2s_dma_read(). If the reader falls more than
+ * block_count - 2 blocks behind, the oldest blocks are dropped and counted
+ * as overruns. The DMA doesn't wait for the reader: if it gets round the ring
+ * to the block being read, the rest of that block is dropped too.
+ *
+ * Receiving can be combined with the streaming output API, but not with a
+ * custom ISR passed to i2s_dma_init. Either side can be initialized, started
+ * and stopped while the other one is running.
+ */
+
+/**
+ * Called from the interrupt handler for each received block.
+ * The block is overwritten once the DMA gets round the ring to it again.
+ */
+typedef void (*i2s_dma_rx_cb_t)(const void *data, size_t len);
+
+typedef struct {
+    uint32_t blocks;        // blocks received
+    uint32_t overruns;      // blocks dropped because the reader was too slow
+    uint32_t ready_blocks;  // blocks waiting to be read
+} i2s_dma_rx_stats_t;
+
+/**
+ * Initialize I2S receiving and allocate the ring of DMA blocks.
+ *
+ * @param clock_div I2S clock configuration, see i2s_get_sample_rate_div.
+ *                  Shared with the output, the last one initialized sets it.
+ * @param pins I2S input pin configuration.
+ * @param block_size Size of a DMA block in bytes. Multiple of 4, up to 4092.
+ * @param block_count Number of blocks in the ring, from 3 to 255.
+ * @param callback Called for each received block, or NULL to use i2s_dma_read.
+ * @return false if the arguments are invalid or out of memory.
+ */
+bool i2s_dma_rx_init(i2s_clock_div_t clock_div, i2s_pins_t pins,
+        uint16_t block_size, uint8_t block_count, i2s_dma_rx_cb_t callback);
+
+/**
+ * Stop receiving and free the ring allocated by i2s_dma_rx_init.
+ */
+void i2s_dma_rx_deinit();
+
+/**
+ * Start receiving. Any blocks not read yet are discarded.
+ */
+void i2s_dma_rx_start();
+
+/**
+ * Stop receiving.
+ */
+void i2s_dma_rx_stop();
+
+/**
+ * Read received data.
+ *
+ * Blocks until len bytes have been received, or timeout. Not available
+ * if a callback was passed to i2s_dma_rx_init.
+ *
+ * @param data Buffer for the samples, for 16 bit stereo each sample is 4 bytes.
+ * @param len Length of the buffer in bytes.
+ * @param timeout Maximum time to wait for each block, in ticks.
+ * @return Number of bytes read, less than len if timed out.
+ */
+size_t i2s_dma_read(void *data, size_t len, portTickType timeout);
+
+/**
+ * Get receive statistics.
+ *
+ * @param reset Reset blocks and overruns counters after reading them.
+ */
+void i2s_dma_get_rx_stats(i2s_dma_rx_stats_t *stats, bool reset);
+
 #endif  // __I2S_DMA_H__
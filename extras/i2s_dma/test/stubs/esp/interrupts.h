@@ -0,0 +1,24 @@
+/* Host test stand-in, the test calls the attached handler itself */
+#ifndef _STUB_INTERRUPTS_H
+#define _STUB_INTERRUPTS_H
+
+#include <stdint.h>
+
+#define INUM_SLC 1
+
+extern void (*slc_isr)(void);
+
+static inline void _xt_isr_attach(uint8_t i, void (*func)(void))
+{
+    slc_isr = func;
+}
+
+static inline void _xt_isr_mask(uint32_t mask)
+{
+}
+
+static inline void _xt_isr_unmask(uint32_t mask)
+{
+}
+
+#endif
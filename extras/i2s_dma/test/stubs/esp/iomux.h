@@ -0,0 +1,23 @@
+/* Host test stand-in, pin setup does nothing */
+#ifndef _STUB_IOMUX_H
+#define _STUB_IOMUX_H
+
+#include <stdint.h>
+
+#define IOMUX_GPIO2_FUNC_I2SO_WS 1
+#define IOMUX_GPIO3_FUNC_I2SO_DATA 1
+#define IOMUX_GPIO15_FUNC_I2SO_BCK 1
+#define IOMUX_GPIO12_FUNC_I2SI_DATA 1
+#define IOMUX_GPIO13_FUNC_I2SI_BCK 1
+#define IOMUX_GPIO14_FUNC_I2SI_WS 1
+
+static inline uint8_t gpio_to_iomux(uint8_t gpio_number)
+{
+    return gpio_number;
+}
+
+static inline void iomux_set_function(uint8_t iomux_num, uint32_t iomux_func)
+{
+}
+
+#endif
@@ -0,0 +1,96 @@
+/* Host test stand-in for FreeRTOS queues
+ *
+ * A task waiting on an empty or full queue calls queue_wait(), which the
+ * test uses to let the (mock) hardware run, once per tick.
+ */
+#ifndef _STUB_QUEUE_H
+#define _STUB_QUEUE_H
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    unsigned len, item_size, head, count;
+    uint8_t data[];
+} stub_queue_t;
+
+typedef stub_queue_t *xQueueHandle;
+
+void queue_wait(void);
+
+static inline xQueueHandle xQueueCreate(unsigned len, unsigned item_size)
+{
+    xQueueHandle q = calloc(1, sizeof(stub_queue_t) + len * item_size);
+    q->len = len;
+    q->item_size = item_size;
+    return q;
+}
+
+static inline void vQueueDelete(xQueueHandle q)
+{
+    free(q);
+}
+
+static inline void xQueueReset(xQueueHandle q)
+{
+    q->head = q->count = 0;
+}
+
+static inline unsigned uxQueueMessagesWaiting(xQueueHandle q)
+{
+    return q->count;
+}
+
+static inline int xQueueIsQueueFullFromISR(xQueueHandle q)
+{
+    return q->count == q->len;
+}
+
+static inline int xQueueSendFromISR(xQueueHandle q, const void *item, portBASE_TYPE *woken)
+{
+    if (q->count == q->len) {
+        return pdFALSE;
+    }
+    memcpy(q->data + (q->head + q->count) % q->len * q->item_size, item, q->item_size);
+    q->count++;
+    return pdTRUE;
+}
+
+static inline int xQueueReceiveFromISR(xQueueHandle q, void *item, portBASE_TYPE *woken)
+{
+    if (!q->count) {
+        return pdFALSE;
+    }
+    memcpy(item, q->data + q->head * q->item_size, q->item_size);
+    q->head = (q->head + 1) % q->len;
+    q->count--;
+    return pdTRUE;
+}
+
+static inline int xQueueSend(xQueueHandle q, const void *item, portTickType timeout)
+{
+    for (;;) {
+        if (xQueueSendFromISR(q, item, NULL)) {
+            return pdTRUE;
+        }
+        if (!timeout--) {
+            return pdFALSE;
+        }
+        queue_wait();
+    }
+}
+
+static inline int xQueueReceive(xQueueHandle q, void *item, portTickType timeout)
+{
+    for (;;) {
+        if (xQueueReceiveFromISR(q, item, NULL)) {
+            return pdTRUE;
+        }
+        if (!timeout--) {
+            return pdFALSE;
+        }
+        queue_wait();
+    }
+}
+
+#endif
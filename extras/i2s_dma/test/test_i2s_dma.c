@@ -0,0 +1,403 @@
+/* Host test for the i2s_dma streaming output and receive code.
+ *
+ * The SLC and I2S registers are plain structs here, and a small model of
+ * the DMA follows the descriptor rings the driver sets up: each step plays
+ * one output block (logging its data) and/or fills one input block with
+ * numbered samples, then raises the EOF interrupts. The model runs
+ * whenever the driver waits on a queue, as the real DMA would while the
+ * task sleeps, and when a test wants the writer or reader to fall behind.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "test.h"
+#include "esp/slc_regs.h"
+#include "esp/i2s_regs.h"
+
+/* Registers */
+static struct SLC_REGS slc;
+static struct I2S_REGS i2s;
+#undef SLC
+#undef I2S
+#define SLC slc
+#define I2S i2s
+
+/* The descriptor link registers only hold the low 20 bits of an address
+   in DRAM, so the driver's memory comes from a mapping at the same place */
+#define DRAM_BASE 0x3ff00000
+#define DRAM_SIZE 0x100000
+static uint8_t *dram;
+static size_t dram_used;
+
+static void *dram_malloc(size_t len)
+{
+    void *p = dram + dram_used;
+    dram_used += (len + 7) & ~7;
+    return (dram_used <= DRAM_SIZE) ? p : NULL;
+}
+
+static void dram_free(void *p)
+{
+}
+
+void sdk_rom_i2c_writeReg_Mask(uint32_t block, uint32_t host_id,
+        uint32_t reg_add, uint32_t Msb, uint32_t Lsb, uint32_t indata)
+{
+}
+
+void (*slc_isr)(void);
+
+#define malloc dram_malloc
+#define free dram_free
+#include "../i2s_dma.c"
+#undef malloc
+#undef free
+
+/* DMA model */
+
+static dma_descriptor_t *out_descr;    /* next block to play */
+static dma_descriptor_t *in_descr;     /* next block to fill */
+static uint8_t played[65536];
+static size_t played_len;
+static uint32_t sample;                /* number of the next input sample */
+
+static dma_descriptor_t *descr_at(uint32_t addr)
+{
+    return (dma_descriptor_t *)(uintptr_t)(DRAM_BASE | addr);
+}
+
+static bool dma_enabled(void)
+{
+    return I2S.FIFO_CONF & I2S_FIFO_CONF_DESCRIPTOR_ENABLE;
+}
+
+static void play_block(void)
+{
+    uint32_t addr = FIELD2VAL(SLC_RX_LINK_DESCRIPTOR_ADDR, SLC.RX_LINK);
+
+    if (SLC.RX_LINK & SLC_RX_LINK_START) {
+        CLEAR_MASK_BITS(SLC.RX_LINK, SLC_RX_LINK_START);
+        out_descr = addr ? descr_at(addr) : NULL;
+    }
+    if (!addr || !dma_enabled() || !(I2S.CONF & I2S_CONF_TX_START)) {
+        out_descr = NULL;
+    }
+    if (!out_descr) {
+        return;
+    }
+    memcpy(played + played_len, out_descr->buf_ptr, out_descr->datalen);
+    played_len += out_descr->datalen;
+    SLC.RX_EOF_DESCRIPTOR_ADDR = (uint32_t)(uintptr_t)out_descr;
+    SET_MASK_BITS(SLC.INT_RAW, SLC_INT_RAW_RX_EOF);
+    out_descr = out_descr->next_link_ptr;
+}
+
+static void receive_block(void)
+{
+    uint32_t addr = FIELD2VAL(SLC_TX_LINK_DESCRIPTOR_ADDR, SLC.TX_LINK);
+
+    if (SLC.TX_LINK & SLC_TX_LINK_START) {
+        CLEAR_MASK_BITS(SLC.TX_LINK, SLC_TX_LINK_START);
+        in_descr = addr ? descr_at(addr) : NULL;
+    }
+    if (SLC.TX_LINK & SLC_TX_LINK_STOP) {
+        CLEAR_MASK_BITS(SLC.TX_LINK, SLC_TX_LINK_STOP);
+        in_descr = NULL;
+    }
+    if (!addr || !dma_enabled() || !(I2S.CONF & I2S_CONF_RX_START)) {
+        in_descr = NULL;
+    }
+    if (!in_descr) {
+        return;
+    }
+    uint32_t *words = in_descr->buf_ptr;
+    for (int i = 0; i < in_descr->blocksize / 4; i++) {
+        words[i] = sample++;
+    }
+    SLC.TX_EOF_DESCRIPTOR_ADDR = (uint32_t)(uintptr_t)in_descr;
+    SET_MASK_BITS(SLC.INT_RAW, SLC_INT_RAW_TX_EOF);
+    in_descr = in_descr->next_link_ptr;
+}
+
+static void interrupt(void)
+{
+    SLC.INT_STATUS = SLC.INT_RAW & SLC.INT_ENABLE;
+    if (SLC.INT_STATUS && slc_isr) {
+        SLC.INT_CLEAR = 0;
+        slc_isr();
+        SLC.INT_RAW &= ~SLC.INT_CLEAR;
+    }
+}
+
+/* Transfer `blocks` blocks each way, then take the interrupt. More than one
+   block per interrupt is what a delayed interrupt looks like. */
+static void run_dma(int blocks)
+{
+    for (int i = 0; i < blocks; i++) {
+        play_block();
+        receive_block();
+    }
+    interrupt();
+}
+
+static uint32_t rand_state;
+
+void queue_wait(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    run_dma(1 + (rand_state >> 16) % 2);
+}
+
+static void reset(void)
+{
+    memset(&SLC, 0, sizeof(SLC));
+    memset(&I2S, 0, sizeof(I2S));
+    dram_used = 0x8000;     /* as on the device, no descriptor at offset 0 */
+    out_descr = in_descr = NULL;
+    played_len = 0;
+    sample = 0;
+    rand_state = 1;
+}
+
+/* Tests */
+
+#define BLOCK_SIZE 64
+#define BLOCK_COUNT 4
+
+static const i2s_clock_div_t clock_div = { 10, 10 };
+static const i2s_pins_t pins = { true, true, true };
+
+/* Output data, no zero bytes so silence can be told apart */
+static uint8_t data[BLOCK_SIZE * 32];
+
+/* What was played, without the blocks of silence, is exactly what was
+   written */
+static bool played_data(size_t len)
+{
+    size_t n = 0;
+
+    for (size_t pos = 0; pos < played_len; pos += BLOCK_SIZE) {
+        const uint8_t *block = played + pos;
+        bool silence = true;
+        for (int i = 0; i < BLOCK_SIZE; i++) {
+            silence &= !block[i];
+        }
+        if (silence) {
+            continue;
+        }
+        if (n + BLOCK_SIZE > len || memcmp(block, data + n, BLOCK_SIZE)) {
+            return false;
+        }
+        n += BLOCK_SIZE;
+    }
+    return n == len;
+}
+
+static int test_stream(void)
+{
+    i2s_dma_stats_t stats;
+
+    reset();
+    check(i2s_dma_stream_init(clock_div, pins, BLOCK_SIZE, BLOCK_COUNT));
+    check(i2s_dma_write(data, sizeof(data), 100) == sizeof(data));
+    i2s_dma_flush();
+    for (int i = 0; i < 2 * BLOCK_COUNT; i++) {
+        run_dma(1);
+    }
+    check(played_data(sizeof(data)));
+    i2s_dma_get_stats(&stats, false);
+    check(stats.blocks == sizeof(data) / BLOCK_SIZE);
+    check(stats.free_blocks == BLOCK_COUNT);
+    i2s_dma_stream_deinit();
+    done();
+}
+
+/* A block the writer is still filling when its turn comes plays as
+   silence, and is played in full on a later round */
+static int test_underrun(void)
+{
+    size_t len = 0;
+    i2s_dma_stats_t stats;
+
+    reset();
+    check(i2s_dma_stream_init(clock_div, pins, BLOCK_SIZE, BLOCK_COUNT));
+    for (int round = 0; round < 6; round++) {
+        /* some blocks and a half, then the writer stalls */
+        size_t n = BLOCK_SIZE * (1 + round % 3);
+        check(i2s_dma_write(data + len, n, 100) == n);
+        len += n;
+        i2s_dma_flush();
+        check(i2s_dma_write(data + len, BLOCK_SIZE / 2, 100) == BLOCK_SIZE / 2);
+        len += BLOCK_SIZE / 2;
+        for (int i = 0; i < BLOCK_COUNT + round; i++) {
+            run_dma(1 + i % 2);
+        }
+        /* the rest of the half block */
+        check(i2s_dma_write(data + len, BLOCK_SIZE / 2, 100) == BLOCK_SIZE / 2);
+        len += BLOCK_SIZE / 2;
+    }
+    i2s_dma_flush();
+    for (int i = 0; i < 3 * BLOCK_COUNT; i++) {
+        run_dma(1);
+    }
+    check(played_data(len));
+    i2s_dma_get_stats(&stats, false);
+    check(stats.underruns > 0);
+    check(stats.blocks == len / BLOCK_SIZE);
+    i2s_dma_stream_deinit();
+    done();
+}
+
+/* Samples read are numbered consecutively within each block, and blocks
+   are only skipped whole */
+static int check_samples(const uint32_t *words, size_t count, uint32_t *last)
+{
+    for (size_t i = 0; i < count; i++) {
+        uint32_t offset = words[i] % (BLOCK_SIZE / 4);
+        if (offset != 0) {
+            check(words[i] == *last + 1);
+        } else {
+            check(words[i] > *last || *last == UINT32_MAX);
+        }
+        *last = words[i];
+    }
+    done();
+}
+
+static int test_receive(void)
+{
+    uint32_t words[BLOCK_SIZE / 4];
+    uint32_t last = UINT32_MAX;
+    i2s_dma_rx_stats_t stats;
+    int r;
+
+    reset();
+    check(i2s_dma_rx_init(clock_div, pins, BLOCK_SIZE, BLOCK_COUNT, NULL));
+    i2s_dma_rx_start();
+    for (int round = 0; round < 20; round++) {
+        /* read part of a block, then fall behind by a varying amount */
+        size_t n = 4 * (1 + round % 7);
+        check(i2s_dma_read(words, n, 10) == n);
+        if ((r = check_samples(words, n / 4, &last))) {
+            return r;
+        }
+        for (int i = 0; i < round % (BLOCK_COUNT + 2); i++) {
+            run_dma(1);
+        }
+        check(i2s_dma_read(words, sizeof(words), 10) == sizeof(words));
+        if ((r = check_samples(words, BLOCK_SIZE / 4, &last))) {
+            return r;
+        }
+    }
+    i2s_dma_get_rx_stats(&stats, false);
+    check(stats.overruns > 0);
+    i2s_dma_rx_deinit();
+    done();
+}
+
+static uint32_t callback_last;
+static int callback_blocks;
+static bool callback_ok;
+
+static void rx_callback(const void *buf, size_t len)
+{
+    uint32_t last = callback_last;
+    callback_ok &= (len == BLOCK_SIZE) && !check_samples(buf, len / 4, &last);
+    callback_last = last;
+    callback_blocks++;
+}
+
+static int test_receive_callback(void)
+{
+    reset();
+    callback_last = UINT32_MAX;
+    callback_blocks = 0;
+    callback_ok = true;
+    check(i2s_dma_rx_init(clock_div, pins, BLOCK_SIZE, BLOCK_COUNT, rx_callback));
+    i2s_dma_rx_start();
+    for (int i = 0; i < 10; i++) {
+        run_dma(1 + i % 3);
+    }
+    check(callback_ok);
+    check(callback_blocks == 19);
+    i2s_dma_rx_deinit();
+    done();
+}
+
+/* Output can be set up, started and stopped while receiving, and the
+   other way round, without disturbing the other stream */
+static int test_both(void)
+{
+    uint32_t words[BLOCK_SIZE / 4];
+    uint32_t last = UINT32_MAX;
+    i2s_dma_rx_stats_t rx_stats;
+    int r;
+
+    reset();
+    check(i2s_dma_rx_init(clock_div, pins, BLOCK_SIZE, BLOCK_COUNT, NULL));
+    i2s_dma_rx_start();
+    check(i2s_dma_read(words, sizeof(words), 10) == sizeof(words));
+    check(!check_samples(words, BLOCK_SIZE / 4, &last));
+
+    check(i2s_dma_stream_init(clock_div, pins, BLOCK_SIZE, BLOCK_COUNT));
+    for (int round = 0; round < 3; round++) {
+        check(i2s_dma_write(data, BLOCK_SIZE * 6, 100) == BLOCK_SIZE * 6);
+        i2s_dma_flush();
+        for (int i = 0; i < BLOCK_COUNT; i++) {
+            run_dma(1);
+        }
+        i2s_dma_stream_stop();
+        check(played_data(BLOCK_SIZE * 6));
+        played_len = 0;
+
+        /* still receiving */
+        last = UINT32_MAX;
+        for (int i = 0; i < 4; i++) {
+            check(i2s_dma_read(words, sizeof(words), 10) == sizeof(words));
+            if ((r = check_samples(words, BLOCK_SIZE / 4, &last))) {
+                return r;
+            }
+        }
+    }
+
+    /* and output carries on without receiving */
+    i2s_dma_get_rx_stats(&rx_stats, true);
+    check(rx_stats.blocks > 0);
+    i2s_dma_rx_stop();
+    check(i2s_dma_write(data, sizeof(data), 100) == sizeof(data));
+    i2s_dma_flush();
+    for (int i = 0; i < 2 * BLOCK_COUNT; i++) {
+        run_dma(1);
+    }
+    check(played_data(sizeof(data)));
+    i2s_dma_get_rx_stats(&rx_stats, false);
+    check(rx_stats.blocks == 0);
+    i2s_dma_rx_deinit();
+    i2s_dma_stream_deinit();
+    done();
+}
+
+int main(void)
+{
+    dram = mmap((void *)DRAM_BASE, DRAM_SIZE, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (dram != (void *)DRAM_BASE) {
+        fprintf(stderr, "Can't map memory at 0x%x\n", DRAM_BASE);
+        return 2;
+    }
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = i % 251 + 1;
+    }
+    test(test_stream, "stream output");
+    test(test_underrun, "stream underrun");
+    test(test_receive, "receive with a slow reader");
+    test(test_receive_callback, "receive callback");
+    test(test_both, "output and receive together");
+    printf("\nPASSED: %d\nFAILED: %d\n", test_passed, test_failed);
+    return (test_failed > 0);
+}
@@ -2,9 +2,12 @@
 
 # expected anyone using jsmn json component includes it as 'jsmn/jsmn.h'
 INC_DIRS += $(jsmn_ROOT)jsmn
+# and the additions outside the jsmn submodule as 'jsmn_stream.h'
+INC_DIRS += $(jsmn_ROOT)
 
 # args for passing into compile rule generation
 jsmn_INC_DIR =
 jsmn_SRC_DIR = $(jsmn_ROOT)jsmn
+jsmn_SRC_DIR += $(jsmn_ROOT)
 
 $(eval $(call component_compile_rules,jsmn))
@@ -0,0 +1,527 @@
+/**
+ * Declarative binding between JSON objects and C structs, see jsmn_bind.h.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "jsmn_bind.h"
+
+/**
+ * Compares a field name with a key token (not NUL terminated).
+ */
+static int jsmn_bind_keycmp(const char *name, const char *key, size_t len) {
+	size_t i;
+	for (i = 0; i < len; i++) {
+		if (name[i] != key[i]) {
+			/* also covers name being shorter ('\0') */
+			return (unsigned char)name[i] - (unsigned char)key[i];
+		}
+	}
+	return name[len] == '\0' ? 0 : 1;
+}
+
+static const jsmn_bind_field *jsmn_bind_find(const jsmn_bind_object *desc,
+		const char *key, size_t len) {
+	unsigned int lo = 0, hi = desc->count;
+
+	while (lo < hi) {
+		unsigned int mid = (lo + hi) / 2;
+		int c = jsmn_bind_keycmp(desc->fields[mid].name, key, len);
+		if (c == 0) {
+			return &desc->fields[mid];
+		}
+		if (c < 0) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Number of tokens making up the value at tokens[i], including nested ones.
+ */
+static unsigned int jsmn_bind_skip(const jsmntok_t *tokens, unsigned int i,
+		unsigned int num_tokens) {
+	unsigned int n = 1;
+	int children = tokens[i].size;
+
+	while (children-- > 0 && i + n < num_tokens) {
+		n += jsmn_bind_skip(tokens, i + n, num_tokens);
+	}
+	return n;
+}
+
+static int jsmn_bind_size_ok(const jsmn_bind_field *f) {
+	switch (f->type) {
+		case JSMN_BIND_T_BOOL:
+		case JSMN_BIND_T_INT:
+		case JSMN_BIND_T_UINT:
+			return f->size == 1 || f->size == 2 || f->size == 4 ||
+				f->size == sizeof(long);
+		case JSMN_BIND_T_FLOAT:
+			return f->size == sizeof(float) || f->size == sizeof(double);
+		case JSMN_BIND_T_STRING:
+			return f->size > 0;
+		case JSMN_BIND_T_OBJECT:
+			return f->object != NULL;
+	}
+	return 0;
+}
+
+int jsmn_bind_check(jsmn_bind_object *desc) {
+	unsigned int i;
+
+	desc->checked = -1;
+	for (i = 0; i < desc->count; i++) {
+		const jsmn_bind_field *f = &desc->fields[i];
+		if (!jsmn_bind_size_ok(f)) {
+			return JSMN_ERROR_INVAL;
+		}
+		if (i > 0 && strcmp(desc->fields[i - 1].name, f->name) >= 0) {
+			return JSMN_ERROR_INVAL;
+		}
+		if (f->type == JSMN_BIND_T_OBJECT && jsmn_bind_check(f->object) != 0) {
+			return JSMN_ERROR_INVAL;
+		}
+	}
+	desc->checked = 1;
+	return 0;
+}
+
+/**
+ * Checks the table the first time it is used. Nested tables are checked
+ * along with it.
+ */
+static int jsmn_bind_checked(jsmn_bind_object *desc) {
+	if (desc->checked == 0) {
+		jsmn_bind_check(desc);
+	}
+	return desc->checked > 0;
+}
+
+static void jsmn_bind_store_int(void *p, size_t size, long v) {
+	switch (size) {
+		case 1: *(signed char *)p = v; break;
+		case 2: *(short *)p = v; break;
+		case 4: *(int *)p = v; break;
+		default: *(long *)p = v; break;
+	}
+}
+
+static long jsmn_bind_load_int(const void *p, size_t size, int is_signed) {
+	switch (size) {
+		case 1: return is_signed ? *(const signed char *)p : *(const unsigned char *)p;
+		case 2: return is_signed ? *(const short *)p : *(const unsigned short *)p;
+		case 4: return is_signed ? *(const int *)p : (long)*(const unsigned int *)p;
+		default: return *(const long *)p;
+	}
+}
+
+static int jsmn_bind_hexval(char c) {
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+/**
+ * Reads the 4 hex digits of a \uXXXX escape at s.
+ */
+static int jsmn_bind_hex4(const char *s, unsigned long *u) {
+	int k;
+
+	*u = 0;
+	for (k = 0; k < 4; k++) {
+		int h = jsmn_bind_hexval(s[k]);
+		if (h < 0) {
+			return JSMN_ERROR_INVAL;
+		}
+		*u = (*u << 4) | h;
+	}
+	return 0;
+}
+
+/**
+ * Copies a string token into out, decoding escapes (\uXXXX as UTF-8,
+ * including UTF-16 surrogate pairs).
+ */
+static int jsmn_bind_string(char *out, size_t size, const char *s, size_t len) {
+	size_t i, n = 0;
+
+	/* most strings have no escapes, copy those in one go */
+	if (memchr(s, '\\', len) == NULL) {
+		if (len >= size) {
+			return JSMN_ERROR_NOMEM;
+		}
+		memcpy(out, s, len);
+		out[len] = '\0';
+		return 0;
+	}
+	for (i = 0; i < len; i++) {
+		char c = s[i];
+		char utf8[3];
+		int ulen = 1;
+
+		if (c == '\\' && i + 1 < len) {
+			c = s[++i];
+			switch (c) {
+				case 'b': c = '\b'; break;
+				case 'f': c = '\f'; break;
+				case 'n': c = '\n'; break;
+				case 'r': c = '\r'; break;
+				case 't': c = '\t'; break;
+				case 'u': {
+					unsigned long u, low;
+					if (i + 4 >= len || jsmn_bind_hex4(s + i + 1, &u) < 0) {
+						return JSMN_ERROR_INVAL;
+					}
+					i += 4;
+					if (u >= 0xdc00 && u < 0xe000) {
+						/* low surrogate without a high one */
+						return JSMN_ERROR_INVAL;
+					}
+					if (u >= 0xd800 && u < 0xdc00) {
+						/* high surrogate, must be followed by \u low surrogate */
+						if (i + 6 >= len || s[i + 1] != '\\' || s[i + 2] != 'u' ||
+								jsmn_bind_hex4(s + i + 3, &low) < 0 ||
+								low < 0xdc00 || low >= 0xe000) {
+							return JSMN_ERROR_INVAL;
+						}
+						i += 6;
+						u = 0x10000 + ((u - 0xd800) << 10) + (low - 0xdc00);
+					}
+					if (u < 0x80) {
+						c = u;
+					} else if (u < 0x800) {
+						c = 0xc0 | (u >> 6);
+						utf8[0] = 0x80 | (u & 0x3f);
+						ulen = 2;
+					} else if (u < 0x10000) {
+						c = 0xe0 | (u >> 12);
+						utf8[0] = 0x80 | ((u >> 6) & 0x3f);
+						utf8[1] = 0x80 | (u & 0x3f);
+						ulen = 3;
+					} else {
+						c = 0xf0 | (u >> 18);
+						utf8[0] = 0x80 | ((u >> 12) & 0x3f);
+						utf8[1] = 0x80 | ((u >> 6) & 0x3f);
+						utf8[2] = 0x80 | (u & 0x3f);
+						ulen = 4;
+					}
+					break;
+				}
+			}
+		}
+		if (n + ulen >= size) {
+			return JSMN_ERROR_NOMEM;
+		}
+		out[n++] = c;
+		if (ulen > 1) {
+			memcpy(out + n, utf8, ulen - 1);
+			n += ulen - 1;
+		}
+	}
+	out[n] = '\0';
+	return 0;
+}
+
+static int jsmn_bind_decode_object(const jsmn_bind_object *desc, void *out,
+		const char *js, const jsmntok_t *tokens, unsigned int num_tokens);
+
+static int jsmn_bind_value(const jsmn_bind_field *f, char *member, const char *js,
+		const jsmntok_t *tokens, unsigned int i, unsigned int num_tokens) {
+	const jsmntok_t *t = &tokens[i];
+	const char *s = js + t->start;
+	size_t len = t->end - t->start;
+	char num[32];
+	char *end;
+
+	if (f->type == JSMN_BIND_T_OBJECT) {
+		return jsmn_bind_decode_object(f->object, member, js, tokens + i,
+				num_tokens - i);
+	}
+	if (f->type == JSMN_BIND_T_STRING) {
+		if (t->type != JSMN_STRING) {
+			return JSMN_ERROR_INVAL;
+		}
+		return jsmn_bind_string(member, f->size, s, len);
+	}
+
+	if (t->type != JSMN_PRIMITIVE || len == 0 || len >= sizeof(num)) {
+		return JSMN_ERROR_INVAL;
+	}
+	if (f->type == JSMN_BIND_T_BOOL) {
+		if (len == 4 && memcmp(s, "true", 4) == 0) {
+			jsmn_bind_store_int(member, f->size, 1);
+		} else if (len == 5 && memcmp(s, "false", 5) == 0) {
+			jsmn_bind_store_int(member, f->size, 0);
+		} else {
+			return JSMN_ERROR_INVAL;
+		}
+		return 1;
+	}
+
+	/* short integers (the usual case) are converted directly, anything else
+	   goes through strtol/strtod */
+	if (f->type != JSMN_BIND_T_FLOAT && len <= 9) {
+		long v = 0;
+		size_t k = (s[0] == '-' && f->type == JSMN_BIND_T_INT) ? 1 : 0;
+		size_t first = k;
+		while (k < len && s[k] >= '0' && s[k] <= '9') {
+			v = v * 10 + (s[k++] - '0');
+		}
+		if (k == len && k > first) {
+			jsmn_bind_store_int(member, f->size, first ? -v : v);
+			return 1;
+		}
+	}
+
+	/* strtol/strtod need a terminated string */
+	memcpy(num, s, len);
+	num[len] = '\0';
+	if (f->type == JSMN_BIND_T_FLOAT) {
+		double d = strtod(num, &end);
+		if (*end != '\0') {
+			return JSMN_ERROR_INVAL;
+		}
+		if (f->size == sizeof(float)) {
+			*(float *)member = d;
+		} else {
+			*(double *)member = d;
+		}
+	} else {
+		long v = (f->type == JSMN_BIND_T_INT) ? strtol(num, &end, 10) :
+			(long)strtoul(num, &end, 10);
+		if (*end != '\0') {
+			return JSMN_ERROR_INVAL;
+		}
+		jsmn_bind_store_int(member, f->size, v);
+	}
+	return 1;
+}
+
+static int jsmn_bind_decode_object(const jsmn_bind_object *desc, void *out,
+		const char *js, const jsmntok_t *tokens, unsigned int num_tokens) {
+	unsigned int i = 1;
+	int members;
+
+	if (num_tokens < 1 || tokens[0].type != JSMN_OBJECT) {
+		return JSMN_ERROR_INVAL;
+	}
+	for (members = tokens[0].size; members > 0; members--) {
+		const jsmntok_t *key = &tokens[i];
+		const jsmn_bind_field *f;
+
+		if (i + 1 >= num_tokens || key->type != JSMN_STRING) {
+			return JSMN_ERROR_INVAL;
+		}
+		f = jsmn_bind_find(desc, js + key->start, key->end - key->start);
+		i++;
+		if (f != NULL) {
+			int r = jsmn_bind_value(f, (char *)out + f->offset, js, tokens, i,
+					num_tokens);
+			if (r < 0) {
+				return r;
+			}
+		}
+		i += jsmn_bind_skip(tokens, i, num_tokens);
+	}
+	return i;
+}
+
+int jsmn_bind_decode(jsmn_bind_object *desc, void *out, const char *js,
+		const jsmntok_t *tokens, unsigned int num_tokens) {
+	if (!jsmn_bind_checked(desc)) {
+		return JSMN_ERROR_INVAL;
+	}
+	return jsmn_bind_decode_object(desc, out, js, tokens, num_tokens);
+}
+
+/**
+ * Output buffer for the encoder, len is how much would have been written so
+ * encoding carries on after the buffer is full.
+ */
+typedef struct {
+	char *buf;
+	size_t size;
+	size_t len;
+} jsmn_bind_out;
+
+static void jsmn_bind_put(jsmn_bind_out *o, const char *s, size_t len) {
+	if (o->len + len < o->size) {
+		memcpy(o->buf + o->len, s, len);
+	}
+	o->len += len;
+}
+
+static void jsmn_bind_put_ulong(jsmn_bind_out *o, unsigned long v) {
+	char digits[24];
+	int d = sizeof(digits);
+
+	do {
+		digits[--d] = '0' + v % 10;
+		v /= 10;
+	} while (v > 0);
+	jsmn_bind_put(o, digits + d, sizeof(digits) - d);
+}
+
+static void jsmn_bind_put_long(jsmn_bind_out *o, long v) {
+	if (v < 0) {
+		jsmn_bind_put(o, "-", 1);
+		jsmn_bind_put_ulong(o, -(unsigned long)v);
+	} else {
+		jsmn_bind_put_ulong(o, v);
+	}
+}
+
+/**
+ * Writes a double with up to 6 decimals (no printf dependency, so it works
+ * without float printf support in the C library).
+ */
+static void jsmn_bind_put_double(jsmn_bind_out *o, double v) {
+	int exp = 0;
+	unsigned long whole, frac;
+	char digits[6];
+	int d;
+
+	if (v != v || v > 1e308 || v < -1e308) {
+		/* NaN and infinity aren't representable in JSON */
+		jsmn_bind_put(o, "null", 4);
+		return;
+	}
+	if (v < 0) {
+		jsmn_bind_put(o, "-", 1);
+		v = -v;
+	}
+	if (v >= 1e9) {
+		while (v >= 10) {
+			v /= 10;
+			exp++;
+		}
+	} else if (v != 0 && v < 1e-4) {
+		while (v < 1) {
+			v *= 10;
+			exp--;
+		}
+	}
+	whole = (unsigned long)v;
+	frac = (unsigned long)((v - whole) * 1e6 + 0.5);
+	if (frac >= 1000000) {
+		whole++;
+		frac -= 1000000;
+	}
+	jsmn_bind_put_ulong(o, whole);
+	if (frac > 0) {
+		for (d = 5; d >= 0; d--) {
+			digits[d] = '0' + frac % 10;
+			frac /= 10;
+		}
+		for (d = 6; digits[d - 1] == '0'; d--)
+			;
+		jsmn_bind_put(o, ".", 1);
+		jsmn_bind_put(o, digits, d);
+	}
+	if (exp != 0) {
+		jsmn_bind_put(o, "e", 1);
+		jsmn_bind_put_long(o, exp);
+	}
+}
+
+static void jsmn_bind_put_string(jsmn_bind_out *o, const char *s, size_t max) {
+	size_t i;
+
+	jsmn_bind_put(o, "\"", 1);
+	for (i = 0; i < max && s[i] != '\0'; i++) {
+		unsigned char c = s[i];
+		const char *esc = NULL;
+		switch (c) {
+			case '\"': esc = "\\\""; break;
+			case '\\': esc = "\\\\"; break;
+			case '\b': esc = "\\b"; break;
+			case '\f': esc = "\\f"; break;
+			case '\n': esc = "\\n"; break;
+			case '\r': esc = "\\r"; break;
+			case '\t': esc = "\\t"; break;
+		}
+		if (esc != NULL) {
+			jsmn_bind_put(o, esc, 2);
+		} else if (c < 0x20) {
+			char u[6] = { '\\', 'u', '0', '0', 0, 0 };
+			u[4] = "0123456789abcdef"[c >> 4];
+			u[5] = "0123456789abcdef"[c & 0xf];
+			jsmn_bind_put(o, u, 6);
+		} else {
+			jsmn_bind_put(o, (const char *)&s[i], 1);
+		}
+	}
+	jsmn_bind_put(o, "\"", 1);
+}
+
+static void jsmn_bind_put_object(jsmn_bind_out *o, const jsmn_bind_object *desc,
+		const char *in) {
+	unsigned int i;
+
+	jsmn_bind_put(o, "{", 1);
+	for (i = 0; i < desc->count; i++) {
+		const jsmn_bind_field *f = &desc->fields[i];
+		const char *member = in + f->offset;
+
+		if (i > 0) {
+			jsmn_bind_put(o, ",", 1);
+		}
+		jsmn_bind_put_string(o, f->name, (size_t)-1);
+		jsmn_bind_put(o, ":", 1);
+		switch (f->type) {
+			case JSMN_BIND_T_BOOL:
+				if (jsmn_bind_load_int(member, f->size, 0)) {
+					jsmn_bind_put(o, "true", 4);
+				} else {
+					jsmn_bind_put(o, "false", 5);
+				}
+				break;
+			case JSMN_BIND_T_INT:
+				jsmn_bind_put_long(o, jsmn_bind_load_int(member, f->size, 1));
+				break;
+			case JSMN_BIND_T_UINT:
+				jsmn_bind_put_ulong(o, jsmn_bind_load_int(member, f->size, 0));
+				break;
+			case JSMN_BIND_T_FLOAT:
+				jsmn_bind_put_double(o, (f->size == sizeof(float)) ?
+						*(const float *)member : *(const double *)member);
+				break;
+			case JSMN_BIND_T_STRING:
+				jsmn_bind_put_string(o, member, f->size);
+				break;
+			case JSMN_BIND_T_OBJECT:
+				jsmn_bind_put_object(o, f->object, member);
+				break;
+		}
+	}
+	jsmn_bind_put(o, "}", 1);
+}
+
+int jsmn_bind_encode(jsmn_bind_object *desc, const void *in, char *buf,
+		size_t size) {
+	jsmn_bind_out o;
+
+	if (!jsmn_bind_checked(desc)) {
+		return JSMN_ERROR_INVAL;
+	}
+	o.buf = buf;
+	o.size = size;
+	o.len = 0;
+	jsmn_bind_put_object(&o, desc, in);
+	if (o.len >= size) {
+		if (size > 0) {
+			buf[0] = '\0';
+		}
+		return JSMN_ERROR_NOMEM;
+	}
+	buf[o.len] = '\0';
+	return o.len;
+}
@@ -0,0 +1,131 @@
+/**
+ * Declarative binding between JSON objects and C structs, see README.md.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __JSMN_BIND_H_
+#define __JSMN_BIND_H_
+
+#include <stddef.h>
+#include "jsmn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Declarative binding between JSON objects and C structs, on top of the
+ * jsmn tokens. A struct is described by a table of fields, built with the
+ * JSMN_BIND_* macros:
+ *
+ * 	struct config {
+ * 		int interval;
+ * 		char host[32];
+ * 		unsigned char enabled;
+ * 	};
+ *
+ * 	static const jsmn_bind_field config_fields[] = {
+ * 		JSMN_BIND_BOOL(struct config, enabled),
+ * 		JSMN_BIND_STRING(struct config, host),
+ * 		JSMN_BIND_INT(struct config, interval),
+ * 	};
+ * 	JSMN_BIND_OBJECT_DEF(config_desc, config_fields);
+ *
+ * The fields must be sorted by JSON name (strcmp order), so keys can be
+ * looked up with a binary search. The first jsmn_bind_decode() or
+ * jsmn_bind_encode() with a table checks this (with jsmn_bind_check()),
+ * and they fail with JSMN_ERROR_INVAL if it isn't.
+ */
+typedef enum {
+	JSMN_BIND_T_BOOL,   /* any integer type, set to 0 or 1 */
+	JSMN_BIND_T_INT,    /* signed integer of 1, 2, 4 or sizeof(long) bytes */
+	JSMN_BIND_T_UINT,   /* unsigned integer of 1, 2, 4 or sizeof(long) bytes */
+	JSMN_BIND_T_FLOAT,  /* float or double */
+	JSMN_BIND_T_STRING, /* char array, NUL terminated, escapes decoded */
+	JSMN_BIND_T_OBJECT  /* nested struct */
+} jsmn_bind_type;
+
+struct jsmn_bind_object;
+
+typedef struct {
+	const char *name; /* JSON key */
+	unsigned char type; /* jsmn_bind_type */
+	unsigned short offset; /* offset of the member in the struct */
+	unsigned short size; /* size of the member */
+	struct jsmn_bind_object *object; /* JSMN_BIND_T_OBJECT fields */
+} jsmn_bind_field;
+
+typedef struct jsmn_bind_object {
+	const jsmn_bind_field *fields;
+	unsigned int count;
+	signed char checked; /* 0 not yet, 1 table is valid, -1 it isn't */
+} jsmn_bind_object;
+
+#define JSMN_BIND_MEMBER_SIZE(st, member) sizeof(((st *)0)->member)
+
+/**
+ * Field with a JSON name different from the member name.
+ */
+#define JSMN_BIND_FIELD(name, type, st, member, object) \
+	{ name, type, offsetof(st, member), JSMN_BIND_MEMBER_SIZE(st, member), object }
+
+#define JSMN_BIND_BOOL(st, member) \
+	JSMN_BIND_FIELD(#member, JSMN_BIND_T_BOOL, st, member, NULL)
+#define JSMN_BIND_INT(st, member) \
+	JSMN_BIND_FIELD(#member, JSMN_BIND_T_INT, st, member, NULL)
+#define JSMN_BIND_UINT(st, member) \
+	JSMN_BIND_FIELD(#member, JSMN_BIND_T_UINT, st, member, NULL)
+#define JSMN_BIND_FLOAT(st, member) \
+	JSMN_BIND_FIELD(#member, JSMN_BIND_T_FLOAT, st, member, NULL)
+#define JSMN_BIND_STRING(st, member) \
+	JSMN_BIND_FIELD(#member, JSMN_BIND_T_STRING, st, member, NULL)
+#define JSMN_BIND_OBJECT(st, member, desc) \
+	JSMN_BIND_FIELD(#member, JSMN_BIND_T_OBJECT, st, member, &(desc))
+
+/**
+ * Define a jsmn_bind_object called name for a table of fields. The object
+ * isn't const, it records whether the table has been checked.
+ */
+#define JSMN_BIND_OBJECT_DEF(name, fields) \
+	jsmn_bind_object name = { fields, sizeof(fields) / sizeof(fields[0]), 0 }
+
+/**
+ * Returns 0 if the fields (and those of nested objects) are sorted by name
+ * and have supported sizes, JSMN_ERROR_INVAL otherwise. Decoding and
+ * encoding call this the first time, it can also be called at startup.
+ */
+int jsmn_bind_check(jsmn_bind_object *desc);
+
+/**
+ * Decode the object tokens[0] (as returned by jsmn_parse() for js) into the
+ * struct out, in a single pass over the tokens. Members for keys that are
+ * not in the JSON are left unchanged, keys that are not in the table are
+ * skipped.
+ *
+ * Strings are UTF-8, \uXXXX escapes (and UTF-16 surrogate pairs of them)
+ * are decoded.
+ *
+ * Returns the number of tokens used, JSMN_ERROR_INVAL if tokens[0] isn't an
+ * object, a value has the wrong type for its field, a string has an unpaired
+ * surrogate or the table isn't valid, or JSMN_ERROR_NOMEM if a string
+ * doesn't fit.
+ */
+int jsmn_bind_decode(jsmn_bind_object *desc, void *out, const char *js,
+		const jsmntok_t *tokens, unsigned int num_tokens);
+
+/**
+ * Write the struct in as a JSON object into buf, NUL terminated.
+ *
+ * Returns the length written (not counting the NUL), JSMN_ERROR_NOMEM if
+ * it doesn't fit in size bytes, or JSMN_ERROR_INVAL if the table isn't
+ * valid.
+ */
+int jsmn_bind_encode(jsmn_bind_object *desc, const void *in, char *buf,
+		size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSMN_BIND_H_ */
@@ -0,0 +1,381 @@
+/**
+ * Streaming (push) JSON parser, see jsmn_stream.h.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include "jsmn_stream.h"
+
+/**
+ * Streaming parser states.
+ */
+enum {
+	JSMN_S_VALUE,          /* expecting a value */
+	JSMN_S_VALUE_OR_END,   /* after '[' */
+	JSMN_S_KEY,            /* after ',' in an object */
+	JSMN_S_KEY_OR_END,     /* after '{' */
+	JSMN_S_COLON,          /* after an object key */
+	JSMN_S_COMMA_OR_END,   /* after a value inside an object or array */
+	JSMN_S_STRING,         /* inside a string */
+	JSMN_S_ESCAPE,         /* after a backslash inside a string */
+	JSMN_S_UNICODE,        /* inside \uXXXX */
+	JSMN_S_PRIMITIVE,      /* inside a primitive */
+	JSMN_S_DONE,           /* top level value complete */
+	JSMN_S_ERROR
+};
+
+static int jsmn_stream_fail(jsmn_stream_parser *parser, int error) {
+	parser->error = error;
+	parser->state = JSMN_S_ERROR;
+	return error;
+}
+
+/**
+ * Appends a character to the key or value being parsed, truncating
+ * when the buffer is full.
+ */
+static void jsmn_stream_append(jsmn_stream_parser *parser, char c) {
+	char *buf;
+	size_t size;
+
+	if (parser->is_key) {
+		buf = parser->levels[parser->depth - 1].key;
+		size = JSMN_STREAM_MAX_KEY;
+	} else {
+		buf = parser->value;
+		size = JSMN_STREAM_MAX_VALUE;
+	}
+	if (parser->value_len + 1 < size) {
+		buf[parser->value_len++] = c;
+		buf[parser->value_len] = '\0';
+	} else if (parser->is_key) {
+		parser->levels[parser->depth - 1].key_truncated = 1;
+	} else {
+		parser->truncated = 1;
+	}
+}
+
+/**
+ * A value (or a whole object/array) is complete.
+ */
+static void jsmn_stream_value_done(jsmn_stream_parser *parser) {
+	parser->state = (parser->depth == 0) ? JSMN_S_DONE : JSMN_S_COMMA_OR_END;
+}
+
+static int jsmn_stream_emit_value(jsmn_stream_parser *parser, jsmntype_t type) {
+	int r = 0;
+	if (parser->callback != NULL) {
+		r = parser->callback(parser, JSMN_STREAM_VALUE, type,
+				parser->value, parser->value_len);
+	}
+	jsmn_stream_value_done(parser);
+	return r;
+}
+
+static int jsmn_stream_open(jsmn_stream_parser *parser, jsmntype_t type) {
+	jsmn_stream_level *level;
+	int r = 0;
+
+	if (parser->depth >= JSMN_STREAM_MAX_DEPTH) {
+		return jsmn_stream_fail(parser, JSMN_ERROR_NOMEM);
+	}
+	if (parser->callback != NULL) {
+		r = parser->callback(parser, JSMN_STREAM_START, type, NULL, 0);
+	}
+	level = &parser->levels[parser->depth++];
+	level->type = type;
+	level->index = 0;
+	level->key_truncated = 0;
+	level->key[0] = '\0';
+	parser->state = (type == JSMN_OBJECT) ? JSMN_S_KEY_OR_END : JSMN_S_VALUE_OR_END;
+	return r;
+}
+
+static int jsmn_stream_close(jsmn_stream_parser *parser, jsmntype_t type) {
+	int r = 0;
+
+	if (parser->depth == 0 || parser->levels[parser->depth - 1].type != type) {
+		return jsmn_stream_fail(parser, JSMN_ERROR_INVAL);
+	}
+	/* Pop first so the key/index describe the object/array in its parent */
+	parser->depth--;
+	if (parser->callback != NULL) {
+		r = parser->callback(parser, JSMN_STREAM_END, type, NULL, 0);
+	}
+	jsmn_stream_value_done(parser);
+	return r;
+}
+
+static int jsmn_stream_is_hex(char c) {
+	return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'F') ||
+		(c >= 'a' && c <= 'f');
+}
+
+/**
+ * Parses one character. Returns 0, an error or the callback's result.
+ */
+static int jsmn_stream_char(jsmn_stream_parser *parser, char c) {
+	switch (parser->state) {
+		case JSMN_S_STRING:
+			if (c == '\"') {
+				if (parser->is_key) {
+					parser->is_key = 0;
+					parser->state = JSMN_S_COLON;
+					return 0;
+				}
+				return jsmn_stream_emit_value(parser, JSMN_STRING);
+			}
+			if (c == '\\') {
+				parser->state = JSMN_S_ESCAPE;
+			}
+			jsmn_stream_append(parser, c);
+			return 0;
+
+		case JSMN_S_ESCAPE:
+			switch (c) {
+				/* Allowed escaped symbols */
+				case '\"': case '/' : case '\\' : case 'b' :
+				case 'f' : case 'r' : case 'n'  : case 't' :
+					parser->state = JSMN_S_STRING;
+					break;
+				/* Allows escaped symbol \uXXXX */
+				case 'u':
+					parser->hex = 0;
+					parser->state = JSMN_S_UNICODE;
+					break;
+				/* Unexpected symbol */
+				default:
+					return jsmn_stream_fail(parser, JSMN_ERROR_INVAL);
+			}
+			jsmn_stream_append(parser, c);
+			return 0;
+
+		case JSMN_S_UNICODE:
+			if (!jsmn_stream_is_hex(c)) {
+				return jsmn_stream_fail(parser, JSMN_ERROR_INVAL);
+			}
+			if (++parser->hex == 4) {
+				parser->state = JSMN_S_STRING;
+			}
+			jsmn_stream_append(parser, c);
+			return 0;
+
+		case JSMN_S_PRIMITIVE:
+			switch (c) {
+				case '\t' : case '\r' : case '\n' : case ' ' :
+				case ','  : case ']'  : case '}' : {
+					/* End of the primitive, the delimiter is parsed again
+					 * in the new state */
+					int r = jsmn_stream_emit_value(parser, JSMN_PRIMITIVE);
+					if (r != 0) {
+						return r;
+					}
+					return jsmn_stream_char(parser, c);
+				}
+			}
+			if (c < 32 || c >= 127 || c == '\"' || c == ':' ||
+					c == '{' || c == '[') {
+				return jsmn_stream_fail(parser, JSMN_ERROR_INVAL);
+			}
+			jsmn_stream_append(parser, c);
+			return 0;
+
+		case JSMN_S_ERROR:
+			return parser->error;
+	}
+
+	/* Structural states, whitespace is insignificant */
+	switch (c) {
+		case '\t' : case '\r' : case '\n' : case ' ':
+			return 0;
+	}
+
+	switch (parser->state) {
+		case JSMN_S_VALUE_OR_END:
+			if (c == ']') {
+				return jsmn_stream_close(parser, JSMN_ARRAY);
+			}
+			/* fall through */
+		case JSMN_S_VALUE:
+			parser->value_len = 0;
+			parser->value[0] = '\0';
+			parser->truncated = 0;
+			switch (c) {
+				case '{':
+					return jsmn_stream_open(parser, JSMN_OBJECT);
+				case '[':
+					return jsmn_stream_open(parser, JSMN_ARRAY);
+				case '\"':
+					parser->is_key = 0;
+					parser->state = JSMN_S_STRING;
+					return 0;
+#ifdef JSMN_STRICT
+				/* In strict mode primitives are: numbers and booleans */
+				case '-': case '0': case '1' : case '2': case '3' : case '4':
+				case '5': case '6': case '7' : case '8': case '9':
+				case 't': case 'f': case 'n' :
+#else
+				/* In non-strict mode every unquoted value is a primitive */
+				default:
+					if (c < 32 || c >= 127 || c == ',' || c == ':' ||
+							c == ']' || c == '}') {
+						return jsmn_stream_fail(parser, JSMN_ERROR_INVAL);
+					}
+#endif
+					parser->state = JSMN_S_PRIMITIVE;
+					jsmn_stream_append(parser, c);
+					return 0;
+			}
+			return jsmn_stream_fail(parser, JSMN_ERROR_INVAL);
+
+		case JSMN_S_KEY_OR_END:
+			if (c == '}') {
+				return jsmn_stream_close(parser, JSMN_OBJECT);
+			}
+			/* fall through */
+		case JSMN_S_KEY:
+			if (c != '\"') {
+				return jsmn_stream_fail(parser, JSMN_ERROR_INVAL);
+			}
+			parser->value_len = 0;
+			parser->levels[parser->depth - 1].key[0] = '\0';
+			parser->levels[parser->depth - 1].key_truncated = 0;
+			parser->is_key = 1;
+			parser->state = JSMN_S_STRING;
+			return 0;
+
+		case JSMN_S_COLON:
+			if (c != ':') {
+				return jsmn_stream_fail(parser, JSMN_ERROR_INVAL);
+			}
+			parser->state = JSMN_S_VALUE;
+			return 0;
+
+		case JSMN_S_COMMA_OR_END:
+			if (c == ',') {
+				jsmn_stream_level *level = &parser->levels[parser->depth - 1];
+				level->index++;
+				parser->state = (level->type == JSMN_OBJECT) ? JSMN_S_KEY : JSMN_S_VALUE;
+				return 0;
+			}
+			if (c == '}') {
+				return jsmn_stream_close(parser, JSMN_OBJECT);
+			}
+			if (c == ']') {
+				return jsmn_stream_close(parser, JSMN_ARRAY);
+			}
+			return jsmn_stream_fail(parser, JSMN_ERROR_INVAL);
+	}
+
+	/* JSMN_S_DONE: only whitespace may follow */
+	return jsmn_stream_fail(parser, JSMN_ERROR_INVAL);
+}
+
+void jsmn_stream_init(jsmn_stream_parser *parser, jsmn_stream_cb callback,
+		void *user) {
+	parser->callback = callback;
+	parser->user = user;
+	parser->pos = 0;
+	parser->state = JSMN_S_VALUE;
+	parser->error = 0;
+	parser->is_key = 0;
+	parser->hex = 0;
+	parser->truncated = 0;
+	parser->depth = 0;
+	parser->value_len = 0;
+	parser->value[0] = '\0';
+}
+
+int jsmn_stream_feed(jsmn_stream_parser *parser, const char *js, size_t len) {
+	size_t i;
+	int r;
+
+	for (i = 0; i < len; i++) {
+		r = jsmn_stream_char(parser, js[i]);
+		if (r != 0) {
+			return r;
+		}
+		parser->pos++;
+	}
+	return 0;
+}
+
+int jsmn_stream_finish(jsmn_stream_parser *parser) {
+	int r;
+
+	/* A top level primitive is only terminated by the end of the data */
+	if (parser->state == JSMN_S_PRIMITIVE && parser->depth == 0) {
+		r = jsmn_stream_emit_value(parser, JSMN_PRIMITIVE);
+		if (r != 0) {
+			return r;
+		}
+	}
+	if (parser->state == JSMN_S_ERROR) {
+		return parser->error;
+	}
+	return (parser->state == JSMN_S_DONE) ? 0 : JSMN_ERROR_PART;
+}
+
+const char *jsmn_stream_key(const jsmn_stream_parser *parser) {
+	if (parser->depth == 0 ||
+			parser->levels[parser->depth - 1].type != JSMN_OBJECT) {
+		return NULL;
+	}
+	return parser->levels[parser->depth - 1].key;
+}
+
+int jsmn_stream_index(const jsmn_stream_parser *parser) {
+	if (parser->depth == 0) {
+		return -1;
+	}
+	return parser->levels[parser->depth - 1].index;
+}
+
+int jsmn_stream_path(const jsmn_stream_parser *parser, char *buf, size_t size) {
+	size_t n = 0;
+	unsigned int i;
+
+	for (i = 0; i < parser->depth; i++) {
+		const jsmn_stream_level *level = &parser->levels[i];
+		if (level->type == JSMN_OBJECT) {
+			const char *key = level->key;
+			if (i > 0) {
+				if (n + 1 >= size) return -1;
+				buf[n++] = '.';
+			}
+			for (; *key != '\0'; key++) {
+				if (n + 1 >= size) return -1;
+				buf[n++] = *key;
+			}
+		} else {
+			char digits[10];
+			unsigned int index = level->index;
+			int d = 0;
+			do {
+				digits[d++] = '0' + index % 10;
+				index /= 10;
+			} while (index > 0);
+			if (n + d + 2 >= size) return -1;
+			buf[n++] = '[';
+			while (d > 0) {
+				buf[n++] = digits[--d];
+			}
+			buf[n++] = ']';
+		}
+	}
+	if (n >= size) return -1;
+	buf[n] = '\0';
+	return n;
+}
+
+int jsmn_stream_truncated(const jsmn_stream_parser *parser) {
+	unsigned int i;
+
+	for (i = 0; i < parser->depth; i++) {
+		if (parser->levels[i].type == JSMN_OBJECT &&
+				parser->levels[i].key_truncated) {
+			return 1;
+		}
+	}
+	return parser->truncated;
+}
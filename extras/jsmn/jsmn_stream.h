@@ -0,0 +1,135 @@
+/**
+ * Streaming (push) JSON parser built on the jsmn token types.
+ *
+ * The JSON data is fed in chunks of any size as it arrives and a callback
+ * is called for each value, object and array, so a large document never
+ * has to be held in memory. See README.md.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __JSMN_STREAM_H_
+#define __JSMN_STREAM_H_
+
+#include <stddef.h>
+#include "jsmn.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Streaming parser limits. Memory use is bounded by these, not by the
+ * size of the JSON document.
+ * 	o JSMN_STREAM_MAX_DEPTH - maximum nesting of objects and arrays
+ * 	o JSMN_STREAM_MAX_KEY - longest object key kept for the path (including
+ * 	  the terminating NUL), longer keys are truncated
+ * 	o JSMN_STREAM_MAX_VALUE - longest string or primitive value passed to the
+ * 	  callback (including the terminating NUL), longer values are truncated
+ */
+#ifndef JSMN_STREAM_MAX_DEPTH
+#define JSMN_STREAM_MAX_DEPTH 8
+#endif
+#ifndef JSMN_STREAM_MAX_KEY
+#define JSMN_STREAM_MAX_KEY 16
+#endif
+#ifndef JSMN_STREAM_MAX_VALUE
+#define JSMN_STREAM_MAX_VALUE 64
+#endif
+
+typedef enum {
+	JSMN_STREAM_START = 0, /* object or array opened */
+	JSMN_STREAM_END = 1,   /* object or array closed */
+	JSMN_STREAM_VALUE = 2  /* complete string or primitive */
+} jsmn_stream_event;
+
+typedef struct jsmn_stream_parser jsmn_stream_parser;
+
+/**
+ * Streaming parser callback. For JSMN_STREAM_VALUE, value is the NUL
+ * terminated string (without quotes, escapes not decoded) or primitive and
+ * len its length. During the callback jsmn_stream_key(), jsmn_stream_index()
+ * and jsmn_stream_path() describe where the value or object/array is, and
+ * jsmn_stream_truncated() says if any of it was cut short.
+ * Return 0 to continue, anything else stops parsing and is returned by
+ * jsmn_stream_feed().
+ */
+typedef int (*jsmn_stream_cb)(jsmn_stream_parser *parser, jsmn_stream_event event,
+		jsmntype_t type, const char *value, size_t len);
+
+typedef struct {
+	jsmntype_t type; /* JSMN_OBJECT or JSMN_ARRAY */
+	unsigned int index; /* current element/member number */
+	unsigned char key_truncated; /* key didn't fit */
+	char key[JSMN_STREAM_MAX_KEY]; /* current member key (objects) */
+} jsmn_stream_level;
+
+struct jsmn_stream_parser {
+	jsmn_stream_cb callback;
+	void *user; /* for use by the callback */
+	unsigned int pos; /* total bytes fed */
+	int state;
+	int error;
+	unsigned char is_key; /* string being parsed is an object key */
+	unsigned char hex; /* \uXXXX digits seen */
+	unsigned char truncated; /* current value didn't fit */
+	unsigned int depth;
+	size_t value_len;
+	char value[JSMN_STREAM_MAX_VALUE];
+	jsmn_stream_level levels[JSMN_STREAM_MAX_DEPTH];
+};
+
+/**
+ * Prepare a streaming parser. Unlike jsmn_parse(), the JSON data doesn't need
+ * to be kept in memory: feed it in chunks of any size as it arrives and the
+ * callback is called for each value, object and array.
+ */
+void jsmn_stream_init(jsmn_stream_parser *parser, jsmn_stream_cb callback,
+		void *user);
+
+/**
+ * Parse the next chunk of JSON data. Returns 0 or a negative error:
+ * JSMN_ERROR_INVAL for invalid JSON (including data after the end of the
+ * top level value), JSMN_ERROR_NOMEM if nesting is deeper than
+ * JSMN_STREAM_MAX_DEPTH. Once an error is returned it is returned again
+ * for any further data.
+ */
+int jsmn_stream_feed(jsmn_stream_parser *parser, const char *js, size_t len);
+
+/**
+ * Signal the end of the data. Returns 0 if a complete JSON value was parsed,
+ * JSMN_ERROR_PART if it was cut short, or the error from jsmn_stream_feed().
+ */
+int jsmn_stream_finish(jsmn_stream_parser *parser);
+
+/**
+ * Key of the current value in its parent object, NULL if the parent is an
+ * array or this is the top level value.
+ */
+const char *jsmn_stream_key(const jsmn_stream_parser *parser);
+
+/**
+ * Index of the current value in its parent array (or object), -1 at the top
+ * level.
+ */
+int jsmn_stream_index(const jsmn_stream_parser *parser);
+
+/**
+ * Write the path of the current value, like "config.servers[1].host", into
+ * buf. Returns the length of the path, or -1 if it doesn't fit in size bytes.
+ */
+int jsmn_stream_path(const jsmn_stream_parser *parser, char *buf, size_t size);
+
+/**
+ * Non-zero if the current value (JSMN_STREAM_VALUE only), or any key on its
+ * path, was longer than JSMN_STREAM_MAX_VALUE/JSMN_STREAM_MAX_KEY and has
+ * been truncated. A truncated key may then match a shorter key it doesn't
+ * equal.
+ */
+int jsmn_stream_truncated(const jsmn_stream_parser *parser);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __JSMN_STREAM_H_ */
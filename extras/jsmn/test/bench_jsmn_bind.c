@@ -0,0 +1,173 @@
+/* Host benchmark of the JSON to struct binding.
+ *
+ * Decodes a 12 member settings object with jsmn_bind_decode(), and with the
+ * loop of examples/json_jsmn_simple that compares every key against each
+ * member name in turn with strncmp(), and prints the time per document for
+ * each (the best of several samples). Both are given the same tokens;
+ * parsing isn't timed.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../jsmn/jsmn.c"
+#include "../jsmn_bind.c"
+
+#define ROUNDS 20000
+#define SAMPLES 10
+
+struct settings {
+    char ap[16];
+    char password[16];
+    char server[32];
+    unsigned short port;
+    int interval;
+    int timezone;
+    int offset;
+    unsigned char dhcp;
+    unsigned char debug;
+    unsigned int retries;
+    float gain;
+    char mode[8];
+};
+
+static const jsmn_bind_field settings_fields[] = {
+    JSMN_BIND_STRING(struct settings, ap),
+    JSMN_BIND_BOOL(struct settings, debug),
+    JSMN_BIND_BOOL(struct settings, dhcp),
+    JSMN_BIND_FLOAT(struct settings, gain),
+    JSMN_BIND_INT(struct settings, interval),
+    JSMN_BIND_STRING(struct settings, mode),
+    JSMN_BIND_INT(struct settings, offset),
+    JSMN_BIND_STRING(struct settings, password),
+    JSMN_BIND_UINT(struct settings, port),
+    JSMN_BIND_UINT(struct settings, retries),
+    JSMN_BIND_STRING(struct settings, server),
+    JSMN_BIND_INT(struct settings, timezone),
+};
+static JSMN_BIND_OBJECT_DEF(settings_desc, settings_fields);
+
+static const char doc[] =
+    "{\"ap\": \"home-wifi\", \"password\": \"secret123\", \"server\": \"mqtt.example.com\","
+    " \"port\": 1883, \"interval\": 60, \"timezone\": 2, \"offset\": -15, \"dhcp\": true,"
+    " \"debug\": false, \"retries\": 5, \"gain\": 1.25, \"mode\": \"auto\"}";
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int jsoneq(const char *json, jsmntok_t *tok, const char *s)
+{
+    if (tok->type == JSMN_STRING && (int)strlen(s) == tok->end - tok->start &&
+        strncmp(json + tok->start, s, tok->end - tok->start) == 0) {
+        return 0;
+    }
+    return -1;
+}
+
+static void copy_string(char *dst, size_t size, const char *js, jsmntok_t *tok)
+{
+    size_t len = tok->end - tok->start;
+    if (len >= size) {
+        len = size - 1;
+    }
+    memcpy(dst, js + tok->start, len);
+    dst[len] = '\0';
+}
+
+/* What an application does without the binding: each key is compared with
+   every name until one matches, and the value converted by hand */
+static int decode_strcmp(struct settings *s, const char *js, jsmntok_t *t, int r)
+{
+    for (int i = 1; i < r - 1; i += 2) {
+        const char *v = js + t[i + 1].start;
+        if (jsoneq(js, &t[i], "ap") == 0) {
+            copy_string(s->ap, sizeof(s->ap), js, &t[i + 1]);
+        } else if (jsoneq(js, &t[i], "password") == 0) {
+            copy_string(s->password, sizeof(s->password), js, &t[i + 1]);
+        } else if (jsoneq(js, &t[i], "server") == 0) {
+            copy_string(s->server, sizeof(s->server), js, &t[i + 1]);
+        } else if (jsoneq(js, &t[i], "port") == 0) {
+            s->port = strtoul(v, NULL, 10);
+        } else if (jsoneq(js, &t[i], "interval") == 0) {
+            s->interval = strtol(v, NULL, 10);
+        } else if (jsoneq(js, &t[i], "timezone") == 0) {
+            s->timezone = strtol(v, NULL, 10);
+        } else if (jsoneq(js, &t[i], "offset") == 0) {
+            s->offset = strtol(v, NULL, 10);
+        } else if (jsoneq(js, &t[i], "dhcp") == 0) {
+            s->dhcp = (*v == 't');
+        } else if (jsoneq(js, &t[i], "debug") == 0) {
+            s->debug = (*v == 't');
+        } else if (jsoneq(js, &t[i], "retries") == 0) {
+            s->retries = strtoul(v, NULL, 10);
+        } else if (jsoneq(js, &t[i], "gain") == 0) {
+            s->gain = strtod(v, NULL);
+        } else if (jsoneq(js, &t[i], "mode") == 0) {
+            copy_string(s->mode, sizeof(s->mode), js, &t[i + 1]);
+        }
+    }
+    return r;
+}
+
+static void report(const char *name, double best)
+{
+    printf("%-28s %7.1f ns/document\n", name, best * 1e9 / ROUNDS);
+}
+
+int main(void)
+{
+    jsmn_parser parser;
+    jsmntok_t t[32];
+    struct settings a, b;
+    double start, elapsed, best_strcmp = 0, best_bind = 0;
+    int r;
+
+    jsmn_init(&parser);
+    r = jsmn_parse(&parser, doc, strlen(doc), t, sizeof(t) / sizeof(t[0]));
+    if (r < 0) {
+        printf("jsmn_parse failed: %d\n", r);
+        return 1;
+    }
+    printf("document %u bytes, %d tokens\n", (unsigned)strlen(doc), r);
+
+    memset(&a, 0, sizeof(a));
+    memset(&b, 0, sizeof(b));
+    for (int n = 0; n < SAMPLES; n++) {
+        start = now();
+        for (int i = 0; i < ROUNDS; i++) {
+            decode_strcmp(&a, doc, t, r);
+        }
+        elapsed = now() - start;
+        if (n == 0 || elapsed < best_strcmp) {
+            best_strcmp = elapsed;
+        }
+
+        start = now();
+        for (int i = 0; i < ROUNDS; i++) {
+            if (jsmn_bind_decode(&settings_desc, &b, doc, t, r) < 0) {
+                printf("jsmn_bind_decode failed\n");
+                return 1;
+            }
+        }
+        elapsed = now() - start;
+        if (n == 0 || elapsed < best_bind) {
+            best_bind = elapsed;
+        }
+    }
+    report("strncmp on every key", best_strcmp);
+    report("jsmn_bind_decode", best_bind);
+
+    if (memcmp(&a, &b, sizeof(a)) != 0) {
+        printf("results differ\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,108 @@
+/* Host benchmark of the streaming JSON parser against jsmn_parse().
+ *
+ * Parses a generated telemetry-like document of about 8KB with
+ * jsmn_parse() on the whole buffer, and with jsmn_stream_feed() both on
+ * the whole buffer and in 536 byte chunks (a TCP segment), and prints the
+ * time per byte and the memory each needs.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../jsmn/jsmn.c"
+#include "../jsmn_stream.c"
+
+#define ROUNDS 2000
+#define MAX_TOKENS 2048
+
+static char doc[16384];
+static size_t doc_len;
+static jsmntok_t tokens[MAX_TOKENS];
+
+static void make_doc(void)
+{
+    char *s = doc;
+    s += sprintf(s, "{\"device\": \"esp-0042\", \"fw\": \"1.4.2\", \"samples\": [");
+    for (int i = 0; i < 120; i++) {
+        s += sprintf(s, "%s{\"t\": %d, \"temp\": %d.%d, \"rh\": %d, \"ok\": true, \"tag\": \"s%d\"}",
+                     i ? ", " : "", 1500000000 + i * 60, 20 + i % 7, i % 10, 40 + i % 20, i);
+    }
+    s += sprintf(s, "], \"config\": {\"interval\": 60, \"servers\": [\"a.example.com\", \"b.example.com\"]}}");
+    doc_len = s - doc;
+}
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int values;
+
+static int count_cb(jsmn_stream_parser *p, jsmn_stream_event event,
+                    jsmntype_t type, const char *value, size_t len)
+{
+    if (event == JSMN_STREAM_VALUE) {
+        values++;
+    }
+    return 0;
+}
+
+static void report(const char *name, double start, size_t memory)
+{
+    double ns = (now() - start) * 1e9 / ROUNDS / doc_len;
+    printf("%-34s %6.2f ns/byte %8u bytes RAM\n", name, ns, (unsigned)memory);
+}
+
+int main(void)
+{
+    jsmn_parser parser;
+    jsmn_stream_parser stream;
+    int ntokens = 0;
+    double start;
+
+    make_doc();
+    printf("document %u bytes\n", (unsigned)doc_len);
+
+    start = now();
+    for (int i = 0; i < ROUNDS; i++) {
+        jsmn_init(&parser);
+        ntokens = jsmn_parse(&parser, doc, doc_len, tokens, MAX_TOKENS);
+    }
+    if (ntokens < 0) {
+        printf("jsmn_parse failed: %d\n", ntokens);
+        return 1;
+    }
+    /* jsmn_parse needs the whole document and a token for each value */
+    report("jsmn_parse", start, doc_len + ntokens * sizeof(jsmntok_t));
+
+    start = now();
+    for (int i = 0; i < ROUNDS; i++) {
+        jsmn_stream_init(&stream, count_cb, NULL);
+        jsmn_stream_feed(&stream, doc, doc_len);
+        if (jsmn_stream_finish(&stream) != 0) {
+            printf("jsmn_stream_feed failed\n");
+            return 1;
+        }
+    }
+    report("jsmn_stream_feed, whole buffer", start, doc_len + sizeof(stream));
+
+    start = now();
+    for (int i = 0; i < ROUNDS; i++) {
+        jsmn_stream_init(&stream, count_cb, NULL);
+        for (size_t pos = 0; pos < doc_len; pos += 536) {
+            jsmn_stream_feed(&stream, doc + pos, doc_len - pos < 536 ? doc_len - pos : 536);
+        }
+        jsmn_stream_finish(&stream);
+    }
+    /* only one chunk needs to be in memory at a time */
+    report("jsmn_stream_feed, 536 byte chunks", start, 536 + sizeof(stream));
+
+    printf("%d tokens, %d values per document\n", ntokens, values / (2 * ROUNDS));
+    return 0;
+}
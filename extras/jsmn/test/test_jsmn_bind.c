@@ -0,0 +1,276 @@
+/* Host test for the JSON to struct binding.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "../jsmn/jsmn.c"
+#include "../jsmn_bind.c"
+
+struct server {
+    char host[16];
+    unsigned short port;
+};
+
+struct config {
+    unsigned char enabled;
+    int interval;
+    long offset;
+    signed char level;
+    unsigned int count;
+    float ratio;
+    double scale;
+    char name[8];
+    struct server server;
+};
+
+static const jsmn_bind_field server_fields[] = {
+    JSMN_BIND_STRING(struct server, host),
+    JSMN_BIND_UINT(struct server, port),
+};
+static JSMN_BIND_OBJECT_DEF(server_desc, server_fields);
+
+static const jsmn_bind_field config_fields[] = {
+    JSMN_BIND_UINT(struct config, count),
+    JSMN_BIND_BOOL(struct config, enabled),
+    JSMN_BIND_INT(struct config, interval),
+    JSMN_BIND_INT(struct config, level),
+    JSMN_BIND_STRING(struct config, name),
+    JSMN_BIND_INT(struct config, offset),
+    JSMN_BIND_FLOAT(struct config, ratio),
+    JSMN_BIND_FLOAT(struct config, scale),
+    JSMN_BIND_OBJECT(struct config, server, server_desc),
+    JSMN_BIND_FIELD("time-zone", JSMN_BIND_T_INT, struct config, level, NULL),
+};
+static JSMN_BIND_OBJECT_DEF(config_desc, config_fields);
+
+static int bind_desc(jsmn_bind_object *desc, const char *js, void *out)
+{
+    jsmn_parser p;
+    jsmntok_t t[64];
+    int r;
+
+    jsmn_init(&p);
+    r = jsmn_parse(&p, js, strlen(js), t, sizeof(t) / sizeof(t[0]));
+    if (r < 0) {
+        return r;
+    }
+    return jsmn_bind_decode(desc, out, js, t, r);
+}
+
+static int bind(const char *js, struct config *c)
+{
+    return bind_desc(&config_desc, js, c);
+}
+
+int test_bind_check(void)
+{
+    static const jsmn_bind_field unsorted[] = {
+        JSMN_BIND_INT(struct config, interval),
+        JSMN_BIND_BOOL(struct config, enabled),
+    };
+    static JSMN_BIND_OBJECT_DEF(unsorted_desc, unsorted);
+
+    check(jsmn_bind_check(&config_desc) == 0);
+    check(jsmn_bind_check(&unsorted_desc) == JSMN_ERROR_INVAL);
+    done();
+}
+
+/* An unsorted table is found on first use, not searched wrongly */
+int test_bind_unsorted(void)
+{
+    static const jsmn_bind_field unsorted[] = {
+        JSMN_BIND_INT(struct config, interval),
+        JSMN_BIND_BOOL(struct config, enabled),
+    };
+    static JSMN_BIND_OBJECT_DEF(unsorted_desc, unsorted);
+    static const jsmn_bind_field unsorted_server[] = {
+        JSMN_BIND_UINT(struct server, port),
+        JSMN_BIND_STRING(struct server, host),
+    };
+    static JSMN_BIND_OBJECT_DEF(unsorted_server_desc, unsorted_server);
+    static const jsmn_bind_field nested[] = {
+        JSMN_BIND_OBJECT(struct config, server, unsorted_server_desc),
+    };
+    static JSMN_BIND_OBJECT_DEF(nested_desc, nested);
+    struct config c;
+    char buf[64];
+
+    memset(&c, 0, sizeof(c));
+    check(unsorted_desc.checked == 0);
+    check(bind_desc(&unsorted_desc, "{\"enabled\": true}", &c) == JSMN_ERROR_INVAL);
+    check(unsorted_desc.checked < 0);
+    check(c.enabled == 0);
+    check(jsmn_bind_encode(&unsorted_desc, &c, buf, sizeof(buf)) == JSMN_ERROR_INVAL);
+
+    check(bind_desc(&nested_desc, "{\"server\": {\"port\": 1}}", &c) == JSMN_ERROR_INVAL);
+    check(c.server.port == 0);
+    check(jsmn_bind_encode(&nested_desc, &c, buf, sizeof(buf)) == JSMN_ERROR_INVAL);
+    done();
+}
+
+int test_bind_decode(void)
+{
+    struct config c;
+    const char *js = "{\"enabled\": true, \"interval\": -30, \"unknown\": [1, {\"a\": 2}],"
+        " \"name\": \"a\\\"b\\u00e9\", \"ratio\": 0.25, \"scale\": -1.5e3,"
+        " \"server\": {\"port\": 8883, \"host\": \"example.com\", \"x\": {}},"
+        " \"count\": 4000000000, \"offset\": -100000, \"level\": -5}";
+
+    memset(&c, 0, sizeof(c));
+    check(bind(js, &c) == 31);
+    check(config_desc.checked == 1);
+    check(server_desc.checked == 1);
+    check(c.enabled == 1);
+    check(c.interval == -30);
+    check(strcmp(c.name, "a\"b\xc3\xa9") == 0);
+    check(c.ratio == 0.25f);
+    check(c.scale == -1500.0);
+    check(c.server.port == 8883);
+    check(strcmp(c.server.host, "example.com") == 0);
+    check(c.count == 4000000000u);
+    check(c.offset == -100000);
+    check(c.level == -5);
+
+    /* missing keys leave members alone */
+    check(bind("{\"enabled\": false, \"time-zone\": 2}", &c) == 5);
+    check(c.enabled == 0);
+    check(c.level == 2);
+    check(c.interval == -30);
+    done();
+}
+
+int test_bind_unicode(void)
+{
+    struct server s;
+    static const struct {
+        const char *json;
+        const char *utf8;
+    } strings[] = {
+        { "\"\\u0041\"", "A" },
+        { "\"\\u00e9\"", "\xc3\xa9" },
+        { "\"\\u20AC\"", "\xe2\x82\xac" },
+        /* U+1F600 as a surrogate pair */
+        { "\"\\ud83d\\ude00\"", "\xf0\x9f\x98\x80" },
+        { "\"x\\uD800\\uDC00y\"", "x\xf0\x90\x80\x80y" },
+        { "\"\\udbff\\udfff\"", "\xf4\x8f\xbf\xbf" },
+    };
+    static const char *bad[] = {
+        "\"\\ud83d\"",
+        "\"\\ud83dx\"",
+        "\"\\ud83d\\n\"",
+        "\"\\ud83d\\u0041\"",
+        "\"\\ud83d\\ud83d\"",
+        "\"\\ude00\"",
+        "\"\\ude00\\ud83d\"",
+        "\"\\ud83d\\ude0\"",
+    };
+    char js[64];
+
+    for (int i = 0; i < sizeof(strings) / sizeof(strings[0]); i++) {
+        snprintf(js, sizeof(js), "{\"host\": %s}", strings[i].json);
+        check(bind_desc(&server_desc, js, &s) == 3);
+        check(strcmp(s.host, strings[i].utf8) == 0);
+    }
+    for (int i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        snprintf(js, sizeof(js), "{\"host\": %s}", bad[i]);
+        check(bind_desc(&server_desc, js, &s) == JSMN_ERROR_INVAL);
+    }
+    /* 15 bytes fit in host[16], the 4 byte sequence doesn't fit after 12 */
+    check(bind_desc(&server_desc, "{\"host\": \"01234567890\\ud83d\\ude00\"}", &s) == 3);
+    check(bind_desc(&server_desc, "{\"host\": \"012345678901\\ud83d\\ude00\"}", &s) == JSMN_ERROR_NOMEM);
+    done();
+}
+
+int test_bind_decode_errors(void)
+{
+    struct config c;
+
+    memset(&c, 0, sizeof(c));
+    check(bind("[1]", &c) == JSMN_ERROR_INVAL);
+    check(bind("{\"interval\": \"5\"}", &c) == JSMN_ERROR_INVAL);
+    check(bind("{\"interval\": 5x}", &c) == JSMN_ERROR_INVAL);
+    check(bind("{\"enabled\": 1}", &c) == JSMN_ERROR_INVAL);
+    check(bind("{\"name\": 5}", &c) == JSMN_ERROR_INVAL);
+    check(bind("{\"server\": []}", &c) == JSMN_ERROR_INVAL);
+    check(bind("{\"name\": \"12345678\"}", &c) == JSMN_ERROR_NOMEM);
+    check(bind("{\"name\": \"1234567\"}", &c) == 3);
+    check(strcmp(c.name, "1234567") == 0);
+    done();
+}
+
+int test_bind_encode(void)
+{
+    struct config c, d;
+    char buf[256];
+    int r;
+
+    memset(&c, 0, sizeof(c));
+    c.enabled = 1;
+    c.interval = -30;
+    c.offset = 123456;
+    c.level = -128;
+    c.count = 4000000000u;
+    c.ratio = 0.25f;
+    c.scale = 3e12;
+    strcpy(c.name, "a\"\n\x01");
+    strcpy(c.server.host, "example.com");
+    c.server.port = 443;
+
+    r = jsmn_bind_encode(&config_desc, &c, buf, sizeof(buf));
+    check(r == (int)strlen(buf));
+    check(strcmp(buf, "{\"count\":4000000000,\"enabled\":true,\"interval\":-30,"
+                 "\"level\":-128,\"name\":\"a\\\"\\n\\u0001\",\"offset\":123456,"
+                 "\"ratio\":0.25,\"scale\":3e12,"
+                 "\"server\":{\"host\":\"example.com\",\"port\":443},\"time-zone\":-128}") == 0);
+
+    /* and back again */
+    memset(&d, 0, sizeof(d));
+    check(bind(buf, &d) > 0);
+    check(memcmp(&c, &d, sizeof(c)) == 0);
+
+    check(jsmn_bind_encode(&config_desc, &c, buf, r) == JSMN_ERROR_NOMEM);
+    check(jsmn_bind_encode(&config_desc, &c, buf, r + 1) == r);
+    done();
+}
+
+int test_bind_encode_float(void)
+{
+    static const jsmn_bind_field fields[] = {
+        JSMN_BIND_FLOAT(struct config, scale),
+    };
+    static JSMN_BIND_OBJECT_DEF(desc, fields);
+    struct config c;
+    char buf[64];
+
+    c.scale = 0;
+    check(jsmn_bind_encode(&desc, &c, buf, sizeof(buf)) > 0);
+    check(strcmp(buf, "{\"scale\":0}") == 0);
+    c.scale = -12.5;
+    check(jsmn_bind_encode(&desc, &c, buf, sizeof(buf)) > 0);
+    check(strcmp(buf, "{\"scale\":-12.5}") == 0);
+    c.scale = 0.9999999;
+    check(jsmn_bind_encode(&desc, &c, buf, sizeof(buf)) > 0);
+    check(strcmp(buf, "{\"scale\":1}") == 0);
+    c.scale = 0.00002;
+    check(jsmn_bind_encode(&desc, &c, buf, sizeof(buf)) > 0);
+    check(strcmp(buf, "{\"scale\":2e-5}") == 0);
+    done();
+}
+
+int main(void)
+{
+    test(test_bind_check, "binding table check");
+    test(test_bind_unsorted, "unsorted table refused on first use");
+    test(test_bind_decode, "decoding JSON into a struct");
+    test(test_bind_unicode, "decoding \\u escapes and surrogate pairs");
+    test(test_bind_decode_errors, "decoding errors");
+    test(test_bind_encode, "encoding a struct as JSON");
+    test(test_bind_encode_float, "encoding floating point values");
+    printf("\nPASSED: %d\nFAILED: %d\n", test_passed, test_failed);
+    return (test_failed > 0);
+}
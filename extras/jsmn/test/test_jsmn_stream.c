@@ -0,0 +1,243 @@
+/* Host test for the streaming JSON parser.
+ *
+ * Every document is fed split into two chunks at each byte offset, and one
+ * byte at a time, and the events logged by the callback are compared with
+ * the expected log each time.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "../jsmn/jsmn.c"
+#include "../jsmn_stream.c"
+
+/* Logs each event as "path{", "}", "path=value" (strings in quotes),
+   separated by spaces, with a "!" after truncated values */
+typedef struct {
+    char buf[512];
+    size_t len;
+    int stop_after; /* return 1 from the callback after this many events */
+    int events;
+} stream_log;
+
+static void log_add(stream_log *log, const char *s, size_t n)
+{
+    if (log->len + n < sizeof(log->buf)) {
+        memcpy(log->buf + log->len, s, n);
+        log->len += n;
+        log->buf[log->len] = '\0';
+    }
+}
+
+static int log_cb(jsmn_stream_parser *p, jsmn_stream_event event,
+                  jsmntype_t type, const char *value, size_t len)
+{
+    stream_log *log = p->user;
+    char path[64];
+    int n = jsmn_stream_path(p, path, sizeof(path));
+
+    if (n < 0) {
+        return -100;
+    }
+    if (log->len > 0) {
+        log_add(log, " ", 1);
+    }
+    if (event != JSMN_STREAM_END) {
+        log_add(log, path, n);
+    }
+    if (event == JSMN_STREAM_VALUE) {
+        log_add(log, "=", 1);
+        if (type == JSMN_STRING) {
+            log_add(log, "\"", 1);
+        }
+        log_add(log, value, len);
+        if (type == JSMN_STRING) {
+            log_add(log, "\"", 1);
+        }
+        if (jsmn_stream_truncated(p)) {
+            log_add(log, "!", 1);
+        }
+    } else if (event == JSMN_STREAM_START) {
+        log_add(log, type == JSMN_OBJECT ? "{" : "[", 1);
+    } else {
+        log_add(log, type == JSMN_OBJECT ? "}" : "]", 1);
+    }
+    if (++log->events == log->stop_after) {
+        return 1;
+    }
+    return 0;
+}
+
+/* Feed s split at `split`, or in chunks of `step` bytes if step > 0 */
+static int stream_run(const char *s, size_t split, size_t step, stream_log *log)
+{
+    jsmn_stream_parser p;
+    size_t n = strlen(s);
+    int r = 0;
+
+    memset(log, 0, sizeof(stream_log));
+    jsmn_stream_init(&p, log_cb, log);
+    if (step == 0) {
+        r = jsmn_stream_feed(&p, s, split);
+        if (r == 0) {
+            r = jsmn_stream_feed(&p, s + split, n - split);
+        }
+    } else {
+        for (size_t i = 0; i < n && r == 0; i += step) {
+            r = jsmn_stream_feed(&p, s + i, (n - i < step) ? n - i : step);
+        }
+    }
+    if (r == 0) {
+        r = jsmn_stream_finish(&p);
+    }
+    return r;
+}
+
+/* True if s gives `status`, and (if 0) the events in `expected`, however
+   it is split */
+static int stream_parse(const char *s, int status, const char *expected)
+{
+    stream_log log;
+    size_t n = strlen(s);
+
+    for (size_t split = 0; split <= n + 1; split++) {
+        int r = (split <= n) ? stream_run(s, split, 0, &log) : stream_run(s, 0, 1, &log);
+        if (r != status) {
+            printf("status is %d, not %d (split at %d)\n", r, status, (int)split);
+            return 0;
+        }
+        if (status == 0 && strcmp(log.buf, expected) != 0) {
+            printf("events are '%s', not '%s' (split at %d)\n", log.buf, expected, (int)split);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int test_stream(void)
+{
+    check(stream_parse("{}", 0, "{ }"));
+    check(stream_parse("[]", 0, "[ ]"));
+    check(stream_parse("{\"a\":0}", 0, "{ a=0 }"));
+    check(stream_parse(" { \"a\" : 0 , \"b\" : \"c\" } \n", 0, "{ a=0 b=\"c\" }"));
+    check(stream_parse("{\"a\": {\"b\": [1, \"x\", {\"c\": null}, []]}, \"d\": true}", 0,
+                       "{ a{ a.b[ a.b[0]=1 a.b[1]=\"x\" a.b[2]{ a.b[2].c=null } a.b[3][ ] ] } d=true }"));
+    check(stream_parse("[[1,2],[-3.5e2]]", 0, "[ [0][ [0][0]=1 [0][1]=2 ] [1][ [1][0]=-3.5e2 ] ]"));
+    check(stream_parse("\"top\"", 0, "=\"top\""));
+    check(stream_parse("12345", 0, "=12345"));
+    check(stream_parse("{\"k\\\"ey\": \"a\\u00e9\\n\\\\\"}", 0, "{ k\\\"ey=\"a\\u00e9\\n\\\\\" }"));
+    check(stream_parse("{\"\": \"\"}", 0, "{ =\"\" }"));
+    done();
+}
+
+int test_stream_errors(void)
+{
+    check(stream_parse("", JSMN_ERROR_PART, NULL));
+    check(stream_parse("[1,2", JSMN_ERROR_PART, NULL));
+    check(stream_parse("{\"a\":\"b", JSMN_ERROR_PART, NULL));
+    check(stream_parse("{\"a\":0]", JSMN_ERROR_INVAL, NULL));
+    check(stream_parse("[0}", JSMN_ERROR_INVAL, NULL));
+    check(stream_parse("{\"a\" 0}", JSMN_ERROR_INVAL, NULL));
+    check(stream_parse("{\"a\":0,}", JSMN_ERROR_INVAL, NULL));
+    check(stream_parse("{,}", JSMN_ERROR_INVAL, NULL));
+    check(stream_parse("{a:0}", JSMN_ERROR_INVAL, NULL));
+    check(stream_parse("[1 2]", JSMN_ERROR_INVAL, NULL));
+    check(stream_parse("]", JSMN_ERROR_INVAL, NULL));
+    check(stream_parse("\"\\x\"", JSMN_ERROR_INVAL, NULL));
+    check(stream_parse("\"\\u00zz\"", JSMN_ERROR_INVAL, NULL));
+    check(stream_parse("{} x", JSMN_ERROR_INVAL, NULL));
+#ifdef JSMN_STRICT
+    check(stream_parse("[1, x]", JSMN_ERROR_INVAL, NULL));
+#else
+    check(stream_parse("[1, x]", 0, "[ [0]=1 [1]=x ]"));
+#endif
+    done();
+}
+
+int test_stream_limits(void)
+{
+    jsmn_stream_parser p;
+    stream_log log;
+    char js[JSMN_STREAM_MAX_VALUE + 16];
+
+    /* Nesting is limited by JSMN_STREAM_MAX_DEPTH */
+    check(stream_parse("[[[[[[[[1]]]]]]]]", 0,
+                       "[ [0][ [0][0][ [0][0][0][ [0][0][0][0][ [0][0][0][0][0][ "
+                       "[0][0][0][0][0][0][ [0][0][0][0][0][0][0][ [0][0][0][0][0][0][0][0]=1 "
+                       "] ] ] ] ] ] ] ]"));
+    check(stream_parse("[[[[[[[[[1]]]]]]]]]", JSMN_ERROR_NOMEM, NULL));
+
+    /* Long values are truncated, parsing carries on */
+    memset(js, 'x', sizeof(js));
+    js[0] = '[';
+    js[1] = '\"';
+    js[sizeof(js) - 3] = '\"';
+    js[sizeof(js) - 2] = ']';
+    js[sizeof(js) - 1] = '\0';
+    memset(&log, 0, sizeof(log));
+    jsmn_stream_init(&p, log_cb, &log);
+    check(jsmn_stream_feed(&p, js, strlen(js)) == 0);
+    check(jsmn_stream_finish(&p) == 0);
+    check(p.truncated);
+    check(p.value_len == JSMN_STREAM_MAX_VALUE - 1);
+    check(strlen(p.value) == JSMN_STREAM_MAX_VALUE - 1);
+
+    /* pos is left at the bad character */
+    jsmn_stream_init(&p, NULL, NULL);
+    check(jsmn_stream_feed(&p, "[1,]", 4) == JSMN_ERROR_INVAL);
+    check(p.pos == 3);
+    check(jsmn_stream_feed(&p, "", 0) == 0);
+    check(jsmn_stream_finish(&p) == JSMN_ERROR_INVAL);
+
+    /* A non-zero return from the callback stops parsing */
+    memset(&log, 0, sizeof(log));
+    log.stop_after = 2;
+    jsmn_stream_init(&p, log_cb, &log);
+    check(jsmn_stream_feed(&p, "[1, 2, 3]", 9) == 1);
+    check(strcmp(log.buf, "[ [0]=1") == 0);
+    done();
+}
+
+/* Truncation is flagged for the key or value it happened to, and stays
+   flagged for everything below a truncated key */
+int test_stream_truncated(void)
+{
+    check(JSMN_STREAM_MAX_KEY == 16);
+    /* Key truncated to 15 characters, the values are short */
+    check(stream_parse("{\"abcdefghijklmnopq\": 1, \"b\": 2}", 0,
+                       "{ abcdefghijklmno=1! b=2 }"));
+    check(stream_parse("{\"abcdefghijklmnopq\": {\"c\": 1}, \"b\": {\"c\": 2}}", 0,
+                       "{ abcdefghijklmno{ abcdefghijklmno.c=1! } b{ b.c=2 } }"));
+    check(stream_parse("{\"abcdefghijklmno\": 1}", 0, "{ abcdefghijklmno=1 }"));
+
+    /* A long value followed by short ones */
+    char js[3 * JSMN_STREAM_MAX_VALUE];
+    char expected[3 * JSMN_STREAM_MAX_VALUE];
+    char *s = js, *e = expected;
+    s += sprintf(s, "{\"a\": \"");
+    e += sprintf(e, "{ a=\"");
+    for (int i = 0; i < JSMN_STREAM_MAX_VALUE; i++) {
+        *s++ = 'v';
+        if (i < JSMN_STREAM_MAX_VALUE - 1) {
+            *e++ = 'v';
+        }
+    }
+    sprintf(s, "\", \"b\": \"w\", \"c\": [3]}");
+    sprintf(e, "\"! b=\"w\" c[ c[0]=3 ] }");
+    check(stream_parse(js, 0, expected));
+    done();
+}
+
+int main(void)
+{
+    test(test_stream, "streaming parser");
+    test(test_stream_errors, "streaming parser errors");
+    test(test_stream_limits, "streaming parser depth and value limits");
+    test(test_stream_truncated, "streaming parser truncated keys and values");
+    printf("\nPASSED: %d\nFAILED: %d\n", test_passed, test_failed);
+    return (test_failed > 0);
+}
@@ -49,6 +49,31 @@ mbedtls_EXTRA_SRC_FILES = $(patsubst %.o,$(MBEDTLS_DIR)library/%.c,$(OBJS_CRYPTO
 # depending on cipher configuration, some mbedTLS variables are unused
 mbedtls_CFLAGS = -Wno-error=unused-but-set-variable -Wno-error=unused-variable $(CFLAGS) 
 
+# Set MBEDTLS_PROFILE=fast for faster RSA/ECC (larger windows, fixed-point
+# tables and lx106 bignum multiply), at the cost of a few KB more heap
+# during handshakes. See include/mbedtls/config.h
+MBEDTLS_PROFILE ?= small
+ifeq ($(MBEDTLS_PROFILE),fast)
+mbedtls_CFLAGS += -DMBEDTLS_PROFILE_FAST
+# so the program sees the same config.h values
+PROGRAM_CFLAGS += -DMBEDTLS_PROFILE_FAST
+endif
+
+# Size of each of the two TLS record I/O buffers, allocated per connection.
+# Smaller than 4096 only works with servers that accept the max_fragment_length
+# extension (see include/net_netconn.h) or never send large records.
+MBEDTLS_SSL_MAX_CONTENT_LEN ?= 4096
+mbedtls_CFLAGS += -DMBEDTLS_SSL_MAX_CONTENT_LEN=$(MBEDTLS_SSL_MAX_CONTENT_LEN)
+PROGRAM_CFLAGS += -DMBEDTLS_SSL_MAX_CONTENT_LEN=$(MBEDTLS_SSL_MAX_CONTENT_LEN)
+
+# Reuse TLS sessions in all client handshakes, by linking callers'
+# mbedtls_ssl_handshake() to the session cache. See include/ssl_client_cache.h
+MBEDTLS_SESSION_CACHE ?= 1
+ifeq ($(MBEDTLS_SESSION_CACHE),1)
+mbedtls_CFLAGS += -DSSL_CLIENT_CACHE_AUTO=1
+LDFLAGS += -Wl,--wrap=mbedtls_ssl_handshake
+endif
+
 $(eval $(call component_compile_rules,mbedtls))
 
 # Helpful error if git submodule not initialised
@@ -0,0 +1,42 @@
+/* Bignum multiply-accumulate for the ESP8266 (Xtensa lx106)
+ *
+ * Included from our mbedtls config.h for MBEDTLS_PROFILE=fast, before
+ * bignum.c includes mbedtls/bn_mul.h. bn_mul.h has no Xtensa version so
+ * would otherwise use its generic C version, which multiplies into a
+ * 64-bit mbedtls_t_udbl. lx106 has no instruction for the high word of a
+ * 32x32 multiply, so that becomes a libgcc __umulsidi3 call for every
+ * limb.
+ *
+ * This version builds each 32x32->64 bit product from four 16x16->32 bit
+ * multiplies (single MUL16U/MULL instructions) inline, with no calls.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _BN_MUL_LX106_H
+#define _BN_MUL_LX106_H
+
+#define MULADDC_INIT                                    \
+{                                                       \
+    mbedtls_mpi_uint b0 = b & 0xffff, b1 = b >> 16;     \
+    mbedtls_mpi_uint s0, s1, lo, hi, m0, m1;
+
+/* (lo, hi) = *s * b + c + *d, then c = hi and *d = lo */
+#define MULADDC_CORE                                    \
+    s0 = *s & 0xffff;                                   \
+    s1 = *(s++) >> 16;                                  \
+    lo = s0 * b0;                                       \
+    hi = s1 * b1;                                       \
+    m0 = s0 * b1;                                       \
+    m1 = s1 * b0;                                       \
+    m0 += m1; hi += (m0 < m1) << 16;                    \
+    hi += m0 >> 16; m0 <<= 16;                          \
+    lo += m0; hi += (lo < m0);                          \
+    lo += c;  hi += (lo < c);                           \
+    lo += *d; hi += (lo < *d);                          \
+    c = hi; *(d++) = lo;
+
+#define MULADDC_STOP                                    \
+}
+
+#endif /* _BN_MUL_LX106_H */
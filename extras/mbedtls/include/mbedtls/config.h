@@ -2345,8 +2345,28 @@
  * \{
  */
 
+/*
+ * Performance profile
+ *
+ * By default the options below are tuned for low RAM use, at the cost of
+ * very slow RSA and ECDHE operations. Building with MBEDTLS_PROFILE=fast
+ * (see extras/mbedtls/component.mk) selects larger windows and the
+ * fixed-point comb optimisation, which use a few KB more heap during a
+ * handshake, and the lx106 multiply-accumulate in bn_mul_lx106.h.
+ *
+ * The fixed-point table is kept in the mbedtls_ecp_group, and a TLS
+ * handshake loads its ECDHE group afresh, so each handshake still builds
+ * the table once for its single multiplication of the generator. Most of
+ * the gain is where a group is kept and reused (examples/mbedtls_benchmark
+ * reports both cases, and extras/mbedtls/README.md has host numbers.)
+ */
+
 /* MPI / BIGNUM options */
+#if defined(MBEDTLS_PROFILE_FAST)
+#define MBEDTLS_MPI_WINDOW_SIZE            3 /**< Maximum windows size used. */
+#else
 #define MBEDTLS_MPI_WINDOW_SIZE            1 /**< Maximum windows size used. */
+#endif
 #define MBEDTLS_MPI_MAX_SIZE            512 /**< Maximum number of bytes for usable MPIs. */
 
 /* CTR_DRBG options */
@@ -2365,8 +2385,13 @@
 
 /* ECP options */
 //#define MBEDTLS_ECP_MAX_BITS             521 /**< Maximum bit size of groups */
+#if defined(MBEDTLS_PROFILE_FAST)
+#define MBEDTLS_ECP_WINDOW_SIZE            4 /**< Maximum window size used */
+#define MBEDTLS_ECP_FIXED_POINT_OPTIM      1 /**< Enable fixed-point speed-up */
+#else
 #define MBEDTLS_ECP_WINDOW_SIZE            2 /**< Maximum window size used */
 #define MBEDTLS_ECP_FIXED_POINT_OPTIM      0 /**< Enable fixed-point speed-up */
+#endif
 
 /* Entropy options */
 //#define MBEDTLS_ENTROPY_MAX_SOURCES                20 /**< Maximum number of sources supported */
@@ -2400,7 +2425,12 @@
 //#define MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES      50 /**< Maximum entries in cache */
 
 /* SSL options */
+/* Set MBEDTLS_SSL_MAX_CONTENT_LEN in the makefile (see component.mk) to shrink
+   the two I/O buffers further. Servers only send records this small if they
+   support the max_fragment_length extension, see ssl_netconn_conf_max_frag_len() */
+#ifndef MBEDTLS_SSL_MAX_CONTENT_LEN
 #define MBEDTLS_SSL_MAX_CONTENT_LEN             4096 /**< Maxium fragment length in bytes, determines the size of each of the two internal I/O buffers */
+#endif
 //#define MBEDTLS_SSL_DEFAULT_TICKET_LIFETIME     86400 /**< Lifetime of session tickets (if enabled) */
 //#define MBEDTLS_PSK_MAX_LEN               32 /**< Max size of TLS pre-shared keys, in bytes (default 256 bits) */
 //#define MBEDTLS_SSL_COOKIE_TIMEOUT        60 /**< Default expiration delay of DTLS cookies, in seconds if HAVE_TIME, or in number of cookies issued */
@@ -2441,6 +2471,10 @@
 #include MBEDTLS_USER_CONFIG_FILE
 #endif
 
+#if defined(MBEDTLS_PROFILE_FAST) && defined(__XTENSA__)
+#include "bn_mul_lx106.h"
+#endif
+
 #include "mbedtls/check_config.h"
 
 #endif /* MBEDTLS_CONFIG_H */
@@ -0,0 +1,83 @@
+/* mbedTLS network I/O (BIO) directly over the lwIP netconn API
+ *
+ * An alternative to mbedtls_net_send/mbedtls_net_recv (net_lwip.c) which
+ * go through the lwIP sockets layer. Received pbufs are copied straight
+ * into the SSL input buffer and outgoing records straight into TCP
+ * segments, without the socket emulation, select() or the extra netbuf
+ * copy in between.
+ *
+ * Usage, in place of mbedtls_net_connect/mbedtls_ssl_set_bio:
+ *
+ *   ssl_netconn_context net;
+ *   ssl_netconn_init(&net);
+ *   if(ssl_netconn_connect(&net, "example.com", 443) != 0) ...
+ *   mbedtls_ssl_set_bio(&ssl, &net, ssl_netconn_send, ssl_netconn_recv,
+ *                       ssl_netconn_recv_timeout);
+ *   ...
+ *   ssl_netconn_free(&net);
+ *
+ * Each TLS connection has two record buffers of MBEDTLS_SSL_MAX_CONTENT_LEN
+ * (plus overhead.) This can be set with MBEDTLS_SSL_MAX_CONTENT_LEN in the
+ * program's Makefile, in which case call ssl_netconn_conf_max_frag_len() on
+ * the config so the server is asked to send records that fit.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _NET_NETCONN_H
+#define _NET_NETCONN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <lwip/api.h>
+#include "mbedtls/ssl.h"
+#include "mbedtls/net.h"
+
+typedef struct {
+    struct netconn *conn;
+    struct pbuf *rx;     /* received data not yet passed to mbedtls */
+    uint16_t rx_offset;  /* bytes of rx already consumed */
+} ssl_netconn_context;
+
+/* Largest max_fragment_length extension value that fits the I/O buffers */
+#if MBEDTLS_SSL_MAX_CONTENT_LEN >= 4096
+#define SSL_NETCONN_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_4096
+#elif MBEDTLS_SSL_MAX_CONTENT_LEN >= 2048
+#define SSL_NETCONN_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_2048
+#elif MBEDTLS_SSL_MAX_CONTENT_LEN >= 1024
+#define SSL_NETCONN_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_1024
+#else
+#define SSL_NETCONN_MAX_FRAG_LEN MBEDTLS_SSL_MAX_FRAG_LEN_512
+#endif
+
+void ssl_netconn_init(ssl_netconn_context *ctx);
+
+/* Resolve host and open a TCP connection to it.
+
+   Returns 0 on success or MBEDTLS_ERR_NET_UNKNOWN_HOST,
+   MBEDTLS_ERR_NET_SOCKET_FAILED or MBEDTLS_ERR_NET_CONNECT_FAILED.
+*/
+int ssl_netconn_connect(ssl_netconn_context *ctx, const char *host, uint16_t port);
+
+/* Use an already connected TCP netconn. ssl_netconn_free() deletes it. */
+void ssl_netconn_set_conn(ssl_netconn_context *ctx, struct netconn *conn);
+
+/* Close the connection and free any buffered data */
+void ssl_netconn_free(ssl_netconn_context *ctx);
+
+/* mbedtls_ssl_send_t/mbedtls_ssl_recv_t/mbedtls_ssl_recv_timeout_t
+   callbacks for mbedtls_ssl_set_bio(), ctx is the ssl_netconn_context.
+
+   ssl_netconn_recv() blocks until data arrives. ssl_netconn_recv_timeout()
+   waits at most timeout ms (0 = forever), as set with
+   mbedtls_ssl_conf_read_timeout(). */
+int ssl_netconn_send(void *ctx, const unsigned char *buf, size_t len);
+int ssl_netconn_recv(void *ctx, unsigned char *buf, size_t len);
+int ssl_netconn_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout);
+
+/* Limit the record size to fit MBEDTLS_SSL_MAX_CONTENT_LEN, by requesting
+   the RFC 6066 max_fragment_length extension from the server. Call on a
+   client config before mbedtls_ssl_setup(). */
+int ssl_netconn_conf_max_frag_len(mbedtls_ssl_config *conf);
+
+#endif
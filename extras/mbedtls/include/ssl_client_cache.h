@@ -0,0 +1,96 @@
+/* TLS client session cache for mbedTLS
+ *
+ * Remembers the session (session ID and/or RFC 5077 session ticket) from
+ * the last successful handshake with each server, so the next connection
+ * to the same server can use an abbreviated handshake. This skips the
+ * certificate verification and key exchange, which take seconds on the
+ * ESP8266.
+ *
+ * Sessions are keyed by the hostname set with mbedtls_ssl_set_hostname().
+ * The peer certificate is not kept, so mbedtls_ssl_get_peer_cert() returns
+ * NULL for a resumed session (mbedtls_ssl_get_verify_result() still
+ * returns the result of the original verification.)
+ *
+ * By default (MBEDTLS_SESSION_CACHE=1 in the mbedtls component) the program
+ * is linked with --wrap=mbedtls_ssl_handshake, so every client handshake
+ * goes through ssl_client_cache_handshake() and reuses sessions without
+ * any change to the caller. Build with MBEDTLS_SESSION_CACHE=0 to turn
+ * this off and call ssl_client_cache_handshake() (or load/save) directly
+ * where wanted. (Handshakes started implicitly by mbedtls_ssl_read() or
+ * mbedtls_ssl_write() bypass the cache, call mbedtls_ssl_handshake() first.)
+ *
+ * Optionally sessions are also saved in sysparam, so they survive deep
+ * sleep and reboots. Each new session is a sysparam write, so this is best
+ * used with servers that keep sessions/tickets valid for a long time.
+ *
+ * Persisted sessions contain the session's master secret, in plaintext in
+ * the sysparam flash area. Anyone who can read the flash can then decrypt
+ * recorded traffic of those sessions, and resume them as this device,
+ * until the server expires them. Removing a session only marks it deleted,
+ * the old value stays in flash until sysparam compacts its region. So
+ * persistence is off unless ssl_client_cache_set_persist(true) is called,
+ * only enable it where physical access to the device is not a concern.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _SSL_CLIENT_CACHE_H
+#define _SSL_CLIENT_CACHE_H
+
+#include <stdbool.h>
+
+/* Before ssl.h, which would otherwise pick up mbedtls' default config.h
+   rather than ours, and disagree with the library about structure layouts */
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+#include "mbedtls/ssl.h"
+
+/* Number of servers to remember sessions for */
+#ifndef SSL_CLIENT_CACHE_ENTRIES
+#define SSL_CLIENT_CACHE_ENTRIES 2
+#endif
+
+/* Prefix of the sysparam keys sessions are persisted under, followed by
+   the hostname */
+#define SSL_CLIENT_CACHE_SYSPARAM_PREFIX "tls_session:"
+
+/* mbedtls_ssl_handshake(), resuming the cached session for this server if
+   there is one.
+
+   Returns the same as mbedtls_ssl_handshake(), so can be called again on
+   MBEDTLS_ERR_SSL_WANT_READ/WANT_WRITE with non-blocking sockets. A cached
+   session is only offered at the start of the initial handshake, and not
+   if the caller has set a session with mbedtls_ssl_set_session().
+
+   On success the session is saved for next time. If a handshake resuming
+   a cached session fails, the session is forgotten.
+
+   With MBEDTLS_SESSION_CACHE=1 this is what mbedtls_ssl_handshake() calls.
+*/
+int ssl_client_cache_handshake(mbedtls_ssl_context *ssl);
+
+/* Set the cached session (if any) for the server set with
+   mbedtls_ssl_set_hostname() on this context. Call after mbedtls_ssl_setup()
+   or mbedtls_ssl_session_reset(), before the handshake.
+
+   Returns 0 if a session was set, 1 if there is no session cached for
+   this server, or a negative mbedtls error code.
+*/
+int ssl_client_cache_load(mbedtls_ssl_context *ssl);
+
+/* Save the session after a successful handshake. */
+int ssl_client_cache_save(const mbedtls_ssl_context *ssl);
+
+/* Forget the cached session for hostname, also from sysparam */
+void ssl_client_cache_remove(const char *hostname);
+
+/* Enable or disable keeping sessions in sysparam as well as RAM.
+   Disabled by default, as this stores the master secrets in flash (see
+   above.) sysparam must be initialised.
+*/
+void ssl_client_cache_set_persist(bool persist);
+
+#endif
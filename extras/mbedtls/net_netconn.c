@@ -0,0 +1,146 @@
+/* mbedTLS network I/O directly over the lwIP netconn API
+ *
+ * For details of use see net_netconn.h
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <lwip/api.h>
+#include <lwip/pbuf.h>
+
+#include "net_netconn.h"
+
+void ssl_netconn_init(ssl_netconn_context *ctx)
+{
+    memset(ctx, 0, sizeof(ssl_netconn_context));
+}
+
+int ssl_netconn_connect(ssl_netconn_context *ctx, const char *host, uint16_t port)
+{
+    ip_addr_t addr;
+
+    if(netconn_gethostbyname(host, &addr) != ERR_OK)
+        return MBEDTLS_ERR_NET_UNKNOWN_HOST;
+
+    struct netconn *conn = netconn_new(NETCONN_TCP);
+    if(!conn)
+        return MBEDTLS_ERR_NET_SOCKET_FAILED;
+
+    if(netconn_connect(conn, &addr, port) != ERR_OK) {
+        netconn_delete(conn);
+        return MBEDTLS_ERR_NET_CONNECT_FAILED;
+    }
+
+    ssl_netconn_set_conn(ctx, conn);
+    return 0;
+}
+
+void ssl_netconn_set_conn(ssl_netconn_context *ctx, struct netconn *conn)
+{
+    ssl_netconn_free(ctx);
+    ctx->conn = conn;
+}
+
+void ssl_netconn_free(ssl_netconn_context *ctx)
+{
+    if(ctx->rx) {
+        pbuf_free(ctx->rx);
+        ctx->rx = NULL;
+    }
+    ctx->rx_offset = 0;
+    if(ctx->conn) {
+        netconn_close(ctx->conn);
+        netconn_delete(ctx->conn);
+        ctx->conn = NULL;
+    }
+}
+
+int ssl_netconn_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    struct netconn *conn = ((ssl_netconn_context *)ctx)->conn;
+    size_t written = 0;
+
+    if(!conn)
+        return MBEDTLS_ERR_NET_INVALID_CONTEXT;
+
+    /* The SSL output buffer is reused as soon as we return, so the data
+       has to be copied into the TCP segments (NETCONN_COPY) */
+    err_t err = netconn_write_partly(conn, buf, len, NETCONN_COPY, &written);
+    if(err == ERR_OK)
+        return written;
+    if(written > 0)
+        return written;
+
+    switch(err) {
+    case ERR_WOULDBLOCK:
+    case ERR_TIMEOUT:
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    case ERR_ABRT:
+    case ERR_RST:
+    case ERR_CLSD:
+    case ERR_CONN:
+        return MBEDTLS_ERR_NET_CONN_RESET;
+    default:
+        return MBEDTLS_ERR_NET_SEND_FAILED;
+    }
+}
+
+/* Copy out of the pbuf chain received last, fetching the next one when it
+   has all been consumed. timeout is passed to lwIP (0 = wait forever.) */
+static int bio_read(ssl_netconn_context *ctx, unsigned char *buf, size_t len,
+                    uint32_t timeout, int timeout_ret)
+{
+    if(!ctx->conn)
+        return MBEDTLS_ERR_NET_INVALID_CONTEXT;
+
+    if(!ctx->rx) {
+        netconn_set_recvtimeout(ctx->conn, timeout);
+        err_t err = netconn_recv_tcp_pbuf(ctx->conn, &ctx->rx);
+        if(err != ERR_OK) {
+            ctx->rx = NULL;
+            switch(err) {
+            case ERR_TIMEOUT:
+            case ERR_WOULDBLOCK:
+                return timeout_ret;
+            case ERR_CLSD:
+                return 0; /* EOF */
+            case ERR_ABRT:
+            case ERR_RST:
+            case ERR_CONN:
+                return MBEDTLS_ERR_NET_CONN_RESET;
+            default:
+                return MBEDTLS_ERR_NET_RECV_FAILED;
+            }
+        }
+        ctx->rx_offset = 0;
+    }
+
+    uint16_t n = pbuf_copy_partial(ctx->rx, buf, len > 0xffff ? 0xffff : len, ctx->rx_offset);
+    ctx->rx_offset += n;
+    if(ctx->rx_offset >= ctx->rx->tot_len) {
+        pbuf_free(ctx->rx);
+        ctx->rx = NULL;
+        ctx->rx_offset = 0;
+    }
+    return n;
+}
+
+int ssl_netconn_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    return bio_read(ctx, buf, len, 0, MBEDTLS_ERR_SSL_WANT_READ);
+}
+
+int ssl_netconn_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout)
+{
+    return bio_read(ctx, buf, len, timeout, MBEDTLS_ERR_SSL_TIMEOUT);
+}
+
+int ssl_netconn_conf_max_frag_len(mbedtls_ssl_config *conf)
+{
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
+    return mbedtls_ssl_conf_max_frag_len(conf, SSL_NETCONN_MAX_FRAG_LEN);
+#else
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+#endif
+}
@@ -0,0 +1,365 @@
+/* TLS client session cache for mbedTLS
+ *
+ * For details of use see ssl_client_cache.h
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include <stdlib.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+#include <sysparam.h>
+
+#include "ssl_client_cache.h"
+#include "mbedtls/platform.h"
+#include "mbedtls/ssl_internal.h"
+
+typedef struct {
+    char *hostname;              /* NULL if entry is unused */
+    uint32_t last_used;
+    mbedtls_ssl_session session; /* without peer_cert */
+} cache_entry_t;
+
+static cache_entry_t cache[SSL_CLIENT_CACHE_ENTRIES];
+static uint32_t use_count;
+static bool persist;
+static xSemaphoreHandle cache_mutex;
+
+/* Header of a session saved in sysparam. The session structure is saved
+   as is, so sessions from a build with a different mbedtls config (size)
+   are ignored. Followed by the session structure then the ticket, 8 bytes
+   so the session is aligned. */
+typedef struct {
+    uint8_t version;
+    uint8_t reserved;
+    uint16_t session_len;
+    uint16_t ticket_len;
+    uint16_t reserved2;
+} persist_header_t;
+
+#define PERSIST_VERSION 1
+
+static void cache_lock(void)
+{
+    if(!cache_mutex) {
+        xSemaphoreHandle mutex = xSemaphoreCreateMutex();
+        taskENTER_CRITICAL();
+        if(!cache_mutex) {
+            cache_mutex = mutex;
+            mutex = NULL;
+        }
+        taskEXIT_CRITICAL();
+        if(mutex)
+            vSemaphoreDelete(mutex);
+    }
+    xSemaphoreTake(cache_mutex, portMAX_DELAY);
+}
+
+static void cache_unlock(void)
+{
+    xSemaphoreGive(cache_mutex);
+}
+
+/* Copy a session, leaving out the peer certificate. Frees any
+   previous contents of dst. */
+static int session_copy(mbedtls_ssl_session *dst, const mbedtls_ssl_session *src)
+{
+    mbedtls_ssl_session_free(dst);
+    memcpy(dst, src, sizeof(mbedtls_ssl_session));
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+    dst->peer_cert = NULL;
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    if(src->ticket != NULL) {
+        dst->ticket = mbedtls_calloc(1, src->ticket_len);
+        if(dst->ticket == NULL) {
+            mbedtls_ssl_session_init(dst);
+            return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        }
+        memcpy(dst->ticket, src->ticket, src->ticket_len);
+    }
+#endif
+    return 0;
+}
+
+/* Is b the same session as a? (ie a resumed session that
+   doesn't need saving again) */
+static bool session_equal(const mbedtls_ssl_session *a, const mbedtls_ssl_session *b)
+{
+    if(a->id_len != b->id_len || memcmp(a->id, b->id, a->id_len)
+       || memcmp(a->master, b->master, sizeof(a->master)))
+        return false;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    if(a->ticket_len != b->ticket_len
+       || (a->ticket_len && memcmp(a->ticket, b->ticket, a->ticket_len)))
+        return false;
+#endif
+    return true;
+}
+
+static void entry_free(cache_entry_t *entry)
+{
+    free(entry->hostname);
+    entry->hostname = NULL;
+    mbedtls_ssl_session_free(&entry->session);
+}
+
+static cache_entry_t *entry_find(const char *hostname)
+{
+    for(int i = 0; i < SSL_CLIENT_CACHE_ENTRIES; i++) {
+        if(cache[i].hostname && !strcmp(cache[i].hostname, hostname))
+            return &cache[i];
+    }
+    return NULL;
+}
+
+/* Find the entry for hostname, or a free/least recently used one
+   to replace */
+static cache_entry_t *entry_alloc(const char *hostname)
+{
+    cache_entry_t *entry = entry_find(hostname);
+    if(entry)
+        return entry;
+
+    entry = &cache[0];
+    for(int i = 0; i < SSL_CLIENT_CACHE_ENTRIES; i++) {
+        if(!cache[i].hostname) {
+            entry = &cache[i];
+            break;
+        }
+        if(cache[i].last_used < entry->last_used)
+            entry = &cache[i];
+    }
+    entry_free(entry);
+    entry->hostname = strdup(hostname);
+    if(!entry->hostname)
+        return NULL;
+    mbedtls_ssl_session_init(&entry->session);
+    return entry;
+}
+
+static char *persist_key(const char *hostname)
+{
+    char *key = malloc(sizeof(SSL_CLIENT_CACHE_SYSPARAM_PREFIX) + strlen(hostname));
+    if(key) {
+        strcpy(key, SSL_CLIENT_CACHE_SYSPARAM_PREFIX);
+        strcat(key, hostname);
+    }
+    return key;
+}
+
+static void persist_save(const char *hostname, const mbedtls_ssl_session *session)
+{
+    char *key = persist_key(hostname);
+    if(!key)
+        return;
+
+    size_t ticket_len = 0;
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    ticket_len = session->ticket_len;
+#endif
+    size_t len = sizeof(persist_header_t) + sizeof(mbedtls_ssl_session) + ticket_len;
+    uint8_t *buf = malloc(len);
+    if(buf) {
+        persist_header_t *header = (persist_header_t *)buf;
+        memset(header, 0, sizeof(persist_header_t));
+        header->version = PERSIST_VERSION;
+        header->session_len = sizeof(mbedtls_ssl_session);
+        header->ticket_len = ticket_len;
+        mbedtls_ssl_session *saved = (mbedtls_ssl_session *)(buf + sizeof(persist_header_t));
+        memcpy(saved, session, sizeof(mbedtls_ssl_session));
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+        saved->peer_cert = NULL;
+#endif
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+        saved->ticket = NULL;
+        if(ticket_len)
+            memcpy(buf + sizeof(persist_header_t) + sizeof(mbedtls_ssl_session), session->ticket, ticket_len);
+#endif
+        sysparam_set_data(key, buf, len, true);
+        memset(buf, 0, len); /* contains the master secret */
+        free(buf);
+    }
+    free(key);
+}
+
+/* Load a session from sysparam into a new cache entry */
+static cache_entry_t *persist_load(const char *hostname)
+{
+    char *key = persist_key(hostname);
+    if(!key)
+        return NULL;
+
+    uint8_t *buf = NULL;
+    size_t len;
+    bool is_binary;
+    cache_entry_t *entry = NULL;
+    if(sysparam_get_data(key, &buf, &len, &is_binary) != SYSPARAM_OK) {
+        free(key);
+        return NULL;
+    }
+    free(key);
+
+    persist_header_t header;
+    if(len < sizeof(header))
+        goto done;
+    memcpy(&header, buf, sizeof(header));
+    if(header.version != PERSIST_VERSION || header.session_len != sizeof(mbedtls_ssl_session)
+       || len != sizeof(header) + header.session_len + header.ticket_len)
+        goto done;
+
+    mbedtls_ssl_session session;
+    memcpy(&session, buf + sizeof(header), sizeof(session));
+#if defined(MBEDTLS_SSL_SESSION_TICKETS)
+    session.ticket = header.ticket_len ? buf + sizeof(header) + sizeof(session) : NULL;
+    session.ticket_len = header.ticket_len;
+#endif
+
+    entry = entry_alloc(hostname);
+    if(entry && session_copy(&entry->session, &session) != 0) {
+        entry_free(entry);
+        entry = NULL;
+    }
+    memset(&session, 0, sizeof(session));
+
+ done:
+    memset(buf, 0, len);
+    free(buf);
+    return entry;
+}
+
+static const char *ssl_hostname(const mbedtls_ssl_context *ssl)
+{
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+    return ssl->hostname;
+#else
+    return NULL;
+#endif
+}
+
+int ssl_client_cache_load(mbedtls_ssl_context *ssl)
+{
+    const char *hostname = ssl_hostname(ssl);
+    if(!hostname)
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+
+    int ret = 1;
+    cache_lock();
+    cache_entry_t *entry = entry_find(hostname);
+    if(!entry && persist)
+        entry = persist_load(hostname);
+    if(entry) {
+        entry->last_used = ++use_count;
+        ret = mbedtls_ssl_set_session(ssl, &entry->session);
+    }
+    cache_unlock();
+    return ret;
+}
+
+int ssl_client_cache_save(const mbedtls_ssl_context *ssl)
+{
+    const char *hostname = ssl_hostname(ssl);
+    if(!hostname || !ssl->session)
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+
+    int ret = 0;
+    cache_lock();
+    cache_entry_t *entry = entry_find(hostname);
+    if(entry && session_equal(&entry->session, ssl->session)) {
+        /* Resumed, nothing has changed */
+        entry->last_used = ++use_count;
+    }
+    else {
+        entry = entry_alloc(hostname);
+        if(!entry) {
+            ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        }
+        else if((ret = session_copy(&entry->session, ssl->session)) != 0) {
+            entry_free(entry);
+        }
+        else {
+            entry->last_used = ++use_count;
+            if(persist)
+                persist_save(hostname, &entry->session);
+        }
+    }
+    cache_unlock();
+    return ret;
+}
+
+void ssl_client_cache_remove(const char *hostname)
+{
+    if(!hostname)
+        return;
+    cache_lock();
+    cache_entry_t *entry = entry_find(hostname);
+    if(entry)
+        entry_free(entry);
+    if(persist) {
+        char *key = persist_key(hostname);
+        if(key) {
+            sysparam_set_data(key, NULL, 0, true);
+            free(key);
+        }
+    }
+    cache_unlock();
+}
+
+void ssl_client_cache_set_persist(bool enable)
+{
+    persist = enable;
+}
+
+#if SSL_CLIENT_CACHE_AUTO
+/* Linked with --wrap=mbedtls_ssl_handshake (see component.mk), so callers'
+   mbedtls_ssl_handshake() comes here and the real one is __real_... */
+int __real_mbedtls_ssl_handshake(mbedtls_ssl_context *ssl);
+#define ssl_handshake __real_mbedtls_ssl_handshake
+
+int __wrap_mbedtls_ssl_handshake(mbedtls_ssl_context *ssl)
+{
+    return ssl_client_cache_handshake(ssl);
+}
+#else
+#define ssl_handshake mbedtls_ssl_handshake
+#endif
+
+/* Is this the start of a client's initial handshake, without a session
+   already set by the caller? */
+static bool handshake_starting(const mbedtls_ssl_context *ssl)
+{
+    if(ssl->conf->endpoint != MBEDTLS_SSL_IS_CLIENT
+       || ssl->state != MBEDTLS_SSL_HELLO_REQUEST
+       || !ssl->handshake || ssl->handshake->resume)
+        return false;
+#if defined(MBEDTLS_SSL_RENEGOTIATION)
+    if(ssl->renego_status != MBEDTLS_SSL_INITIAL_HANDSHAKE)
+        return false;
+#endif
+    return true;
+}
+
+int ssl_client_cache_handshake(mbedtls_ssl_context *ssl)
+{
+    if(ssl == NULL || ssl->conf == NULL)
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+
+    if(handshake_starting(ssl))
+        ssl_client_cache_load(ssl);
+    bool resuming = ssl->handshake && ssl->handshake->resume;
+
+    int ret = ssl_handshake(ssl);
+
+    if(ssl->conf->endpoint != MBEDTLS_SSL_IS_CLIENT)
+        return ret;
+    if(ret == 0) {
+        ssl_client_cache_save(ssl);
+    }
+    else if(resuming && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        /* The server may have choked on the session, don't offer it again */
+        ssl_client_cache_remove(ssl_hostname(ssl));
+    }
+    return ret;
+}
@@ -0,0 +1,8 @@
+/* Host benchmark additions to include/mbedtls/config.h (included from it
+ * as MBEDTLS_USER_CONFIG_FILE): 32-bit bignum limbs in C, as on the
+ * ESP8266, instead of the x86-64 assembly for 64-bit limbs.
+ */
+#undef MBEDTLS_HAVE_ASM
+#undef MBEDTLS_AESNI_C
+#undef MBEDTLS_PADLOCK_C
+#define MBEDTLS_HAVE_INT32
@@ -0,0 +1,355 @@
+/* Host benchmark of the public key operations in a TLS handshake.
+ *
+ * Built once for each performance profile in include/mbedtls/config.h
+ * (see the Makefile), with 32-bit bignum limbs as on the ESP8266. Times
+ * ECDHE on P-256 and Curve25519, both on a newly loaded group as in a
+ * handshake and on one whose fixed-point table is already built, RSA-2048
+ * public and private key operations, and complete ECDHE-RSA handshakes on
+ * P-256 between an mbedtls client and server in memory (this mbedtls has
+ * no TLS curve id for Curve25519). Prints the time and TSC cycles per
+ * operation, the best of several samples.
+ *
+ * The host has a 32x32->64 multiply instruction, the lx106 doesn't, so
+ * absolute numbers say little about the device (examples/mbedtls_benchmark
+ * measures there). The ratios between the profiles are what carries over,
+ * apart from the lx106 multiply-accumulate, which only the device build
+ * uses.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <x86intrin.h>
+
+#include "mbedtls/config.h"
+#include "mbedtls/certs.h"
+#include "mbedtls/ecdh.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/rsa.h"
+#include "mbedtls/ssl.h"
+
+#define SAMPLES 5
+
+#if defined(MBEDTLS_PROFILE_FAST)
+#define PROFILE "fast"
+#else
+#define PROFILE "small"
+#endif
+
+static uint32_t rand_state = 1;
+
+static int bench_rng(void *ctx, unsigned char *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        rand_state = rand_state * 1103515245 + 12345;
+        buf[i] = rand_state >> 16;
+    }
+    return 0;
+}
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* Time spent in one kind of operation, the best sample is reported */
+typedef struct {
+    double start, elapsed, best;
+    uint64_t start_cycles, cycles, best_cycles;
+    int count, samples;
+} timing_t;
+
+static void timing_start(timing_t *t)
+{
+    t->start = now();
+    t->start_cycles = __rdtsc();
+}
+
+static void timing_stop(timing_t *t)
+{
+    t->cycles += __rdtsc() - t->start_cycles;
+    t->elapsed += now() - t->start;
+}
+
+/* End of a sample of t->count operations */
+static void timing_sample(timing_t *t)
+{
+    if (!t->samples++ || t->elapsed < t->best) {
+        t->best = t->elapsed;
+        t->best_cycles = t->cycles;
+    }
+    t->elapsed = 0;
+    t->cycles = 0;
+}
+
+static void report(const char *name, const timing_t *t)
+{
+    printf("%-36s %9.0f us %12.0f cycles\n", name, t->best * 1e6 / t->count,
+           (double)t->best_cycles / t->count);
+}
+
+/* One side of an ECDHE key exchange: generate a key pair and compute the
+   shared secret with the peer's public key. */
+static int ecdh_exchange(mbedtls_ecp_group *grp, const mbedtls_ecp_point *peer_Q, timing_t *t)
+{
+    mbedtls_mpi d, z;
+    mbedtls_ecp_point Q;
+    int ret;
+
+    mbedtls_mpi_init(&d);
+    mbedtls_mpi_init(&z);
+    mbedtls_ecp_point_init(&Q);
+    timing_start(t);
+    ret = mbedtls_ecdh_gen_public(grp, &d, &Q, bench_rng, NULL);
+    if (!ret) {
+        ret = mbedtls_ecdh_compute_shared(grp, &z, peer_Q, &d, bench_rng, NULL);
+    }
+    timing_stop(t);
+    mbedtls_mpi_free(&d);
+    mbedtls_mpi_free(&z);
+    mbedtls_ecp_point_free(&Q);
+    return ret;
+}
+
+/* "new group" loads the group for each exchange as a handshake does, so
+   with MBEDTLS_ECP_FIXED_POINT_OPTIM it includes building the comb table.
+   "table built" reuses the group. */
+static int bench_ecdh(const char *name, mbedtls_ecp_group_id id, int rounds)
+{
+    mbedtls_ecp_group grp, peer_grp;
+    mbedtls_ecp_point peer_Q;
+    mbedtls_mpi peer_d;
+    timing_t fresh = { .count = rounds }, reused = { .count = rounds };
+    char label[48];
+    int ret;
+
+    mbedtls_ecp_group_init(&peer_grp);
+    mbedtls_ecp_point_init(&peer_Q);
+    mbedtls_mpi_init(&peer_d);
+    ret = mbedtls_ecp_group_load(&peer_grp, id);
+    if (!ret) {
+        ret = mbedtls_ecdh_gen_public(&peer_grp, &peer_d, &peer_Q, bench_rng, NULL);
+    }
+    for (int n = 0; n < SAMPLES && !ret; n++) {
+        for (int i = 0; i < rounds && !ret; i++) {
+            mbedtls_ecp_group_init(&grp);
+            ret = mbedtls_ecp_group_load(&grp, id);
+            if (!ret) {
+                ret = ecdh_exchange(&grp, &peer_Q, &fresh);
+            }
+            if (!ret) {
+                ret = ecdh_exchange(&grp, &peer_Q, &reused);
+            }
+            mbedtls_ecp_group_free(&grp);
+        }
+        timing_sample(&fresh);
+        timing_sample(&reused);
+    }
+    mbedtls_ecp_group_free(&peer_grp);
+    mbedtls_ecp_point_free(&peer_Q);
+    mbedtls_mpi_free(&peer_d);
+    if (ret) {
+        printf("%s failed: -0x%x\n", name, -ret);
+        return ret;
+    }
+    snprintf(label, sizeof(label), "%s, new group", name);
+    report(label, &fresh);
+    snprintf(label, sizeof(label), "%s, table built", name);
+    report(label, &reused);
+    return 0;
+}
+
+static int bench_rsa(int rounds)
+{
+    mbedtls_pk_context pk;
+    unsigned char in[512], out[512];
+    timing_t pub = { .count = rounds }, priv = { .count = rounds };
+    char name[32];
+    int ret;
+
+    mbedtls_pk_init(&pk);
+    ret = mbedtls_pk_parse_key(&pk, (const unsigned char *)mbedtls_test_srv_key,
+                               mbedtls_test_srv_key_len, NULL, 0);
+    if (ret || mbedtls_pk_get_type(&pk) != MBEDTLS_PK_RSA) {
+        printf("RSA key parse failed: -0x%x\n", -ret);
+        mbedtls_pk_free(&pk);
+        return 1;
+    }
+    mbedtls_rsa_context *rsa = mbedtls_pk_rsa(pk);
+
+    memset(in, 0x5a, sizeof(in));
+    in[0] = 0;
+    for (int n = 0; n < SAMPLES && !ret; n++) {
+        for (int i = 0; i < rounds && !ret; i++) {
+            timing_start(&pub);
+            ret = mbedtls_rsa_public(rsa, in, out);
+            timing_stop(&pub);
+            if (!ret) {
+                timing_start(&priv);
+                ret = mbedtls_rsa_private(rsa, bench_rng, NULL, in, out);
+                timing_stop(&priv);
+            }
+        }
+        timing_sample(&pub);
+        timing_sample(&priv);
+    }
+    if (ret) {
+        printf("RSA failed: -0x%x\n", -ret);
+    } else {
+        snprintf(name, sizeof(name), "RSA-%u public", (unsigned)mbedtls_pk_get_bitlen(&pk));
+        report(name, &pub);
+        snprintf(name, sizeof(name), "RSA-%u private", (unsigned)mbedtls_pk_get_bitlen(&pk));
+        report(name, &priv);
+    }
+    mbedtls_pk_free(&pk);
+    return ret;
+}
+
+/* One direction of a connection */
+typedef struct {
+    uint8_t data[16384];
+    size_t len;
+} pipe_t;
+
+typedef struct {
+    pipe_t *in, *out;
+} bio_t;
+
+static int bio_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    pipe_t *p = ((bio_t *)ctx)->out;
+    if (len > sizeof(p->data) - p->len) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    memcpy(p->data + p->len, buf, len);
+    p->len += len;
+    return len;
+}
+
+static int bio_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    pipe_t *p = ((bio_t *)ctx)->in;
+    if (!p->len) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    if (len > p->len) {
+        len = p->len;
+    }
+    memcpy(buf, p->data, len);
+    memmove(p->data, p->data + len, p->len - len);
+    p->len -= len;
+    return len;
+}
+
+/* Full ECDHE-RSA handshakes (no session resumption), with the client and
+   server steps timed separately. The client, as the device would be,
+   verifies the server certificate and does the ECDHE exchange on a new
+   group, the server also signs with RSA-2048. */
+static int bench_handshake(const char *name, mbedtls_ecp_group_id curve, int rounds)
+{
+    static const int suites[] = { MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256, 0 };
+    const mbedtls_ecp_group_id curves[] = { curve, MBEDTLS_ECP_DP_NONE };
+    static pipe_t to_server, to_client;
+    bio_t client_bio = { &to_client, &to_server };
+    bio_t server_bio = { &to_server, &to_client };
+    mbedtls_ssl_config server_conf, client_conf;
+    mbedtls_x509_crt server_crt, ca_crt;
+    mbedtls_pk_context server_key;
+    timing_t client_t = { .count = rounds }, server_t = { .count = rounds };
+    char label[48];
+    int ret = 0;
+
+    mbedtls_x509_crt_init(&server_crt);
+    mbedtls_x509_crt_init(&ca_crt);
+    mbedtls_pk_init(&server_key);
+    mbedtls_x509_crt_parse(&server_crt, (const unsigned char *)mbedtls_test_srv_crt, mbedtls_test_srv_crt_len);
+    mbedtls_x509_crt_parse(&ca_crt, (const unsigned char *)mbedtls_test_cas_pem, mbedtls_test_cas_pem_len);
+    mbedtls_pk_parse_key(&server_key, (const unsigned char *)mbedtls_test_srv_key, mbedtls_test_srv_key_len, NULL, 0);
+
+    mbedtls_ssl_config_init(&server_conf);
+    mbedtls_ssl_config_defaults(&server_conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    mbedtls_ssl_conf_rng(&server_conf, bench_rng, NULL);
+    mbedtls_ssl_conf_own_cert(&server_conf, &server_crt, &server_key);
+    mbedtls_ssl_conf_ciphersuites(&server_conf, suites);
+    mbedtls_ssl_conf_curves(&server_conf, curves);
+
+    mbedtls_ssl_config_init(&client_conf);
+    mbedtls_ssl_config_defaults(&client_conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    mbedtls_ssl_conf_rng(&client_conf, bench_rng, NULL);
+    mbedtls_ssl_conf_authmode(&client_conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_ca_chain(&client_conf, &ca_crt, NULL);
+    mbedtls_ssl_conf_ciphersuites(&client_conf, suites);
+    mbedtls_ssl_conf_curves(&client_conf, curves);
+
+    for (int n = 0; n < SAMPLES && !ret; n++) {
+        for (int i = 0; i < rounds && !ret; i++) {
+            mbedtls_ssl_context client, server;
+            int client_ret = 1, server_ret = 1;
+
+            to_server.len = 0;
+            to_client.len = 0;
+            mbedtls_ssl_init(&client);
+            mbedtls_ssl_init(&server);
+            mbedtls_ssl_setup(&client, &client_conf);
+            mbedtls_ssl_setup(&server, &server_conf);
+            mbedtls_ssl_set_hostname(&client, "localhost");
+            mbedtls_ssl_set_bio(&client, &client_bio, bio_send, bio_recv, NULL);
+            mbedtls_ssl_set_bio(&server, &server_bio, bio_send, bio_recv, NULL);
+
+            for (int step = 0; step < 100 && (client_ret || server_ret); step++) {
+                if (client_ret) {
+                    timing_start(&client_t);
+                    client_ret = mbedtls_ssl_handshake(&client);
+                    timing_stop(&client_t);
+                }
+                if (server_ret) {
+                    timing_start(&server_t);
+                    server_ret = mbedtls_ssl_handshake(&server);
+                    timing_stop(&server_t);
+                }
+                if ((client_ret < 0 && client_ret != MBEDTLS_ERR_SSL_WANT_READ)
+                    || (server_ret < 0 && server_ret != MBEDTLS_ERR_SSL_WANT_READ)) {
+                    break;
+                }
+            }
+            ret = client_ret ? client_ret : server_ret;
+            mbedtls_ssl_free(&client);
+            mbedtls_ssl_free(&server);
+        }
+        timing_sample(&client_t);
+        timing_sample(&server_t);
+    }
+
+    mbedtls_ssl_config_free(&client_conf);
+    mbedtls_ssl_config_free(&server_conf);
+    mbedtls_x509_crt_free(&server_crt);
+    mbedtls_x509_crt_free(&ca_crt);
+    mbedtls_pk_free(&server_key);
+    if (ret) {
+        printf("%s handshake failed: -0x%x\n", name, -ret);
+        return ret;
+    }
+    snprintf(label, sizeof(label), "%s handshake, client", name);
+    report(label, &client_t);
+    snprintf(label, sizeof(label), "%s handshake, server", name);
+    report(label, &server_t);
+    return 0;
+}
+
+int main(void)
+{
+    int ret = 0;
+
+    printf("profile %s: MPI window %d, ECP window %d, fixed point %d\n", PROFILE,
+           MBEDTLS_MPI_WINDOW_SIZE, MBEDTLS_ECP_WINDOW_SIZE, MBEDTLS_ECP_FIXED_POINT_OPTIM);
+    ret |= bench_ecdh("ECDHE P-256", MBEDTLS_ECP_DP_SECP256R1, 20);
+    ret |= bench_ecdh("ECDHE Curve25519", MBEDTLS_ECP_DP_CURVE25519, 20);
+    ret |= bench_rsa(10);
+    ret |= bench_handshake("ECDHE-RSA P-256", MBEDTLS_ECP_DP_SECP256R1, 10);
+    return ret != 0;
+}
@@ -0,0 +1,17 @@
+/* Host test stand-in for the FreeRTOS headers used by ssl_client_cache */
+#ifndef _STUB_FREERTOS_H
+#define _STUB_FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t portTickType;
+typedef long portBASE_TYPE;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY ((portTickType)0xffffffff)
+
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+#endif
@@ -0,0 +1,35 @@
+/* Host test stand-in, see FreeRTOS.h. The tests are single threaded, the
+   mutex only checks it is taken and given in pairs. */
+#ifndef _STUB_SEMPHR_H
+#define _STUB_SEMPHR_H
+
+#include <assert.h>
+#include <stdlib.h>
+
+typedef int *xSemaphoreHandle;
+
+static inline xSemaphoreHandle xSemaphoreCreateMutex(void)
+{
+    return calloc(1, sizeof(int));
+}
+
+static inline void vSemaphoreDelete(xSemaphoreHandle s)
+{
+    free(s);
+}
+
+static inline portBASE_TYPE xSemaphoreTake(xSemaphoreHandle s, portTickType ticks)
+{
+    assert(*s == 0);
+    *s = 1;
+    return pdTRUE;
+}
+
+static inline portBASE_TYPE xSemaphoreGive(xSemaphoreHandle s)
+{
+    assert(*s == 1);
+    *s = 0;
+    return pdTRUE;
+}
+
+#endif
@@ -0,0 +1,429 @@
+/* Host test for the TLS client session cache.
+ *
+ * Each "connection" is a fresh mbedtls client and server context joined
+ * by two in-memory buffers, with both handshakes pumped in turn as if on
+ * non-blocking sockets. The client calls plain mbedtls_ssl_handshake(),
+ * which is wrapped by the cache. The server counts the sessions it
+ * resumes from its session cache or from tickets.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "../ssl_client_cache.c"
+
+#include "mbedtls/certs.h"
+#include "mbedtls/ssl_cache.h"
+#include "mbedtls/ssl_ticket.h"
+
+/* sysparam, in RAM. Only what ssl_client_cache uses. */
+
+#define MAX_PARAMS 8
+
+static struct {
+    char *key;
+    uint8_t *value;
+    size_t len;
+} params[MAX_PARAMS];
+static int param_writes;
+
+static int param_find(const char *key)
+{
+    for (int i = 0; i < MAX_PARAMS; i++) {
+        if (params[i].key && !strcmp(params[i].key, key)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+sysparam_status_t sysparam_get_data(const char *key, uint8_t **destptr, size_t *actual_length, bool *is_binary)
+{
+    int i = param_find(key);
+    if (i < 0) {
+        return SYSPARAM_NOTFOUND;
+    }
+    *destptr = malloc(params[i].len);
+    memcpy(*destptr, params[i].value, params[i].len);
+    *actual_length = params[i].len;
+    if (is_binary) {
+        *is_binary = true;
+    }
+    return SYSPARAM_OK;
+}
+
+sysparam_status_t sysparam_set_data(const char *key, const uint8_t *value, size_t value_len, bool binary)
+{
+    int i = param_find(key);
+    param_writes++;
+    if (i >= 0) {
+        free(params[i].key);
+        free(params[i].value);
+        params[i].key = NULL;
+    }
+    if (!value_len) {
+        return SYSPARAM_OK;
+    }
+    for (i = 0; params[i].key; i++) {
+    }
+    params[i].key = strdup(key);
+    params[i].value = malloc(value_len);
+    memcpy(params[i].value, value, value_len);
+    params[i].len = value_len;
+    return SYSPARAM_OK;
+}
+
+/* Forget everything the cache holds in RAM, as a reboot would */
+static void reboot(void)
+{
+    for (int i = 0; i < SSL_CLIENT_CACHE_ENTRIES; i++) {
+        entry_free(&cache[i]);
+    }
+}
+
+static void reset(void)
+{
+    reboot();
+    for (int i = 0; i < MAX_PARAMS; i++) {
+        free(params[i].key);
+        free(params[i].value);
+        params[i].key = NULL;
+    }
+    param_writes = 0;
+    persist = false;
+}
+
+static uint32_t rand_state = 1;
+
+static int test_rng(void *ctx, unsigned char *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        rand_state = rand_state * 1103515245 + 12345;
+        buf[i] = rand_state >> 16;
+    }
+    return 0;
+}
+
+/* One direction of a connection */
+typedef struct {
+    uint8_t data[16384];
+    size_t len;
+} pipe_t;
+
+typedef struct {
+    pipe_t *in, *out;
+} bio_t;
+
+static int bio_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    pipe_t *p = ((bio_t *)ctx)->out;
+    if (len > sizeof(p->data) - p->len) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+    memcpy(p->data + p->len, buf, len);
+    p->len += len;
+    return len;
+}
+
+static int bio_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    pipe_t *p = ((bio_t *)ctx)->in;
+    if (!p->len) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+    if (len > p->len) {
+        len = p->len;
+    }
+    memcpy(buf, p->data, len);
+    memmove(p->data, p->data + len, p->len - len);
+    p->len -= len;
+    return len;
+}
+
+/* The server. Sessions stay in its cache (or valid tickets) across
+   connections until server_init() is called again. */
+
+static mbedtls_ssl_config server_conf, client_conf;
+static mbedtls_x509_crt server_crt, ca_crt;
+static mbedtls_pk_context server_key;
+static mbedtls_ssl_cache_context server_cache;
+static mbedtls_ssl_ticket_context server_ticket;
+static int cache_hits, ticket_hits;
+
+static int count_cache_get(void *data, mbedtls_ssl_session *session)
+{
+    int ret = mbedtls_ssl_cache_get(data, session);
+    if (ret == 0) {
+        cache_hits++;
+    }
+    return ret;
+}
+
+static int count_ticket_parse(void *p_ticket, mbedtls_ssl_session *session, unsigned char *buf, size_t len)
+{
+    int ret = mbedtls_ssl_ticket_parse(p_ticket, session, buf, len);
+    if (ret == 0) {
+        ticket_hits++;
+    }
+    return ret;
+}
+
+static void server_free(void)
+{
+    mbedtls_ssl_config_free(&server_conf);
+    mbedtls_ssl_cache_free(&server_cache);
+    mbedtls_ssl_ticket_free(&server_ticket);
+}
+
+/* Set up the server, with a session cache and/or session tickets */
+static void server_init(bool use_cache, bool use_tickets)
+{
+    server_free();
+    mbedtls_ssl_config_init(&server_conf);
+    mbedtls_ssl_config_defaults(&server_conf, MBEDTLS_SSL_IS_SERVER, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    mbedtls_ssl_conf_rng(&server_conf, test_rng, NULL);
+    mbedtls_ssl_conf_own_cert(&server_conf, &server_crt, &server_key);
+    mbedtls_ssl_cache_init(&server_cache);
+    if (use_cache) {
+        mbedtls_ssl_conf_session_cache(&server_conf, &server_cache, count_cache_get, mbedtls_ssl_cache_set);
+    }
+    mbedtls_ssl_ticket_init(&server_ticket);
+    if (use_tickets) {
+        mbedtls_ssl_ticket_setup(&server_ticket, test_rng, NULL, MBEDTLS_CIPHER_AES_256_GCM, 86400);
+        mbedtls_ssl_conf_session_tickets_cb(&server_conf, mbedtls_ssl_ticket_write, count_ticket_parse, &server_ticket);
+    }
+    cache_hits = 0;
+    ticket_hits = 0;
+}
+
+static void setup(void)
+{
+    mbedtls_x509_crt_init(&server_crt);
+    mbedtls_x509_crt_init(&ca_crt);
+    mbedtls_pk_init(&server_key);
+    mbedtls_x509_crt_parse(&server_crt, (const unsigned char *)mbedtls_test_srv_crt, mbedtls_test_srv_crt_len);
+    mbedtls_x509_crt_parse(&ca_crt, (const unsigned char *)mbedtls_test_cas_pem, mbedtls_test_cas_pem_len);
+    mbedtls_pk_parse_key(&server_key, (const unsigned char *)mbedtls_test_srv_key, mbedtls_test_srv_key_len, NULL, 0);
+
+    /* Only "localhost" matches the certificate, the other hostnames
+       stand for other servers */
+    mbedtls_ssl_config_init(&client_conf);
+    mbedtls_ssl_config_defaults(&client_conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM, MBEDTLS_SSL_PRESET_DEFAULT);
+    mbedtls_ssl_conf_rng(&client_conf, test_rng, NULL);
+    mbedtls_ssl_conf_authmode(&client_conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+    mbedtls_ssl_conf_ca_chain(&client_conf, &ca_crt, NULL);
+}
+
+/* Connect to the server as hostname. Returns the client's handshake
+   result, or 1 if the handshakes didn't finish. */
+static int connect(const char *hostname)
+{
+    static pipe_t to_server, to_client;
+    bio_t client_bio = { &to_client, &to_server };
+    bio_t server_bio = { &to_server, &to_client };
+    mbedtls_ssl_context client, server;
+    int client_ret = 1, server_ret = 1;
+
+    to_server.len = 0;
+    to_client.len = 0;
+    mbedtls_ssl_init(&client);
+    mbedtls_ssl_init(&server);
+    mbedtls_ssl_setup(&client, &client_conf);
+    mbedtls_ssl_setup(&server, &server_conf);
+    if (hostname) {
+        mbedtls_ssl_set_hostname(&client, hostname);
+    }
+    mbedtls_ssl_set_bio(&client, &client_bio, bio_send, bio_recv, NULL);
+    mbedtls_ssl_set_bio(&server, &server_bio, bio_send, bio_recv, NULL);
+
+    for (int i = 0; i < 100; i++) {
+        if (client_ret != 0) {
+            client_ret = mbedtls_ssl_handshake(&client);
+        }
+        if (server_ret != 0) {
+            server_ret = mbedtls_ssl_handshake(&server);
+        }
+        if ((client_ret == 0 && server_ret == 0)
+            || (client_ret < 0 && client_ret != MBEDTLS_ERR_SSL_WANT_READ)
+            || (server_ret < 0 && server_ret != MBEDTLS_ERR_SSL_WANT_READ)) {
+            break;
+        }
+    }
+    if (client_ret == MBEDTLS_ERR_SSL_WANT_READ) {
+        client_ret = 1;
+    }
+
+    mbedtls_ssl_free(&client);
+    mbedtls_ssl_free(&server);
+    return client_ret;
+}
+
+static int resumed(void)
+{
+    return cache_hits + ticket_hits;
+}
+
+int test_session_id(void)
+{
+    reset();
+    server_init(true, false);
+    check(connect("localhost") == 0);
+    check(resumed() == 0);
+    check(entry_find("localhost"));
+    for (int i = 1; i <= 3; i++) {
+        check(connect("localhost") == 0);
+        check(cache_hits == i);
+    }
+    done();
+}
+
+int test_ticket(void)
+{
+    reset();
+    server_init(false, true);
+    check(connect("localhost") == 0);
+    check(resumed() == 0);
+    check(entry_find("localhost"));
+    check(entry_find("localhost")->session.ticket_len > 0);
+    for (int i = 1; i <= 3; i++) {
+        check(connect("localhost") == 0);
+        check(ticket_hits == i);
+    }
+    done();
+}
+
+/* A server that has forgotten the session does a full handshake, and
+   the new session replaces the old one */
+int test_server_forgot(void)
+{
+    reset();
+    server_init(true, false);
+    check(connect("localhost") == 0);
+    server_init(true, false);
+    check(connect("localhost") == 0);
+    check(resumed() == 0);
+    check(connect("localhost") == 0);
+    check(cache_hits == 1);
+    done();
+}
+
+/* A resumed handshake that fails forgets the session */
+int test_bad_session(void)
+{
+    reset();
+    server_init(true, true);
+    check(connect("localhost") == 0);
+    check(entry_find("localhost"));
+    entry_find("localhost")->session.master[0] ^= 1;
+    check(connect("localhost") < 0);
+    check(!entry_find("localhost"));
+    /* The server did find the session, the failed handshake was resumed */
+    check(resumed() == 1);
+    check(connect("localhost") == 0);
+    check(resumed() == 1);
+    check(connect("localhost") == 0);
+    check(resumed() == 2);
+    done();
+}
+
+/* Sessions for SSL_CLIENT_CACHE_ENTRIES servers are kept, least recently
+   used is replaced */
+int test_lru(void)
+{
+    reset();
+    server_init(true, false);
+    check(SSL_CLIENT_CACHE_ENTRIES == 2);
+    check(connect("a") == 0);
+    check(connect("b") == 0);
+    check(connect("a") == 0);
+    check(cache_hits == 1);
+    check(connect("c") == 0);
+    check(!entry_find("b"));
+    check(connect("a") == 0);
+    check(cache_hits == 2);
+    check(connect("b") == 0);
+    check(cache_hits == 2);
+    done();
+}
+
+/* Without a hostname there is nothing to key the session by */
+int test_no_hostname(void)
+{
+    reset();
+    server_init(true, false);
+    check(connect(NULL) == 0);
+    for (int i = 0; i < SSL_CLIENT_CACHE_ENTRIES; i++) {
+        check(!cache[i].hostname);
+    }
+    done();
+}
+
+int test_persist(void)
+{
+    int i;
+
+    reset();
+    server_init(true, false);
+    check(connect("localhost") == 0);
+    check(param_writes == 0);
+
+    ssl_client_cache_set_persist(true);
+    server_init(true, false);
+    check(connect("localhost") == 0);
+    check(param_writes == 1);
+    check(param_find(SSL_CLIENT_CACHE_SYSPARAM_PREFIX "localhost") >= 0);
+    reboot();
+    check(connect("localhost") == 0);
+    check(cache_hits == 1);
+    /* Resumed the same session, not written again */
+    check(param_writes == 1);
+
+    /* A failed session is removed from sysparam too */
+    check(entry_find("localhost"));
+    entry_find("localhost")->session.master[0] ^= 1;
+    check(connect("localhost") < 0);
+    check(param_find(SSL_CLIENT_CACHE_SYSPARAM_PREFIX "localhost") < 0);
+    check(cache_hits == 2);
+    reboot();
+    check(connect("localhost") == 0);
+    check(cache_hits == 2);
+
+    /* Sessions from an incompatible build are ignored */
+    i = param_find(SSL_CLIENT_CACHE_SYSPARAM_PREFIX "localhost");
+    check(i >= 0);
+    params[i].value[0] = PERSIST_VERSION + 1;
+    reboot();
+    check(connect("localhost") == 0);
+    check(cache_hits == 2);
+
+    /* The server sends a new ticket each time, which is saved */
+    server_init(false, true);
+    check(connect("localhost") == 0);
+    i = param_writes;
+    reboot();
+    check(connect("localhost") == 0);
+    check(ticket_hits == 1);
+    check(param_writes == i + 1);
+    reboot();
+    check(connect("localhost") == 0);
+    check(ticket_hits == 2);
+    done();
+}
+
+int main(int argc, char **argv)
+{
+    setup();
+    test(test_session_id, "resume with session ID");
+    test(test_ticket, "resume with session ticket");
+    test(test_server_forgot, "server forgot the session");
+    test(test_bad_session, "resumed handshake fails");
+    test(test_lru, "least recently used session replaced");
+    test(test_no_hostname, "no hostname");
+    test(test_persist, "sessions in sysparam");
+    printf("\nPASSED: %d\nFAILED: %d\n", test_passed, test_failed);
+    return (test_failed > 0);
+}
@@ -10,13 +10,34 @@
  *  protocol.
  */
 
-/** Select the table-lookup method of computing the 8-bit CRC
- *  by setting this to 1 during compilation.  The lookup table enlarges code
- *  size by about 250 bytes.  By default, a slower but very compact algorithm
- *  is used.
+/** Values for ONEWIRE_CRC_METHOD */
+#define ONEWIRE_CRC_BITWISE 0  ///< one bit at a time, no tables
+#define ONEWIRE_CRC_NIBBLE  1  ///< four bits at a time, 48 bytes of tables
+#define ONEWIRE_CRC_TABLE   2  ///< a byte at a time, 768 bytes of tables
+#define ONEWIRE_CRC_SLICE4  3  ///< four bytes at a time, 3KB of tables
+
+/** Select the method of computing the 8-bit, 16-bit and 32-bit CRCs by
+ *  setting this during compilation. The table driven methods are faster
+ *  but enlarge the code. By default, a slower but very compact algorithm
+ *  is used. The table sizes above are for crc8 and crc16, onewire_crc32()
+ *  adds 64 bytes, 1KB or 4KB when it is used.
+ *
+ *  Setting the old ONEWIRE_CRC8_TABLE to 1 selects ONEWIRE_CRC_TABLE.
+ */
+#ifndef ONEWIRE_CRC_METHOD
+#if defined(ONEWIRE_CRC8_TABLE) && ONEWIRE_CRC8_TABLE
+#define ONEWIRE_CRC_METHOD ONEWIRE_CRC_TABLE
+#else
+#define ONEWIRE_CRC_METHOD ONEWIRE_CRC_BITWISE
+#endif
+#endif
+
+/** Set this to 1 to put the CRC functions in IRAM and their tables in
+ *  IRAM_DATA, so they can be used while the flash cache is disabled (or
+ *  to save the flash cache misses.) By default they are in flash.
  */
-#ifndef ONEWIRE_CRC8_TABLE
-#define ONEWIRE_CRC8_TABLE 0
+#ifndef ONEWIRE_CRC_IRAM
+#define ONEWIRE_CRC_IRAM 0
 #endif
 
 /** Type used to hold all 1-Wire device ROM addresses (64-bit) */
@@ -232,4 +253,17 @@ bool onewire_check_crc16(const uint8_t* input, size_t len, const uint8_t* invert
  */
 uint16_t onewire_crc16(const uint8_t* input, size_t len, uint16_t crc_iv);
 
+/** Compute a CRC-32 as zlib's crc32() does (the CRC of Ethernet, PNG, ...)
+ *
+ *  This isn't used by 1-Wire devices, but shares their CRC methods, e.g.
+ *  with the OTA code in extras/rboot-ota.
+ *
+ *  @param data  Array of bytes to checksum.
+ *  @param len   How many bytes are in `data`.
+ *  @param crc   0 to start, or the result for the preceding data.
+ *
+ *  @returns the CRC-32 of all data so far.
+ */
+uint32_t onewire_crc32(const uint8_t *data, size_t len, uint32_t crc);
+
 #endif
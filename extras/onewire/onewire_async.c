@@ -0,0 +1,406 @@
+#include "onewire_async.h"
+#include "esp/gpio.h"
+#include "esp/timer.h"
+#include "esp/interrupts.h"
+#include "espressif/esp_system.h"
+#include "xtensa_ops.h"
+#include "task.h"
+#include <string.h>
+
+#define ONEWIRE_SEARCH     0xf0
+
+// FRC1 runs at 80MHz / 16
+#define TICKS_PER_US 5
+
+// Time slot lengths in microseconds (standard speed). Each one is the time
+// from the start of a slot (or the end of its busy-waited part) to the
+// start of the next one, including the recovery time.
+#define RESET_LOW_US        480
+#define RESET_HIGH_US       480
+#define WRITE1_LOW_US       6
+#define WRITE1_REST_US      64
+#define WRITE0_LOW_US       60
+#define WRITE0_REST_US      10
+#define READ_LOW_US         2
+#define READ_SAMPLE_US      11
+#define READ_REST_US        55
+
+// Devices start their presence pulse 15-60us after the reset is released.
+// The bus is watched for it from PRESENCE_MIN_US (so it has risen after the
+// reset) to PRESENCE_WAIT_US.
+#define PRESENCE_MIN_US     15
+#define PRESENCE_WAIT_US    75
+// A write-0 slot held low for longer than this (by a late interrupt) is
+// out of spec, devices may have read something else.
+#define WRITE0_MAX_LOW_US   120
+
+enum {
+    PHASE_START,
+    PHASE_RESET_RELEASE,
+    PHASE_TX,
+    PHASE_RX,
+    PHASE_SEARCH_ID,
+    PHASE_SEARCH_CMP,
+    PHASE_SEARCH_WRITE,
+    PHASE_FINISH,
+};
+
+static const uint8_t search_cmd = ONEWIRE_SEARCH;
+
+// The first job in the queue is the one running
+static onewire_job_t *queue_head;
+static onewire_job_t *queue_tail;
+
+// State of the running job that has to survive between interrupts
+static uint32_t pin_mask;
+static bool release_pending;
+static bool power_after_release;
+static uint32_t slot_start;     // CCOUNT when a write-0 slot pulled the bus low
+static uint32_t cycles_per_us;
+
+static inline uint32_t get_ccount(void) {
+    uint32_t ccount;
+    RSR(ccount, ccount);
+    return ccount;
+}
+
+static inline void bus_low(void) {
+    GPIO.OUT_CLEAR = pin_mask;
+}
+
+static inline bool bus_read(void) {
+    return (GPIO.IN & pin_mask) != 0;
+}
+
+// Release the bus, or drive it high if this was the last bit of a job that
+// wants power afterwards. The strong pull-up has to follow the last bit
+// within 10us, so this can't wait for the end of the job.
+static inline void bus_release(int pin) {
+    if (power_after_release) {
+        power_after_release = false;
+        GPIO.CONF[pin] &= ~GPIO_CONF_OPEN_DRAIN;
+    }
+    GPIO.OUT_SET = pin_mask;
+}
+
+// Each of these starts a slot and returns the time until the interrupt
+// handler needs to run again.
+
+static IRAM uint32_t write_bit(int pin, bool v) {
+    bus_low();
+    if (v) {
+        sdk_os_delay_us(WRITE1_LOW_US);
+        bus_release(pin);
+        return WRITE1_REST_US;
+    }
+    // The bus is released on the next interrupt
+    slot_start = get_ccount();
+    release_pending = true;
+    return WRITE0_LOW_US;
+}
+
+static IRAM bool read_bit(int pin) {
+    bool r;
+
+    bus_low();
+    sdk_os_delay_us(READ_LOW_US);
+    bus_release(pin);
+    sdk_os_delay_us(READ_SAMPLE_US);
+    r = bus_read();
+    return r;
+}
+
+// Decide which branch of the search tree to follow for the current bit,
+// the same way as onewire_search_next() does.
+static IRAM bool search_direction(onewire_job_t *job, bool cmp_id_bit) {
+    onewire_search_t *search = job->search;
+    uint8_t id_bit_number = job->bit + 1;
+    uint8_t rom_byte_mask = 1 << (job->bit % 8);
+    uint8_t *rom_byte = &search->rom_no[job->bit / 8];
+    bool direction;
+
+    if (job->id_bit != cmp_id_bit) {
+        direction = job->id_bit;
+    } else {
+        if (id_bit_number < search->last_discrepancy) {
+            direction = (*rom_byte & rom_byte_mask) != 0;
+        } else {
+            direction = (id_bit_number == search->last_discrepancy);
+        }
+        if (!direction) {
+            job->last_zero = id_bit_number;
+        }
+    }
+    if (direction) {
+        *rom_byte |= rom_byte_mask;
+    } else {
+        *rom_byte &= ~rom_byte_mask;
+    }
+    return direction;
+}
+
+static IRAM void search_done(onewire_job_t *job, bool found) {
+    onewire_search_t *search = job->search;
+    onewire_addr_t addr = 0;
+
+    if (found) {
+        search->last_discrepancy = job->last_zero;
+        if (search->last_discrepancy == 0) {
+            search->last_device_found = true;
+        }
+        for (int i = 7; i >= 0; i--) {
+            addr = (addr << 8) | search->rom_no[i];
+        }
+    }
+    if (!found || !search->rom_no[0]) {
+        search->last_discrepancy = 0;
+        search->last_device_found = false;
+        addr = ONEWIRE_NONE;
+    }
+    job->found = addr;
+}
+
+// Run the next step of a job. Returns the time until the next step, or 0
+// if the job has finished (with job->status set).
+static IRAM uint32_t job_step(onewire_job_t *job) {
+    int pin = job->pin;
+    bool v;
+
+    if (release_pending) {
+        release_pending = false;
+        bus_release(pin);
+        if (get_ccount() - slot_start > WRITE0_MAX_LOW_US * cycles_per_us) {
+            job->status = ONEWIRE_JOB_TIMING_ERROR;
+            return 0;
+        }
+        return WRITE0_REST_US;
+    }
+
+    switch (job->phase) {
+    case PHASE_START:
+        // Undo the power of an earlier job and release the bus
+        GPIO.CONF[pin] |= GPIO_CONF_OPEN_DRAIN;
+        GPIO.OUT_SET = pin_mask;
+        job->bit = 0;
+        job->last_zero = 0;
+        job->phase = PHASE_TX;
+        if (job->reset) {
+            if (!bus_read()) {
+                job->status = ONEWIRE_JOB_BUS_ERROR;
+                return 0;
+            }
+            bus_low();
+            job->phase = PHASE_RESET_RELEASE;
+            return RESET_LOW_US;
+        }
+        return 1;
+    case PHASE_RESET_RELEASE: {
+        // Wait here for the presence pulse rather than sampling it on a
+        // later interrupt, which could come after the pulse has ended.
+        uint32_t start = get_ccount();
+        uint32_t waited;
+        GPIO.OUT_SET = pin_mask;
+        do {
+            waited = (get_ccount() - start) / cycles_per_us;
+            if (waited >= PRESENCE_MIN_US && !bus_read()) {
+                job->phase = PHASE_TX;
+                return RESET_HIGH_US - waited;
+            }
+        } while (waited < PRESENCE_WAIT_US);
+        job->status = ONEWIRE_JOB_NO_PRESENCE;
+        return 0;
+    }
+    case PHASE_TX:
+        if (job->bit < job->tx_len * 8) {
+            v = (job->tx[job->bit / 8] >> (job->bit % 8)) & 1;
+            job->bit++;
+            if (job->power && job->bit == job->tx_len * 8 && !job->rx_len) {
+                power_after_release = true;
+            }
+            return write_bit(pin, v);
+        }
+        job->bit = 0;
+        if (job->search) {
+            job->phase = PHASE_SEARCH_ID;
+            return job_step(job);
+        }
+        job->phase = PHASE_RX;
+        // fall through
+    case PHASE_RX:
+        if (job->bit < job->rx_len * 8) {
+            v = read_bit(pin);
+            if (v) {
+                job->rx[job->bit / 8] |= 1 << (job->bit % 8);
+            } else {
+                job->rx[job->bit / 8] &= ~(1 << (job->bit % 8));
+            }
+            job->bit++;
+            return READ_REST_US;
+        }
+        job->phase = PHASE_FINISH;
+        // fall through
+    case PHASE_FINISH:
+        if (job->power) {
+            GPIO.CONF[pin] &= ~GPIO_CONF_OPEN_DRAIN;
+            GPIO.OUT_SET = pin_mask;
+        }
+        job->status = ONEWIRE_JOB_DONE;
+        return 0;
+    case PHASE_SEARCH_ID:
+        if (job->bit == 64) {
+            search_done(job, true);
+            job->status = ONEWIRE_JOB_DONE;
+            return 0;
+        }
+        job->id_bit = read_bit(pin);
+        job->phase = PHASE_SEARCH_CMP;
+        return READ_REST_US;
+    case PHASE_SEARCH_CMP:
+        v = read_bit(pin);
+        if (job->id_bit && v) {
+            // No devices answered
+            search_done(job, false);
+            job->status = ONEWIRE_JOB_DONE;
+            return 0;
+        }
+        job->id_bit = search_direction(job, v);
+        job->phase = PHASE_SEARCH_WRITE;
+        return READ_REST_US;
+    case PHASE_SEARCH_WRITE:
+        job->bit++;
+        job->phase = PHASE_SEARCH_ID;
+        return write_bit(pin, job->id_bit);
+    }
+    job->status = ONEWIRE_JOB_BUS_ERROR;
+    return 0;
+}
+
+static IRAM void start_job(onewire_job_t *job) {
+    pin_mask = BIT(job->pin);
+    release_pending = false;
+    power_after_release = false;
+}
+
+static IRAM void onewire_timer_isr(void) {
+    portBASE_TYPE woken = pdFALSE;
+    uint32_t delay = 0;
+    onewire_job_t *job;
+
+    while ((job = queue_head) != NULL) {
+        delay = job_step(job);
+        if (delay) break;
+
+        // The job has finished, start the next one
+        if (job->search && job->status != ONEWIRE_JOB_DONE) {
+            search_done(job, false);
+        }
+        queue_head = job->next;
+        if (!queue_head) {
+            queue_tail = NULL;
+        } else {
+            start_job(queue_head);
+        }
+        if (job->done) {
+            job->done(job);
+        }
+        xSemaphoreGiveFromISR(job->sem, &woken);
+    }
+
+    if (delay) {
+        timer_set_load(FRC1, delay * TICKS_PER_US);
+    } else {
+        timer_set_run(FRC1, false);
+    }
+    portEND_SWITCHING_ISR(woken);
+}
+
+void onewire_async_init(void) {
+    timer_set_interrupts(FRC1, false);
+    timer_set_run(FRC1, false);
+    queue_head = queue_tail = NULL;
+    _xt_isr_attach(INUM_TIMER_FRC1, onewire_timer_isr);
+    timer_set_divider(FRC1, TIMER_CLKDIV_16);
+    timer_set_reload(FRC1, false);
+    timer_set_interrupts(FRC1, true);
+}
+
+bool onewire_job_init(onewire_job_t *job, int pin) {
+    memset(job, 0, sizeof(onewire_job_t));
+    job->pin = pin;
+    job->status = ONEWIRE_JOB_DONE;
+    vSemaphoreCreateBinary(job->sem);
+    if (!job->sem) return false;
+    // binary semaphores are created 'given'
+    xSemaphoreTake(job->sem, 0);
+
+    gpio_enable(pin, GPIO_OUT_OPEN_DRAIN);
+    gpio_write(pin, 1);
+    return true;
+}
+
+void onewire_job_free(onewire_job_t *job) {
+    if (job->sem) {
+        vSemaphoreDelete(job->sem);
+        job->sem = NULL;
+    }
+}
+
+static void queue_job(onewire_job_t *job) {
+    job->status = ONEWIRE_JOB_PENDING;
+    job->phase = PHASE_START;
+    job->next = NULL;
+
+    taskENTER_CRITICAL();
+    cycles_per_us = sdk_system_get_cpu_freq();
+    if (queue_tail) {
+        queue_tail->next = job;
+        queue_tail = job;
+    } else {
+        // The engine is idle, start it
+        queue_head = queue_tail = job;
+        start_job(job);
+        timer_set_load(FRC1, TICKS_PER_US);
+        timer_set_run(FRC1, true);
+    }
+    taskEXIT_CRITICAL();
+}
+
+void onewire_async_submit(onewire_job_t *job) {
+    job->search = NULL;
+    queue_job(job);
+}
+
+void onewire_async_search(onewire_job_t *job, onewire_search_t *search) {
+    job->search = search;
+    job->reset = true;
+    job->tx = &search_cmd;
+    job->tx_len = 1;
+    job->rx_len = 0;
+    job->power = false;
+    job->found = ONEWIRE_NONE;
+
+    if (search->last_device_found) {
+        // Nothing left to find, don't bother the bus
+        search->last_discrepancy = 0;
+        search->last_device_found = false;
+        job->status = ONEWIRE_JOB_DONE;
+        if (job->done) {
+            job->done(job);
+        }
+        xSemaphoreGive(job->sem);
+        return;
+    }
+    queue_job(job);
+}
+
+onewire_job_status_t onewire_async_wait(onewire_job_t *job, portTickType timeout) {
+    if (job->status != ONEWIRE_JOB_PENDING) {
+        // Finished already, clear the semaphore for the next submit
+        xSemaphoreTake(job->sem, 0);
+        return job->status;
+    }
+    if (!xSemaphoreTake(job->sem, timeout)) {
+        return ONEWIRE_JOB_PENDING;
+    }
+    return job->status;
+}
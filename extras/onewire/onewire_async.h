@@ -0,0 +1,109 @@
+#ifndef __ONEWIRE_ASYNC_H__
+#define __ONEWIRE_ASYNC_H__
+
+#include "onewire.h"
+#include <FreeRTOS.h>
+#include <semphr.h>
+
+/** @file onewire_async.h
+ *
+ *  Interrupt driven 1-Wire transfers.
+ *
+ *  The routines in onewire.h busy-wait through every time slot, so a byte
+ *  keeps the CPU busy for about 0.5ms. Here the slots are generated by the
+ *  FRC1 timer interrupt instead: each interrupt only does the part of a
+ *  slot that has to be timed to the microsecond (at most ~13us for a read
+ *  slot, up to 75us waiting for the presence pulse after a reset), and the
+ *  rest of the slot passes with the CPU free for tasks. A write-0 slot ends
+ *  on the next interrupt; if that comes too late (more than 120us low) the
+ *  job fails with ::ONEWIRE_JOB_TIMING_ERROR and can be retried.
+ *
+ *  A transfer is described by a onewire_job_t (an optional reset, bytes to
+ *  write, bytes to read, optional strong pull-up afterwards) or is a search
+ *  for the next device. Jobs are queued with onewire_async_submit() and run
+ *  one after another, so jobs for several pins can be queued at once.
+ *
+ *  FRC1 is also used by extras/pwm, so the two can't be used together.
+ */
+
+typedef enum {
+    ONEWIRE_JOB_PENDING,      ///< queued or running
+    ONEWIRE_JOB_DONE,         ///< finished successfully
+    ONEWIRE_JOB_NO_PRESENCE,  ///< no device answered the reset
+    ONEWIRE_JOB_BUS_ERROR,    ///< the bus is held low (shorted?)
+    ONEWIRE_JOB_TIMING_ERROR, ///< an interrupt came too late to end a slot in
+                              ///  time, the job may be partly done
+} onewire_job_status_t;
+
+typedef struct onewire_job onewire_job_t;
+
+/** A 1-Wire transfer. Set up with onewire_job_init(), then fill in the
+ *  public fields before each submit.
+ */
+struct onewire_job {
+    int pin;                  ///< GPIO pin of the bus
+    bool reset;               ///< start with a reset / presence cycle
+    const uint8_t *tx;        ///< bytes to write
+    size_t tx_len;
+    uint8_t *rx;              ///< buffer for bytes read after the write
+    size_t rx_len;
+    bool power;               ///< drive the bus high after the last bit
+                              ///  (see onewire_power())
+    /** Called in interrupt context when the job has finished (optional) */
+    void (*done)(onewire_job_t *job);
+    void *arg;                ///< for use by the callback
+
+    volatile onewire_job_status_t status;
+    onewire_addr_t found;     ///< result of onewire_async_search()
+
+    /* private */
+    xSemaphoreHandle sem;
+    onewire_search_t *search;
+    onewire_job_t *next;
+    uint16_t bit;
+    uint8_t phase;
+    uint8_t last_zero;
+    bool id_bit;
+};
+
+/** Set up FRC1 and its interrupt handler. Call once before any other
+ *  function here.
+ */
+void onewire_async_init(void);
+
+/** Initialise a job for a pin and configure the pin as open drain output.
+ *
+ *  @returns `false` if the completion semaphore couldn't be allocated.
+ */
+bool onewire_job_init(onewire_job_t *job, int pin);
+
+/** Free the resources of a job that is no longer queued. */
+void onewire_job_free(onewire_job_t *job);
+
+/** Queue a job. It runs as soon as the jobs before it have finished.
+ *
+ *  The job and the buffers it points to must stay valid until it has
+ *  finished.
+ */
+void onewire_async_submit(onewire_job_t *job);
+
+/** Queue a search for the next device on the bus.
+ *
+ *  Works like onewire_search_next(), with the result in `job->found` when
+ *  the job has finished. The other transfer fields of the job are ignored.
+ */
+void onewire_async_search(onewire_job_t *job, onewire_search_t *search);
+
+/** Wait for a submitted job to finish.
+ *
+ *  @returns the job status, ::ONEWIRE_JOB_PENDING on timeout.
+ */
+onewire_job_status_t onewire_async_wait(onewire_job_t *job, portTickType timeout);
+
+/** Submit a job and wait for it to finish. */
+static inline onewire_job_status_t onewire_async_run(onewire_job_t *job) {
+    onewire_async_submit(job);
+    return onewire_async_wait(job, portMAX_DELAY);
+}
+
+#endif
@@ -0,0 +1,681 @@
+// CRC routines for 1-Wire devices.
+//
+// The 1-Wire CRC scheme is described in Maxim Application Note 27:
+// "Understanding and Using Cyclic Redundancy Checks with Maxim iButton Products"
+//
+// Both CRCs are bit-reflected: the CRC8 polynomial is x^8 + x^5 + x^4 + 1
+// (0x8C reflected), the CRC16 polynomial is x^16 + x^15 + x^2 + 1 (0xA001
+// reflected). The CRC-32 isn't a 1-Wire CRC, it is the one used by zlib
+// (0xEDB88320 reflected), here so the OTA code can share the same methods.
+// ONEWIRE_CRC_METHOD (see onewire.h) selects how they're computed. All
+// methods give the same results, they only trade code and table size for
+// speed.
+
+#include "onewire.h"
+#include <common_macros.h>
+
+#if ONEWIRE_CRC_IRAM
+#define CRC_FUNC  IRAM
+#define CRC_TABLE IRAM_DATA __attribute__((aligned(4)))
+#else
+#define CRC_FUNC
+#define CRC_TABLE __attribute__((aligned(4)))
+#endif
+
+// The tables are in flash or IRAM, which can only be read a 32-bit word at
+// a time (anything else goes through the slow unaligned load exception
+// handler), so byte and halfword entries are picked out of whole words.
+static inline uint8_t table_u8(const uint8_t *table, uint8_t i) {
+    return ((const uint32_t *)table)[i / 4] >> (8 * (i % 4));
+}
+
+static inline uint16_t table_u16(const uint16_t *table, uint8_t i) {
+    return ((const uint32_t *)table)[i / 2] >> (16 * (i % 2));
+}
+
+#if ONEWIRE_CRC_METHOD == ONEWIRE_CRC_BITWISE
+
+// Bit by bit. This is much slower, but much smaller, than the lookup tables.
+CRC_FUNC uint8_t onewire_crc8(const uint8_t *data, uint8_t len) {
+    uint8_t crc = 0;
+    
+    while (len--) {
+        uint8_t inbyte = *data++;
+        for (int i = 8; i; i--) {
+            uint8_t mix = (crc ^ inbyte) & 0x01;
+            crc >>= 1;
+            if (mix) crc ^= 0x8C;
+            inbyte >>= 1;
+        }
+    }
+    return crc;
+}
+
+CRC_FUNC uint16_t onewire_crc16(const uint8_t* input, size_t len, uint16_t crc_iv) {
+    uint16_t crc = crc_iv;
+    static const uint8_t oddparity[16] CRC_TABLE =
+        { 0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0 };
+
+    for (size_t i = 0; i < len; i++) {
+      // Even though we're just copying a byte from the input,
+      // we'll be doing 16-bit computation with it.
+      uint16_t cdata = input[i];
+      cdata = (cdata ^ crc) & 0xff;
+      crc >>= 8;
+
+      if (table_u8(oddparity, cdata & 0x0F) ^ table_u8(oddparity, cdata >> 4))
+          crc ^= 0xC001;
+
+      cdata <<= 6;
+      crc ^= cdata;
+      cdata <<= 1;
+      crc ^= cdata;
+    }
+    return crc;
+}
+
+CRC_FUNC uint32_t onewire_crc32(const uint8_t *data, size_t len, uint32_t crc) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *data++;
+        for (int i = 8; i; i--) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+#elif ONEWIRE_CRC_METHOD == ONEWIRE_CRC_NIBBLE
+
+// Four bits at a time. crc_nibble[i] is the CRC register after shifting
+// out the four bits of i.
+static const uint8_t crc8_nibble[16] CRC_TABLE = {
+    0x00, 0x9d, 0x23, 0xbe, 0x46, 0xdb, 0x65, 0xf8,
+    0x8c, 0x11, 0xaf, 0x32, 0xca, 0x57, 0xe9, 0x74
+};
+
+static const uint16_t crc16_nibble[16] CRC_TABLE = {
+    0x0000, 0xcc01, 0xd801, 0x1400, 0xf001, 0x3c00, 0x2800, 0xe401,
+    0xa001, 0x6c00, 0x7800, 0xb401, 0x5000, 0x9c01, 0x8801, 0x4400
+};
+
+CRC_FUNC uint8_t onewire_crc8(const uint8_t *data, uint8_t len) {
+    uint8_t crc = 0;
+
+    while (len--) {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ table_u8(crc8_nibble, crc & 0x0f);
+        crc = (crc >> 4) ^ table_u8(crc8_nibble, crc & 0x0f);
+    }
+    return crc;
+}
+
+CRC_FUNC uint16_t onewire_crc16(const uint8_t* input, size_t len, uint16_t crc_iv) {
+    uint16_t crc = crc_iv;
+
+    while (len--) {
+        crc ^= *input++;
+        crc = (crc >> 4) ^ table_u16(crc16_nibble, crc & 0x0f);
+        crc = (crc >> 4) ^ table_u16(crc16_nibble, crc & 0x0f);
+    }
+    return crc;
+}
+
+static const uint32_t crc32_nibble[16] CRC_TABLE = {
+    0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+    0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+    0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+    0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+};
+
+CRC_FUNC uint32_t onewire_crc32(const uint8_t *data, size_t len, uint32_t crc) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *data++;
+        crc = (crc >> 4) ^ crc32_nibble[crc & 0x0f];
+        crc = (crc >> 4) ^ crc32_nibble[crc & 0x0f];
+    }
+    return ~crc;
+}
+
+#elif ONEWIRE_CRC_METHOD == ONEWIRE_CRC_TABLE
+
+// This table comes from Dallas sample code where it is freely reusable,
+// though Copyright (C) 2000 Dallas Semiconductor Corporation
+static const uint8_t dscrc_table[256] CRC_TABLE = {
+      0, 94,188,226, 97, 63,221,131,194,156,126, 32,163,253, 31, 65,
+    157,195, 33,127,252,162, 64, 30, 95,  1,227,189, 62, 96,130,220,
+     35,125,159,193, 66, 28,254,160,225,191, 93,  3,128,222, 60, 98,
+    190,224,  2, 92,223,129, 99, 61,124, 34,192,158, 29, 67,161,255,
+     70, 24,250,164, 39,121,155,197,132,218, 56,102,229,187, 89,  7,
+    219,133,103, 57,186,228,  6, 88, 25, 71,165,251,120, 38,196,154,
+    101, 59,217,135,  4, 90,184,230,167,249, 27, 69,198,152,122, 36,
+    248,166, 68, 26,153,199, 37,123, 58,100,134,216, 91,  5,231,185,
+    140,210, 48,110,237,179, 81, 15, 78, 16,242,172, 47,113,147,205,
+     17, 79,173,243,112, 46,204,146,211,141,111, 49,178,236, 14, 80,
+    175,241, 19, 77,206,144,114, 44,109, 51,209,143, 12, 82,176,238,
+     50,108,142,208, 83, 13,239,177,240,174, 76, 18,145,207, 45,115,
+    202,148,118, 40,171,245, 23, 73,  8, 86,180,234,105, 55,213,139,
+     87,  9,235,181, 54,104,138,212,149,203, 41,119,244,170, 72, 22,
+    233,183, 85, 11,136,214, 52,106, 43,117,151,201, 74, 20,246,168,
+    116, 42,200,150, 21, 75,169,247,182,232, 10, 84,215,137,107, 53
+};
+
+static const uint16_t crc16_table[256] CRC_TABLE = {
+    0x0000, 0xc0c1, 0xc181, 0x0140, 0xc301, 0x03c0, 0x0280, 0xc241,
+    0xc601, 0x06c0, 0x0780, 0xc741, 0x0500, 0xc5c1, 0xc481, 0x0440,
+    0xcc01, 0x0cc0, 0x0d80, 0xcd41, 0x0f00, 0xcfc1, 0xce81, 0x0e40,
+    0x0a00, 0xcac1, 0xcb81, 0x0b40, 0xc901, 0x09c0, 0x0880, 0xc841,
+    0xd801, 0x18c0, 0x1980, 0xd941, 0x1b00, 0xdbc1, 0xda81, 0x1a40,
+    0x1e00, 0xdec1, 0xdf81, 0x1f40, 0xdd01, 0x1dc0, 0x1c80, 0xdc41,
+    0x1400, 0xd4c1, 0xd581, 0x1540, 0xd701, 0x17c0, 0x1680, 0xd641,
+    0xd201, 0x12c0, 0x1380, 0xd341, 0x1100, 0xd1c1, 0xd081, 0x1040,
+    0xf001, 0x30c0, 0x3180, 0xf141, 0x3300, 0xf3c1, 0xf281, 0x3240,
+    0x3600, 0xf6c1, 0xf781, 0x3740, 0xf501, 0x35c0, 0x3480, 0xf441,
+    0x3c00, 0xfcc1, 0xfd81, 0x3d40, 0xff01, 0x3fc0, 0x3e80, 0xfe41,
+    0xfa01, 0x3ac0, 0x3b80, 0xfb41, 0x3900, 0xf9c1, 0xf881, 0x3840,
+    0x2800, 0xe8c1, 0xe981, 0x2940, 0xeb01, 0x2bc0, 0x2a80, 0xea41,
+    0xee01, 0x2ec0, 0x2f80, 0xef41, 0x2d00, 0xedc1, 0xec81, 0x2c40,
+    0xe401, 0x24c0, 0x2580, 0xe541, 0x2700, 0xe7c1, 0xe681, 0x2640,
+    0x2200, 0xe2c1, 0xe381, 0x2340, 0xe101, 0x21c0, 0x2080, 0xe041,
+    0xa001, 0x60c0, 0x6180, 0xa141, 0x6300, 0xa3c1, 0xa281, 0x6240,
+    0x6600, 0xa6c1, 0xa781, 0x6740, 0xa501, 0x65c0, 0x6480, 0xa441,
+    0x6c00, 0xacc1, 0xad81, 0x6d40, 0xaf01, 0x6fc0, 0x6e80, 0xae41,
+    0xaa01, 0x6ac0, 0x6b80, 0xab41, 0x6900, 0xa9c1, 0xa881, 0x6840,
+    0x7800, 0xb8c1, 0xb981, 0x7940, 0xbb01, 0x7bc0, 0x7a80, 0xba41,
+    0xbe01, 0x7ec0, 0x7f80, 0xbf41, 0x7d00, 0xbdc1, 0xbc81, 0x7c40,
+    0xb401, 0x74c0, 0x7580, 0xb541, 0x7700, 0xb7c1, 0xb681, 0x7640,
+    0x7200, 0xb2c1, 0xb381, 0x7340, 0xb101, 0x71c0, 0x7080, 0xb041,
+    0x5000, 0x90c1, 0x9181, 0x5140, 0x9301, 0x53c0, 0x5280, 0x9241,
+    0x9601, 0x56c0, 0x5780, 0x9741, 0x5500, 0x95c1, 0x9481, 0x5440,
+    0x9c01, 0x5cc0, 0x5d80, 0x9d41, 0x5f00, 0x9fc1, 0x9e81, 0x5e40,
+    0x5a00, 0x9ac1, 0x9b81, 0x5b40, 0x9901, 0x59c0, 0x5880, 0x9841,
+    0x8801, 0x48c0, 0x4980, 0x8941, 0x4b00, 0x8bc1, 0x8a81, 0x4a40,
+    0x4e00, 0x8ec1, 0x8f81, 0x4f40, 0x8d01, 0x4dc0, 0x4c80, 0x8c41,
+    0x4400, 0x84c1, 0x8581, 0x4540, 0x8701, 0x47c0, 0x4680, 0x8641,
+    0x8201, 0x42c0, 0x4380, 0x8341, 0x4100, 0x81c1, 0x8081, 0x4040
+};
+
+CRC_FUNC uint8_t onewire_crc8(const uint8_t *data, uint8_t len) {
+    uint8_t crc = 0;
+
+    while (len--) {
+        crc = table_u8(dscrc_table, crc ^ *data++);
+    }
+    return crc;
+}
+
+CRC_FUNC uint16_t onewire_crc16(const uint8_t* input, size_t len, uint16_t crc_iv) {
+    uint16_t crc = crc_iv;
+
+    while (len--) {
+        crc = (crc >> 8) ^ table_u16(crc16_table, (crc ^ *input++) & 0xff);
+    }
+    return crc;
+}
+
+static const uint32_t crc32_table[256] CRC_TABLE = {
+    0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
+    0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
+    0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
+    0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
+    0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
+    0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
+    0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
+    0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
+    0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
+    0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
+    0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
+    0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
+    0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
+    0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
+    0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
+    0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
+    0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
+    0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
+    0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
+    0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
+    0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
+    0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
+    0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
+    0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
+    0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
+    0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
+    0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
+    0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
+    0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
+    0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
+    0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
+    0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
+    0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
+    0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
+    0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
+    0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
+    0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
+    0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
+    0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
+    0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
+    0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
+    0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
+    0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
+};
+
+CRC_FUNC uint32_t onewire_crc32(const uint8_t *data, size_t len, uint32_t crc) {
+    crc = ~crc;
+    while (len--) {
+        crc = (crc >> 8) ^ crc32_table[(crc ^ *data++) & 0xff];
+    }
+    return ~crc;
+}
+
+#elif ONEWIRE_CRC_METHOD == ONEWIRE_CRC_SLICE4
+
+// Slicing-by-4: four bytes are looked up independently and the results
+// combined, instead of each lookup waiting for the one before it.
+//
+// Byte k of crc8_slice[i] is the CRC of byte i followed by k zero bytes,
+// so the four entries for one index are read with a single word access.
+static const uint32_t crc8_slice[256] CRC_TABLE = {
+    0x00000000, 0x8fabc45e, 0x074f91bc, 0x88e455e2, 0x0e9e3b61, 0x8135ff3f,
+    0x09d1aadd, 0x867a6e83, 0x1c2576c2, 0x938eb29c, 0x1b6ae77e, 0x94c12320,
+    0x12bb4da3, 0x9d1089fd, 0x15f4dc1f, 0x9a5f1841, 0x384aec9d, 0xb7e128c3,
+    0x3f057d21, 0xb0aeb97f, 0x36d4d7fc, 0xb97f13a2, 0x319b4640, 0xbe30821e,
+    0x246f9a5f, 0xabc45e01, 0x23200be3, 0xac8bcfbd, 0x2af1a13e, 0xa55a6560,
+    0x2dbe3082, 0xa215f4dc, 0x7094c123, 0xff3f057d, 0x77db509f, 0xf87094c1,
+    0x7e0afa42, 0xf1a13e1c, 0x79456bfe, 0xf6eeafa0, 0x6cb1b7e1, 0xe31a73bf,
+    0x6bfe265d, 0xe455e203, 0x622f8c80, 0xed8448de, 0x65601d3c, 0xeacbd962,
+    0x48de2dbe, 0xc775e9e0, 0x4f91bc02, 0xc03a785c, 0x464016df, 0xc9ebd281,
+    0x410f8763, 0xcea4433d, 0x54fb5b7c, 0xdb509f22, 0x53b4cac0, 0xdc1f0e9e,
+    0x5a65601d, 0xd5cea443, 0x5d2af1a1, 0xd28135ff, 0xe0319b46, 0x6f9a5f18,
+    0xe77e0afa, 0x68d5cea4, 0xeeafa027, 0x61046479, 0xe9e0319b, 0x664bf5c5,
+    0xfc14ed84, 0x73bf29da, 0xfb5b7c38, 0x74f0b866, 0xf28ad6e5, 0x7d2112bb,
+    0xf5c54759, 0x7a6e8307, 0xd87b77db, 0x57d0b385, 0xdf34e667, 0x509f2239,
+    0xd6e54cba, 0x594e88e4, 0xd1aadd06, 0x5e011958, 0xc45e0119, 0x4bf5c547,
+    0xc31190a5, 0x4cba54fb, 0xcac03a78, 0x456bfe26, 0xcd8fabc4, 0x42246f9a,
+    0x90a55a65, 0x1f0e9e3b, 0x97eacbd9, 0x18410f87, 0x9e3b6104, 0x1190a55a,
+    0x9974f0b8, 0x16df34e6, 0x8c802ca7, 0x032be8f9, 0x8bcfbd1b, 0x04647945,
+    0x821e17c6, 0x0db5d398, 0x8551867a, 0x0afa4224, 0xa8efb6f8, 0x274472a6,
+    0xafa02744, 0x200be31a, 0xa6718d99, 0x29da49c7, 0xa13e1c25, 0x2e95d87b,
+    0xb4cac03a, 0x3b610464, 0xb3855186, 0x3c2e95d8, 0xba54fb5b, 0x35ff3f05,
+    0xbd1b6ae7, 0x32b0aeb9, 0xd9622f8c, 0x56c9ebd2, 0xde2dbe30, 0x51867a6e,
+    0xd7fc14ed, 0x5857d0b3, 0xd0b38551, 0x5f18410f, 0xc547594e, 0x4aec9d10,
+    0xc208c8f2, 0x4da30cac, 0xcbd9622f, 0x4472a671, 0xcc96f393, 0x433d37cd,
+    0xe128c311, 0x6e83074f, 0xe66752ad, 0x69cc96f3, 0xefb6f870, 0x601d3c2e,
+    0xe8f969cc, 0x6752ad92, 0xfd0db5d3, 0x72a6718d, 0xfa42246f, 0x75e9e031,
+    0xf3938eb2, 0x7c384aec, 0xf4dc1f0e, 0x7b77db50, 0xa9f6eeaf, 0x265d2af1,
+    0xaeb97f13, 0x2112bb4d, 0xa768d5ce, 0x28c31190, 0xa0274472, 0x2f8c802c,
+    0xb5d3986d, 0x3a785c33, 0xb29c09d1, 0x3d37cd8f, 0xbb4da30c, 0x34e66752,
+    0xbc0232b0, 0x33a9f6ee, 0x91bc0232, 0x1e17c66c, 0x96f3938e, 0x195857d0,
+    0x9f223953, 0x1089fd0d, 0x986da8ef, 0x17c66cb1, 0x8d9974f0, 0x0232b0ae,
+    0x8ad6e54c, 0x057d2112, 0x83074f91, 0x0cac8bcf, 0x8448de2d, 0x0be31a73,
+    0x3953b4ca, 0xb6f87094, 0x3e1c2576, 0xb1b7e128, 0x37cd8fab, 0xb8664bf5,
+    0x30821e17, 0xbf29da49, 0x2576c208, 0xaadd0656, 0x223953b4, 0xad9297ea,
+    0x2be8f969, 0xa4433d37, 0x2ca768d5, 0xa30cac8b, 0x01195857, 0x8eb29c09,
+    0x0656c9eb, 0x89fd0db5, 0x0f876336, 0x802ca768, 0x08c8f28a, 0x876336d4,
+    0x1d3c2e95, 0x9297eacb, 0x1a73bf29, 0x95d87b77, 0x13a215f4, 0x9c09d1aa,
+    0x14ed8448, 0x9b464016, 0x49c775e9, 0xc66cb1b7, 0x4e88e455, 0xc123200b,
+    0x47594e88, 0xc8f28ad6, 0x4016df34, 0xcfbd1b6a, 0x55e2032b, 0xda49c775,
+    0x52ad9297, 0xdd0656c9, 0x5b7c384a, 0xd4d7fc14, 0x5c33a9f6, 0xd3986da8,
+    0x718d9974, 0xfe265d2a, 0x76c208c8, 0xf969cc96, 0x7f13a215, 0xf0b8664b,
+    0x785c33a9, 0xf7f7f7f7, 0x6da8efb6, 0xe2032be8, 0x6ae77e0a, 0xe54cba54,
+    0x6336d4d7, 0xec9d1089, 0x6479456b, 0xebd28135
+};
+
+// CRC16 of byte i followed by 0 (low half) or 1 (high half) zero bytes
+static const uint32_t crc16_slice01[256] CRC_TABLE = {
+    0x00000000, 0x9001c0c1, 0x6001c181, 0xf0000140, 0xc002c301, 0x500303c0,
+    0xa0030280, 0x3002c241, 0xc007c601, 0x500606c0, 0xa0060780, 0x3007c741,
+    0x00050500, 0x9004c5c1, 0x6004c481, 0xf0050440, 0xc00dcc01, 0x500c0cc0,
+    0xa00c0d80, 0x300dcd41, 0x000f0f00, 0x900ecfc1, 0x600ece81, 0xf00f0e40,
+    0x000a0a00, 0x900bcac1, 0x600bcb81, 0xf00a0b40, 0xc008c901, 0x500909c0,
+    0xa0090880, 0x3008c841, 0xc019d801, 0x501818c0, 0xa0181980, 0x3019d941,
+    0x001b1b00, 0x901adbc1, 0x601ada81, 0xf01b1a40, 0x001e1e00, 0x901fdec1,
+    0x601fdf81, 0xf01e1f40, 0xc01cdd01, 0x501d1dc0, 0xa01d1c80, 0x301cdc41,
+    0x00141400, 0x9015d4c1, 0x6015d581, 0xf0141540, 0xc016d701, 0x501717c0,
+    0xa0171680, 0x3016d641, 0xc013d201, 0x501212c0, 0xa0121380, 0x3013d341,
+    0x00111100, 0x9010d1c1, 0x6010d081, 0xf0111040, 0xc031f001, 0x503030c0,
+    0xa0303180, 0x3031f141, 0x00333300, 0x9032f3c1, 0x6032f281, 0xf0333240,
+    0x00363600, 0x9037f6c1, 0x6037f781, 0xf0363740, 0xc034f501, 0x503535c0,
+    0xa0353480, 0x3034f441, 0x003c3c00, 0x903dfcc1, 0x603dfd81, 0xf03c3d40,
+    0xc03eff01, 0x503f3fc0, 0xa03f3e80, 0x303efe41, 0xc03bfa01, 0x503a3ac0,
+    0xa03a3b80, 0x303bfb41, 0x00393900, 0x9038f9c1, 0x6038f881, 0xf0393840,
+    0x00282800, 0x9029e8c1, 0x6029e981, 0xf0282940, 0xc02aeb01, 0x502b2bc0,
+    0xa02b2a80, 0x302aea41, 0xc02fee01, 0x502e2ec0, 0xa02e2f80, 0x302fef41,
+    0x002d2d00, 0x902cedc1, 0x602cec81, 0xf02d2c40, 0xc025e401, 0x502424c0,
+    0xa0242580, 0x3025e541, 0x00272700, 0x9026e7c1, 0x6026e681, 0xf0272640,
+    0x00222200, 0x9023e2c1, 0x6023e381, 0xf0222340, 0xc020e101, 0x502121c0,
+    0xa0212080, 0x3020e041, 0xc061a001, 0x506060c0, 0xa0606180, 0x3061a141,
+    0x00636300, 0x9062a3c1, 0x6062a281, 0xf0636240, 0x00666600, 0x9067a6c1,
+    0x6067a781, 0xf0666740, 0xc064a501, 0x506565c0, 0xa0656480, 0x3064a441,
+    0x006c6c00, 0x906dacc1, 0x606dad81, 0xf06c6d40, 0xc06eaf01, 0x506f6fc0,
+    0xa06f6e80, 0x306eae41, 0xc06baa01, 0x506a6ac0, 0xa06a6b80, 0x306bab41,
+    0x00696900, 0x9068a9c1, 0x6068a881, 0xf0696840, 0x00787800, 0x9079b8c1,
+    0x6079b981, 0xf0787940, 0xc07abb01, 0x507b7bc0, 0xa07b7a80, 0x307aba41,
+    0xc07fbe01, 0x507e7ec0, 0xa07e7f80, 0x307fbf41, 0x007d7d00, 0x907cbdc1,
+    0x607cbc81, 0xf07d7c40, 0xc075b401, 0x507474c0, 0xa0747580, 0x3075b541,
+    0x00777700, 0x9076b7c1, 0x6076b681, 0xf0777640, 0x00727200, 0x9073b2c1,
+    0x6073b381, 0xf0727340, 0xc070b101, 0x507171c0, 0xa0717080, 0x3070b041,
+    0x00505000, 0x905190c1, 0x60519181, 0xf0505140, 0xc0529301, 0x505353c0,
+    0xa0535280, 0x30529241, 0xc0579601, 0x505656c0, 0xa0565780, 0x30579741,
+    0x00555500, 0x905495c1, 0x60549481, 0xf0555440, 0xc05d9c01, 0x505c5cc0,
+    0xa05c5d80, 0x305d9d41, 0x005f5f00, 0x905e9fc1, 0x605e9e81, 0xf05f5e40,
+    0x005a5a00, 0x905b9ac1, 0x605b9b81, 0xf05a5b40, 0xc0589901, 0x505959c0,
+    0xa0595880, 0x30589841, 0xc0498801, 0x504848c0, 0xa0484980, 0x30498941,
+    0x004b4b00, 0x904a8bc1, 0x604a8a81, 0xf04b4a40, 0x004e4e00, 0x904f8ec1,
+    0x604f8f81, 0xf04e4f40, 0xc04c8d01, 0x504d4dc0, 0xa04d4c80, 0x304c8c41,
+    0x00444400, 0x904584c1, 0x60458581, 0xf0444540, 0xc0468701, 0x504747c0,
+    0xa0474680, 0x30468641, 0xc0438201, 0x504242c0, 0xa0424380, 0x30438341,
+    0x00414100, 0x904081c1, 0x60408081, 0xf0414040
+};
+
+// CRC16 of byte i followed by 2 (low half) or 3 (high half) zero bytes
+static const uint32_t crc16_slice23[256] CRC_TABLE = {
+    0x00000000, 0xfc01c051, 0xb801c0a1, 0x440000f0, 0x3001c141, 0xcc000110,
+    0x880001e0, 0x7401c1b1, 0x6002c281, 0x9c0302d0, 0xd8030220, 0x2402c271,
+    0x500303c0, 0xac02c391, 0xe802c361, 0x14030330, 0xc004c501, 0x3c050550,
+    0x780505a0, 0x8404c5f1, 0xf0050440, 0x0c04c411, 0x4804c4e1, 0xb40504b0,
+    0xa0060780, 0x5c07c7d1, 0x1807c721, 0xe4060770, 0x9007c6c1, 0x6c060690,
+    0x28060660, 0xd407c631, 0xc00bca01, 0x3c0a0a50, 0x780a0aa0, 0x840bcaf1,
+    0xf00a0b40, 0x0c0bcb11, 0x480bcbe1, 0xb40a0bb0, 0xa0090880, 0x5c08c8d1,
+    0x1808c821, 0xe4090870, 0x9008c9c1, 0x6c090990, 0x28090960, 0xd408c931,
+    0x000f0f00, 0xfc0ecf51, 0xb80ecfa1, 0x440f0ff0, 0x300ece41, 0xcc0f0e10,
+    0x880f0ee0, 0x740eceb1, 0x600dcd81, 0x9c0c0dd0, 0xd80c0d20, 0x240dcd71,
+    0x500c0cc0, 0xac0dcc91, 0xe80dcc61, 0x140c0c30, 0xc015d401, 0x3c141450,
+    0x781414a0, 0x8415d4f1, 0xf0141540, 0x0c15d511, 0x4815d5e1, 0xb41415b0,
+    0xa0171680, 0x5c16d6d1, 0x1816d621, 0xe4171670, 0x9016d7c1, 0x6c171790,
+    0x28171760, 0xd416d731, 0x00111100, 0xfc10d151, 0xb810d1a1, 0x441111f0,
+    0x3010d041, 0xcc111010, 0x881110e0, 0x7410d0b1, 0x6013d381, 0x9c1213d0,
+    0xd8121320, 0x2413d371, 0x501212c0, 0xac13d291, 0xe813d261, 0x14121230,
+    0x001e1e00, 0xfc1fde51, 0xb81fdea1, 0x441e1ef0, 0x301fdf41, 0xcc1e1f10,
+    0x881e1fe0, 0x741fdfb1, 0x601cdc81, 0x9c1d1cd0, 0xd81d1c20, 0x241cdc71,
+    0x501d1dc0, 0xac1cdd91, 0xe81cdd61, 0x141d1d30, 0xc01adb01, 0x3c1b1b50,
+    0x781b1ba0, 0x841adbf1, 0xf01b1a40, 0x0c1ada11, 0x481adae1, 0xb41b1ab0,
+    0xa0181980, 0x5c19d9d1, 0x1819d921, 0xe4181970, 0x9019d8c1, 0x6c181890,
+    0x28181860, 0xd419d831, 0xc029e801, 0x3c282850, 0x782828a0, 0x8429e8f1,
+    0xf0282940, 0x0c29e911, 0x4829e9e1, 0xb42829b0, 0xa02b2a80, 0x5c2aead1,
+    0x182aea21, 0xe42b2a70, 0x902aebc1, 0x6c2b2b90, 0x282b2b60, 0xd42aeb31,
+    0x002d2d00, 0xfc2ced51, 0xb82ceda1, 0x442d2df0, 0x302cec41, 0xcc2d2c10,
+    0x882d2ce0, 0x742cecb1, 0x602fef81, 0x9c2e2fd0, 0xd82e2f20, 0x242fef71,
+    0x502e2ec0, 0xac2fee91, 0xe82fee61, 0x142e2e30, 0x00222200, 0xfc23e251,
+    0xb823e2a1, 0x442222f0, 0x3023e341, 0xcc222310, 0x882223e0, 0x7423e3b1,
+    0x6020e081, 0x9c2120d0, 0xd8212020, 0x2420e071, 0x502121c0, 0xac20e191,
+    0xe820e161, 0x14212130, 0xc026e701, 0x3c272750, 0x782727a0, 0x8426e7f1,
+    0xf0272640, 0x0c26e611, 0x4826e6e1, 0xb42726b0, 0xa0242580, 0x5c25e5d1,
+    0x1825e521, 0xe4242570, 0x9025e4c1, 0x6c242490, 0x28242460, 0xd425e431,
+    0x003c3c00, 0xfc3dfc51, 0xb83dfca1, 0x443c3cf0, 0x303dfd41, 0xcc3c3d10,
+    0x883c3de0, 0x743dfdb1, 0x603efe81, 0x9c3f3ed0, 0xd83f3e20, 0x243efe71,
+    0x503f3fc0, 0xac3eff91, 0xe83eff61, 0x143f3f30, 0xc038f901, 0x3c393950,
+    0x783939a0, 0x8438f9f1, 0xf0393840, 0x0c38f811, 0x4838f8e1, 0xb43938b0,
+    0xa03a3b80, 0x5c3bfbd1, 0x183bfb21, 0xe43a3b70, 0x903bfac1, 0x6c3a3a90,
+    0x283a3a60, 0xd43bfa31, 0xc037f601, 0x3c363650, 0x783636a0, 0x8437f6f1,
+    0xf0363740, 0x0c37f711, 0x4837f7e1, 0xb43637b0, 0xa0353480, 0x5c34f4d1,
+    0x1834f421, 0xe4353470, 0x9034f5c1, 0x6c353590, 0x28353560, 0xd434f531,
+    0x00333300, 0xfc32f351, 0xb832f3a1, 0x443333f0, 0x3032f241, 0xcc333210,
+    0x883332e0, 0x7432f2b1, 0x6031f181, 0x9c3031d0, 0xd8303120, 0x2431f171,
+    0x503030c0, 0xac31f091, 0xe831f061, 0x14303030
+};
+
+CRC_FUNC uint8_t onewire_crc8(const uint8_t *data, uint8_t len) {
+    uint8_t crc = 0;
+
+    while (len >= 4) {
+        crc = (crc8_slice[crc ^ data[0]] >> 24)
+            ^ (crc8_slice[data[1]] >> 16)
+            ^ (crc8_slice[data[2]] >> 8)
+            ^ crc8_slice[data[3]];
+        data += 4;
+        len -= 4;
+    }
+    while (len--) {
+        crc = crc8_slice[crc ^ *data++];
+    }
+    return crc;
+}
+
+CRC_FUNC uint16_t onewire_crc16(const uint8_t* input, size_t len, uint16_t crc_iv) {
+    uint16_t crc = crc_iv;
+
+    while (len >= 4) {
+        crc = (crc16_slice23[(crc ^ input[0]) & 0xff] >> 16)
+            ^ crc16_slice23[((crc >> 8) ^ input[1]) & 0xff]
+            ^ (crc16_slice01[input[2]] >> 16)
+            ^ crc16_slice01[input[3]];
+        input += 4;
+        len -= 4;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ (uint16_t)crc16_slice01[(crc ^ *input++) & 0xff];
+    }
+    return crc;
+}
+
+// CRC-32 of byte i followed by k zero bytes, one table for each k
+static const uint32_t crc32_slice0[256] CRC_TABLE = {
+    0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
+    0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
+    0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
+    0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
+    0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
+    0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
+    0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
+    0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
+    0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
+    0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
+    0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
+    0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
+    0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
+    0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
+    0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
+    0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
+    0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
+    0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
+    0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
+    0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
+    0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
+    0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
+    0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
+    0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
+    0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
+    0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
+    0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
+    0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
+    0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
+    0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
+    0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
+    0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
+    0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
+    0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
+    0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
+    0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
+    0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
+    0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
+    0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
+    0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
+    0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
+    0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
+    0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
+};
+
+static const uint32_t crc32_slice1[256] CRC_TABLE = {
+    0x00000000, 0x191b3141, 0x32366282, 0x2b2d53c3, 0x646cc504, 0x7d77f445,
+    0x565aa786, 0x4f4196c7, 0xc8d98a08, 0xd1c2bb49, 0xfaefe88a, 0xe3f4d9cb,
+    0xacb54f0c, 0xb5ae7e4d, 0x9e832d8e, 0x87981ccf, 0x4ac21251, 0x53d92310,
+    0x78f470d3, 0x61ef4192, 0x2eaed755, 0x37b5e614, 0x1c98b5d7, 0x05838496,
+    0x821b9859, 0x9b00a918, 0xb02dfadb, 0xa936cb9a, 0xe6775d5d, 0xff6c6c1c,
+    0xd4413fdf, 0xcd5a0e9e, 0x958424a2, 0x8c9f15e3, 0xa7b24620, 0xbea97761,
+    0xf1e8e1a6, 0xe8f3d0e7, 0xc3de8324, 0xdac5b265, 0x5d5daeaa, 0x44469feb,
+    0x6f6bcc28, 0x7670fd69, 0x39316bae, 0x202a5aef, 0x0b07092c, 0x121c386d,
+    0xdf4636f3, 0xc65d07b2, 0xed705471, 0xf46b6530, 0xbb2af3f7, 0xa231c2b6,
+    0x891c9175, 0x9007a034, 0x179fbcfb, 0x0e848dba, 0x25a9de79, 0x3cb2ef38,
+    0x73f379ff, 0x6ae848be, 0x41c51b7d, 0x58de2a3c, 0xf0794f05, 0xe9627e44,
+    0xc24f2d87, 0xdb541cc6, 0x94158a01, 0x8d0ebb40, 0xa623e883, 0xbf38d9c2,
+    0x38a0c50d, 0x21bbf44c, 0x0a96a78f, 0x138d96ce, 0x5ccc0009, 0x45d73148,
+    0x6efa628b, 0x77e153ca, 0xbabb5d54, 0xa3a06c15, 0x888d3fd6, 0x91960e97,
+    0xded79850, 0xc7cca911, 0xece1fad2, 0xf5facb93, 0x7262d75c, 0x6b79e61d,
+    0x4054b5de, 0x594f849f, 0x160e1258, 0x0f152319, 0x243870da, 0x3d23419b,
+    0x65fd6ba7, 0x7ce65ae6, 0x57cb0925, 0x4ed03864, 0x0191aea3, 0x188a9fe2,
+    0x33a7cc21, 0x2abcfd60, 0xad24e1af, 0xb43fd0ee, 0x9f12832d, 0x8609b26c,
+    0xc94824ab, 0xd05315ea, 0xfb7e4629, 0xe2657768, 0x2f3f79f6, 0x362448b7,
+    0x1d091b74, 0x04122a35, 0x4b53bcf2, 0x52488db3, 0x7965de70, 0x607eef31,
+    0xe7e6f3fe, 0xfefdc2bf, 0xd5d0917c, 0xcccba03d, 0x838a36fa, 0x9a9107bb,
+    0xb1bc5478, 0xa8a76539, 0x3b83984b, 0x2298a90a, 0x09b5fac9, 0x10aecb88,
+    0x5fef5d4f, 0x46f46c0e, 0x6dd93fcd, 0x74c20e8c, 0xf35a1243, 0xea412302,
+    0xc16c70c1, 0xd8774180, 0x9736d747, 0x8e2de606, 0xa500b5c5, 0xbc1b8484,
+    0x71418a1a, 0x685abb5b, 0x4377e898, 0x5a6cd9d9, 0x152d4f1e, 0x0c367e5f,
+    0x271b2d9c, 0x3e001cdd, 0xb9980012, 0xa0833153, 0x8bae6290, 0x92b553d1,
+    0xddf4c516, 0xc4eff457, 0xefc2a794, 0xf6d996d5, 0xae07bce9, 0xb71c8da8,
+    0x9c31de6b, 0x852aef2a, 0xca6b79ed, 0xd37048ac, 0xf85d1b6f, 0xe1462a2e,
+    0x66de36e1, 0x7fc507a0, 0x54e85463, 0x4df36522, 0x02b2f3e5, 0x1ba9c2a4,
+    0x30849167, 0x299fa026, 0xe4c5aeb8, 0xfdde9ff9, 0xd6f3cc3a, 0xcfe8fd7b,
+    0x80a96bbc, 0x99b25afd, 0xb29f093e, 0xab84387f, 0x2c1c24b0, 0x350715f1,
+    0x1e2a4632, 0x07317773, 0x4870e1b4, 0x516bd0f5, 0x7a468336, 0x635db277,
+    0xcbfad74e, 0xd2e1e60f, 0xf9ccb5cc, 0xe0d7848d, 0xaf96124a, 0xb68d230b,
+    0x9da070c8, 0x84bb4189, 0x03235d46, 0x1a386c07, 0x31153fc4, 0x280e0e85,
+    0x674f9842, 0x7e54a903, 0x5579fac0, 0x4c62cb81, 0x8138c51f, 0x9823f45e,
+    0xb30ea79d, 0xaa1596dc, 0xe554001b, 0xfc4f315a, 0xd7626299, 0xce7953d8,
+    0x49e14f17, 0x50fa7e56, 0x7bd72d95, 0x62cc1cd4, 0x2d8d8a13, 0x3496bb52,
+    0x1fbbe891, 0x06a0d9d0, 0x5e7ef3ec, 0x4765c2ad, 0x6c48916e, 0x7553a02f,
+    0x3a1236e8, 0x230907a9, 0x0824546a, 0x113f652b, 0x96a779e4, 0x8fbc48a5,
+    0xa4911b66, 0xbd8a2a27, 0xf2cbbce0, 0xebd08da1, 0xc0fdde62, 0xd9e6ef23,
+    0x14bce1bd, 0x0da7d0fc, 0x268a833f, 0x3f91b27e, 0x70d024b9, 0x69cb15f8,
+    0x42e6463b, 0x5bfd777a, 0xdc656bb5, 0xc57e5af4, 0xee530937, 0xf7483876,
+    0xb809aeb1, 0xa1129ff0, 0x8a3fcc33, 0x9324fd72
+};
+
+static const uint32_t crc32_slice2[256] CRC_TABLE = {
+    0x00000000, 0x01c26a37, 0x0384d46e, 0x0246be59, 0x0709a8dc, 0x06cbc2eb,
+    0x048d7cb2, 0x054f1685, 0x0e1351b8, 0x0fd13b8f, 0x0d9785d6, 0x0c55efe1,
+    0x091af964, 0x08d89353, 0x0a9e2d0a, 0x0b5c473d, 0x1c26a370, 0x1de4c947,
+    0x1fa2771e, 0x1e601d29, 0x1b2f0bac, 0x1aed619b, 0x18abdfc2, 0x1969b5f5,
+    0x1235f2c8, 0x13f798ff, 0x11b126a6, 0x10734c91, 0x153c5a14, 0x14fe3023,
+    0x16b88e7a, 0x177ae44d, 0x384d46e0, 0x398f2cd7, 0x3bc9928e, 0x3a0bf8b9,
+    0x3f44ee3c, 0x3e86840b, 0x3cc03a52, 0x3d025065, 0x365e1758, 0x379c7d6f,
+    0x35dac336, 0x3418a901, 0x3157bf84, 0x3095d5b3, 0x32d36bea, 0x331101dd,
+    0x246be590, 0x25a98fa7, 0x27ef31fe, 0x262d5bc9, 0x23624d4c, 0x22a0277b,
+    0x20e69922, 0x2124f315, 0x2a78b428, 0x2bbade1f, 0x29fc6046, 0x283e0a71,
+    0x2d711cf4, 0x2cb376c3, 0x2ef5c89a, 0x2f37a2ad, 0x709a8dc0, 0x7158e7f7,
+    0x731e59ae, 0x72dc3399, 0x7793251c, 0x76514f2b, 0x7417f172, 0x75d59b45,
+    0x7e89dc78, 0x7f4bb64f, 0x7d0d0816, 0x7ccf6221, 0x798074a4, 0x78421e93,
+    0x7a04a0ca, 0x7bc6cafd, 0x6cbc2eb0, 0x6d7e4487, 0x6f38fade, 0x6efa90e9,
+    0x6bb5866c, 0x6a77ec5b, 0x68315202, 0x69f33835, 0x62af7f08, 0x636d153f,
+    0x612bab66, 0x60e9c151, 0x65a6d7d4, 0x6464bde3, 0x662203ba, 0x67e0698d,
+    0x48d7cb20, 0x4915a117, 0x4b531f4e, 0x4a917579, 0x4fde63fc, 0x4e1c09cb,
+    0x4c5ab792, 0x4d98dda5, 0x46c49a98, 0x4706f0af, 0x45404ef6, 0x448224c1,
+    0x41cd3244, 0x400f5873, 0x4249e62a, 0x438b8c1d, 0x54f16850, 0x55330267,
+    0x5775bc3e, 0x56b7d609, 0x53f8c08c, 0x523aaabb, 0x507c14e2, 0x51be7ed5,
+    0x5ae239e8, 0x5b2053df, 0x5966ed86, 0x58a487b1, 0x5deb9134, 0x5c29fb03,
+    0x5e6f455a, 0x5fad2f6d, 0xe1351b80, 0xe0f771b7, 0xe2b1cfee, 0xe373a5d9,
+    0xe63cb35c, 0xe7fed96b, 0xe5b86732, 0xe47a0d05, 0xef264a38, 0xeee4200f,
+    0xeca29e56, 0xed60f461, 0xe82fe2e4, 0xe9ed88d3, 0xebab368a, 0xea695cbd,
+    0xfd13b8f0, 0xfcd1d2c7, 0xfe976c9e, 0xff5506a9, 0xfa1a102c, 0xfbd87a1b,
+    0xf99ec442, 0xf85cae75, 0xf300e948, 0xf2c2837f, 0xf0843d26, 0xf1465711,
+    0xf4094194, 0xf5cb2ba3, 0xf78d95fa, 0xf64fffcd, 0xd9785d60, 0xd8ba3757,
+    0xdafc890e, 0xdb3ee339, 0xde71f5bc, 0xdfb39f8b, 0xddf521d2, 0xdc374be5,
+    0xd76b0cd8, 0xd6a966ef, 0xd4efd8b6, 0xd52db281, 0xd062a404, 0xd1a0ce33,
+    0xd3e6706a, 0xd2241a5d, 0xc55efe10, 0xc49c9427, 0xc6da2a7e, 0xc7184049,
+    0xc25756cc, 0xc3953cfb, 0xc1d382a2, 0xc011e895, 0xcb4dafa8, 0xca8fc59f,
+    0xc8c97bc6, 0xc90b11f1, 0xcc440774, 0xcd866d43, 0xcfc0d31a, 0xce02b92d,
+    0x91af9640, 0x906dfc77, 0x922b422e, 0x93e92819, 0x96a63e9c, 0x976454ab,
+    0x9522eaf2, 0x94e080c5, 0x9fbcc7f8, 0x9e7eadcf, 0x9c381396, 0x9dfa79a1,
+    0x98b56f24, 0x99770513, 0x9b31bb4a, 0x9af3d17d, 0x8d893530, 0x8c4b5f07,
+    0x8e0de15e, 0x8fcf8b69, 0x8a809dec, 0x8b42f7db, 0x89044982, 0x88c623b5,
+    0x839a6488, 0x82580ebf, 0x801eb0e6, 0x81dcdad1, 0x8493cc54, 0x8551a663,
+    0x8717183a, 0x86d5720d, 0xa9e2d0a0, 0xa820ba97, 0xaa6604ce, 0xaba46ef9,
+    0xaeeb787c, 0xaf29124b, 0xad6fac12, 0xacadc625, 0xa7f18118, 0xa633eb2f,
+    0xa4755576, 0xa5b73f41, 0xa0f829c4, 0xa13a43f3, 0xa37cfdaa, 0xa2be979d,
+    0xb5c473d0, 0xb40619e7, 0xb640a7be, 0xb782cd89, 0xb2cddb0c, 0xb30fb13b,
+    0xb1490f62, 0xb08b6555, 0xbbd72268, 0xba15485f, 0xb853f606, 0xb9919c31,
+    0xbcde8ab4, 0xbd1ce083, 0xbf5a5eda, 0xbe9834ed
+};
+
+static const uint32_t crc32_slice3[256] CRC_TABLE = {
+    0x00000000, 0xb8bc6765, 0xaa09c88b, 0x12b5afee, 0x8f629757, 0x37def032,
+    0x256b5fdc, 0x9dd738b9, 0xc5b428ef, 0x7d084f8a, 0x6fbde064, 0xd7018701,
+    0x4ad6bfb8, 0xf26ad8dd, 0xe0df7733, 0x58631056, 0x5019579f, 0xe8a530fa,
+    0xfa109f14, 0x42acf871, 0xdf7bc0c8, 0x67c7a7ad, 0x75720843, 0xcdce6f26,
+    0x95ad7f70, 0x2d111815, 0x3fa4b7fb, 0x8718d09e, 0x1acfe827, 0xa2738f42,
+    0xb0c620ac, 0x087a47c9, 0xa032af3e, 0x188ec85b, 0x0a3b67b5, 0xb28700d0,
+    0x2f503869, 0x97ec5f0c, 0x8559f0e2, 0x3de59787, 0x658687d1, 0xdd3ae0b4,
+    0xcf8f4f5a, 0x7733283f, 0xeae41086, 0x525877e3, 0x40edd80d, 0xf851bf68,
+    0xf02bf8a1, 0x48979fc4, 0x5a22302a, 0xe29e574f, 0x7f496ff6, 0xc7f50893,
+    0xd540a77d, 0x6dfcc018, 0x359fd04e, 0x8d23b72b, 0x9f9618c5, 0x272a7fa0,
+    0xbafd4719, 0x0241207c, 0x10f48f92, 0xa848e8f7, 0x9b14583d, 0x23a83f58,
+    0x311d90b6, 0x89a1f7d3, 0x1476cf6a, 0xaccaa80f, 0xbe7f07e1, 0x06c36084,
+    0x5ea070d2, 0xe61c17b7, 0xf4a9b859, 0x4c15df3c, 0xd1c2e785, 0x697e80e0,
+    0x7bcb2f0e, 0xc377486b, 0xcb0d0fa2, 0x73b168c7, 0x6104c729, 0xd9b8a04c,
+    0x446f98f5, 0xfcd3ff90, 0xee66507e, 0x56da371b, 0x0eb9274d, 0xb6054028,
+    0xa4b0efc6, 0x1c0c88a3, 0x81dbb01a, 0x3967d77f, 0x2bd27891, 0x936e1ff4,
+    0x3b26f703, 0x839a9066, 0x912f3f88, 0x299358ed, 0xb4446054, 0x0cf80731,
+    0x1e4da8df, 0xa6f1cfba, 0xfe92dfec, 0x462eb889, 0x549b1767, 0xec277002,
+    0x71f048bb, 0xc94c2fde, 0xdbf98030, 0x6345e755, 0x6b3fa09c, 0xd383c7f9,
+    0xc1366817, 0x798a0f72, 0xe45d37cb, 0x5ce150ae, 0x4e54ff40, 0xf6e89825,
+    0xae8b8873, 0x1637ef16, 0x048240f8, 0xbc3e279d, 0x21e91f24, 0x99557841,
+    0x8be0d7af, 0x335cb0ca, 0xed59b63b, 0x55e5d15e, 0x47507eb0, 0xffec19d5,
+    0x623b216c, 0xda874609, 0xc832e9e7, 0x708e8e82, 0x28ed9ed4, 0x9051f9b1,
+    0x82e4565f, 0x3a58313a, 0xa78f0983, 0x1f336ee6, 0x0d86c108, 0xb53aa66d,
+    0xbd40e1a4, 0x05fc86c1, 0x1749292f, 0xaff54e4a, 0x322276f3, 0x8a9e1196,
+    0x982bbe78, 0x2097d91d, 0x78f4c94b, 0xc048ae2e, 0xd2fd01c0, 0x6a4166a5,
+    0xf7965e1c, 0x4f2a3979, 0x5d9f9697, 0xe523f1f2, 0x4d6b1905, 0xf5d77e60,
+    0xe762d18e, 0x5fdeb6eb, 0xc2098e52, 0x7ab5e937, 0x680046d9, 0xd0bc21bc,
+    0x88df31ea, 0x3063568f, 0x22d6f961, 0x9a6a9e04, 0x07bda6bd, 0xbf01c1d8,
+    0xadb46e36, 0x15080953, 0x1d724e9a, 0xa5ce29ff, 0xb77b8611, 0x0fc7e174,
+    0x9210d9cd, 0x2aacbea8, 0x38191146, 0x80a57623, 0xd8c66675, 0x607a0110,
+    0x72cfaefe, 0xca73c99b, 0x57a4f122, 0xef189647, 0xfdad39a9, 0x45115ecc,
+    0x764dee06, 0xcef18963, 0xdc44268d, 0x64f841e8, 0xf92f7951, 0x41931e34,
+    0x5326b1da, 0xeb9ad6bf, 0xb3f9c6e9, 0x0b45a18c, 0x19f00e62, 0xa14c6907,
+    0x3c9b51be, 0x842736db, 0x96929935, 0x2e2efe50, 0x2654b999, 0x9ee8defc,
+    0x8c5d7112, 0x34e11677, 0xa9362ece, 0x118a49ab, 0x033fe645, 0xbb838120,
+    0xe3e09176, 0x5b5cf613, 0x49e959fd, 0xf1553e98, 0x6c820621, 0xd43e6144,
+    0xc68bceaa, 0x7e37a9cf, 0xd67f4138, 0x6ec3265d, 0x7c7689b3, 0xc4caeed6,
+    0x591dd66f, 0xe1a1b10a, 0xf3141ee4, 0x4ba87981, 0x13cb69d7, 0xab770eb2,
+    0xb9c2a15c, 0x017ec639, 0x9ca9fe80, 0x241599e5, 0x36a0360b, 0x8e1c516e,
+    0x866616a7, 0x3eda71c2, 0x2c6fde2c, 0x94d3b949, 0x090481f0, 0xb1b8e695,
+    0xa30d497b, 0x1bb12e1e, 0x43d23e48, 0xfb6e592d, 0xe9dbf6c3, 0x516791a6,
+    0xccb0a91f, 0x740cce7a, 0x66b96194, 0xde0506f1
+};
+
+CRC_FUNC uint32_t onewire_crc32(const uint8_t *data, size_t len, uint32_t crc) {
+    crc = ~crc;
+    while (len >= 4) {
+        crc ^= data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+        crc = crc32_slice3[crc & 0xff]
+            ^ crc32_slice2[(crc >> 8) & 0xff]
+            ^ crc32_slice1[(crc >> 16) & 0xff]
+            ^ crc32_slice0[crc >> 24];
+        data += 4;
+        len -= 4;
+    }
+    while (len--) {
+        crc = (crc >> 8) ^ crc32_slice0[(crc ^ *data++) & 0xff];
+    }
+    return ~crc;
+}
+
+#else
+#error "Unknown ONEWIRE_CRC_METHOD"
+#endif
+
+// Compute the 1-Wire CRC16 and compare it against the received CRC.
+// Example usage (reading a DS2408):
+//    // Put everything in a buffer so we can compute the CRC easily.
+//    uint8_t buf[13];
+//    buf[0] = 0xF0;    // Read PIO Registers
+//    buf[1] = 0x88;    // LSB address
+//    buf[2] = 0x00;    // MSB address
+//    WriteBytes(net, buf, 3);    // Write 3 cmd bytes
+//    ReadBytes(net, buf+3, 10);  // Read 6 data bytes, 2 0xFF, 2 CRC16
+//    if (!CheckCRC16(buf, 11, &buf[11])) {
+//        // Handle error.
+//    }     
+//          
+// @param input - Array of bytes to checksum.
+// @param len - How many bytes to use.
+// @param inverted_crc - The two CRC16 bytes in the received data.
+//                       This should just point into the received data,
+//                       *not* at a 16-bit integer.
+// @param crc - The crc starting value (optional)
+// @return 1, iff the CRC matches.
+bool onewire_check_crc16(const uint8_t* input, size_t len, const uint8_t* inverted_crc, uint16_t crc_iv) {
+    uint16_t crc = ~onewire_crc16(input, len, crc_iv);
+    return (crc & 0xFF) == inverted_crc[0] && (crc >> 8) == inverted_crc[1];
+}
@@ -0,0 +1,9 @@
+/* Host test stand-in for FreeRTOS.h, onewire.h only needs the basic types */
+#ifndef _STUB_FREERTOS_H
+#define _STUB_FREERTOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#endif
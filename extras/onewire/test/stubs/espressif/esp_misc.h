@@ -0,0 +1,9 @@
+/* Host test stand-in for espressif/esp_misc.h */
+#ifndef _STUB_ESP_MISC_H
+#define _STUB_ESP_MISC_H
+
+#include <stdint.h>
+
+void sdk_os_delay_us(uint16_t us);
+
+#endif
@@ -0,0 +1,162 @@
+/* Host test for the 1-Wire CRC routines.
+ *
+ * Built once for each ONEWIRE_CRC_METHOD. Each build is checked against
+ * known values and against a plain bit by bit CRC, on every length and
+ * alignment up to 300 bytes and on 200000 random buffers. The same goes
+ * for the zlib CRC-32 the OTA code uses.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "../onewire_crc.c"
+
+#define RANDOM_BUFFERS 200000
+
+/* The CRCs as defined in Maxim AN27, one bit at a time */
+static uint8_t ref_crc8(const uint8_t *data, size_t len)
+{
+    uint8_t crc = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        for (int b = 0; b < 8; b++) {
+            int mix = (crc ^ (data[i] >> b)) & 1;
+            crc >>= 1;
+            if (mix)
+                crc ^= 0x8c;
+        }
+    }
+    return crc;
+}
+
+static uint16_t ref_crc16(const uint8_t *data, size_t len, uint16_t crc)
+{
+    for (size_t i = 0; i < len; i++) {
+        for (int b = 0; b < 8; b++) {
+            int mix = (crc ^ (data[i] >> b)) & 1;
+            crc >>= 1;
+            if (mix)
+                crc ^= 0xa001;
+        }
+    }
+    return crc;
+}
+
+/* The CRC-32 as zlib's crc32() */
+static uint32_t ref_crc32(const uint8_t *data, size_t len, uint32_t crc)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        for (int b = 0; b < 8; b++) {
+            int mix = (crc ^ (data[i] >> b)) & 1;
+            crc >>= 1;
+            if (mix)
+                crc ^= 0xedb88320;
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t rand_state = 0x12345678;
+
+static uint32_t xorshift(void)
+{
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+    return rand_state;
+}
+
+int test_known_values(void)
+{
+    /* ROM code example from AN27, and the usual "123456789" check values */
+    static const uint8_t rom[8] = { 0x02, 0x1c, 0xb8, 0x01, 0x00, 0x00, 0x00, 0xa2 };
+    static const uint8_t check_str[] = "123456789";
+
+    check(onewire_crc8(rom, 7) == 0xa2);
+    check(onewire_crc8(rom, 8) == 0);
+    check(onewire_crc8(check_str, 9) == 0xa1);
+    check(onewire_crc16(check_str, 9, 0) == 0xbb3d);
+    check(onewire_crc8(rom, 0) == 0);
+    check(onewire_crc16(rom, 0, 0x1234) == 0x1234);
+    check(onewire_crc32(check_str, 9, 0) == 0xcbf43926);
+    check(onewire_crc32(check_str + 5, 4, onewire_crc32(check_str, 5, 0)) == 0xcbf43926);
+    check(onewire_crc32(rom, 0, 0x1234) == 0x1234);
+    done();
+}
+
+int test_check_crc16(void)
+{
+    uint8_t buf[13] = { 0xf0, 0x88, 0x00, 1, 2, 3, 4, 5, 6, 0xff, 0xff };
+    uint16_t crc = ~ref_crc16(buf, 11, 0);
+
+    buf[11] = crc & 0xff;
+    buf[12] = crc >> 8;
+    check(onewire_check_crc16(buf, 11, &buf[11], 0));
+    buf[5] ^= 0x10;
+    check(!onewire_check_crc16(buf, 11, &buf[11], 0));
+    done();
+}
+
+/* Every length up to 300 bytes (255 for crc8, which takes a uint8_t
+   length) at every alignment, so the 4-byte paths and the tails meet
+   all cases */
+int test_lengths(void)
+{
+    static uint8_t buf[304] __attribute__((aligned(4)));
+
+    for (size_t i = 0; i < sizeof(buf); i++)
+        buf[i] = xorshift();
+    for (int offset = 0; offset < 4; offset++) {
+        for (size_t len = 0; len <= 300; len++) {
+            const uint8_t *p = buf + offset;
+            if (len <= 255)
+                check(onewire_crc8(p, len) == ref_crc8(p, len));
+            check(onewire_crc16(p, len, 0) == ref_crc16(p, len, 0));
+            check(onewire_crc16(p, len, 0xffff) == ref_crc16(p, len, 0xffff));
+            check(onewire_crc32(p, len, 0) == ref_crc32(p, len, 0));
+        }
+    }
+    done();
+}
+
+int test_random(void)
+{
+    static uint8_t buf[260];
+
+    for (int n = 0; n < RANDOM_BUFFERS; n++) {
+        size_t len = xorshift() % 256;
+        size_t offset = xorshift() % 4;
+        uint32_t iv = xorshift();
+        for (size_t i = 0; i < len; i++)
+            buf[offset + i] = xorshift();
+        if (onewire_crc8(buf + offset, len) != ref_crc8(buf + offset, len)) {
+            printf("crc8 differs for buffer %d (%u bytes)\n", n, (unsigned)len);
+            fail();
+        }
+        if (onewire_crc16(buf + offset, len, iv) != ref_crc16(buf + offset, len, iv)) {
+            printf("crc16 differs for buffer %d (%u bytes)\n", n, (unsigned)len);
+            fail();
+        }
+        if (onewire_crc32(buf + offset, len, iv) != ref_crc32(buf + offset, len, iv)) {
+            printf("crc32 differs for buffer %d (%u bytes)\n", n, (unsigned)len);
+            fail();
+        }
+    }
+    done();
+}
+
+int main(void)
+{
+    printf("ONEWIRE_CRC_METHOD %d\n", ONEWIRE_CRC_METHOD);
+    test(test_known_values, "known CRC values");
+    test(test_check_crc16, "onewire_check_crc16");
+    test(test_lengths, "all lengths and alignments");
+    test(test_random, "random buffers");
+    printf("\nPASSED: %d\nFAILED: %d\n", test_passed, test_failed);
+    return (test_failed > 0);
+}
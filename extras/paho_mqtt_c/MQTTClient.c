@@ -15,6 +15,7 @@
  *******************************************************************************/
 #include <espressif/esp_common.h>
 #include <lwip/arch.h>
+#include <string.h>
 #include "MQTTClient.h"
 
 void  NewMessageData(MessageData* md, MQTTString* aTopicName, MQTTMessage* aMessgage) {
@@ -51,61 +52,82 @@ int  sendPacket(MQTTClient* c, int length, Timer* timer)
 }
 
 
-int  decodePacket(MQTTClient* c, int* value, int timeout)
+// Length of the packet at the start of readbuf, from its fixed header.
+// Returns 0 if more data is needed to tell, or -1 if the header is malformed.
+static int packetLength(MQTTClient* c)
 {
-    unsigned char i;
-    int multiplier = 1;
-    int len = 0;
     const int MAX_NO_OF_REMAINING_LENGTH_BYTES = 4;
+    int rem_len = 0;
+    int multiplier = 1;
+    int i;
 
-    *value = 0;
-    do
+    for (i = 1; i < c->readbuf_len; ++i)
     {
-        int rc = MQTTPACKET_READ_ERROR;
-
-        if (++len > MAX_NO_OF_REMAINING_LENGTH_BYTES)
-        {
-            rc = MQTTPACKET_READ_ERROR; /* bad data */
-            goto exit;
-        }
-        rc = c->ipstack->mqttread(c->ipstack, &i, 1, timeout);
-        if (rc != 1)
-        {
-		    goto exit;
-        }
-        *value += (i & 127) * multiplier;
+        if (i > MAX_NO_OF_REMAINING_LENGTH_BYTES)
+            return -1;  /* bad data */
+        rem_len += (c->readbuf[i] & 127) * multiplier;
         multiplier *= 128;
-    } while ((i & 128) != 0);
-exit:
-    return len;
+        if ((c->readbuf[i] & 128) == 0)
+            return 1 + i + rem_len;
+    }
+    return 0;
 }
 
 
-// Return packet type. If no packet avilable, return FAILURE, or READ_ERROR if timeout
+// Return packet type. If no packet avilable, return FAILURE, or READ_ERROR if the connection failed.
+// Data is read from the network in chunks as large as readbuf allows, and any
+// data after the packet is kept for the next call. The packet stays at the start
+// of readbuf until the next call.
 int  readPacket(MQTTClient* c, Timer* timer)
 {
-    int rc = FAILURE;
     MQTTHeader header = {0};
-    int len = 0;
-    int rem_len = 0;
+    int len;
+    int rc;
 
-    /* 1. read the header byte.  This has the packet type in it */
-    if (c->ipstack->mqttread(c->ipstack, c->readbuf, 1, left_ms(timer)) != 1)
-        goto exit;
-    len = 1;
-    /* 2. read the remaining length.  This is variable in itself */
-    decodePacket(c, &rem_len, left_ms(timer));
-    len += MQTTPacket_encode(c->readbuf + 1, rem_len); /* put the original remaining length back into the buffer */
-    /* 3. read the rest of the buffer using a callback to supply the rest of the data */
-    if (rem_len > 0 && (c->ipstack->mqttread(c->ipstack, c->readbuf + len, rem_len, left_ms(timer)) != rem_len))
+    /* drop the packet handled last time, keep anything received after it */
+    if (c->packet_len)
     {
-        rc = READ_ERROR;
-        goto exit;
+        c->readbuf_len -= c->packet_len;
+        memmove(c->readbuf, c->readbuf + c->packet_len, c->readbuf_len);
+        c->packet_len = 0;
+    }
+
+    while (1)
+    {
+        if (c->discard_len)
+        {
+            /* skip the rest of a packet too big for readbuf */
+            len = (c->discard_len < c->readbuf_len) ? c->discard_len : c->readbuf_len;
+            c->readbuf_len -= len;
+            memmove(c->readbuf, c->readbuf + len, c->readbuf_len);
+            c->discard_len -= len;
+        }
+        else
+        {
+            len = packetLength(c);
+            if (len < 0)
+                return READ_ERROR;
+            if (len > 0 && len <= c->readbuf_len)
+            {
+                c->packet_len = len;
+                header.byte = c->readbuf[0];
+                return header.bits.type;
+            }
+            if (len > c->readbuf_size)
+            {
+                c->discard_len = len;
+                continue;
+            }
+        }
+
+        /* need more data, take as much as has arrived */
+        rc = c->ipstack->mqttread(c->ipstack, c->readbuf + c->readbuf_len, c->readbuf_size - c->readbuf_len, left_ms(timer));
+        if (rc < 0)
+            return READ_ERROR;
+        if (rc == 0)
+            return FAILURE;
+        c->readbuf_len += rc;
     }
-    header.byte = c->readbuf[0];
-    rc = header.bits.type;
-exit:
-    return rc;
 }
 
 
@@ -173,6 +195,43 @@ int  deliverMessage(MQTTClient* c, MQTTString* topicName, MQTTMessage* message)
 }
 
 
+static int findInFlight(MQTTClient* c, unsigned short id)
+{
+    int i;
+    for (i = 0; i < MAX_INFLIGHT_MESSAGES; ++i)
+    {
+        if (c->inflight[i].state != 0 && c->inflight[i].id == id)
+            return i;
+    }
+    return -1;
+}
+
+
+static void completeInFlight(MQTTClient* c, int i, int rc)
+{
+    c->inflight[i].state = 0;
+    if (c->inflight[i].wait)
+    {
+        c->inflight[i].done = 1;
+        c->inflight[i].rc = rc;
+    }
+    if (c->inflight[i].fp != NULL)
+        c->inflight[i].fp(c->inflight[i].id, rc);
+}
+
+
+// fail in-flight publishes that timed out, or all of them if the connection is gone
+static void expireInFlight(MQTTClient* c, int all)
+{
+    int i;
+    for (i = 0; i < MAX_INFLIGHT_MESSAGES; ++i)
+    {
+        if (c->inflight[i].state != 0 && (all || expired(&c->inflight[i].timer)))
+            completeInFlight(c, i, FAILURE);
+    }
+}
+
+
 int  keepalive(MQTTClient* c)
 {
     int rc = SUCCESS;
@@ -214,6 +273,8 @@ exit:
 }
 
 
+// Handle at most one packet, waiting for it until timer expires. Replies are
+// sent with the command timeout, so they still go out when timer has expired.
 int cycle(MQTTClient* c, Timer* timer)
 {
     // read the socket, see what work is due
@@ -221,13 +282,31 @@ int cycle(MQTTClient* c, Timer* timer)
 
     int len = 0,
         rc = SUCCESS;
+    Timer send_timer;
+
+    InitTimer(&send_timer);
+    countdown_ms(&send_timer, c->command_timeout_ms);
 
     switch (packet_type)
     {
         case CONNACK:
-        case PUBACK:
         case SUBACK:
             break;
+        case PUBACK:
+        case PUBCOMP:
+        {
+            unsigned short mypacketid;
+            unsigned char dup, type;
+            int i;
+            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) == 1
+                && (i = findInFlight(c, mypacketid)) >= 0)
+            {
+                // We still can receive from broker, treat as recoverable
+                c->fail_count = 0;
+                completeInFlight(c, i, SUCCESS);
+            }
+            break;
+        }
         case PUBLISH:
         {
             MQTTString topicName;
@@ -245,7 +324,7 @@ int cycle(MQTTClient* c, Timer* timer)
                 if (len <= 0)
                     rc = FAILURE;
                 else
-                    rc = sendPacket(c, len, timer);
+                    rc = sendPacket(c, len, &send_timer);
                 if (rc == FAILURE)
                     goto exit; // there was a problem
             }
@@ -255,18 +334,34 @@ int cycle(MQTTClient* c, Timer* timer)
         {
             unsigned short mypacketid;
             unsigned char dup, type;
+            int i;
             if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
                 rc = FAILURE;
             else if ((len = MQTTSerialize_ack(c->buf, c->buf_size, PUBREL, 0, mypacketid)) <= 0)
                 rc = FAILURE;
-            else if ((rc = sendPacket(c, len, timer)) != SUCCESS) // send the PUBREL packet
+            else if ((rc = sendPacket(c, len, &send_timer)) != SUCCESS) // send the PUBREL packet
                 rc = FAILURE; // there was a problem
             if (rc == FAILURE)
                 goto exit; // there was a problem
+            if ((i = findInFlight(c, mypacketid)) >= 0)
+                c->inflight[i].state = PUBCOMP;
             break;
         }
-        case PUBCOMP:
+        case PUBREL:
+        {
+            // second half of an incoming QoS2 publish
+            unsigned short mypacketid;
+            unsigned char dup, type;
+            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
+                rc = FAILURE;
+            else if ((len = MQTTSerialize_ack(c->buf, c->buf_size, PUBCOMP, 0, mypacketid)) <= 0)
+                rc = FAILURE;
+            else if ((rc = sendPacket(c, len, &send_timer)) != SUCCESS) // send the PUBCOMP packet
+                rc = FAILURE; // there was a problem
+            if (rc == FAILURE)
+                goto exit; // there was a problem
             break;
+        }
         case PINGRESP:
         {
             c->ping_outstanding = 0;
@@ -281,7 +376,14 @@ int cycle(MQTTClient* c, Timer* timer)
         }
     }
     if (c->isconnected)
+    {
         rc = keepalive(c);
+        if (rc == DISCONNECTED)
+            c->isconnected = 0;
+        expireInFlight(c, rc == DISCONNECTED);
+    }
+    else
+        expireInFlight(c, 1);
 exit:
     if (rc == SUCCESS)
         rc = packet_type;
@@ -306,6 +408,14 @@ void  NewMQTTClient(MQTTClient* c, Network* network, unsigned int command_timeou
     c->fail_count = 0;
     c->defaultMessageHandler = NULL;
     InitTimer(&(c->ping_timer));
+    c->readbuf_len = 0;
+    c->packet_len = 0;
+    c->discard_len = 0;
+    for (i = 0; i < MAX_INFLIGHT_MESSAGES; ++i)
+    {
+        c->inflight[i].state = 0;
+        c->inflight[i].wait = 0;
+    }
 }
 
 
@@ -314,21 +424,64 @@ int  MQTTYield(MQTTClient* c, int timeout_ms)
     int rc = SUCCESS;
     Timer timer;
 
+    if (!c->isconnected)
+        return DISCONNECTED;
+
     InitTimer(&timer);
     countdown_ms(&timer, timeout_ms);
-    while (!expired(&timer))
+    do
     {
         rc = cycle(c, &timer);
-        // cycle could return 0 or packet_type or 65535 if nothing is read
-        // cycle returns DISCONNECTED only if keepalive() fails.
+        // cycle could return 0 or packet_type or FAILURE if nothing is read
+        // cycle returns DISCONNECTED if keepalive() fails or the connection is gone
         if (rc == DISCONNECTED)
             break;
+        if (rc == FAILURE && timeout_ms == 0)
+        {
+            rc = SUCCESS;
+            break;  // nothing more already received, don't wait for more
+        }
         rc = SUCCESS;
-    }
+    } while (!expired(&timer));
     return rc;
 }
 
 
+int  MQTTProcess(MQTTClient* c)
+{
+    int rc;
+    Timer timer;
+
+    if (!c->isconnected)
+        return DISCONNECTED;
+
+    InitTimer(&timer);  // already expired, only take what has arrived
+    do
+    {
+        rc = cycle(c, &timer);
+    }
+    while (rc > 0);     // a packet was handled, there may be more
+
+    return (rc == DISCONNECTED) ? DISCONNECTED : SUCCESS;
+}
+
+
+int  MQTTNextTimeout(MQTTClient* c)
+{
+    int ms = -1;
+    int i;
+
+    if (c->keepAliveInterval != 0)
+        ms = left_ms(&c->ping_timer);
+    for (i = 0; i < MAX_INFLIGHT_MESSAGES; ++i)
+    {
+        if (c->inflight[i].state != 0 && (ms < 0 || left_ms(&c->inflight[i].timer) < ms))
+            ms = left_ms(&c->inflight[i].timer);
+    }
+    return ms;
+}
+
+
 // only used in single-threaded mode where one command at a time is in process
 int  waitfor(MQTTClient* c, int packet_type, Timer* timer)
 {
@@ -338,8 +491,11 @@ int  waitfor(MQTTClient* c, int packet_type, Timer* timer)
     {
         if (expired(timer))
             break; // we timed out
+        rc = cycle(c, timer);
+        if (rc == DISCONNECTED)
+            break; // the connection is gone, don't spin until the timeout
     }
-    while ((rc = cycle(c, timer)) != packet_type);
+    while (rc != packet_type);
 
     return rc;
 }
@@ -361,6 +517,11 @@ int  MQTTConnect(MQTTClient* c, MQTTPacket_connectData* options)
     if (options == 0)
         options = &default_options; // set default options if none were supplied
 
+    // new connection, drop anything left over from the last one
+    c->readbuf_len = 0;
+    c->packet_len = 0;
+    c->discard_len = 0;
+
     c->keepAliveInterval = options->keepAliveInterval;
     countdown(&(c->ping_timer), c->keepAliveInterval);
 
@@ -472,13 +633,17 @@ exit:
 }
 
 
-int  MQTTPublish(MQTTClient* c, const char* topic, MQTTMessage* message)
+// Send a publish. For QoS1/2 *slot is set to its in-flight slot, which is
+// kept for the caller to wait on if wait is set.
+static int publish(MQTTClient* c, const char* topic, MQTTMessage* message, publishCompleteHandler handler,
+                   int wait, int* slot)
 {
     int rc = FAILURE;
     Timer timer;
     MQTTString topicStr = MQTTString_initializer;
     topicStr.cstring = (char *)topic;
     int len = 0;
+    int i = 0;
 
     InitTimer(&timer);
     countdown_ms(&timer, c->command_timeout_ms);
@@ -487,53 +652,78 @@ int  MQTTPublish(MQTTClient* c, const char* topic, MQTTMessage* message)
         goto exit;
 
     if (message->qos == QOS1 || message->qos == QOS2)
+    {
+        // find a free in-flight slot
+        for (i = 0; i < MAX_INFLIGHT_MESSAGES; ++i)
+        {
+            if (c->inflight[i].state == 0 && !c->inflight[i].wait)
+                break;
+        }
+        if (i == MAX_INFLIGHT_MESSAGES)
+            goto exit;
         message->id = getNextPacketId(c);
+    }
 
     len = MQTTSerialize_publish(c->buf, c->buf_size, 0, message->qos, message->retained, message->id, 
               topicStr, (unsigned char*)message->payload, message->payloadlen);
     if (len <= 0)
         goto exit;
-    if ((rc = sendPacket(c, len, &timer)) != SUCCESS) // send the subscribe packet
+    if ((rc = sendPacket(c, len, &timer)) != SUCCESS) // send the publish packet
     {
         goto exit; // there was a problem
     }
 
-    if (message->qos == QOS1)
+    if (message->qos == QOS1 || message->qos == QOS2)
     {
-        if (waitfor(c, PUBACK, &timer) == PUBACK)
-        {
-            // We still can receive from broker, treat as recoverable
-            c->fail_count = 0;
-            unsigned short mypacketid;
-            unsigned char dup, type;
-            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
-                rc = FAILURE;
-            else
-                rc = SUCCESS;
-        }
-        else
-        {
-            rc = FAILURE;
-        }
-
+        c->inflight[i].id = message->id;
+        c->inflight[i].state = (message->qos == QOS1) ? PUBACK : PUBREC;
+        c->inflight[i].fp = handler;
+        c->inflight[i].wait = wait;
+        c->inflight[i].done = 0;
+        InitTimer(&c->inflight[i].timer);
+        countdown_ms(&c->inflight[i].timer, c->command_timeout_ms);
+        *slot = i;
     }
-    else if (message->qos == QOS2)
+
+exit:
+    return rc;
+}
+
+
+int  MQTTPublishAsync(MQTTClient* c, const char* topic, MQTTMessage* message, publishCompleteHandler handler)
+{
+    int slot;
+    return publish(c, topic, message, handler, 0, &slot);
+}
+
+
+int  MQTTPublish(MQTTClient* c, const char* topic, MQTTMessage* message)
+{
+    int rc = FAILURE;
+    Timer timer;
+    int i;
+
+    InitTimer(&timer);
+    countdown_ms(&timer, c->command_timeout_ms);
+
+    if ((rc = publish(c, topic, message, NULL, 1, &i)) != SUCCESS)
+        goto exit;
+
+    if (message->qos == QOS1 || message->qos == QOS2)
     {
-        if (waitfor(c, PUBCOMP, &timer) == PUBCOMP)
+        // wait for our own PUBACK/PUBCOMP, other publishes may complete
+        // (or expire) in the same cycles
+        while (!c->inflight[i].done && !expired(&timer))
         {
-            // We still can receive from broker, treat as recoverable
-            c->fail_count = 0;
-            unsigned short mypacketid;
-            unsigned char dup, type;
-            if (MQTTDeserialize_ack(&type, &dup, &mypacketid, c->readbuf, c->readbuf_size) != 1)
-                rc = FAILURE;
-            else
-                rc = SUCCESS;
+            if (cycle(c, &timer) == DISCONNECTED)
+                break;
         }
+        if (c->inflight[i].done)
+            rc = c->inflight[i].rc;
         else
-        {
             rc = FAILURE;
-        }
+        // if still in flight it completes without us, with no handler
+        c->inflight[i].wait = 0;
     }
 
 exit:
@@ -554,6 +744,7 @@ int  MQTTDisconnect(MQTTClient* c)
         rc = sendPacket(c, len, &timer);            // send the disconnect packet
 
     c->isconnected = 0;
+    expireInFlight(c, 1);
     return rc;
 }
 
@@ -23,6 +23,7 @@
 #define MAX_PACKET_ID 65535
 #define MAX_MESSAGE_HANDLERS 5
 #define MAX_FAIL_ALLOWED  2
+#define MAX_INFLIGHT_MESSAGES 5
 
 enum QoS { QOS0, QOS1, QOS2 };
 
@@ -49,6 +50,9 @@ typedef struct _MessageData
 
 typedef void (*messageHandler)(MessageData*);
 
+// called when a QoS1/2 publish completes (rc SUCCESS) or fails (rc FAILURE)
+typedef void (*publishCompleteHandler)(unsigned short id, int rc);
+
 struct _MQTTClient
 {
     unsigned int next_packetid;
@@ -71,6 +75,21 @@ struct _MQTTClient
 
     Network* ipstack;
     Timer ping_timer;
+
+    size_t readbuf_len;     // bytes received into readbuf, may be more than one packet
+    size_t packet_len;      // length of the packet at the start of readbuf being handled
+    size_t discard_len;     // bytes still to be skipped of a packet too big for readbuf
+
+    struct InFlight
+    {
+        unsigned short id;
+        unsigned char state;
+        publishCompleteHandler fp;
+        Timer timer;
+        unsigned char wait;     // MQTTPublish() is waiting for it, the slot stays taken until it has the result
+        unsigned char done;
+        int rc;
+    } inflight[MAX_INFLIGHT_MESSAGES];      // outgoing QoS1/2 publishes waiting for PUBACK/PUBCOMP
 };
 
 
@@ -82,8 +101,30 @@ int MQTTPublish(MQTTClient* c, const char* topic, MQTTMessage* message);
 int MQTTSubscribe(MQTTClient* c, const char* topic, enum QoS qos, messageHandler handler);
 int MQTTUnsubscribe(MQTTClient* c, const char* topic);
 int MQTTDisconnect(MQTTClient* c);
+// Handle incoming packets for up to timeout_ms. With timeout_ms 0, only handles
+// packets already received and returns without blocking. Returns DISCONNECTED
+// as soon as the connection fails.
 int MQTTYield(MQTTClient* c, int timeout_ms);
 
+// Event driven operation, for a task that waits on several sockets with
+// select() instead of calling MQTTYield(). Call MQTTProcess() when the socket
+// (c->ipstack->my_socket) is readable, and when MQTTNextTimeout() ms have
+// passed. It handles everything that has arrived, sends keepalive pings and
+// times out publishes, without waiting for the network. Returns SUCCESS or
+// DISCONNECTED.
+int MQTTProcess(MQTTClient* c);
+
+// Time in ms until MQTTProcess() has to be called for the keepalive ping or a
+// publish timeout, or -1 if there is nothing to time.
+int MQTTNextTimeout(MQTTClient* c);
+
+// Send a publish without waiting for the broker to acknowledge it. For QoS1/2,
+// message->id is set and handler (optional) is called from MQTTYield once the
+// PUBACK/PUBCOMP arrives, or with FAILURE if it doesn't arrive within the command
+// timeout or the connection drops. Up to MAX_INFLIGHT_MESSAGES can be outstanding,
+// returns FAILURE if there are already that many.
+int MQTTPublishAsync(MQTTClient* c, const char* topic, MQTTMessage* message, publishCompleteHandler handler);
+
 void NewMQTTClient(MQTTClient*, Network*, unsigned int, unsigned char*, size_t, unsigned char*, size_t);
 
 #define DefaultClient {0, 0, 0, 0, NULL, NULL, 0, 0, 0}
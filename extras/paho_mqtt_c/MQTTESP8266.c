@@ -25,6 +25,7 @@
 #include <lwip/netdb.h>
 #include <lwip/sys.h>
 #include <string.h>
+#include <errno.h>
 
 #include "MQTTESP8266.h"
 
@@ -32,7 +33,7 @@ char  expired(Timer* timer)
 {
     portTickType now = xTaskGetTickCount();
     int32_t left = timer->end_time - now;
-    return (left < 0);
+    return (left <= 0);
 }
 
 
@@ -53,7 +54,7 @@ int  left_ms(Timer* timer)
 {
     portTickType now = xTaskGetTickCount();
     int32_t left = timer->end_time - now;
-    return (left < 0) ? 0 : left / portTICK_RATE_MS;
+    return (left < 0) ? 0 : left * portTICK_RATE_MS;
 }
 
 
@@ -70,19 +71,33 @@ int  mqtt_esp_read(Network* n, unsigned char* buffer, int len, int timeout_ms)
     fd_set fdset;
     int rc = 0;
     int rcvd = 0;
-    FD_ZERO(&fdset);
-    FD_SET(n->my_socket, &fdset);
-    // It seems tv_sec actually means FreeRTOS tick
-    tv.tv_sec = timeout_ms / portTICK_RATE_MS;
-    tv.tv_usec = 0;
-    rc = select(n->my_socket + 1, &fdset, 0, 0, &tv);
-    if ((rc > 0) && (FD_ISSET(n->my_socket, &fdset)))
+    if (timeout_ms > 0)
     {
-        rcvd = recv(n->my_socket, buffer, len, 0);
+        FD_ZERO(&fdset);
+        FD_SET(n->my_socket, &fdset);
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = (timeout_ms % 1000) * 1000;
+        rc = select(n->my_socket + 1, &fdset, 0, 0, &tv);
+        if (rc == 0)
+        {
+            // nothing arrived in time
+            return 0;
+        }
+        if ((rc < 0) || !FD_ISSET(n->my_socket, &fdset))
+        {
+            // select fail
+            return -1;
+        }
     }
-    else
+    // take whatever has arrived, up to len, in one go
+    rcvd = recv(n->my_socket, buffer, len, MSG_DONTWAIT);
+    if (rcvd < 0)
     {
-        // select fail
+        return (errno == EWOULDBLOCK || errno == EAGAIN) ? 0 : -1;
+    }
+    if (rcvd == 0)
+    {
+        // connection closed by peer
         return -1;
     }
     return rcvd;
@@ -97,9 +112,8 @@ int  mqtt_esp_write(Network* n, unsigned char* buffer, int len, int timeout_ms)
 
     FD_ZERO(&fdset);
     FD_SET(n->my_socket, &fdset);
-    // It seems tv_sec actually means FreeRTOS tick
-    tv.tv_sec = timeout_ms / portTICK_RATE_MS;
-    tv.tv_usec = 0;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
     rc = select(n->my_socket + 1, 0, &fdset, 0, &tv);
     if ((rc > 0) && (FD_ISSET(n->my_socket, &fdset)))
     {
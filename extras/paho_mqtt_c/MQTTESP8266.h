@@ -47,6 +47,10 @@ int left_ms(Timer*);
 
 void InitTimer(Timer*);
 
+/* Read whatever data is available, up to len bytes, waiting up to
+   timeout_ms for some to arrive (0 doesn't wait at all.) Returns the
+   number of bytes read, 0 if there was nothing to read, or -1 if the
+   connection failed or was closed. */
 int mqtt_esp_read(Network*, unsigned char*, int, int);
 int mqtt_esp_write(Network*, unsigned char*, int, int);
 void mqtt_esp_disconnect(Network*);
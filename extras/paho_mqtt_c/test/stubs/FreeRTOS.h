@@ -0,0 +1,13 @@
+/* Host test stand-in for the FreeRTOS headers used by paho_mqtt_c */
+#ifndef _STUB_FREERTOS_H
+#define _STUB_FREERTOS_H
+
+#include <stdint.h>
+
+typedef uint32_t portTickType;
+#define portTICK_RATE_MS 10
+
+/* 10ms ticks of the host's monotonic clock, see test_mqtt.c */
+portTickType xTaskGetTickCount(void);
+
+#endif
@@ -0,0 +1,2 @@
+/* Host test stand-in, see sockets.h */
+#include <arpa/inet.h>
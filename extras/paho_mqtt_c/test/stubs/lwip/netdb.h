@@ -0,0 +1,2 @@
+/* Host test stand-in, see sockets.h */
+#include <netdb.h>
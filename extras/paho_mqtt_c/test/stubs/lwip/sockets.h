@@ -0,0 +1,5 @@
+/* Host test stand-in: the host's BSD sockets have the same API as lwip's */
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <unistd.h>
@@ -0,0 +1 @@
+/* Host test stand-in, nothing needed from lwip/sys.h */
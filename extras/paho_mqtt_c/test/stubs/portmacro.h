@@ -0,0 +1 @@
+/* Host test stand-in, see FreeRTOS.h */
@@ -0,0 +1,541 @@
+/* Host test for the MQTT client.
+ *
+ * The client talks over a socket pair, through the same MQTTESP8266.c
+ * network code as on the device, to a broker stand-in running in another
+ * thread. The broker answers CONNECT, SUBSCRIBE, PUBLISH and PINGREQ, and
+ * can push publishes to the client in chunks of any size, hold back acks
+ * and send them out of order, or drop the connection.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+
+#include "test.h"
+#include "MQTTClient.h"
+
+#define COMMAND_TIMEOUT_MS 3000
+
+static unsigned now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+portTickType xTaskGetTickCount(void)
+{
+    return now_ms() / portTICK_RATE_MS;
+}
+
+/* Broker stand-in */
+
+static struct {
+    int fd;
+    pthread_t thread;
+    /* behaviour, set before broker_start() */
+    int push_count;         /* publishes sent to the client after SUBACK */
+    int push_chunk;         /* bytes per write of those, 0 for all in one */
+    int push_big;           /* start with a publish too big for readbuf */
+    int ack_batch;          /* hold back acks until this many publishes */
+    int no_ack;             /* don't ack publishes at all */
+    int ack_skip;           /* don't ack this many publishes, then ack */
+    int drop_on;            /* close the connection on this packet type */
+    /* what it received, read after broker_stop() */
+    int received[16];
+    unsigned short held[MAX_INFLIGHT_MESSAGES];
+    unsigned char held_type[MAX_INFLIGHT_MESSAGES];
+    int held_count;
+} broker;
+
+static int write_all(int fd, const unsigned char *buf, int len)
+{
+    while (len > 0) {
+        int n = write(fd, buf, len);
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, unsigned char *buf, int len)
+{
+    while (len > 0) {
+        int n = read(fd, buf, len);
+        if (n <= 0) {
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Read one packet into buf, returns its type or -1 when the client has gone */
+static int broker_read(unsigned char *buf, int *len)
+{
+    int rem_len = 0, multiplier = 1;
+    unsigned char b;
+
+    if (read_all(broker.fd, buf, 1) < 0) {
+        return -1;
+    }
+    *len = 1;
+    do {
+        if (read_all(broker.fd, &b, 1) < 0) {
+            return -1;
+        }
+        buf[(*len)++] = b;
+        rem_len += (b & 127) * multiplier;
+        multiplier *= 128;
+    } while (b & 128);
+    if (read_all(broker.fd, buf + *len, rem_len) < 0) {
+        return -1;
+    }
+    *len += rem_len;
+    return buf[0] >> 4;
+}
+
+static void broker_ack(unsigned char type, unsigned short id)
+{
+    unsigned char buf[4];
+    int len = MQTTSerialize_ack(buf, sizeof(buf), type, 0, id);
+    write_all(broker.fd, buf, len);
+}
+
+/* Payload of the n'th pushed publish */
+static void push_payload(char *payload, int n)
+{
+    sprintf(payload, "message %d", n);
+}
+
+static void broker_push(void)
+{
+    static unsigned char buf[8192];
+    static char big[300];
+    MQTTString topic = MQTTString_initializer;
+    char payload[32];
+    int len = 0;
+
+    topic.cstring = "a/b";
+    if (broker.push_big) {
+        memset(big, 'x', sizeof(big));
+        len += MQTTSerialize_publish(buf, sizeof(buf), 0, 0, 0, 0, topic,
+                                     (unsigned char *)big, sizeof(big));
+    }
+    for (int n = 0; n < broker.push_count; n++) {
+        push_payload(payload, n);
+        len += MQTTSerialize_publish(buf + len, sizeof(buf) - len, 0, n % 3, 0, n + 1, topic,
+                                     (unsigned char *)payload, strlen(payload));
+    }
+    if (!broker.push_chunk) {
+        write_all(broker.fd, buf, len);
+        return;
+    }
+    for (int pos = 0; pos < len; pos += broker.push_chunk) {
+        int n = (len - pos < broker.push_chunk) ? len - pos : broker.push_chunk;
+        write_all(broker.fd, buf + pos, n);
+        usleep(100);
+    }
+}
+
+static void *broker_run(void *arg)
+{
+    unsigned char buf[1024];
+    unsigned char reply[8];
+    int len, type;
+
+    while ((type = broker_read(buf, &len)) >= 0) {
+        broker.received[type]++;
+        if (type == broker.drop_on) {
+            break;
+        }
+        switch (type) {
+        case CONNECT:
+            reply[0] = CONNACK << 4;
+            reply[1] = 2;
+            reply[2] = 0;
+            reply[3] = 0;
+            write_all(broker.fd, reply, 4);
+            break;
+        case SUBSCRIBE:
+            /* packet id follows the fixed header, granted QoS is 2 */
+            reply[0] = SUBACK << 4;
+            reply[1] = 3;
+            reply[2] = buf[2];
+            reply[3] = buf[3];
+            reply[4] = 2;
+            write_all(broker.fd, reply, 5);
+            broker_push();
+            break;
+        case PUBLISH: {
+            unsigned char dup, retained, *payload;
+            unsigned short id;
+            int qos, payloadlen;
+            MQTTString topic;
+            MQTTDeserialize_publish(&dup, &qos, &retained, &id, &topic, &payload, &payloadlen, buf, len);
+            if (qos == 0 || broker.no_ack) {
+                break;
+            }
+            if (broker.ack_skip) {
+                broker.ack_skip--;
+                break;
+            }
+            if (broker.ack_batch) {
+                broker.held[broker.held_count] = id;
+                broker.held_type[broker.held_count++] = (qos == 1) ? PUBACK : PUBREC;
+                if (broker.held_count == broker.ack_batch) {
+                    /* all at once, newest first */
+                    while (broker.held_count--) {
+                        broker_ack(broker.held_type[broker.held_count], broker.held[broker.held_count]);
+                    }
+                    broker.ack_batch = 0;
+                }
+                break;
+            }
+            broker_ack((qos == 1) ? PUBACK : PUBREC, id);
+            break;
+        }
+        case PUBREC:
+            broker_ack(PUBREL, (buf[2] << 8) | buf[3]);
+            break;
+        case PUBREL:
+            broker_ack(PUBCOMP, (buf[2] << 8) | buf[3]);
+            break;
+        case PINGREQ:
+            reply[0] = PINGRESP << 4;
+            reply[1] = 0;
+            write_all(broker.fd, reply, 2);
+            break;
+        }
+    }
+    close(broker.fd);
+    return NULL;
+}
+
+/* Client */
+
+static MQTTClient client;
+static Network network;
+static unsigned char sendbuf[200], readbuf[100];
+static int reads;
+
+static int counting_read(Network *n, unsigned char *buf, int len, int timeout_ms)
+{
+    reads++;
+    return mqtt_esp_read(n, buf, len, timeout_ms);
+}
+
+/* Start the broker and connect the client to it, the broker's behaviour
+   has been set in `broker` */
+static int broker_start(int keepalive)
+{
+    MQTTPacket_connectData data = MQTTPacket_connectData_initializer;
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+        return -1;
+    }
+    broker.fd = fds[1];
+    pthread_create(&broker.thread, NULL, broker_run, NULL);
+
+    NewNetwork(&network);
+    network.my_socket = fds[0];
+    network.mqttread = counting_read;
+    NewMQTTClient(&client, &network, COMMAND_TIMEOUT_MS, sendbuf, sizeof(sendbuf), readbuf, sizeof(readbuf));
+    data.MQTTVersion = 3;
+    data.clientID.cstring = "test";
+    data.keepAliveInterval = keepalive;
+    return MQTTConnect(&client, &data);
+}
+
+static void broker_stop(void)
+{
+    close(network.my_socket);
+    pthread_join(broker.thread, NULL);
+}
+
+static void broker_reset(void)
+{
+    memset(&broker, 0, sizeof(broker));
+    broker.drop_on = -1;
+}
+
+static char delivered[64][32];
+static int delivered_qos[64];
+static int delivered_count;
+
+static void on_message(MessageData *md)
+{
+    MQTTMessage *m = md->message;
+    if (delivered_count < 64 && m->payloadlen < sizeof(delivered[0])) {
+        memcpy(delivered[delivered_count], m->payload, m->payloadlen);
+        delivered[delivered_count][m->payloadlen] = 0;
+        delivered_qos[delivered_count++] = m->qos;
+    }
+}
+
+static unsigned short completed_id[16];
+static int completed_rc[16];
+static int completed_count;
+
+static void on_complete(unsigned short id, int rc)
+{
+    completed_id[completed_count] = id;
+    completed_rc[completed_count++] = rc;
+}
+
+static int check_delivered(int count)
+{
+    char payload[32];
+
+    check(delivered_count == count);
+    for (int n = 0; n < count; n++) {
+        push_payload(payload, n);
+        check(!strcmp(delivered[n], payload));
+        check(delivered_qos[n] == n % 3);
+    }
+    done();
+}
+
+/* Publishes pushed by the broker are delivered in order and acked, however
+   the stream is split */
+static int check_subscribe(int chunk, int big)
+{
+    unsigned start;
+    int r;
+
+    broker_reset();
+    broker.push_count = 30;
+    broker.push_chunk = chunk;
+    broker.push_big = big;
+    delivered_count = 0;
+    check(broker_start(0) == SUCCESS);
+    check(MQTTSubscribe(&client, "a/#", QOS2, on_message) == SUCCESS);
+    start = now_ms();
+    while (delivered_count < 30 && now_ms() - start < 2000) {
+        check(MQTTYield(&client, 100) == SUCCESS);
+    }
+    /* let the last PUBCOMP go out */
+    check(MQTTYield(&client, 50) == SUCCESS);
+    broker_stop();
+    r = check_delivered(30);
+    if (r) {
+        return r;
+    }
+    check(broker.received[PUBACK] == 10);
+    check(broker.received[PUBREC] == 10);
+    check(broker.received[PUBCOMP] == 10);
+    done();
+}
+
+static int test_subscribe_coalesced(void)
+{
+    return check_subscribe(0, 0);
+}
+
+static int test_subscribe_split(void)
+{
+    int r = check_subscribe(1, 0);
+    if (r) {
+        return r;
+    }
+    return check_subscribe(7, 0);
+}
+
+static int test_subscribe_oversized(void)
+{
+    /* the 300 byte publish doesn't fit readbuf and is skipped */
+    int r = check_subscribe(0, 1);
+    if (r) {
+        return r;
+    }
+    return check_subscribe(13, 1);
+}
+
+/* Several publishes in flight, acked by the broker in reverse order */
+static int test_pipelined_publish(void)
+{
+    MQTTMessage m[MAX_INFLIGHT_MESSAGES + 1];
+    unsigned start;
+
+    broker_reset();
+    broker.ack_batch = MAX_INFLIGHT_MESSAGES;
+    completed_count = 0;
+    check(broker_start(0) == SUCCESS);
+    for (int i = 0; i <= MAX_INFLIGHT_MESSAGES; i++) {
+        m[i].qos = (i & 1) ? QOS2 : QOS1;
+        m[i].retained = 0;
+        m[i].payload = "data";
+        m[i].payloadlen = 4;
+        check(MQTTPublishAsync(&client, "a/b", &m[i], on_complete) ==
+              ((i < MAX_INFLIGHT_MESSAGES) ? SUCCESS : FAILURE));
+    }
+    start = now_ms();
+    while (completed_count < MAX_INFLIGHT_MESSAGES && now_ms() - start < 2000) {
+        check(MQTTYield(&client, 100) == SUCCESS);
+    }
+    check(completed_count == MAX_INFLIGHT_MESSAGES);
+    /* each one once; acked newest first, but QoS2 ones only complete
+       after the PUBREL/PUBCOMP round trip */
+    for (int i = 0; i < MAX_INFLIGHT_MESSAGES; i++) {
+        int found = 0;
+        for (int j = 0; j < completed_count; j++) {
+            if (completed_id[j] == m[i].id) {
+                check(completed_rc[j] == SUCCESS);
+                found++;
+            }
+        }
+        check(found == 1);
+    }
+    check(completed_id[0] == m[MAX_INFLIGHT_MESSAGES - 1].id);
+
+    /* and a blocking one once the slots are free */
+    m[0].qos = QOS2;
+    check(MQTTPublish(&client, "a/b", &m[0]) == SUCCESS);
+    broker_stop();
+    check(broker.received[PUBLISH] == MAX_INFLIGHT_MESSAGES + 1);
+    done();
+}
+
+/* A blocking publish gets its own result when another one expires in the
+   same cycle that handles its PUBACK */
+static int test_publish_with_expiry(void)
+{
+    MQTTMessage a = { QOS1, 0, 0, 0, "a", 1 };
+    MQTTMessage b = { QOS1, 0, 0, 0, "b", 1 };
+    unsigned start;
+
+    broker_reset();
+    broker.ack_skip = 1;
+    completed_count = 0;
+    check(broker_start(0) == SUCCESS);
+    client.command_timeout_ms = 200;
+    check(MQTTPublishAsync(&client, "a/b", &a, on_complete) == SUCCESS);
+    /* a expires while nothing runs the client, b's PUBACK comes at once */
+    usleep(300000);
+    start = now_ms();
+    check(MQTTPublish(&client, "a/b", &b) == SUCCESS);
+    check(now_ms() - start < 100);
+    check(completed_count == 1);
+    check(completed_id[0] == a.id && completed_rc[0] == FAILURE);
+
+    /* the slots are free again */
+    for (int i = 0; i < MAX_INFLIGHT_MESSAGES; i++) {
+        check(client.inflight[i].state == 0 && !client.inflight[i].wait);
+    }
+    check(MQTTPublish(&client, "a/b", &b) == SUCCESS);
+    broker_stop();
+    check(broker.received[PUBLISH] == 3);
+    done();
+}
+
+/* A dead connection is reported straight away, not after the timeouts */
+static int test_dead_connection(void)
+{
+    MQTTMessage m = { QOS1, 0, 0, 0, "data", 4 };
+    unsigned start;
+
+    broker_reset();
+    broker.no_ack = 1;
+    broker.drop_on = SUBSCRIBE;
+    completed_count = 0;
+    check(broker_start(0) == SUCCESS);
+    check(MQTTPublishAsync(&client, "a/b", &m, on_complete) == SUCCESS);
+
+    reads = 0;
+    start = now_ms();
+    check(MQTTSubscribe(&client, "a/#", QOS1, on_message) == FAILURE);
+    check(now_ms() - start < COMMAND_TIMEOUT_MS / 2);
+    check(reads < 10);
+    check(completed_count == 1 && completed_rc[0] == FAILURE);
+
+    start = now_ms();
+    check(MQTTYield(&client, COMMAND_TIMEOUT_MS) == DISCONNECTED);
+    check(MQTTProcess(&client) == DISCONNECTED);
+    check(MQTTPublish(&client, "a/b", &m) == FAILURE);
+    check(now_ms() - start < 100);
+    broker_stop();
+    done();
+}
+
+/* Waiting for data blocks in select(), it doesn't poll */
+static int test_idle_wait(void)
+{
+    unsigned start, elapsed;
+
+    broker_reset();
+    check(broker_start(0) == SUCCESS);
+    reads = 0;
+    start = now_ms();
+    check(MQTTYield(&client, 300) == SUCCESS);
+    elapsed = now_ms() - start;
+    broker_stop();
+    check(elapsed >= 280 && elapsed < 400);
+    check(reads <= 3);
+    done();
+}
+
+/* Driven from select() with MQTTProcess() and MQTTNextTimeout(), including
+   the keepalive pings */
+static int test_event_driven(void)
+{
+    int processed = 0;
+    unsigned start;
+
+    broker_reset();
+    broker.push_count = 10;
+    broker.push_chunk = 5;
+    delivered_count = 0;
+    check(broker_start(1) == SUCCESS);
+    check(MQTTSubscribe(&client, "a/#", QOS2, on_message) == SUCCESS);
+
+    start = now_ms();
+    while (now_ms() - start < 2500) {
+        int timeout = MQTTNextTimeout(&client);
+        struct timeval tv;
+        fd_set fds;
+
+        check(timeout >= 0 && timeout <= 1000);
+        FD_ZERO(&fds);
+        FD_SET(network.my_socket, &fds);
+        tv.tv_sec = timeout / 1000;
+        tv.tv_usec = (timeout % 1000) * 1000;
+        select(network.my_socket + 1, &fds, NULL, NULL, &tv);
+        check(MQTTProcess(&client) == SUCCESS);
+        processed++;
+    }
+    broker_stop();
+    check(check_delivered(10) == 0);
+    check(broker.received[PINGREQ] >= 2);
+    check(client.fail_count == 0);
+    /* woken for data and pings, not spinning */
+    check(processed < 200);
+    done();
+}
+
+int main(void)
+{
+    signal(SIGPIPE, SIG_IGN);
+    test(test_subscribe_coalesced, "publishes in one read");
+    test(test_subscribe_split, "publishes split across reads");
+    test(test_subscribe_oversized, "publish too big for readbuf");
+    test(test_pipelined_publish, "pipelined publishes");
+    test(test_publish_with_expiry, "blocking publish while another expires");
+    test(test_dead_connection, "dead connection");
+    test(test_idle_wait, "idle wait");
+    test(test_event_driven, "event driven");
+    printf("\nPASSED: %d\nFAILED: %d\n", test_passed, test_failed);
+    return (test_failed > 0);
+}
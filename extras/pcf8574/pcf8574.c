@@ -1,54 +1,66 @@
 #include "pcf8574.h"
-#include <i2c/i2c.h>
 
-uint8_t pcf8574_port_read(uint8_t addr)
+uint8_t pcf8574_port_read_bus(i2c_bus_t *bus, uint8_t addr)
 {
-    i2c_start();
-    uint8_t res = i2c_write((addr << 1) | 1) ? i2c_read(1) : 0;
-    i2c_stop();
-    return res;
+    uint8_t res;
+    return i2c_bus_slave_read(bus, addr, &res, 1) ? res : 0;
 }
 
-size_t pcf8574_port_read_buf(uint8_t addr, void *buf, size_t len)
+size_t pcf8574_port_read_buf_bus(i2c_bus_t *bus, uint8_t addr, void *buf, size_t len)
 {
     if (!len || !buf) return 0;
-    uint8_t *_buf = (uint8_t *)buf;
-
-    i2c_start();
-    if (!i2c_write((addr << 1) | 1)) return 0;
-    for (size_t i = 0; i < len; i++)
-        *_buf++ = i2c_read(i == len - 1);
-    i2c_stop();
-    return len;
+    return i2c_bus_slave_read(bus, addr, buf, len) ? len : 0;
 }
 
-size_t pcf8574_port_write_buf(uint8_t addr, void *buf, size_t len)
+size_t pcf8574_port_write_buf_bus(i2c_bus_t *bus, uint8_t addr, void *buf, size_t len)
 {
     if (!len || !buf) return 0;
-    uint8_t *_buf = (uint8_t *)buf;
+    return i2c_bus_slave_write(bus, addr, buf, len) ? len : 0;
+}
+
+void pcf8574_port_write_bus(i2c_bus_t *bus, uint8_t addr, uint8_t value)
+{
+    i2c_bus_slave_write(bus, addr, &value, 1);
+}
+
+bool pcf8574_gpio_read_bus(i2c_bus_t *bus, uint8_t addr, uint8_t num)
+{
+    return (bool)((pcf8574_port_read_bus(bus, addr) >> num) & 1);
+}
+
+void pcf8574_gpio_write_bus(i2c_bus_t *bus, uint8_t addr, uint8_t num, bool value)
+{
+    uint8_t bit = (uint8_t)value << num;
+    uint8_t mask = ~(1 << num);
+    pcf8574_port_write_bus(bus, addr, (pcf8574_port_read_bus(bus, addr) & mask) | bit);
+}
+
+uint8_t pcf8574_port_read(uint8_t addr)
+{
+    return pcf8574_port_read_bus(NULL, addr);
+}
+
+size_t pcf8574_port_read_buf(uint8_t addr, void *buf, size_t len)
+{
+    return pcf8574_port_read_buf_bus(NULL, addr, buf, len);
+}
 
-    i2c_start();
-    if (!i2c_write(addr << 1)) return 0;
-    for (size_t i = 0; i < len; i++)
-        i2c_write(*_buf++);
-    return len;
+size_t pcf8574_port_write_buf(uint8_t addr, void *buf, size_t len)
+{
+    return pcf8574_port_write_buf_bus(NULL, addr, buf, len);
 }
 
 void pcf8574_port_write(uint8_t addr, uint8_t value)
 {
-    i2c_start();
-    if (i2c_write(addr << 1)) i2c_write(value);
-    i2c_stop();
+    pcf8574_port_write_bus(NULL, addr, value);
 }
 
 bool pcf8574_gpio_read(uint8_t addr, uint8_t num)
 {
-    return (bool)((pcf8574_port_read(addr) >> num) & 1);
+    return pcf8574_gpio_read_bus(NULL, addr, num);
 }
 
 void pcf8574_gpio_write(uint8_t addr, uint8_t num, bool value)
 {
-    uint8_t bit = (uint8_t)value << num;
-    uint8_t mask = ~(1 << num);
-    pcf8574_port_write (addr, (pcf8574_port_read(addr) & mask) | bit);
+    pcf8574_gpio_write_bus(NULL, addr, num, value);
 }
@@ -8,6 +8,7 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <i2c/i2c.h>
 
 #ifdef __cplusplus
 extern "C"
@@ -64,6 +65,17 @@ bool pcf8574_gpio_read(uint8_t addr, uint8_t num);
  */
 void pcf8574_gpio_write(uint8_t addr, uint8_t num, bool value);
 
+/*
+ * The same operations on a bus set up with i2c_bus_init(). The functions
+ * above use the bus set up by i2c_init(), which bus NULL selects here too.
+ */
+uint8_t pcf8574_port_read_bus(i2c_bus_t *bus, uint8_t addr);
+size_t pcf8574_port_read_buf_bus(i2c_bus_t *bus, uint8_t addr, void *buf, size_t len);
+void pcf8574_port_write_bus(i2c_bus_t *bus, uint8_t addr, uint8_t value);
+size_t pcf8574_port_write_buf_bus(i2c_bus_t *bus, uint8_t addr, void *buf, size_t len);
+bool pcf8574_gpio_read_bus(i2c_bus_t *bus, uint8_t addr, uint8_t num);
+void pcf8574_gpio_write_bus(i2c_bus_t *bus, uint8_t addr, uint8_t num, bool value);
+
 #ifdef __cplusplus
 }
 #endif
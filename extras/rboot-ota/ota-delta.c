@@ -0,0 +1,324 @@
+/* Delta/compressed OTA image decoder
+ *
+ * For details of use and the image format see ota-delta.h
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdint.h>
+#include <string.h>
+#include <espressif/spi_flash.h>
+#include <onewire/onewire.h>
+
+#include "ota-delta.h"
+
+enum {
+    DELTA_SNIFF,    /* collecting the first 4 bytes to check for the magic */
+    DELTA_PLAIN,    /* not a delta image, pass data straight through */
+    DELTA_HEADER,   /* collecting the rest of the delta header */
+    DELTA_OP,       /* expecting a command op byte */
+    DELTA_LEN,      /* decoding a varint length */
+    DELTA_ARG,      /* decoding a varint offset/distance */
+    DELTA_LITERAL,  /* passing literal data through */
+    DELTA_DONE,
+    DELTA_ERROR,
+};
+
+#define OP_LITERAL 0
+#define OP_COPY_SRC 1
+#define OP_COPY_OUT 2
+
+#define MAGIC_LEN 4
+
+/* copies are done through a stack buffer of this size */
+#define COPY_CHUNK 64
+
+static uint32_t read_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* CRC-32 (as zlib.crc32) of len bytes of flash */
+static bool crc32_flash(uint32_t addr, uint32_t len, uint32_t *crc_out)
+{
+    uint32_t buf[COPY_CHUNK / 4];
+    uint32_t crc = 0;
+
+    while(len > 0) {
+        uint32_t n = (len < sizeof(buf)) ? len : sizeof(buf);
+        if(sdk_spi_flash_read(addr, buf, sizeof(buf)) != SPI_FLASH_RESULT_OK) {
+            return false;
+        }
+        crc = onewire_crc32((uint8_t *)buf, n, crc);
+        addr += n;
+        len -= n;
+    }
+    *crc_out = crc;
+    return true;
+}
+
+static bool delta_fail(ota_delta_status *status, const char *error)
+{
+    status->error = error;
+    status->state = DELTA_ERROR;
+    return false;
+}
+
+/* Write decoded data out to flash and the verifier */
+static bool delta_output(ota_delta_status *status, const uint8_t *data, uint32_t len)
+{
+    if(status->out_len + len > status->out_limit) {
+        return delta_fail(status, "Image too large");
+    }
+    if(!rboot_write_flash(status->write, (uint8_t *)data, len)) {
+        return delta_fail(status, "Flash write failed");
+    }
+    rboot_verify_update(status->verify, data, len);
+    status->out_len += len;
+    return true;
+}
+
+/* Read up to COPY_CHUNK bytes from any flash offset. When reading back
+   the output image, bytes that rboot_write_flash is still holding back
+   (to make up a whole word) are taken from the write status instead.
+*/
+static bool delta_read(ota_delta_status *status, uint32_t addr, uint8_t *buf, uint32_t len, bool from_output)
+{
+    uint32_t flushed = status->write->start_addr;
+    if(from_output && addr + len > flushed) {
+        uint32_t from = (addr > flushed) ? addr : flushed;
+        memcpy(buf + (from - addr), status->write->extra_bytes + (from - flushed), addr + len - from);
+        if(addr >= flushed)
+            return true;
+        len = flushed - addr;
+    }
+
+    uint32_t aligned[COPY_CHUNK / 4 + 2];
+    uint32_t start = addr & ~3;
+    uint32_t end = (addr + len + 3) & ~3;
+    if(sdk_spi_flash_read(start, aligned, end - start) != SPI_FLASH_RESULT_OK) {
+        return false;
+    }
+    memcpy(buf, (uint8_t *)aligned + (addr - start), len);
+    return true;
+}
+
+/* Execute a copy command, len bytes from either the source image or
+   'distance' bytes back in the output. */
+static bool delta_copy(ota_delta_status *status)
+{
+    uint8_t buf[COPY_CHUNK];
+    uint32_t remaining = status->len;
+    uint32_t src, distance = 0;
+
+    if(status->op == OP_COPY_SRC) {
+        src = status->src_offset + status->src_pos;
+        if(status->src_pos > status->src_len || remaining > status->src_len - status->src_pos) {
+            return delta_fail(status, "Copy outside source image");
+        }
+        status->src_pos += remaining;
+    }
+    else {
+        distance = status->arg;
+        if(distance == 0 || distance > status->out_len) {
+            return delta_fail(status, "Copy outside image");
+        }
+        src = status->out_start + status->out_len - distance;
+    }
+
+    while(remaining > 0) {
+        uint32_t n = (remaining < COPY_CHUNK) ? remaining : COPY_CHUNK;
+        if(distance && distance < n) {
+            /* overlapping copy, read the repeating part once and replicate it */
+            if(!delta_read(status, src, buf, distance, true)) {
+                return delta_fail(status, "Flash read failed");
+            }
+            for(int i = distance; i < n; i++) {
+                buf[i] = buf[i - distance];
+            }
+        }
+        else if(!delta_read(status, src, buf, n, distance != 0)) {
+            return delta_fail(status, "Flash read failed");
+        }
+        if(!delta_output(status, buf, n)) {
+            return false;
+        }
+        src += n;
+        remaining -= n;
+    }
+    return true;
+}
+
+static bool delta_header(ota_delta_status *status)
+{
+    status->target_len = read_le32(status->header + 4);
+    status->src_len = read_le32(status->header + 8);
+    if(status->target_len > status->out_limit) {
+        return delta_fail(status, "Image too large");
+    }
+    if(status->src_len) {
+        /* Make sure the patch is for the image we're running */
+        uint32_t crc;
+        if(status->src_len > status->out_limit) {
+            return delta_fail(status, "Delta doesn't match running image");
+        }
+        if(!crc32_flash(status->src_offset, status->src_len, &crc)) {
+            return delta_fail(status, "Flash read failed");
+        }
+        if(crc != read_le32(status->header + 12)) {
+            return delta_fail(status, "Delta doesn't match running image");
+        }
+    }
+    status->state = (status->target_len > 0) ? DELTA_OP : DELTA_DONE;
+    return true;
+}
+
+/* Called when a command is fully decoded (apart from literal data) */
+static bool delta_command(ota_delta_status *status)
+{
+    if(status->out_len + status->len > status->target_len) {
+        return delta_fail(status, "Delta command past end of image");
+    }
+    if(status->op == OP_LITERAL) {
+        status->state = DELTA_LITERAL;
+        return true;
+    }
+    if(!delta_copy(status)) {
+        return false;
+    }
+    status->state = (status->out_len == status->target_len) ? DELTA_DONE : DELTA_OP;
+    return true;
+}
+
+void ota_delta_init(ota_delta_status *status, rboot_write_status *write, rboot_verify_status *verify,
+                    uint32_t src_offset, uint32_t limit)
+{
+    memset(status, 0, sizeof(ota_delta_status));
+    status->write = write;
+    status->verify = verify;
+    status->out_start = write->start_addr;
+    status->out_limit = limit;
+    status->src_offset = src_offset;
+    status->state = DELTA_SNIFF;
+}
+
+bool ota_delta_update(ota_delta_status *status, const uint8_t *data, size_t len)
+{
+    while(len > 0) {
+        uint32_t n;
+        switch(status->state) {
+        case DELTA_SNIFF:
+        case DELTA_HEADER:
+            n = ((status->state == DELTA_SNIFF) ? MAGIC_LEN : sizeof(status->header)) - status->header_len;
+            if(n > len)
+                n = len;
+            memcpy(status->header + status->header_len, data, n);
+            status->header_len += n;
+            data += n;
+            len -= n;
+            if(status->state == DELTA_SNIFF && status->header_len == MAGIC_LEN) {
+                if(memcmp(status->header, OTA_DELTA_MAGIC, MAGIC_LEN)) {
+                    /* plain image, output what we've held back */
+                    status->state = DELTA_PLAIN;
+                    if(!delta_output(status, status->header, MAGIC_LEN))
+                        return false;
+                } else {
+                    status->state = DELTA_HEADER;
+                }
+            }
+            else if(status->header_len == sizeof(status->header)) {
+                if(!delta_header(status))
+                    return false;
+            }
+            break;
+        case DELTA_PLAIN:
+            return delta_output(status, data, len);
+        case DELTA_OP:
+            status->op = *data >> 6;
+            status->len = *data & 0x3f;
+            data++;
+            len--;
+            if(status->op > OP_COPY_OUT) {
+                return delta_fail(status, "Bad delta command");
+            }
+            status->arg = 0;
+            status->shift = 0;
+            if(status->len == 0) {
+                status->state = DELTA_LEN;
+            } else if(status->op == OP_LITERAL) {
+                if(!delta_command(status))
+                    return false;
+            } else {
+                status->state = DELTA_ARG;
+            }
+            break;
+        case DELTA_LEN:
+        case DELTA_ARG:
+            if(status->shift > 28) {
+                return delta_fail(status, "Bad delta varint");
+            }
+            status->arg |= (uint32_t)(*data & 0x7f) << status->shift;
+            status->shift += 7;
+            data++;
+            len--;
+            if(data[-1] & 0x80)
+                break;
+            if(status->state == DELTA_LEN) {
+                status->len = status->arg;
+                status->arg = 0;
+                status->shift = 0;
+                if(status->len == 0) {
+                    return delta_fail(status, "Bad delta command");
+                }
+                if(status->op != OP_LITERAL) {
+                    status->state = DELTA_ARG;
+                    break;
+                }
+            }
+            else if(status->op == OP_COPY_SRC) {
+                /* zigzag decode, relative to the previous source copy */
+                int32_t rel = (status->arg >> 1) ^ -(int32_t)(status->arg & 1);
+                status->src_pos += rel;
+            }
+            if(!delta_command(status))
+                return false;
+            break;
+        case DELTA_LITERAL:
+            n = (status->len < len) ? status->len : len;
+            if(!delta_output(status, data, n))
+                return false;
+            status->len -= n;
+            data += n;
+            len -= n;
+            if(status->len == 0) {
+                status->state = (status->out_len == status->target_len) ? DELTA_DONE : DELTA_OP;
+            }
+            break;
+        case DELTA_DONE:
+            return delta_fail(status, "Data after end of delta");
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ota_delta_finish(ota_delta_status *status, uint32_t *image_length, const char **error_message)
+{
+    if(status->state == DELTA_SNIFF && status->header_len > 0) {
+        /* very short plain image */
+        status->state = DELTA_PLAIN;
+        delta_output(status, status->header, status->header_len);
+    }
+    if(status->state != DELTA_PLAIN && status->state != DELTA_DONE && status->state != DELTA_ERROR) {
+        delta_fail(status, "Delta image truncated");
+    }
+    if(image_length)
+        *image_length = status->out_len;
+    if(status->state == DELTA_ERROR) {
+        if(error_message)
+            *error_message = status->error;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,103 @@
+#ifndef _OTA_DELTA_H
+#define _OTA_DELTA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rboot-api.h"
+
+/* Delta/compressed OTA image support
+ *
+ * An OTA image can be sent either as a plain rboot image, or as a
+ * delta image generated by utils/mkdelta.py. A delta image is decoded
+ * as it is received, against the image in the currently running slot,
+ * and written out as a plain image into the OTA slot. Only a few
+ * hundred bytes of RAM are needed, there is no decompression window -
+ * back-references are read from the already written part of the new
+ * image in flash.
+ *
+ * ota-tftp detects delta images automatically, so the server and
+ * ota_tftp_download() accept either kind.
+ *
+ * Delta image format (all values little endian):
+ *
+ * Header, 16 bytes:
+ *   "RBD1" magic
+ *   uint32 length of the decoded image
+ *   uint32 length of the source image it was made against (0 if none)
+ *   uint32 CRC-32 (as zlib.crc32) of the source image (0 if none)
+ *
+ * Followed by commands until the decoded length is reached. Each
+ * command starts with an op byte:
+ *   bits 7-6: 0 = literal, 1 = copy from source image, 2 = copy from output
+ *   bits 5-0: length, or 0 if the length follows as a varint
+ * Literal: <length> bytes of data follow.
+ * Copy from source: zigzag varint offset, relative to the end of the
+ *   previous source copy.
+ * Copy from output: varint distance back from the current output position
+ *   (may be less than the length, to repeat a run.)
+ *
+ * Varints are LEB128: 7 bits per byte, low bits first, bit 7 set if
+ * more bytes follow.
+ *
+ * Before decoding anything, the device checks the CRC of the first
+ * <source length> bytes of its running slot, so a delta is only applied
+ * to the exact image it was made against. The CRC comes from
+ * extras/onewire, which has to be added to EXTRA_COMPONENTS too. Its
+ * ONEWIRE_CRC_METHOD setting decides how fast the check is (the default
+ * bitwise CRC is the slowest.)
+ */
+
+#define OTA_DELTA_MAGIC "RBD1"
+
+/* Decoder state, treat as opaque */
+typedef struct {
+    rboot_write_status *write;
+    rboot_verify_status *verify;
+    uint32_t out_start;     /* flash offset the image is written to */
+    uint32_t out_len;       /* bytes of image output so far */
+    uint32_t out_limit;     /* maximum image length */
+    uint32_t src_offset;    /* flash offset of the source image */
+    uint32_t src_len;
+    uint32_t src_pos;       /* end of the previous source copy */
+    uint32_t target_len;
+    uint32_t len;           /* length of current command */
+    uint32_t arg;           /* varint being decoded */
+    uint8_t shift;
+    uint8_t state;
+    uint8_t op;
+    uint8_t header_len;
+    uint8_t header[16];
+    const char *error;
+} ota_delta_status;
+
+/* Start receiving an image, which may be either a plain rboot image or a
+   delta image.
+
+   Decoded image data is written using 'write' (see rboot_write_init) and
+   passed to 'verify' (see rboot_verify_init.)
+
+   src_offset is the flash offset of the image that delta images were
+   generated against, normally the running slot - rboot_get_slot_offset().
+   limit is the maximum length of the decoded image.
+*/
+void ota_delta_init(ota_delta_status *status, rboot_write_status *write, rboot_verify_status *verify,
+                    uint32_t src_offset, uint32_t limit);
+
+/* Pass the next chunk of received data to the decoder.
+
+   Returns false on error (see ota_delta_finish for the error message.)
+*/
+bool ota_delta_update(ota_delta_status *status, const uint8_t *data, size_t len);
+
+/* Check that a complete image has been received.
+
+   image_length (optional) is set to the length of the decoded image written
+   to flash. error_message (optional) is set to a static human-readable
+   error message if fails.
+
+   Does not flush the write status or finish the verifier, call
+   rboot_write_end() and rboot_verify_finish() as well.
+*/
+bool ota_delta_finish(ota_delta_status *status, uint32_t *image_length, const char **error_message);
+
+#endif
@@ -7,6 +7,8 @@
  * BSD Licensed as described in the file LICENSE
  */
 #include <FreeRTOS.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <strings.h>
 
@@ -23,6 +25,7 @@
 
 #include "ota-tftp.h"
 #include "rboot-api.h"
+#include "ota-delta.h"
 
 #define TFTP_FIRMWARE_FILE "firmware.bin"
 #define TFTP_OCTET_MODE "octet" /* non-case-sensitive */
@@ -38,14 +41,38 @@
 #define TFTP_ERR_FULL 3
 #define TFTP_ERR_ILLEGAL 4
 #define TFTP_ERR_BADID 5
+#define TFTP_ERR_OPTION 8
 
 #define MAX_IMAGE_SIZE 0x100000 /*1MB images max at the moment */
 
+/* RFC2348 block size and RFC7440 window size options */
+#define TFTP_OPT_BLKSIZE "blksize"
+#define TFTP_OPT_WINDOWSIZE "windowsize"
+
+#define TFTP_DEFAULT_BLKSIZE 512
+#define TFTP_DEFAULT_WINDOWSIZE 1
+
+/* lwIP is built without IP_REASSEMBLY, so a DATA packet has to fit
+   in a single unfragmented 1500 byte frame (less IP, UDP & TFTP headers) */
+#define TFTP_MAX_BLKSIZE 1468
+
+/* Every block in a window may be queued in the netconn's receive
+   mailbox at once, so keep this below DEFAULT_UDP_RECVMBOX_SIZE */
+#define TFTP_MAX_WINDOWSIZE 4
+
+typedef struct {
+    uint16_t blksize;
+    uint16_t windowsize;
+} tftp_opts_t;
+
 static void tftp_task(void *port_p);
 static char *tftp_get_field(int field, struct netbuf *netbuf);
-static err_t tftp_receive_data(struct netconn *nc, size_t write_offs, size_t limit_offs, size_t *received_len, ip_addr_t *peer_addr, int peer_port, tftp_receive_cb receive_cb);
+static bool tftp_parse_options(struct netbuf *netbuf, int first_field, tftp_opts_t *opts);
+static err_t tftp_receive_data(struct netconn *nc, size_t write_offs, size_t limit_offs, uint32_t src_offs, size_t *received_len, tftp_opts_t *opts, const tftp_opts_t *oack, rboot_verify_status *verify, ip_addr_t *peer_addr, int peer_port, tftp_receive_cb receive_cb);
+static bool tftp_write_netbuf(ota_delta_status *image, struct netbuf *netbuf);
 static err_t tftp_send_ack(struct netconn *nc, int block);
-static err_t tftp_send_rrq(struct netconn *nc, const char *filename);
+static err_t tftp_send_oack(struct netconn *nc, const tftp_opts_t *opts);
+static err_t tftp_send_rrq(struct netconn *nc, const char *filename, const tftp_opts_t *opts);
 static void tftp_send_error(struct netconn *nc, int err_code, const char *err_msg);
 
 int (*verify_cb)(int) = NULL;
@@ -62,6 +89,13 @@ void ota_tftp_init_server(int listen_port)
 
 err_t ota_tftp_download(const char *server, int port, const char *filename,
                         int timeout, int ota_slot, tftp_receive_cb receive_cb)
+{
+    return ota_tftp_download_digest(server, port, filename, timeout, ota_slot, receive_cb, NULL, NULL);
+}
+
+err_t ota_tftp_download_digest(const char *server, int port, const char *filename,
+                               int timeout, int ota_slot, tftp_receive_cb receive_cb,
+                               rboot_digest_update_fn digest_fn, void *digest_ctx)
 {
     rboot_config rboot_config = rboot_get_config();
     /* Validate the OTA slot parameter */
@@ -102,15 +136,24 @@ err_t ota_tftp_download(const char *server, int port, const char *filename,
 
     netconn_connect(nc, &addr, port);
 
-    err = tftp_send_rrq(nc, filename);
+    /* Ask for the largest blocks & window we support. If the server
+       doesn't reply with an OACK, we fall back to RFC1350 defaults. */
+    tftp_opts_t opts = {
+        .blksize = TFTP_MAX_BLKSIZE,
+        .windowsize = TFTP_MAX_WINDOWSIZE,
+    };
+    err = tftp_send_rrq(nc, filename, &opts);
     if(err) {
         netconn_delete(nc);
         return err;
     }
 
+    rboot_verify_status verify;
+    rboot_verify_init(&verify, digest_fn, digest_ctx);
+
     size_t received_len;
     err = tftp_receive_data(nc, flash_offset, flash_offset+MAX_IMAGE_SIZE,
-                            &received_len, &addr, port, receive_cb);
+                            rboot_config.roms[rboot_config.current_rom], &received_len, &opts, NULL, &verify, &addr, port, receive_cb);
     netconn_delete(nc);
     return err;
 }
@@ -170,6 +213,16 @@ static void tftp_task(void *listen_port)
         }
         free(mode);
 
+        /* any options follow the mode, clamp them to what we support */
+        tftp_opts_t opts = { 0 };
+        bool has_opts = tftp_parse_options(netbuf, 2, &opts);
+        if(opts.blksize > TFTP_MAX_BLKSIZE) {
+            opts.blksize = TFTP_MAX_BLKSIZE;
+        }
+        if(opts.windowsize > TFTP_MAX_WINDOWSIZE) {
+            opts.windowsize = TFTP_MAX_WINDOWSIZE;
+        }
+
         /* establish a connection back to the sender from this netbuf */
         netconn_connect(nc, netbuf_fromaddr(netbuf), netbuf_fromport(netbuf));
         netbuf_delete(netbuf);
@@ -185,18 +238,29 @@ static void tftp_task(void *listen_port)
             continue;
         }
 
-        /* ACK the WRQ */
-        int ack_err = tftp_send_ack(nc, 0);
+        /* ACK the WRQ, or OACK if the client sent options we understand.
+           Keep the OACK as sent, in case it has to be sent again. */
+        tftp_opts_t oack = opts;
+        int ack_err = has_opts ? tftp_send_oack(nc, &oack) : tftp_send_ack(nc, 0);
         if(ack_err != 0) {
 
             netconn_disconnect(nc);
             continue;
         }
 
+        if(!opts.blksize) {
+            opts.blksize = TFTP_DEFAULT_BLKSIZE;
+        }
+        if(!opts.windowsize) {
+            opts.windowsize = TFTP_DEFAULT_WINDOWSIZE;
+        }
+
         /* Finished WRQ phase, start TFTP data transfer */
         size_t received_len;
+        rboot_verify_status verify;
+        rboot_verify_init(&verify, NULL, NULL);
         netconn_set_recvtimeout(nc, 10000);
-        int recv_err = tftp_receive_data(nc, conf.roms[slot], conf.roms[slot]+MAX_IMAGE_SIZE, &received_len, NULL, 0, NULL);
+        int recv_err = tftp_receive_data(nc, conf.roms[slot], conf.roms[slot]+MAX_IMAGE_SIZE, conf.roms[conf.current_rom], &received_len, &opts, has_opts ? &oack : NULL, &verify, NULL, 0, NULL);
 
         netconn_disconnect(nc);
 
@@ -255,15 +319,83 @@ static char *tftp_get_field(int field, struct netbuf *netbuf)
     return result;
 }
 
+/* Parse RFC2347 option name/value pairs from a request or OACK,
+   starting at field first_field.
+
+   Sets opts->blksize and opts->windowsize to the values found, or
+   zero if an option isn't present (values are not range checked
+   beyond being valid for the option.)
+
+   Returns true if either option was found.
+*/
+static bool tftp_parse_options(struct netbuf *netbuf, int first_field, tftp_opts_t *opts)
+{
+    bool found = false;
+    opts->blksize = 0;
+    opts->windowsize = 0;
+    for(int field = first_field; ; field += 2) {
+        char *name = tftp_get_field(field, netbuf);
+        char *value = name ? tftp_get_field(field + 1, netbuf) : NULL;
+        if(!value) {
+            free(name);
+            break;
+        }
+        long n = strtol(value, NULL, 10);
+        if(!strcasecmp(name, TFTP_OPT_BLKSIZE) && n >= 8 && n <= 65464) {
+            opts->blksize = n;
+            found = true;
+        }
+        else if(!strcasecmp(name, TFTP_OPT_WINDOWSIZE) && n >= 1 && n <= 65535) {
+            opts->windowsize = n;
+            found = true;
+        }
+        free(name);
+        free(value);
+    }
+    return found;
+}
+
 #define TFTP_TIMEOUT_RETRANSMITS 10
 
-static err_t tftp_receive_data(struct netconn *nc, size_t write_offs, size_t limit_offs, size_t *received_len, ip_addr_t *peer_addr, int peer_port, tftp_receive_cb receive_cb)
+/* Receive DATA blocks and write them to flash, ACKing once per window.
+
+   Data is also passed to the verifier as it arrives, so the image
+   doesn't need to be read back from flash to verify it.
+
+   The received data may be a delta image (see ota-delta.h), which is
+   decoded against the image at src_offs as it arrives.
+
+   For the server, opts are the options already negotiated with the
+   client, and oack is the OACK sent to the client (NULL if the WRQ was
+   answered with ACK 0.) Until the first block arrives, the server
+   repeats that answer on timeout or when the WRQ is repeated.
+
+   For the client (peer_addr set), opts are the options we requested in
+   the RRQ - RFC1350 defaults apply unless the server answers with an
+   OACK.
+*/
+static err_t tftp_receive_data(struct netconn *nc, size_t write_offs, size_t limit_offs, uint32_t src_offs, size_t *received_len, tftp_opts_t *opts, const tftp_opts_t *oack, rboot_verify_status *verify, ip_addr_t *peer_addr, int peer_port, tftp_receive_cb receive_cb)
 {
     *received_len = 0;
-    const int DATA_PACKET_SZ = 512 + 4; /*( packet size plus header */
-    uint32_t start_offs = write_offs;
+    rboot_write_status write_status = rboot_write_init(write_offs);
+    ota_delta_status image;
+    ota_delta_init(&image, &write_status, verify, src_offs, limit_offs - write_offs);
     int block = 1;
 
+    tftp_opts_t cur = *opts;
+    bool oack_allowed = false;
+    if(peer_addr) {
+        cur.blksize = TFTP_DEFAULT_BLKSIZE;
+        cur.windowsize = TFTP_DEFAULT_WINDOWSIZE;
+        oack_allowed = true;
+    }
+    int data_packet_sz = cur.blksize + 4; /* packet size plus header */
+
+    bool is_server = !peer_addr;
+    bool ack0_sent = is_server && !oack; /* ACK 0 was sent, so can retransmit it */
+    int window_count = 0;      /* blocks received in sequence since the last ACK */
+    bool resync_acked = false; /* already ACKed the last in-sequence block after a gap/duplicate */
+
     struct netbuf *netbuf = 0;
     int retries = TFTP_TIMEOUT_RETRANSMITS;
 
@@ -290,11 +422,18 @@ static err_t tftp_receive_data(struct netconn *nc, size_t write_offs, size_t lim
         }
 
         if(err == ERR_TIMEOUT) {
-            if(retries-- > 0 && block > 1) {
-                /* Retransmit the last ACK, wait for repeat data block.
-
-                 This doesn't work for the first block, have to time out and start again. */
-                tftp_send_ack(nc, block-1);
+            if(retries-- > 0 && (block > 1 || ack0_sent || oack)) {
+                /* Retransmit the last ACK (or the OACK), sender will repeat
+                   the window after it.
+
+                 A client that hasn't had an OACK yet can't do this for the
+                 first block, it has to time out and start again. */
+                if(block == 1 && oack) {
+                    tftp_send_oack(nc, oack);
+                } else {
+                    tftp_send_ack(nc, block-1);
+                }
+                window_count = 0;
                 continue;
             }
             tftp_send_error(nc, TFTP_ERR_ILLEGAL, "Timeout");
@@ -306,97 +445,130 @@ static err_t tftp_receive_data(struct netconn *nc, size_t write_offs, size_t lim
         }
 
         uint16_t opcode = netbuf_read_u16_n(netbuf, 0);
+        if(opcode == TFTP_OP_OACK && oack_allowed) {
+            /* Server accepted some of our options, it may not reply with
+               values larger than we asked for. */
+            tftp_opts_t accepted;
+            tftp_parse_options(netbuf, 0, &accepted);
+            netbuf_delete(netbuf);
+            if(accepted.blksize > opts->blksize || accepted.windowsize > opts->windowsize) {
+                tftp_send_error(nc, TFTP_ERR_OPTION, "Bad option value");
+                return ERR_VAL;
+            }
+            if(accepted.blksize) {
+                cur.blksize = accepted.blksize;
+                data_packet_sz = cur.blksize + 4;
+            }
+            if(accepted.windowsize) {
+                cur.windowsize = accepted.windowsize;
+            }
+            oack_allowed = false;
+            ack0_sent = true;
+            tftp_send_ack(nc, 0);
+            continue;
+        }
+        if(opcode == TFTP_OP_OACK && !is_server && ack0_sent && block == 1) {
+            /* repeated OACK, our ACK 0 got lost */
+            netbuf_delete(netbuf);
+            tftp_send_ack(nc, 0);
+            continue;
+        }
+        if(opcode == TFTP_OP_WRQ && is_server && block == 1) {
+            /* repeated WRQ, our OACK or ACK 0 got lost */
+            netbuf_delete(netbuf);
+            if(oack) {
+                tftp_send_oack(nc, oack);
+            } else {
+                tftp_send_ack(nc, 0);
+            }
+            continue;
+        }
         if(opcode != TFTP_OP_DATA) {
             tftp_send_error(nc, TFTP_ERR_ILLEGAL, "Unknown opcode");
             netbuf_delete(netbuf);
             return ERR_VAL;
         }
+        oack_allowed = false;
 
         uint16_t client_block = netbuf_read_u16_n(netbuf, 2);
-        if(client_block != block) {
+        if(client_block != (uint16_t)block) {
             netbuf_delete(netbuf);
-            if(client_block == block-1) {
-                /* duplicate block, means our ack got lost */
+            /* Either a block we already have (our ACK got lost, so
+               the sender is repeating the window) or a gap (a block
+               in this window got lost.) Either way, ACK the last block
+               received in sequence once and the sender will restart
+               from there. Ignore the rest of the window.
+            */
+            if(!resync_acked) {
                 tftp_send_ack(nc, block-1);
-                continue;
-            }
-            else {
-                tftp_send_error(nc, TFTP_ERR_ILLEGAL, "Block# out of order");
-                return ERR_VAL;
+                resync_acked = true;
             }
+            window_count = 0;
+            continue;
         }
 
         /* Reset retry count if we got valid data */
         retries = TFTP_TIMEOUT_RETRANSMITS;
+        resync_acked = false;
 
-        if(write_offs % SECTOR_SIZE == 0) {
-            sdk_spi_flash_erase_sector(write_offs / SECTOR_SIZE);
-        }
-
-        /* One UDP packet can be more than one netbuf segment, so iterate all the
-           segments in the netbuf and write them to flash
-        */
-        int offset = 0;
+        /* The image decoder checks the size of the image it writes out,
+           which for a delta image is more than has been received. */
         int len = netbuf_len(netbuf);
 
-        if(write_offs + len >= limit_offs) {
-            tftp_send_error(nc, TFTP_ERR_FULL, "Image too large");
-            return ERR_VAL;
-        }
+        bool last_block = len < data_packet_sz;
+        bool window_done = ++window_count >= cur.windowsize;
 
-        bool first_chunk = true;
-        do
-        {
-            uint16_t chunk_len;
-            uint32_t *chunk;
-            netbuf_data(netbuf, (void **)&chunk, &chunk_len);
-            if(first_chunk) {
-                chunk++; /* skip the 4 byte TFTP header */
-                chunk_len -= 4; /* assuming this netbuf chunk is at least 4 bytes! */
-                first_chunk = false;
-            }
-            if(chunk_len && ((uint32_t)chunk % 4)) {
-                /* sdk_spi_flash_write requires a word aligned
-                   buffer, so if the UDP payload is unaligned
-                   (common) then we copy the first word to the stack
-                   and write that to flash, then move the rest of the
-                   buffer internally to sit on an aligned offset.
-
-                   Assuming chunk_len is always a multiple of 4 bytes.
-                */
-                uint32_t first_word;
-                memcpy(&first_word, chunk, 4);
-                sdk_spi_flash_write(write_offs+offset, &first_word, 4);
-                memmove(LWIP_MEM_ALIGN(chunk),&chunk[1],chunk_len-4);
-                chunk = LWIP_MEM_ALIGN(chunk);
-                offset += 4;
-                chunk_len -= 4;
+        if(window_done && !last_block) {
+            /* ACK before programming the block, so the next window is
+               already on its way while we're busy writing to flash.
+            */
+            err_t ack_err = tftp_send_ack(nc, block);
+            if(ack_err != ERR_OK) {
+                netbuf_delete(netbuf);
+                return ack_err;
             }
-            sdk_spi_flash_write(write_offs+offset, chunk, chunk_len);
-            offset += chunk_len;
-        } while(netbuf_next(netbuf) >= 0);
+            window_count = 0;
+        }
 
+        bool write_ok = tftp_write_netbuf(&image, netbuf);
         netbuf_delete(netbuf);
+        if(!write_ok) {
+            const char *err = "Flash write failed";
+            ota_delta_finish(&image, NULL, &err);
+            tftp_send_error(nc, TFTP_ERR_ILLEGAL, err);
+            return ERR_IF;
+        }
+        if(verify->error) {
+            /* No need to wait for the rest of a bad image */
+            tftp_send_error(nc, TFTP_ERR_ILLEGAL, verify->error);
+            return ERR_VAL;
+        }
 
         *received_len += len - 4;
 
-        if(len < DATA_PACKET_SZ) {
+        if(last_block) {
             /* This was the last block, but verify the image before we ACK
                it so the client gets an indication if things were successful.
             */
             const char *err = "Unknown validation error";
-            uint32_t image_length;
-            if(!rboot_verify_image(start_offs, &image_length, &err)
-               || image_length != *received_len) {
+            uint32_t image_length, written_length;
+            if(!ota_delta_finish(&image, &written_length, &err)
+               || !rboot_write_end(&write_status)
+               || !rboot_verify_finish(verify, &image_length, &err)
+               || image_length != written_length) {
                 tftp_send_error(nc, TFTP_ERR_ILLEGAL, err);
                 return ERR_VAL;
             }
-        }
 
-        err_t ack_err = tftp_send_ack(nc, block);
-        if(ack_err != ERR_OK) {
-
-            return ack_err;
+            err_t ack_err = tftp_send_ack(nc, block);
+            if(ack_err != ERR_OK) {
+                return ack_err;
+            }
+        }
+        else {
+            /* If the next block crosses into a new sector, erase it
+               now rather than after the block arrives. */
+            rboot_write_erase_ahead(&write_status, cur.blksize);
         }
 
         // Make sure ack was successful before calling callback.
@@ -404,15 +576,42 @@ static err_t tftp_receive_data(struct netconn *nc, size_t write_offs, size_t lim
             receive_cb(*received_len);
         }
 
-        if(len < DATA_PACKET_SZ) {
+        if(last_block) {
             return ERR_OK;
         }
 
         block++;
-        write_offs += 512;
     }
 }
 
+/* Pass the payload of a TFTP DATA packet to the image decoder, which
+   writes it to flash and passes it to the verifier. Works directly on
+   the segments of the netbuf (one UDP packet can be more than one
+   pbuf.) Unaligned payloads are staged by rboot_write_flash, the pbufs
+   themselves are never modified.
+*/
+static bool tftp_write_netbuf(ota_delta_status *image, struct netbuf *netbuf)
+{
+    int skip = 4; /* TFTP header */
+    netbuf_first(netbuf);
+    do
+    {
+        uint16_t chunk_len;
+        uint8_t *chunk;
+        netbuf_data(netbuf, (void **)&chunk, &chunk_len);
+        if(skip) {
+            int n = (chunk_len < skip) ? chunk_len : skip;
+            chunk += n;
+            chunk_len -= n;
+            skip -= n;
+        }
+        if(chunk_len && !ota_delta_update(image, chunk, chunk_len)) {
+            return false;
+        }
+    } while(netbuf_next(netbuf) >= 0);
+    return true;
+}
+
 static err_t tftp_send_ack(struct netconn *nc, int block)
 {
     /* Send ACK */
@@ -436,14 +635,52 @@ static void tftp_send_error(struct netconn *nc, int err_code, const char *err_ms
     netbuf_delete(err);
 }
 
-static err_t tftp_send_rrq(struct netconn *nc, const char *filename)
+/* Write "name\0value\0" for each option set in opts to buf, returns length */
+static int tftp_format_options(char *buf, const tftp_opts_t *opts)
+{
+    int len = 0;
+    if(opts->blksize) {
+        len += sprintf(buf + len, TFTP_OPT_BLKSIZE) + 1;
+        len += sprintf(buf + len, "%u", opts->blksize) + 1;
+    }
+    if(opts->windowsize) {
+        len += sprintf(buf + len, TFTP_OPT_WINDOWSIZE) + 1;
+        len += sprintf(buf + len, "%u", opts->windowsize) + 1;
+    }
+    return len;
+}
+
+/* Longest possible output of tftp_format_options */
+#define TFTP_OPTIONS_MAX_LEN (sizeof(TFTP_OPT_BLKSIZE) + 6 + sizeof(TFTP_OPT_WINDOWSIZE) + 6)
+
+static err_t tftp_send_oack(struct netconn *nc, const tftp_opts_t *opts)
 {
+    char optbuf[TFTP_OPTIONS_MAX_LEN];
+    int optlen = tftp_format_options(optbuf, opts);
+
+    struct netbuf *oackbuf = netbuf_new();
+    uint16_t *oackdata = (uint16_t *)netbuf_alloc(oackbuf, 2 + optlen);
+    oackdata[0] = htons(TFTP_OP_OACK);
+    memcpy(&oackdata[1], optbuf, optlen);
+
+    err_t err = netconn_send(nc, oackbuf);
+    netbuf_delete(oackbuf);
+    return err;
+}
+
+static err_t tftp_send_rrq(struct netconn *nc, const char *filename, const tftp_opts_t *opts)
+{
+    char optbuf[TFTP_OPTIONS_MAX_LEN];
+    int optlen = tftp_format_options(optbuf, opts);
+
     struct netbuf *rrqbuf = netbuf_new();
-    uint16_t *rrqdata = (uint16_t *)netbuf_alloc(rrqbuf, 4 + strlen(filename) + strlen(TFTP_OCTET_MODE));
+    uint16_t *rrqdata = (uint16_t *)netbuf_alloc(rrqbuf, 4 + strlen(filename) + strlen(TFTP_OCTET_MODE) + optlen);
     rrqdata[0] = htons(TFTP_OP_RRQ);
     char *rrq_filename = (char *)&rrqdata[1];
     strcpy(rrq_filename, filename);
-    strcpy(rrq_filename + strlen(filename) + 1, TFTP_OCTET_MODE);
+    char *rrq_mode = rrq_filename + strlen(filename) + 1;
+    strcpy(rrq_mode, TFTP_OCTET_MODE);
+    memcpy(rrq_mode + strlen(TFTP_OCTET_MODE) + 1, optbuf, optlen);
 
     err_t err = netconn_send(nc, rrqbuf);
     netbuf_delete(rrqbuf);
@@ -2,6 +2,7 @@
 #define _OTA_TFTP_H
 
 #include "lwip/err.h"
+#include "rboot-api.h"
 
 typedef void (*tftp_receive_cb)(size_t bytes_received);
 typedef int (*tftp_verify_cb)();
@@ -23,10 +24,24 @@ typedef int (*tftp_verify_cb)();
  * TFTP protocol implemented as per RFC1350:
  * https://tools.ietf.org/html/rfc1350
  *
+ * The blksize (RFC2348) and windowsize (RFC7440) options are supported by
+ * both the server and the client, so large blocks can be sent several at
+ * a time per ACK. Blocks are limited to 1468 bytes (no IP fragmentation)
+ * and windows to 4 blocks. Peers without option support fall back to
+ * 512 byte lock-step transfers. Example client command using options:
+ * curl -T firmware/myprogram.bin --tftp-blksize 1468 tftp://ESP_IP/firmware.bin
+ *
+ * Either a plain image or a delta image generated with utils/mkdelta.py
+ * can be sent, delta images are decoded against the running image as they
+ * are received (see ota-delta.h.)
+ *
  * IMPORTANT: TFTP is not a secure protocol.
  * Only allow TFTP OTA updates on trusted networks.
  *
  *
+ * Host tests for the TFTP transfer, image verification and delta images
+ * are in test/, run them with "make test" there.
+ *
  * For more details, see https://github.com/SuperHouse/esp-open-rtos/wiki/OTA-Update-Configuration
  */
 
@@ -45,12 +60,28 @@ void ota_tftp_init_server(int listen_port);
 
    Does not change the current firmware slot, or reboot.
 
+   Requests the largest supported blksize & windowsize options from
+   the server, falls back to plain RFC1350 if the server ignores them.
+
    receive_cb: called repeatedly after each successful packet that
    has been written to flash and ACKed.  Can pass NULL to omit.
  */
 err_t ota_tftp_download(const char *server, int port, const char *filename,
                         int timeout, int ota_slot, tftp_receive_cb receive_cb);
 
+/* As for ota_tftp_download(), but also calculate a digest of the image
+   as it is received.
+
+   digest_fn/digest_ctx are as for rboot_digest_image(), the caller
+   initialises the digest context beforehand and finishes it
+   afterwards. On success the digest covers the verified image length,
+   so matches rboot_digest_image() without needing to read the image
+   back from flash. If the download fails the digest is invalid.
+ */
+err_t ota_tftp_download_digest(const char *server, int port, const char *filename,
+                               int timeout, int ota_slot, tftp_receive_cb receive_cb,
+                               rboot_digest_update_fn digest_fn, void *digest_ctx);
+
 void ota_tftp_set_verify_callback(tftp_verify_cb verify_cb);
 
 #define TFTP_PORT 69
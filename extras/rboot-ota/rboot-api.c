@@ -108,57 +108,112 @@ rboot_write_status ICACHE_FLASH_ATTR rboot_write_init(uint32 start_addr) {
 	return status;
 }
 
+// size of the stack buffer used to stage unaligned data on its way to flash
+#define WRITE_STAGE_SIZE 128
+
+// erase any sectors not yet erased, up to the one holding end_addr - 1
+static bool ICACHE_FLASH_ATTR erase_to(rboot_write_status *status, uint32 end_addr) {
+	int32 lastsect = (end_addr - 1) / SECTOR_SIZE;
+	while (lastsect > status->last_sector_erased) {
+		if (spi_flash_erase_sector(status->last_sector_erased + 1) != SPI_FLASH_RESULT_OK) {
+			return false;
+		}
+		status->last_sector_erased++;
+	}
+	return true;
+}
+
+// write a whole number of words at the current write address
+// aligned data goes straight to flash, anything else is copied through
+// a small staging buffer rather than a heap allocation
+static bool ICACHE_FLASH_ATTR write_words(rboot_write_status *status, const uint8 *data, uint32 len) {
+	uint32 stage[WRITE_STAGE_SIZE / 4];
+	uint32 chunk;
+
+	if (!erase_to(status, status->start_addr + len)) {
+		return false;
+	}
+
+	if (((uint32)data & 3) == 0) {
+		if (spi_flash_write(status->start_addr, (uint32 *)((void*)data), len) != SPI_FLASH_RESULT_OK) {
+			return false;
+		}
+		status->start_addr += len;
+		return true;
+	}
+
+	while (len > 0) {
+		chunk = (len < sizeof(stage)) ? len : sizeof(stage);
+		memcpy(stage, data, chunk);
+		if (spi_flash_write(status->start_addr, stage, chunk) != SPI_FLASH_RESULT_OK) {
+			return false;
+		}
+		status->start_addr += chunk;
+		data += chunk;
+		len -= chunk;
+	}
+	return true;
+}
+
 // function to do the actual writing to flash
-// call repeatedly with more data (max len per write is the flash sector size (4k))
+// call repeatedly with more data, any length
 bool ICACHE_FLASH_ATTR rboot_write_flash(rboot_write_status *status, uint8 *data, uint16 len) {
 	
-	bool ret = false;
-	uint8 *buffer;
-	int32 lastsect;
+	uint8 fill;
+	uint16 whole;
 	
 	if (data == NULL || len == 0) {
 		return true;
 	}
 	
-	// get a buffer
-	buffer = (uint8 *)os_malloc(len + status->extra_count);
-	if (!buffer) {
-		//os_printf("No ram!\r\n");
-		return false;
+	// top up any remaining bytes from last chunk to a whole word
+	if (status->extra_count) {
+		fill = 4 - status->extra_count;
+		if (fill > len) {
+			fill = len;
+		}
+		memcpy(status->extra_bytes + status->extra_count, data, fill);
+		status->extra_count += fill;
+		data += fill;
+		len -= fill;
+		if (status->extra_count < 4) {
+			return true;
+		}
+		if (!write_words(status, status->extra_bytes, 4)) {
+			return false;
+		}
+		status->extra_count = 0;
 	}
 
-	// copy in any remaining bytes from last chunk
-	memcpy(buffer, status->extra_bytes, status->extra_count);
-	// copy in new data
-	memcpy(buffer + status->extra_count, data, len);
-
-	// calculate length, must be multiple of 4
-	// save any remaining bytes for next go
-	len += status->extra_count;
-	status->extra_count = len % 4;
-	len -= status->extra_count;
-	memcpy(status->extra_bytes, buffer + len, status->extra_count);
-
-	// check data will fit
-	//if (status->start_addr + len < (status->start_sector + status->max_sector_count) * SECTOR_SIZE) {
-
-		// erase any additional sectors needed by this chunk
-		lastsect = ((status->start_addr + len) - 1) / SECTOR_SIZE;
-		while (lastsect > status->last_sector_erased) {
-			status->last_sector_erased++;
-			spi_flash_erase_sector(status->last_sector_erased);
-		}
+	// write the whole words, save any remaining bytes for next go
+	whole = len & ~3;
+	if (whole && !write_words(status, data, whole)) {
+		return false;
+	}
+	status->extra_count = len - whole;
+	memcpy(status->extra_bytes, data + whole, status->extra_count);
+	return true;
+}
 
-		// write current chunk
-		//os_printf("write addr: 0x%08x, len: 0x%04x\r\n", status->start_addr, len);
-		if (spi_flash_write(status->start_addr, (uint32 *)((void*)buffer), len) == SPI_FLASH_RESULT_OK) {
-			ret = true;
-			status->start_addr += len;
-		}
-	//}
+// erase, ahead of time, any sectors the next len bytes will be written to
+bool ICACHE_FLASH_ATTR rboot_write_erase_ahead(rboot_write_status *status, uint32 len) {
+	if (len == 0) {
+		return true;
+	}
+	return erase_to(status, status->start_addr + status->extra_count + len);
+}
 
-	os_free(buffer);
-	return ret;
+// flush any remaining bytes, padded out to a whole word with 0xff
+bool ICACHE_FLASH_ATTR rboot_write_end(rboot_write_status *status) {
+	if (status->extra_count == 0) {
+		return true;
+	}
+	memset(status->extra_bytes + status->extra_count, 0xff, 4 - status->extra_count);
+	if (!write_words(status, status->extra_bytes, 4)) {
+		return false;
+	}
+	status->extra_count = 0;
+	return true;
 }
 
 #ifdef BOOT_RTC_ENABLED
@@ -368,6 +423,193 @@ bool rboot_digest_image(uint32_t offset, uint32_t image_length, rboot_digest_upd
     return true;
 }
 
+/* States for the incremental image verifier */
+enum {
+    VERIFY_HEADER,          /* collecting an image header */
+    VERIFY_SECTION_HEADER,  /* collecting a section header */
+    VERIFY_SECTION_DATA,    /* inside section data */
+    VERIFY_PAD,             /* skipping padding until 'next', then 'after' */
+    VERIFY_CHECKSUM,        /* skipping to the checksum byte at 'next' */
+    VERIFY_DONE,
+    VERIFY_ERROR,
+};
+
+/* sanity limit on image size, same as rboot_verify_image */
+#define VERIFY_MAX_IMAGE 0x100000
+
+static void verify_fail(rboot_verify_status *status, const char *error)
+{
+    status->error = error;
+    status->state = VERIFY_ERROR;
+}
+
+/* Called after a section's data (or the last header) is consumed. */
+static void verify_next_section(rboot_verify_status *status)
+{
+    if(status->is_new_header) {
+        /* pad to a 16 byte offset, expect a v1.1 header after that */
+        status->next = (status->offset + 15) & ~15;
+        status->after = VERIFY_HEADER;
+        status->state = VERIFY_PAD;
+        return;
+    }
+    if(status->remaining_sections > 0) {
+        status->state = VERIFY_SECTION_HEADER;
+        return;
+    }
+    /* add a byte for the image checksum, pad the image length to a
+       16 byte boundary. Checksum is the last byte. */
+    status->image_length = (status->offset + 1 + 15) & ~15;
+    status->next = status->image_length - 1;
+    status->state = VERIFY_CHECKSUM;
+}
+
+static void verify_header(rboot_verify_status *status)
+{
+    image_header_t *header = (image_header_t *)status->header;
+    if(status->offset == sizeof(image_header_t)) {
+        /* initial header */
+        if(header->magic != ROM_MAGIC_OLD && header->magic != ROM_MAGIC_NEW) {
+            verify_fail(status, "Missing initial magic");
+            return;
+        }
+        status->is_new_header = (header->magic == ROM_MAGIC_NEW);
+    }
+    else {
+        if(header->magic != ROM_MAGIC_OLD) {
+            verify_fail(status, "Bad second magic");
+            return;
+        }
+        status->is_new_header = false;
+    }
+    status->remaining_sections = header->section_count;
+    if(status->remaining_sections > 0) {
+        status->state = VERIFY_SECTION_HEADER;
+    } else {
+        verify_next_section(status);
+    }
+}
+
+static void verify_section_header(rboot_verify_status *status)
+{
+    section_header_t *header = (section_header_t *)status->header;
+    RBOOT_DEBUG("Found section @ 0x%08x length %d load 0x%08x\n", status->offset - sizeof(section_header_t), header->length, header->load_addr);
+    if(header->length + status->offset > VERIFY_MAX_IMAGE) {
+        verify_fail(status, "Image truncated");
+        return;
+    }
+    if(header->length % 4) {
+        verify_fail(status, "Header length not modulo 4");
+        return;
+    }
+    status->next = status->offset + header->length;
+    status->remaining_sections--;
+    status->state = VERIFY_SECTION_DATA;
+    if(header->length == 0) {
+        verify_next_section(status);
+    }
+}
+
+void rboot_verify_init(rboot_verify_status *status, rboot_digest_update_fn digest_fn, void *digest_ctx)
+{
+    memset(status, 0, sizeof(rboot_verify_status));
+    status->state = VERIFY_HEADER;
+    status->checksum = CHKSUM_INIT;
+    status->digest_fn = digest_fn;
+    status->digest_ctx = digest_ctx;
+}
+
+void rboot_verify_update(rboot_verify_status *status, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    const uint8_t *start = data;
+
+    while(len > 0 && status->state < VERIFY_DONE) {
+        uint32_t n;
+        switch(status->state) {
+        case VERIFY_HEADER:
+        case VERIFY_SECTION_HEADER:
+            /* both header types are 8 bytes */
+            n = sizeof(status->header) - status->header_len;
+            if(n > len)
+                n = len;
+            memcpy(status->header + status->header_len, p, n);
+            status->header_len += n;
+            status->offset += n;
+            p += n;
+            len -= n;
+            if(status->header_len == sizeof(status->header)) {
+                status->header_len = 0;
+                if(status->state == VERIFY_HEADER)
+                    verify_header(status);
+                else
+                    verify_section_header(status);
+            }
+            break;
+        case VERIFY_SECTION_DATA:
+        case VERIFY_PAD:
+            n = status->next - status->offset;
+            if(n > len)
+                n = len;
+            if(status->state == VERIFY_SECTION_DATA && !status->is_new_header) {
+                for(int i = 0; i < n; i++)
+                    status->checksum ^= p[i];
+            }
+            status->offset += n;
+            p += n;
+            len -= n;
+            if(status->offset == status->next) {
+                if(status->state == VERIFY_PAD)
+                    status->state = status->after;
+                else
+                    verify_next_section(status);
+            }
+            break;
+        case VERIFY_CHECKSUM:
+            n = status->next - status->offset;
+            if(n >= len) {
+                status->offset += len;
+                p += len;
+                len = 0;
+                break;
+            }
+            p += n;
+            if(*p != status->checksum) {
+                verify_fail(status, "Invalid checksum");
+                break;
+            }
+            p++;
+            status->offset += n + 1;
+            len -= n + 1;
+            status->state = VERIFY_DONE;
+            RBOOT_DEBUG("rboot_verify_update: verified expected 0x%08x bytes.\n", status->image_length);
+            break;
+        }
+    }
+
+    /* hash everything up to the end of the image, nothing after */
+    if(status->digest_fn && p > start && status->state != VERIFY_ERROR)
+        status->digest_fn(status->digest_ctx, (void *)start, p - start);
+
+    /* anything left over is trailing data after a complete image */
+    status->offset += len;
+}
+
+bool rboot_verify_finish(rboot_verify_status *status, uint32_t *image_length, const char **error_message)
+{
+    if(status->state != VERIFY_DONE && status->state != VERIFY_ERROR)
+        verify_fail(status, "Image truncated");
+
+    if(image_length)
+        *image_length = (status->state == VERIFY_DONE) ? status->image_length : status->offset;
+    if(status->state == VERIFY_ERROR) {
+        if(error_message)
+            *error_message = status->error;
+        return false;
+    }
+    return true;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -83,10 +83,30 @@ rboot_write_status ICACHE_FLASH_ATTR rboot_write_init(uint32 start_addr);
  *  specified on the prior call to rboot_write_init. Current write position is
  *  tracked automatically. This method is likely to be called each time a packet
  *  of OTA data is received over the network.
+ *  @note   Data does not need to be word aligned and may be any length, unaligned
+ *          data is staged through a small stack buffer (no heap allocation.)
  *  @note   Call rboot_write_init before calling this function to get the rboot_write_status structure
 */
 bool ICACHE_FLASH_ATTR rboot_write_flash(rboot_write_status *status, uint8 *data, uint16 len);
 
+/**	@brief  Erase flash ahead of the current write position
+ *	@param  status Pointer to rboot_write_status structure defining the write status
+ *  @param  len Number of bytes, from the current write position, that will be written next
+ *	@retval	bool True on success
+ *  @note   rboot_write_flash erases sectors as it needs them, so calling this is optional.
+ *          Call it while waiting for the next chunk of data (for example after ACKing a
+ *          network packet) so the sector erase overlaps with the network transfer.
+*/
+bool ICACHE_FLASH_ATTR rboot_write_erase_ahead(rboot_write_status *status, uint32 len);
+
+/**	@brief  Finish a flash write
+ *	@param  status Pointer to rboot_write_status structure defining the write status
+ *	@retval	bool True on success
+ *  @note   Writes out any bytes still buffered from the last rboot_write_flash call,
+ *          padded with 0xff to a 4 byte boundary. Call once after the last chunk of data.
+*/
+bool ICACHE_FLASH_ATTR rboot_write_end(rboot_write_status *status);
+
 #ifdef BOOT_RTC_ENABLED
 /** @brief  Get rBoot status/control data from RTC data area
  *  @param  rtc Pointer to a rboot_rtc_data structure to be populated
@@ -172,6 +192,61 @@ typedef void (*rboot_digest_update_fn)(void * ctx, void *data, size_t data_len);
 **/
 bool rboot_digest_image(uint32_t offset, uint32_t image_length, rboot_digest_update_fn update_fn, void *update_ctx);
 
+/** @description State for verifying (and optionally hashing) an image
+    incrementally as it is received, without reading it back from flash.
+
+    Treat as opaque, see rboot_verify_init().
+**/
+typedef struct {
+    uint32_t offset;         /* bytes of image consumed so far */
+    uint32_t next;           /* offset where the current section/padding ends */
+    uint32_t image_length;   /* total image length, once the last section is seen */
+    uint8_t state;
+    uint8_t after;
+    uint8_t checksum;
+    uint8_t is_new_header;
+    uint8_t remaining_sections;
+    uint8_t header_len;
+    uint8_t header[8];
+    const char *error;
+    rboot_digest_update_fn digest_fn;
+    void *digest_ctx;
+} rboot_verify_status;
+
+/** @description Start verifying an image incrementally.
+
+    Performs the same checks as rboot_verify_image(), but on data as it is
+    passed to rboot_verify_update() rather than on data in flash.
+
+    @param status - Verifier state to initialise.
+
+    @param digest_fn - Optional digest update function (see
+    rboot_digest_update_fn.) Called with the image data as it arrives, the
+    result matches rboot_digest_image() over the verified image length.
+    Pass NULL to only verify.
+
+    @param digest_ctx - Context argument for digest update function.
+**/
+void rboot_verify_init(rboot_verify_status *status, rboot_digest_update_fn digest_fn, void *digest_ctx);
+
+/** @description Pass the next chunk of image data to the verifier.
+
+    Chunks can be any length and alignment. Any data after the end of the
+    image is counted but not verified or hashed.
+**/
+void rboot_verify_update(rboot_verify_status *status, const void *data, size_t len);
+
+/** @description Finish incremental verification, after all data has been passed
+    to rboot_verify_update(). Does not read flash.
+
+    @param status - Verifier state.
+    @param Optional pointer will return the total valid length of the image.
+    @param Optional pointer to a static human-readable error message if fails.
+
+    @return True for valid, False for invalid.
+**/
+bool rboot_verify_finish(rboot_verify_status *status, uint32_t *image_length, const char **error_message);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,86 @@
+/* Emulated SPI flash for the rboot-ota host tests
+ *
+ * Writes can only clear bits, as on the real thing, so a missing erase
+ * shows up as corrupted data.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <espressif/spi_flash.h>
+#include <espressif/esp_system.h>
+
+#include "flash.h"
+
+uint8_t flash[FLASH_SIZE];
+
+sdk_SpiFlashOpResult sdk_spi_flash_erase_sector(uint16_t sec)
+{
+    if ((sec + 1) * 0x1000 > FLASH_SIZE) {
+        return SPI_FLASH_RESULT_ERR;
+    }
+    memset(flash + sec * 0x1000, 0xff, 0x1000);
+    return SPI_FLASH_RESULT_OK;
+}
+
+sdk_SpiFlashOpResult sdk_spi_flash_write(uint32_t des_addr, uint32_t *src_addr, uint32_t size)
+{
+    const uint8_t *src = (const uint8_t *)src_addr;
+
+    if ((des_addr & 3) || (size & 3) || ((uintptr_t)src_addr & 3) || des_addr + size > FLASH_SIZE) {
+        return SPI_FLASH_RESULT_ERR;
+    }
+    for (uint32_t i = 0; i < size; i++) {
+        flash[des_addr + i] &= src[i];
+    }
+    return SPI_FLASH_RESULT_OK;
+}
+
+sdk_SpiFlashOpResult sdk_spi_flash_read(uint32_t src_addr, uint32_t *des_addr, uint32_t size)
+{
+    /* rboot_verify_image() reads the checksum byte from an odd address */
+    if (((uintptr_t)des_addr & 3) || src_addr + size > FLASH_SIZE) {
+        return SPI_FLASH_RESULT_ERR;
+    }
+    memcpy(des_addr, flash + src_addr, size);
+    return SPI_FLASH_RESULT_OK;
+}
+
+bool sdk_system_rtc_mem_read(uint8_t src, void *dst, uint16_t n)
+{
+    return false;
+}
+
+bool sdk_system_rtc_mem_write(uint8_t dst, const void *src, uint16_t n)
+{
+    return false;
+}
+
+void flash_load(uint32_t addr, const uint8_t *data, size_t len)
+{
+    memset(flash, 0xff, FLASH_SIZE);
+    memcpy(flash + addr, data, len);
+}
+
+uint8_t *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *data;
+
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = malloc(*len ? *len : 1);
+    if (fread(data, 1, *len, f) != *len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
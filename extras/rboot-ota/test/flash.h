@@ -0,0 +1,22 @@
+/* Emulated SPI flash for the rboot-ota host tests
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _TEST_FLASH_H
+#define _TEST_FLASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define FLASH_SIZE 0x200000
+
+extern uint8_t flash[FLASH_SIZE];
+
+/* Erase all of the flash, then program data at addr */
+void flash_load(uint32_t addr, const uint8_t *data, size_t len);
+
+/* Read a whole file into a new buffer, returns NULL on failure */
+uint8_t *read_file(const char *path, size_t *len);
+
+#endif
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+#
+# Generate firmware images for the rboot-ota host tests, in the same
+# layout as esptool.py elf2image (version 2 images, as rboot boots, and
+# plain version 1 images), plus delta images made from them with
+# utils/mkdelta.py.
+#
+# mkimages.py <output dir>
+#
+import os
+import random
+import struct
+import subprocess
+import sys
+
+CHKSUM_INIT = 0xef
+
+def section_data(rng, length):
+    # Code-like data: a limited alphabet of "instructions" with runs of
+    # repeated sequences, so it compresses about as well as real code
+    words = [rng.getrandbits(24).to_bytes(3, 'little') for _ in range(64)]
+    out = bytearray()
+    while len(out) < length:
+        if out and rng.random() < 0.2:
+            start = rng.randrange(len(out))
+            out += out[start:start + rng.randrange(8, 64)]
+        else:
+            out += rng.choice(words)
+    return out[:length]
+
+def pad(data, align):
+    return data + b'\0' * (-len(data) % align)
+
+def image_v1(sections, entry):
+    """ sections is a list of (load address, data) """
+    out = bytearray(struct.pack('<BBBBI', 0xe9, len(sections), 0, 0x20, entry))
+    checksum = CHKSUM_INIT
+    for addr, data in sections:
+        data = pad(data, 4)
+        out += struct.pack('<II', addr, len(data)) + data
+        for b in data:
+            checksum ^= b
+    out = pad(out + b'\0', 16)
+    out[-1] = checksum
+    return out
+
+def image_v2(irom, sections, entry):
+    irom = pad(irom, 4)
+    out = bytearray(struct.pack('<BBBBI', 0xea, 4, 0, 0x20, entry))
+    out += struct.pack('<II', 0, len(irom)) + irom
+    return pad(out, 16) + image_v1(sections, entry)
+
+def write(path, data):
+    with open(path, 'wb') as f:
+        f.write(data)
+
+def main():
+    out_dir = sys.argv[1]
+    mkdelta = os.path.join(os.path.dirname(__file__), '../../../utils/mkdelta.py')
+    os.makedirs(out_dir, exist_ok=True)
+    rng = random.Random(1)
+
+    irom = section_data(rng, 180000)
+    iram = section_data(rng, 24000)
+    dram = section_data(rng, 2000)
+    rodata = section_data(rng, 6000)
+    v1 = image_v2(irom, [(0x40100000, iram), (0x3ffe8000, dram), (0x3ffe8800, rodata)], 0x40100004)
+
+    # The next version: a function grows, some code moves, a string changes
+    irom2 = irom[:50000] + section_data(rng, 700) + irom[50000:120000] + irom[121000:]
+    irom2[150000:150016] = b'version 1.1\0\0\0\0\0'
+    iram2 = iram[:12000] + iram[12400:] + iram[12000:12400]
+    v2 = image_v2(irom2, [(0x40100000, iram2), (0x3ffe8000, dram), (0x3ffe8800, rodata)], 0x40100008)
+
+    plain = image_v1([(0x40100000, section_data(rng, 3000)), (0x3ffe8000, section_data(rng, 500))],
+                     0x40100004)
+
+    write(os.path.join(out_dir, 'app_v1.bin'), v1)
+    write(os.path.join(out_dir, 'app_v2.bin'), v2)
+    write(os.path.join(out_dir, 'plain.bin'), plain)
+    subprocess.check_call([sys.executable, mkdelta, '--source', os.path.join(out_dir, 'app_v1.bin'),
+                           os.path.join(out_dir, 'app_v2.bin'), os.path.join(out_dir, 'app_v2.delta')])
+    subprocess.check_call([sys.executable, mkdelta, os.path.join(out_dir, 'app_v2.bin'),
+                           os.path.join(out_dir, 'app_v2.z')])
+
+if __name__ == '__main__':
+    main()
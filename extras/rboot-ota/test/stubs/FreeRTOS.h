@@ -0,0 +1,22 @@
+/* Host test stand-in for the FreeRTOS headers used by rboot-ota */
+#ifndef _STUB_FREERTOS_H
+#define _STUB_FREERTOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+typedef uint32_t portTickType;
+typedef void (*pdTASK_CODE)(void *);
+
+static inline int xTaskCreate(pdTASK_CODE code, const signed char *name, int stack,
+                              void *param, int prio, void *handle)
+{
+    return 0;
+}
+
+static inline void vPortEnterCritical(void) {}
+static inline void vPortExitCritical(void) {}
+#define taskYIELD()
+
+#endif
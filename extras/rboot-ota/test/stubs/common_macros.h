@@ -0,0 +1,8 @@
+/* Host test stand-in for common_macros.h, for onewire_crc.c */
+#ifndef _STUB_COMMON_MACROS_H
+#define _STUB_COMMON_MACROS_H
+
+#define IRAM
+#define IRAM_DATA
+
+#endif
@@ -0,0 +1,12 @@
+/* Host test stand-in */
+#ifndef _STUB_ESP_SYSTEM_H
+#define _STUB_ESP_SYSTEM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+void sdk_system_restart(void);
+bool sdk_system_rtc_mem_read(uint8_t src, void *dst, uint16_t n);
+bool sdk_system_rtc_mem_write(uint8_t dst, const void *src, uint16_t n);
+
+#endif
@@ -0,0 +1,17 @@
+/* Host test stand-in, see flash.c for the emulated flash */
+#ifndef _STUB_SPI_FLASH_H
+#define _STUB_SPI_FLASH_H
+
+#include <stdint.h>
+
+typedef enum {
+    SPI_FLASH_RESULT_OK,
+    SPI_FLASH_RESULT_ERR,
+    SPI_FLASH_RESULT_TIMEOUT
+} sdk_SpiFlashOpResult;
+
+sdk_SpiFlashOpResult sdk_spi_flash_erase_sector(uint16_t sec);
+sdk_SpiFlashOpResult sdk_spi_flash_write(uint32_t des_addr, uint32_t *src_addr, uint32_t size);
+sdk_SpiFlashOpResult sdk_spi_flash_read(uint32_t src_addr, uint32_t *des_addr, uint32_t size);
+
+#endif
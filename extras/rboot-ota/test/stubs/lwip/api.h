@@ -0,0 +1,27 @@
+/* Host test stand-in for the lwIP netconn API, see test_tftp.c */
+#ifndef _STUB_LWIP_API_H
+#define _STUB_LWIP_API_H
+
+#include "lwip/err.h"
+#include "lwip/netbuf.h"
+
+enum netconn_type {
+    NETCONN_UDP
+};
+
+struct netconn;
+
+extern const ip_addr_t ip_addr_any;
+#define IP_ADDR_ANY (&ip_addr_any)
+
+struct netconn *netconn_new(enum netconn_type type);
+err_t netconn_delete(struct netconn *conn);
+err_t netconn_bind(struct netconn *conn, const ip_addr_t *addr, u16_t port);
+err_t netconn_connect(struct netconn *conn, const ip_addr_t *addr, u16_t port);
+err_t netconn_disconnect(struct netconn *conn);
+err_t netconn_recv(struct netconn *conn, struct netbuf **new_buf);
+err_t netconn_send(struct netconn *conn, struct netbuf *buf);
+void netconn_set_recvtimeout(struct netconn *conn, int timeout);
+err_t netconn_gethostbyname(const char *name, ip_addr_t *addr);
+
+#endif
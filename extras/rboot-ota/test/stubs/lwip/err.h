@@ -0,0 +1,16 @@
+/* Host test stand-in for lwIP */
+#ifndef _STUB_LWIP_ERR_H
+#define _STUB_LWIP_ERR_H
+
+#include <stdint.h>
+
+typedef int8_t err_t;
+
+#define ERR_OK       0
+#define ERR_MEM     -1
+#define ERR_TIMEOUT -3
+#define ERR_VAL     -6
+#define ERR_USE     -8
+#define ERR_IF     -16
+
+#endif
@@ -0,0 +1,45 @@
+/* Host test stand-in for lwIP netbufs, see test_tftp.c.
+
+   A received netbuf is split into two segments, so code walking the
+   segments with netbuf_first()/netbuf_next() gets exercised.
+*/
+#ifndef _STUB_LWIP_NETBUF_H
+#define _STUB_LWIP_NETBUF_H
+
+#include <stdint.h>
+#include <arpa/inet.h>
+#include "lwip/err.h"
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef int8_t s8_t;
+
+typedef struct {
+    u32_t addr;
+} ip_addr_t;
+
+#define NETBUF_MAX_LEN 1600
+
+struct netbuf {
+    u8_t data[NETBUF_MAX_LEN];
+    u16_t len;
+    u16_t split;    /* start of the second segment */
+    int seg;
+    ip_addr_t addr;
+    u16_t port;
+};
+
+struct netbuf *netbuf_new(void);
+void netbuf_delete(struct netbuf *buf);
+void *netbuf_alloc(struct netbuf *buf, u16_t size);
+u16_t netbuf_len(struct netbuf *buf);
+u16_t netbuf_copy_partial(struct netbuf *buf, void *dataptr, u16_t len, u16_t offset);
+void netbuf_first(struct netbuf *buf);
+s8_t netbuf_next(struct netbuf *buf);
+err_t netbuf_data(struct netbuf *buf, void **dataptr, u16_t *len);
+
+#define netbuf_fromaddr(buf) (&(buf)->addr)
+#define netbuf_fromport(buf) ((buf)->port)
+
+#endif
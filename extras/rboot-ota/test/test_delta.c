@@ -0,0 +1,205 @@
+/* Host test for delta OTA images.
+ *
+ * Delta images made by utils/mkdelta.py (see mkimages.py) are decoded
+ * by ota-delta.c into (emulated) flash, in random sized chunks the way
+ * ota-tftp passes them on, and the result compared with the new image.
+ *
+ * test_delta <directory written by mkimages.py>
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "flash.h"
+#include "../rboot-api.c"
+#include "../ota-delta.c"
+
+#define RUNNING_SLOT 0x2000
+#define OTA_SLOT 0x102000
+#define SLOT_SIZE 0x100000
+
+static const char *image_dir;
+static uint32_t rand_state;
+
+static uint32_t next_rand(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+static uint8_t *load(const char *name, size_t *len)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", image_dir, name);
+    return read_file(path, len);
+}
+
+/* Receive `data` into the OTA slot as ota-tftp does. Returns true if the
+   decoder, the flash writes and the verifier all succeeded. */
+static bool receive(const uint8_t *data, size_t len, uint32_t *image_length, const char **error)
+{
+    rboot_write_status write = rboot_write_init(OTA_SLOT);
+    rboot_verify_status verify;
+    ota_delta_status image;
+    uint32_t verified_length;
+    size_t pos = 0;
+
+    rboot_verify_init(&verify, NULL, NULL);
+    ota_delta_init(&image, &write, &verify, RUNNING_SLOT, SLOT_SIZE);
+    while (pos < len) {
+        size_t n = next_rand() % 1468 + 1;
+        if (n > len - pos) {
+            n = len - pos;
+        }
+        if (!ota_delta_update(&image, data + pos, n)) {
+            break;
+        }
+        rboot_write_erase_ahead(&write, 1468);
+        pos += n;
+    }
+    return ota_delta_finish(&image, image_length, error)
+        && rboot_write_end(&write)
+        && rboot_verify_finish(&verify, &verified_length, error)
+        && verified_length == *image_length;
+}
+
+/* Receive `name` with `running` in the running slot, and check the
+   result is `expected` */
+static int check_receive(const char *running, const char *name, const char *expected)
+{
+    size_t src_len, len, expected_len;
+    uint8_t *src = load(running, &src_len);
+    uint8_t *data = load(name, &len);
+    uint8_t *target = load(expected, &expected_len);
+    uint32_t image_length;
+    const char *error = NULL;
+
+    check(src && data && target);
+    flash_load(RUNNING_SLOT, src, src_len);
+    check(receive(data, len, &image_length, &error));
+    check(image_length == expected_len);
+    check(!memcmp(flash + OTA_SLOT, target, expected_len));
+    free(src);
+    free(data);
+    free(target);
+    done();
+}
+
+int test_delta(void)
+{
+    for (int i = 0; i < 10; i++) {
+        int r = check_receive("app_v1.bin", "app_v2.delta", "app_v2.bin");
+        if (r) {
+            return r;
+        }
+    }
+    done();
+}
+
+int test_compressed(void)
+{
+    /* no source image, the running slot doesn't matter */
+    for (int i = 0; i < 10; i++) {
+        int r = check_receive("plain.bin", "app_v2.z", "app_v2.bin");
+        if (r) {
+            return r;
+        }
+    }
+    done();
+}
+
+int test_plain(void)
+{
+    int r = check_receive("app_v1.bin", "app_v2.bin", "app_v2.bin");
+    if (r) {
+        return r;
+    }
+    return check_receive("app_v1.bin", "plain.bin", "plain.bin");
+}
+
+/* A delta for a different running image has to be refused before
+   anything is written */
+static int check_wrong_source(const uint8_t *src, size_t src_len)
+{
+    size_t len;
+    uint8_t *data = load("app_v2.delta", &len);
+    uint32_t image_length;
+    const char *error = NULL;
+
+    check(data);
+    flash_load(RUNNING_SLOT, src, src_len);
+    check(!receive(data, len, &image_length, &error));
+    check(error && !strcmp(error, "Delta doesn't match running image"));
+    check(image_length == 0);
+    free(data);
+    done();
+}
+
+int test_wrong_source(void)
+{
+    size_t len;
+    uint8_t *src = load("app_v1.bin", &len);
+    int r;
+
+    check(src);
+    /* Same length, one byte different */
+    for (int i = 0; i < 20; i++) {
+        size_t pos = next_rand() % len;
+        src[pos] ^= 0x10;
+        r = check_wrong_source(src, len);
+        if (r) {
+            return r;
+        }
+        src[pos] ^= 0x10;
+    }
+    free(src);
+
+    src = load("app_v2.bin", &len);
+    check(src);
+    r = check_wrong_source(src, len);
+    free(src);
+    return r;
+}
+
+int test_truncated(void)
+{
+    size_t len;
+    uint8_t *src = load("app_v1.bin", &len);
+    uint8_t *data;
+    uint32_t image_length;
+    const char *error;
+
+    check(src);
+    flash_load(RUNNING_SLOT, src, len);
+    free(src);
+    data = load("app_v2.z", &len);
+    check(data);
+    for (int i = 0; i < 20; i++) {
+        error = NULL;
+        check(!receive(data, next_rand() % len, &image_length, &error));
+        check(error);
+    }
+    free(data);
+    done();
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <image directory>\n", argv[0]);
+        return 2;
+    }
+    image_dir = argv[1];
+    rand_state = 1;
+    test(test_delta, "delta against the running image");
+    test(test_compressed, "compressed image");
+    test(test_plain, "plain images");
+    test(test_wrong_source, "delta for a different running image");
+    test(test_truncated, "truncated image");
+    printf("\nPASSED: %d\nFAILED: %d\n", test_passed, test_failed);
+    return (test_failed > 0);
+}
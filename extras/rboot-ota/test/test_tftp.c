@@ -0,0 +1,632 @@
+/* Host test for the OTA TFTP client and server.
+ *
+ * ota-tftp.c is built against stand-ins for lwIP (stubs/) and talks to a
+ * scripted TFTP peer that sends an image, with packets dropped on
+ * purpose. The image decoder and verifier are replaced by a buffer that
+ * collects what would have been written to flash.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "../ota-tftp.c"
+
+/* Image decoder, verifier and rboot stand-ins */
+
+static uint8_t received[0x40000];
+static size_t received_len_total;
+
+void ota_delta_init(ota_delta_status *status, rboot_write_status *write, rboot_verify_status *verify,
+                    uint32_t src_offset, uint32_t limit)
+{
+    received_len_total = 0;
+}
+
+bool ota_delta_update(ota_delta_status *status, const uint8_t *data, size_t len)
+{
+    if (received_len_total + len > sizeof(received)) {
+        return false;
+    }
+    memcpy(received + received_len_total, data, len);
+    received_len_total += len;
+    return true;
+}
+
+bool ota_delta_finish(ota_delta_status *status, uint32_t *image_length, const char **error_message)
+{
+    if (image_length) {
+        *image_length = received_len_total;
+    }
+    return true;
+}
+
+void rboot_verify_init(rboot_verify_status *status, rboot_digest_update_fn digest_fn, void *digest_ctx)
+{
+    memset(status, 0, sizeof(*status));
+}
+
+bool rboot_verify_finish(rboot_verify_status *status, uint32_t *image_length, const char **error_message)
+{
+    if (image_length) {
+        *image_length = received_len_total;
+    }
+    return true;
+}
+
+rboot_write_status rboot_write_init(uint32 start_addr)
+{
+    rboot_write_status status = { .start_addr = start_addr };
+    return status;
+}
+
+bool rboot_write_erase_ahead(rboot_write_status *status, uint32 len)
+{
+    return true;
+}
+
+bool rboot_write_end(rboot_write_status *status)
+{
+    return true;
+}
+
+rboot_config rboot_get_config(void)
+{
+    rboot_config conf = {
+        .magic = BOOT_CONFIG_MAGIC,
+        .count = 2,
+        .current_rom = 0,
+        .roms = { 0x2000, 0x102000 },
+    };
+    return conf;
+}
+
+bool rboot_set_current_rom(uint8 rom)
+{
+    return true;
+}
+
+void sdk_system_restart(void)
+{
+}
+
+/* The peer: a TFTP server (for ota_tftp_download) or a client doing a
+   WRQ (for the server side), sending `image`. */
+
+#define PEER_PORT 40000
+
+typedef struct {
+    const uint8_t *image;
+    size_t len;
+    bool is_server;
+    bool options;           /* understands blksize/windowsize */
+    uint16_t max_blksize;   /* server: largest values it accepts */
+    uint16_t max_windowsize;
+    bool resend_request;    /* client: repeat the WRQ when waiting for the OACK */
+
+    uint16_t blksize;
+    uint16_t windowsize;
+    enum { PEER_IDLE, PEER_WAIT_ACK0, PEER_SENDING, PEER_DONE, PEER_FAILED } state;
+    uint16_t acked;
+    int data_sent;
+} peer_t;
+
+static peer_t peer;
+
+/* Link: packets queued for the device, and loss injection */
+
+#define QUEUE_LEN 16
+
+static struct netbuf *inbox[QUEUE_LEN];
+static int inbox_head, inbox_count;
+static uint32_t rand_state;
+static int loss_percent;        /* random loss of DATA and ACK packets */
+static int drop_to_peer[7];     /* drop the next n packets of an opcode */
+static int device_acks, device_oacks, timeouts;
+
+static bool lose(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return (int)((rand_state >> 16) % 100) < loss_percent;
+}
+
+static void send_to_device(const void *data, size_t len)
+{
+    uint16_t opcode = ((const uint8_t *)data)[1];
+
+    if ((opcode == TFTP_OP_DATA || opcode == TFTP_OP_ACK) && lose()) {
+        return;
+    }
+    if (inbox_count == QUEUE_LEN) {
+        return;  /* receive mailbox full */
+    }
+    struct netbuf *buf = netbuf_new();
+    memcpy(buf->data, data, len);
+    buf->len = len;
+    buf->split = len > 6 ? 4 + (len * 7 / 13) % (len - 4) : len;
+    buf->addr.addr = 0x0100a8c0;
+    buf->port = PEER_PORT;
+    inbox[(inbox_head + inbox_count++) % QUEUE_LEN] = buf;
+}
+
+static size_t add_option(uint8_t *p, const char *name, unsigned value)
+{
+    size_t len = strlen(name) + 1;
+    memcpy(p, name, len);
+    return len + sprintf((char *)p + len, "%u", value) + 1;
+}
+
+static void peer_send_request(void)
+{
+    uint8_t pkt[64] = { 0, TFTP_OP_WRQ };
+    size_t len = 2;
+
+    len += sprintf((char *)pkt + len, "firmware.bin") + 1;
+    len += sprintf((char *)pkt + len, "octet") + 1;
+    len += add_option(pkt + len, TFTP_OPT_BLKSIZE, peer.blksize);
+    len += add_option(pkt + len, TFTP_OPT_WINDOWSIZE, peer.windowsize);
+    send_to_device(pkt, len);
+}
+
+static void peer_send_oack(void)
+{
+    uint8_t pkt[64] = { 0, TFTP_OP_OACK };
+    size_t len = 2;
+
+    len += add_option(pkt + len, TFTP_OPT_BLKSIZE, peer.blksize);
+    len += add_option(pkt + len, TFTP_OPT_WINDOWSIZE, peer.windowsize);
+    send_to_device(pkt, len);
+}
+
+static uint16_t peer_last_block(void)
+{
+    return peer.len / peer.blksize + 1;
+}
+
+static void peer_send_window(void)
+{
+    uint8_t pkt[4 + TFTP_MAX_BLKSIZE];
+
+    for (uint16_t block = peer.acked + 1;
+         block <= peer.acked + peer.windowsize && block <= peer_last_block(); block++) {
+        size_t offs = (size_t)(block - 1) * peer.blksize;
+        size_t n = peer.len - offs < peer.blksize ? peer.len - offs : peer.blksize;
+        pkt[0] = 0;
+        pkt[1] = TFTP_OP_DATA;
+        pkt[2] = block >> 8;
+        pkt[3] = block & 0xff;
+        memcpy(pkt + 4, peer.image + offs, n);
+        send_to_device(pkt, 4 + n);
+        peer.data_sent++;
+    }
+}
+
+/* A packet from the device has reached the peer */
+static void peer_receive(const uint8_t *pkt, size_t len)
+{
+    uint16_t opcode = (pkt[0] << 8) | pkt[1];
+
+    switch (opcode) {
+    case TFTP_OP_RRQ: {
+        if (!peer.is_server || peer.state != PEER_IDLE) {
+            break;
+        }
+        /* Skip filename and mode, then pick up the requested options */
+        tftp_opts_t req = { 0 };
+        size_t i = 2;
+        int field = 0;
+        const char *name = NULL;
+        while (i < len) {
+            const char *s = (const char *)pkt + i;
+            if (field >= 2 && field % 2 == 0) {
+                name = s;
+            } else if (field >= 2) {
+                if (!strcmp(name, TFTP_OPT_BLKSIZE)) {
+                    req.blksize = atoi(s);
+                } else if (!strcmp(name, TFTP_OPT_WINDOWSIZE)) {
+                    req.windowsize = atoi(s);
+                }
+            }
+            i += strlen(s) + 1;
+            field++;
+        }
+        if (peer.options && req.blksize && req.windowsize) {
+            peer.blksize = req.blksize < peer.max_blksize ? req.blksize : peer.max_blksize;
+            peer.windowsize = req.windowsize < peer.max_windowsize ? req.windowsize : peer.max_windowsize;
+            peer.state = PEER_WAIT_ACK0;
+            peer_send_oack();
+        } else {
+            peer.blksize = TFTP_DEFAULT_BLKSIZE;
+            peer.windowsize = TFTP_DEFAULT_WINDOWSIZE;
+            peer.state = PEER_SENDING;
+            peer_send_window();
+        }
+        break;
+    }
+    case TFTP_OP_OACK:
+        if (!peer.is_server && peer.state == PEER_IDLE) {
+            peer.state = PEER_SENDING;
+            peer_send_window();
+        }
+        break;
+    case TFTP_OP_ACK: {
+        uint16_t block = (pkt[2] << 8) | pkt[3];
+        if (peer.state == PEER_IDLE || peer.state == PEER_WAIT_ACK0) {
+            if (block != 0) {
+                break;
+            }
+            peer.state = PEER_SENDING;
+        }
+        if (peer.state != PEER_SENDING || block < peer.acked) {
+            break;
+        }
+        peer.acked = block;
+        if (block == peer_last_block()) {
+            peer.state = PEER_DONE;
+        } else {
+            peer_send_window();
+        }
+        break;
+    }
+    case TFTP_OP_ERROR:
+        peer.state = PEER_FAILED;
+        break;
+    }
+}
+
+/* Both sides waited for a packet that didn't come */
+static void peer_timeout(void)
+{
+    switch (peer.state) {
+    case PEER_IDLE:
+        if (!peer.is_server && peer.resend_request) {
+            peer_send_request();
+        }
+        break;
+    case PEER_WAIT_ACK0:
+        peer_send_oack();
+        break;
+    case PEER_SENDING:
+        peer_send_window();
+        break;
+    default:
+        break;
+    }
+}
+
+/* lwIP stand-ins */
+
+const ip_addr_t ip_addr_any;
+static struct netconn {
+    int dummy;
+} the_conn;
+
+struct netbuf *netbuf_new(void)
+{
+    return calloc(1, sizeof(struct netbuf));
+}
+
+void netbuf_delete(struct netbuf *buf)
+{
+    free(buf);
+}
+
+void *netbuf_alloc(struct netbuf *buf, u16_t size)
+{
+    buf->len = size;
+    buf->split = size;
+    return buf->data;
+}
+
+u16_t netbuf_len(struct netbuf *buf)
+{
+    return buf->len;
+}
+
+u16_t netbuf_copy_partial(struct netbuf *buf, void *dataptr, u16_t len, u16_t offset)
+{
+    if (offset >= buf->len) {
+        return 0;
+    }
+    if (len > buf->len - offset) {
+        len = buf->len - offset;
+    }
+    memcpy(dataptr, buf->data + offset, len);
+    return len;
+}
+
+void netbuf_first(struct netbuf *buf)
+{
+    buf->seg = 0;
+}
+
+s8_t netbuf_next(struct netbuf *buf)
+{
+    if (buf->seg == 0 && buf->split < buf->len) {
+        buf->seg = 1;
+        return 1;
+    }
+    return -1;
+}
+
+err_t netbuf_data(struct netbuf *buf, void **dataptr, u16_t *len)
+{
+    if (buf->seg == 0) {
+        *dataptr = buf->data;
+        *len = buf->split;
+    } else {
+        *dataptr = buf->data + buf->split;
+        *len = buf->len - buf->split;
+    }
+    return ERR_OK;
+}
+
+struct netconn *netconn_new(enum netconn_type type)
+{
+    return &the_conn;
+}
+
+err_t netconn_delete(struct netconn *conn)
+{
+    return ERR_OK;
+}
+
+err_t netconn_bind(struct netconn *conn, const ip_addr_t *addr, u16_t port)
+{
+    return ERR_OK;
+}
+
+err_t netconn_connect(struct netconn *conn, const ip_addr_t *addr, u16_t port)
+{
+    return ERR_OK;
+}
+
+err_t netconn_disconnect(struct netconn *conn)
+{
+    return ERR_OK;
+}
+
+void netconn_set_recvtimeout(struct netconn *conn, int timeout)
+{
+}
+
+err_t netconn_gethostbyname(const char *name, ip_addr_t *addr)
+{
+    addr->addr = 0x0100a8c0;
+    return ERR_OK;
+}
+
+err_t netconn_recv(struct netconn *conn, struct netbuf **new_buf)
+{
+    if (!inbox_count) {
+        timeouts++;
+        peer_timeout();
+        *new_buf = NULL;
+        return ERR_TIMEOUT;
+    }
+    *new_buf = inbox[inbox_head];
+    inbox_head = (inbox_head + 1) % QUEUE_LEN;
+    inbox_count--;
+    return ERR_OK;
+}
+
+err_t netconn_send(struct netconn *conn, struct netbuf *buf)
+{
+    uint16_t opcode = buf->data[1];
+
+    if (opcode == TFTP_OP_ACK) {
+        device_acks++;
+    } else if (opcode == TFTP_OP_OACK) {
+        device_oacks++;
+    }
+    if (opcode < 7 && drop_to_peer[opcode]) {
+        drop_to_peer[opcode]--;
+        return ERR_OK;
+    }
+    if ((opcode == TFTP_OP_DATA || opcode == TFTP_OP_ACK) && lose()) {
+        return ERR_OK;
+    }
+    peer_receive(buf->data, buf->len);
+    return ERR_OK;
+}
+
+/* Test setup */
+
+static uint8_t image[100000];
+
+static void reset(size_t len, uint32_t seed)
+{
+    while (inbox_count) {
+        netbuf_delete(inbox[inbox_head]);
+        inbox_head = (inbox_head + 1) % QUEUE_LEN;
+        inbox_count--;
+    }
+    memset(&peer, 0, sizeof(peer));
+    memset(drop_to_peer, 0, sizeof(drop_to_peer));
+    loss_percent = 0;
+    device_acks = device_oacks = timeouts = 0;
+    rand_state = seed;
+    for (size_t i = 0; i < len; i++) {
+        image[i] = (uint8_t)(i * 31 + (i >> 8) + seed);
+    }
+    peer.image = image;
+    peer.len = len;
+    received_len_total = 0;
+}
+
+static bool received_ok(void)
+{
+    return received_len_total == peer.len && !memcmp(received, image, peer.len);
+}
+
+/* Run the server's receive loop after its answer to a WRQ */
+static err_t run_server(bool options)
+{
+    tftp_opts_t opts = { 0 };
+    tftp_opts_t oack;
+    size_t len;
+    rboot_verify_status verify;
+
+    peer.is_server = false;
+    if (options) {
+        peer.blksize = opts.blksize = TFTP_MAX_BLKSIZE;
+        peer.windowsize = opts.windowsize = TFTP_MAX_WINDOWSIZE;
+        oack = opts;
+        tftp_send_oack(&the_conn, &oack);
+    } else {
+        peer.blksize = opts.blksize = TFTP_DEFAULT_BLKSIZE;
+        peer.windowsize = opts.windowsize = TFTP_DEFAULT_WINDOWSIZE;
+        tftp_send_ack(&the_conn, 0);
+    }
+    rboot_verify_init(&verify, NULL, NULL);
+    return tftp_receive_data(&the_conn, 0x102000, 0x102000 + MAX_IMAGE_SIZE, 0x2000, &len,
+                             &opts, options ? &oack : NULL, &verify, NULL, 0, NULL);
+}
+
+/* Tests */
+
+int test_client_plain(void)
+{
+    reset(10000, 1);
+    peer.is_server = true;
+    check(ota_tftp_download("server", TFTP_PORT, "firmware.bin", 1000, 1, NULL) == ERR_OK);
+    check(received_ok());
+    check(peer.blksize == 512);
+    check(device_acks == 10000 / 512 + 1);
+    done();
+}
+
+int test_client_options(void)
+{
+    reset(100000, 2);
+    peer.is_server = true;
+    peer.options = true;
+    peer.max_blksize = 2048;
+    peer.max_windowsize = 16;
+    check(ota_tftp_download("server", TFTP_PORT, "firmware.bin", 1000, 1, NULL) == ERR_OK);
+    check(received_ok());
+    check(peer.blksize == TFTP_MAX_BLKSIZE);
+    check(peer.windowsize == TFTP_MAX_WINDOWSIZE);
+    /* ACK 0 for the OACK, one per window, one for the last block */
+    check(device_acks == 1 + (100000 / TFTP_MAX_BLKSIZE) / TFTP_MAX_WINDOWSIZE + 1);
+    done();
+}
+
+int test_client_smaller_options(void)
+{
+    /* Image length a multiple of the block size, ends with an empty block */
+    reset(1024 * 20, 3);
+    peer.is_server = true;
+    peer.options = true;
+    peer.max_blksize = 1024;
+    peer.max_windowsize = 2;
+    check(ota_tftp_download("server", TFTP_PORT, "firmware.bin", 1000, 1, NULL) == ERR_OK);
+    check(received_ok());
+    check(peer.blksize == 1024);
+    check(peer.state == PEER_DONE);
+    done();
+}
+
+int test_client_lost_ack0(void)
+{
+    reset(5000, 4);
+    peer.is_server = true;
+    peer.options = true;
+    peer.max_blksize = TFTP_MAX_BLKSIZE;
+    peer.max_windowsize = TFTP_MAX_WINDOWSIZE;
+    drop_to_peer[TFTP_OP_ACK] = 1;
+    check(ota_tftp_download("server", TFTP_PORT, "firmware.bin", 1000, 1, NULL) == ERR_OK);
+    check(received_ok());
+    done();
+}
+
+int test_server_plain(void)
+{
+    reset(10000, 5);
+    check(run_server(false) == ERR_OK);
+    check(received_ok());
+    check(peer.state == PEER_DONE);
+    done();
+}
+
+int test_server_options(void)
+{
+    reset(100000, 6);
+    check(run_server(true) == ERR_OK);
+    check(received_ok());
+    check(peer.state == PEER_DONE);
+    check(device_oacks == 1);
+    done();
+}
+
+int test_server_lost_oack(void)
+{
+    /* The client waits for the OACK without repeating its WRQ, so the
+       server has to send it again */
+    reset(20000, 7);
+    drop_to_peer[TFTP_OP_OACK] = 2;
+    check(run_server(true) == ERR_OK);
+    check(received_ok());
+    check(device_oacks == 3);
+    check(timeouts == 2);
+    done();
+}
+
+int test_server_lost_oack_repeated_wrq(void)
+{
+    reset(20000, 8);
+    peer.resend_request = true;
+    drop_to_peer[TFTP_OP_OACK] = 1;
+    check(run_server(true) == ERR_OK);
+    check(received_ok());
+    check(peer.state == PEER_DONE);
+    done();
+}
+
+int test_server_lost_ack0(void)
+{
+    reset(3000, 9);
+    drop_to_peer[TFTP_OP_ACK] = 1;
+    check(run_server(false) == ERR_OK);
+    check(received_ok());
+    done();
+}
+
+int test_lossy(void)
+{
+    for (uint32_t seed = 100; seed < 140; seed++) {
+        reset(60000 + seed * 37, seed);
+        loss_percent = 10;
+        peer.is_server = true;
+        peer.options = true;
+        peer.max_blksize = TFTP_MAX_BLKSIZE;
+        peer.max_windowsize = TFTP_MAX_WINDOWSIZE;
+        check(ota_tftp_download("server", TFTP_PORT, "firmware.bin", 1000, 1, NULL) == ERR_OK);
+        check(received_ok());
+
+        reset(60000 + seed * 37, seed);
+        loss_percent = 10;
+        check(run_server(seed & 1) == ERR_OK);
+        check(received_ok());
+    }
+    done();
+}
+
+int main(void)
+{
+    test(test_client_plain, "client, server without options");
+    test(test_client_options, "client, blksize and windowsize");
+    test(test_client_smaller_options, "client, server lowers options");
+    test(test_client_lost_ack0, "client, ACK 0 lost");
+    test(test_server_plain, "server, client without options");
+    test(test_server_options, "server, blksize and windowsize");
+    test(test_server_lost_oack, "server, OACK lost");
+    test(test_server_lost_oack_repeated_wrq, "server, OACK lost, WRQ repeated");
+    test(test_server_lost_ack0, "server, ACK 0 lost");
+    test(test_lossy, "10% loss of DATA and ACK packets");
+    printf("\nPASSED: %d\nFAILED: %d\n", test_passed, test_failed);
+    return (test_failed > 0);
+}
@@ -0,0 +1,124 @@
+/* Host test for the incremental image verifier.
+ *
+ * Each image given on the command line is replayed through
+ * rboot_verify_update() in random sized chunks, and the result compared
+ * with rboot_verify_image() and rboot_digest_image() on the same image in
+ * (emulated) flash. Then the same again with single bytes corrupted and
+ * with the image truncated.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "test.h"
+#include "flash.h"
+#include "../rboot-api.c"
+
+#define SLOT 0x2000
+
+static uint8_t digest[0x110000];
+static size_t digest_len;
+
+static void digest_update(void *ctx, void *data, size_t len)
+{
+    memcpy(digest + digest_len, data, len);
+    digest_len += len;
+}
+
+static uint32_t rand_state;
+
+static uint32_t next_rand(void)
+{
+    rand_state = rand_state * 1103515245 + 12345;
+    return rand_state >> 8;
+}
+
+/* Feed len bytes of data to the verifier in random chunks of 1 to
+   max_chunk bytes. Returns the verifier's result. */
+static bool stream(const uint8_t *data, size_t len, size_t max_chunk, uint32_t *image_length)
+{
+    rboot_verify_status status;
+    size_t pos = 0;
+
+    rboot_verify_init(&status, digest_update, NULL);
+    digest_len = 0;
+    while (pos < len) {
+        size_t n = next_rand() % max_chunk + 1;
+        if (n > len - pos) {
+            n = len - pos;
+        }
+        rboot_verify_update(&status, data + pos, n);
+        pos += n;
+    }
+    return rboot_verify_finish(&status, image_length, NULL);
+}
+
+/* Verify from flash, and the digest rboot_digest_image() would produce */
+static bool from_flash(const uint8_t *data, size_t len, uint32_t *image_length)
+{
+    flash_load(SLOT, data, len);
+    if (!rboot_verify_image(SLOT, image_length, NULL)) {
+        return false;
+    }
+    digest_len = 0;
+    return rboot_digest_image(SLOT, *image_length, digest_update, NULL);
+}
+
+static const char *image_path;
+
+static int test_replay(void)
+{
+    size_t len;
+    uint8_t *image = read_file(image_path, &len);
+    static uint8_t expected_digest[sizeof(digest)];
+    uint32_t flash_len, stream_len;
+    bool ok;
+
+    check(image);
+    check(from_flash(image, len, &flash_len));
+    memcpy(expected_digest, digest, digest_len);
+
+    /* Whole image, in chunks from single bytes up to TFTP blocks */
+    for (size_t max_chunk = 1; max_chunk <= 2048; max_chunk *= 2) {
+        check(stream(image, len, max_chunk, &stream_len));
+        check(stream_len == flash_len);
+        check(digest_len == flash_len);
+        check(!memcmp(digest, expected_digest, flash_len));
+    }
+
+    /* Single corrupted bytes: both verifiers have to agree */
+    for (int i = 0; i < 300; i++) {
+        size_t pos = next_rand() % flash_len;
+        uint8_t old = image[pos];
+        image[pos] ^= 1 << (next_rand() % 8);
+        ok = from_flash(image, len, &flash_len);
+        check(stream(image, len, 1500, &stream_len) == ok);
+        if (ok) {
+            check(stream_len == flash_len);
+        }
+        image[pos] = old;
+        check(from_flash(image, len, &flash_len));
+    }
+
+    /* Truncated images */
+    for (int i = 0; i < 50; i++) {
+        check(!stream(image, next_rand() % flash_len, 1500, &stream_len));
+    }
+
+    free(image);
+    done();
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++) {
+        rand_state = i;
+        image_path = argv[i];
+        test(test_replay, image_path);
+    }
+    printf("\nPASSED: %d\nFAILED: %d\n", test_passed, test_failed);
+    return (test_failed > 0);
+}
@@ -0,0 +1,65 @@
+/**
+ * sensor_sched adapter for the BMP180.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include "sensor_sched.h"
+#include "bmp180/bmp180.h"
+
+// The temperature is needed to compensate the pressure, so the trigger
+// starts the short temperature conversion, and the step reads it and
+// starts the pressure conversion. The scheduler runs the steps of all
+// BMP180s after one wait, and both conversions overlap with the other
+// sensors.
+//
+// The driver keeps one bus for all its functions, so each call selects
+// the sensor's bus first.
+static int bmp180_trigger(void *dev)
+{
+    sensor_bmp180_t *s = dev;
+    uint32_t us;
+
+    bmp180_set_bus(s->bus);
+    us = bmp180_start_temperature();
+    if (!us) {
+        return -1;
+    }
+    return (us + 999) / 1000;
+}
+
+static int bmp180_step(void *dev)
+{
+    sensor_bmp180_t *s = dev;
+    uint32_t us;
+
+    bmp180_set_bus(s->bus);
+    if (!bmp180_read_raw_temperature(&s->ut)) {
+        return -1;
+    }
+    us = bmp180_start_pressure(s->oss);
+    if (!us) {
+        return -1;
+    }
+    return (us + 999) / 1000;
+}
+
+static bool bmp180_read(void *dev, int32_t *values)
+{
+    sensor_bmp180_t *s = dev;
+    uint32_t up, pressure;
+
+    bmp180_set_bus(s->bus);
+    if (!bmp180_read_raw_pressure(s->oss, &up)) {
+        return false;
+    }
+    bmp180_compensate(s->constants, s->ut, up, s->oss, &values[0], &pressure);
+    values[1] = pressure;
+    return true;
+}
+
+const sensor_ops_t sensor_ops_bmp180 = {
+    .trigger = bmp180_trigger,
+    .step = bmp180_step,
+    .read = bmp180_read,
+};
@@ -0,0 +1,96 @@
+/**
+ * sensor_sched adapter for the BMP280/BME280.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include "sensor_sched.h"
+#include "bmp280/bmp280.h"
+#include "task.h"
+
+// Registers read in one transfer: ctrl_hum (BME280 only), status, ctrl
+#define REG_CTRL_HUM 0xf2
+#define CTRL_HUM 0
+#define STATUS 1
+#define CTRL 2
+#define STATUS_MEASURING (1 << 3)
+
+// Oversampling register setting to number of samples, 0 is skipped
+static inline uint32_t samples(uint8_t osrs)
+{
+    return osrs ? 1 << ((osrs > 5 ? 5 : osrs) - 1) : 0;
+}
+
+// Maximum measurement time in microseconds for the oversampling settings
+// in regs, from appendix B of the BME280 datasheet (the BMP280 datasheet
+// gives the same times). bmp280_t doesn't keep the settings, so they are
+// read back from the sensor.
+static uint32_t measurement_us(bmp280_t *dev, const uint8_t *regs)
+{
+    uint32_t t = samples(regs[CTRL] >> 5);
+    uint32_t p = samples((regs[CTRL] >> 2) & 7);
+    uint32_t h = dev->id == BME280_CHIP_ID ? samples(regs[CTRL_HUM] & 7) : 0;
+
+    return 1250 + 2300 * t + (p ? 2300 * p + 575 : 0) + (h ? 2300 * h + 575 : 0);
+}
+
+static bool read_regs(bmp280_t *dev, uint8_t *regs)
+{
+    return i2c_bus_read_regs(dev->bus, dev->i2c_addr, REG_CTRL_HUM, regs, 3);
+}
+
+static int bmp280_trigger(void *dev)
+{
+    bmp280_t *d = dev;
+    uint8_t regs[3];
+
+    if (!read_regs(d, regs)) {
+        return -1;
+    }
+    uint8_t ctrl = (regs[CTRL] & ~3) | BMP280_MODE_FORCED;
+    if (!i2c_bus_write_regs(d->bus, d->i2c_addr, REG_CTRL_HUM + CTRL, &ctrl, 1)) {
+        return -1;
+    }
+    return (measurement_us(d, regs) + 999) / 1000;
+}
+
+// The scheduler has waited the time returned by the trigger, but the
+// sensor's clock may run slow, so wait up to one more measurement time
+// for the busy flag to clear. bmp280_is_measuring() can't tell a bus error
+// from "done", hence the register read here.
+static bool bmp280_read(void *dev, int32_t *values)
+{
+    bmp280_t *d = dev;
+    uint8_t regs[3];
+
+    if (!read_regs(d, regs)) {
+        return false;
+    }
+    if (regs[STATUS] & STATUS_MEASURING) {
+        uint32_t ms = (measurement_us(d, regs) + 999) / 1000;
+        // The first tick can come right away, so wait one more
+        portTickType ticks = (ms + portTICK_RATE_MS - 1) / portTICK_RATE_MS + 1;
+        for (; regs[STATUS] & STATUS_MEASURING; ticks--) {
+            if (ticks == 0) {
+                return false;
+            }
+            vTaskDelay(1);
+            if (!read_regs(d, regs)) {
+                return false;
+            }
+        }
+    }
+
+    uint32_t pressure, humidity = 0;
+    if (!bmp280_read_fixed(d, &values[0], &pressure, &humidity)) {
+        return false;
+    }
+    values[1] = pressure;
+    values[2] = humidity;
+    return true;
+}
+
+const sensor_ops_t sensor_ops_bmp280 = {
+    .trigger = bmp280_trigger,
+    .read = bmp280_read,
+};
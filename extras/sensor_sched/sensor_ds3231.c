@@ -0,0 +1,27 @@
+/**
+ * sensor_sched adapter for the DS3231 temperature sensor.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include "sensor_sched.h"
+#include "ds3231/ds3231.h"
+
+// The DS3231 converts on its own every 64 seconds. The driver keeps one
+// bus, so select the sensor's first.
+static bool ds3231_read(void *dev, int32_t *values)
+{
+    sensor_ds3231_t *s = dev;
+    int16_t temp;
+
+    ds3231_setBus(s->bus);
+    if (!ds3231_getRawTemp(&temp)) {
+        return false;
+    }
+    values[0] = temp;
+    return true;
+}
+
+const sensor_ops_t sensor_ops_ds3231 = {
+    .read = ds3231_read,
+};
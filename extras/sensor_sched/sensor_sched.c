@@ -0,0 +1,218 @@
+/**
+ * Periodic sampling of many sensors from one task.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include "sensor_sched.h"
+#include <string.h>
+#include "task.h"
+
+typedef struct {
+    const sensor_ops_t *ops;
+    void *dev;
+    const void *bus;
+    portTickType period;
+    portTickType next;          // when the next sample is due
+    uint32_t errors;
+    // Latest reading, double buffered: the task writes the slot readers
+    // aren't using and then bumps seq, so readers never wait for it.
+    volatile uint32_t seq;
+    sensor_reading_t slot[2];
+} sensor_t;
+
+static sensor_t sensors[SENSOR_SCHED_MAX_SENSORS];
+static int sensor_count;
+// Sampling order, sensors of one bus next to each other
+static uint8_t order[SENSOR_SCHED_MAX_SENSORS];
+static xTaskHandle sched_task;
+
+#define compiler_barrier() __asm__ volatile("" ::: "memory")
+
+static void publish(sensor_t *s, const int32_t *values, bool ok)
+{
+    const sensor_reading_t *cur = &s->slot[s->seq & 1];
+    sensor_reading_t *next = &s->slot[(s->seq + 1) & 1];
+
+    if (ok) {
+        memcpy(next->values, values, sizeof(next->values));
+        next->timestamp = xTaskGetTickCount();
+        next->valid = true;
+    } else {
+        s->errors++;
+        memcpy(next, cur, sizeof(sensor_reading_t));
+    }
+    next->errors = s->errors;
+    compiler_barrier();
+    s->seq++;
+}
+
+static inline bool is_due(const sensor_t *s, portTickType now)
+{
+    return (int32_t)(now - s->next) >= 0;
+}
+
+// Tick by which a conversion started before `from` that takes `ms` is done.
+// The first tick can come right away, so wait one more.
+static inline portTickType done_by(portTickType from, int ms)
+{
+    return ms ? from + (ms + portTICK_RATE_MS - 1) / portTICK_RATE_MS + 1 : from;
+}
+
+static void sleep_until(portTickType t)
+{
+    portTickType now = xTaskGetTickCount();
+
+    if ((int32_t)(t - now) > 0) {
+        vTaskDelay(t - now);
+    }
+}
+
+static void sched_task_fn(void *arg)
+{
+    bool due[SENSOR_SCHED_MAX_SENSORS];
+    int32_t values[SENSOR_SCHED_MAX_VALUES];
+
+    for (;;) {
+        portTickType now = xTaskGetTickCount();
+        int wait_ms = 0, step_ms = 0;
+        bool steps = false;
+
+        // Start all due conversions
+        for (int i = 0; i < sensor_count; i++) {
+            sensor_t *s = &sensors[order[i]];
+            due[i] = is_due(s, now);
+            if (!due[i] || !s->ops->trigger) {
+                continue;
+            }
+            int ms = s->ops->trigger(s->dev);
+            if (ms < 0) {
+                due[i] = false;
+                publish(s, NULL, false);
+            } else if (s->ops->step) {
+                steps = true;
+                if (ms > step_ms) {
+                    step_ms = ms;
+                }
+            } else if (ms > wait_ms) {
+                wait_ms = ms;
+            }
+        }
+        portTickType triggered = xTaskGetTickCount();
+        portTickType ready = done_by(triggered, wait_ms);
+
+        // Run the second steps together, the other conversions go on
+        if (steps) {
+            sleep_until(done_by(triggered, step_ms));
+            step_ms = 0;
+            for (int i = 0; i < sensor_count; i++) {
+                sensor_t *s = &sensors[order[i]];
+                if (!due[i] || !s->ops->trigger || !s->ops->step) {
+                    continue;
+                }
+                int ms = s->ops->step(s->dev);
+                if (ms < 0) {
+                    due[i] = false;
+                    publish(s, NULL, false);
+                } else if (ms > step_ms) {
+                    step_ms = ms;
+                }
+            }
+            portTickType stepped = done_by(xTaskGetTickCount(), step_ms);
+            if ((int32_t)(stepped - ready) > 0) {
+                ready = stepped;
+            }
+        }
+        sleep_until(ready);
+
+        // Read the results
+        for (int i = 0; i < sensor_count; i++) {
+            sensor_t *s = &sensors[order[i]];
+            if (due[i]) {
+                memset(values, 0, sizeof(values));
+                publish(s, values, s->ops->read(s->dev, values));
+            }
+            if (is_due(s, now)) {
+                s->next += s->period;
+                // Skip samples rather than catching up after a delay
+                if (is_due(s, now)) {
+                    s->next = now + s->period;
+                }
+            }
+        }
+
+        // Sleep until the next sensor is due
+        now = xTaskGetTickCount();
+        portTickType next = now + portMAX_DELAY / 2;
+        for (int i = 0; i < sensor_count; i++) {
+            if ((int32_t)(sensors[i].next - next) < 0) {
+                next = sensors[i].next;
+            }
+        }
+        if ((int32_t)(next - now) > 0) {
+            vTaskDelay(next - now);
+        }
+    }
+}
+
+int sensor_sched_add(const sensor_ops_t *ops, void *dev, const void *bus,
+                     uint32_t period_ms)
+{
+    if (sched_task || sensor_count == SENSOR_SCHED_MAX_SENSORS) {
+        return -1;
+    }
+
+    int id = sensor_count++;
+    sensor_t *s = &sensors[id];
+    memset(s, 0, sizeof(sensor_t));
+    s->ops = ops;
+    s->dev = dev;
+    s->bus = bus;
+    s->period = period_ms / portTICK_RATE_MS;
+    if (s->period == 0) {
+        s->period = 1;
+    }
+
+    // Insert after the last sensor on the same bus
+    int pos = id;
+    for (int i = 0; i < id; i++) {
+        if (sensors[order[i]].bus == bus) {
+            pos = i + 1;
+        }
+    }
+    memmove(&order[pos + 1], &order[pos], id - pos);
+    order[pos] = id;
+
+    return id;
+}
+
+bool sensor_sched_start(unsigned priority, unsigned stack_depth)
+{
+    portTickType now = xTaskGetTickCount();
+
+    for (int i = 0; i < sensor_count; i++) {
+        sensors[i].next = now;
+    }
+    return xTaskCreate(sched_task_fn, (signed char *)"sensor_sched",
+                       stack_depth, NULL, priority, &sched_task) == pdPASS;
+}
+
+bool sensor_sched_get(int id, sensor_reading_t *reading)
+{
+    if (id < 0 || id >= sensor_count) {
+        return false;
+    }
+
+    sensor_t *s = &sensors[id];
+    uint32_t seq;
+    do {
+        // Retry if the task published while we were copying, it could
+        // have gone on to write the slot we were reading.
+        seq = s->seq;
+        compiler_barrier();
+        memcpy(reading, &s->slot[seq & 1], sizeof(sensor_reading_t));
+        compiler_barrier();
+    } while (seq != s->seq);
+
+    return true;
+}
@@ -0,0 +1,116 @@
+/**
+ * Periodic sampling of many sensors from one task.
+ *
+ * Each sensor is added with a sample period. A scheduler task wakes up when
+ * sensors are due, starts the conversion on all of them (grouped by bus),
+ * waits once for the longest conversion time and then reads all of them,
+ * so the conversions overlap instead of running one after another. The
+ * latest reading of each sensor is kept in a table that other tasks can
+ * read at any time without locking.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __SENSOR_SCHED_H__
+#define __SENSOR_SCHED_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "FreeRTOS.h"
+#include "i2c/i2c.h"
+
+#ifndef SENSOR_SCHED_MAX_SENSORS
+#define SENSOR_SCHED_MAX_SENSORS 16
+#endif
+
+#define SENSOR_SCHED_MAX_VALUES 3
+
+/**
+ * Driver functions for one type of sensor. `dev` is the pointer passed to
+ * sensor_sched_add().
+ */
+typedef struct {
+    /**
+     * Start a conversion (optional, NULL if read() does everything).
+     * @return Time in milliseconds until the result can be read, or -1 on
+     *         error.
+     */
+    int (*trigger)(void *dev);
+    /**
+     * Read the result into up to SENSOR_SCHED_MAX_VALUES values.
+     * @return false on error.
+     */
+    bool (*read)(void *dev, int32_t *values);
+    /**
+     * Second step of a conversion that needs one (optional, only used with
+     * a trigger). Called once the time returned by the trigger has passed,
+     * for all due sensors after one wait.
+     * @return Time in milliseconds until the result can be read, or -1 on
+     *         error.
+     */
+    int (*step)(void *dev);
+} sensor_ops_t;
+
+typedef struct {
+    int32_t values[SENSOR_SCHED_MAX_VALUES];
+    portTickType timestamp;  ///< tick count when the values were read
+    uint32_t errors;         ///< failed samples so far
+    bool valid;              ///< false until the first successful sample
+} sensor_reading_t;
+
+/**
+ * Add a sensor. Sensors can only be added before sensor_sched_start().
+ *
+ * @param bus Sensors with the same bus are sampled together. Usually the
+ *            i2c_bus_t pointer, or NULL.
+ * @param period_ms Sample period in milliseconds.
+ * @return Sensor ID for sensor_sched_get(), or -1 if the table is full.
+ */
+int sensor_sched_add(const sensor_ops_t *ops, void *dev, const void *bus,
+                     uint32_t period_ms);
+
+/**
+ * Start the scheduler task. All sensors are sampled right away, then
+ * according to their periods.
+ */
+bool sensor_sched_start(unsigned priority, unsigned stack_depth);
+
+/**
+ * Get the latest reading of a sensor. Never blocks.
+ *
+ * @return false if the ID is invalid.
+ */
+bool sensor_sched_get(int id, sensor_reading_t *reading);
+
+/*
+ * Adapters for the drivers in extras. Link the driver component too.
+ */
+
+/** BMP280/BME280 in forced mode. `dev` is a bmp280_t set up with
+ *  BMP280_MODE_FORCED. The conversion time follows the oversampling
+ *  settings. Values are those of bmp280_read_fixed() (temperature,
+ *  pressure, humidity). */
+extern const sensor_ops_t sensor_ops_bmp280;
+
+/** BMP180. `dev` is a sensor_bmp180_t. Values are those of
+ *  bmp180_measure() (temperature, pressure). */
+extern const sensor_ops_t sensor_ops_bmp180;
+
+struct bmp180_constants;
+
+typedef struct {
+    i2c_bus_t *bus;                      ///< as for bmp180_set_bus()
+    struct bmp180_constants *constants;  ///< from bmp180_fillInternalConstants()
+    uint8_t oss;                         ///< pressure oversampling, 0 to 3
+    int32_t ut;                          ///< used by the adapter
+} sensor_bmp180_t;
+
+/** DS3231 temperature. `dev` is a sensor_ds3231_t. The value is in 1/4
+ *  degrees Celsius (ds3231_getRawTemp()). */
+extern const sensor_ops_t sensor_ops_ds3231;
+
+typedef struct {
+    i2c_bus_t *bus;                      ///< as for ds3231_setBus()
+} sensor_ds3231_t;
+
+#endif  // __SENSOR_SCHED_H__
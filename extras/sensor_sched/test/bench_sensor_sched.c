@@ -0,0 +1,176 @@
+/* Host benchmark of the sensor scheduler on the mock I2C bus.
+ *
+ * Twelve sensors on six buses: a BMP180 and five BMP280s at x4 pressure
+ * oversampling, six BME280s at x16 everything. Prints the (mock) time one
+ * sample of all of them takes one after another, as a task using the
+ * drivers directly would do it, and with the scheduler, and how much of it
+ * is busy waiting and bus time. Then the (host) time of sensor_sched_get().
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "mock_i2c.h"
+#include "../sensor_sched.c"
+#include "bmp280/bmp280.h"
+#include "bmp180/bmp180.h"
+
+#define BUSES 6
+#define GETS 10000000
+#define SAMPLES 5
+
+static i2c_bus_t bus[BUSES];
+static mock_i2c_dev_t mock[2 * BUSES];
+static bmp280_t bmp280[2 * BUSES];
+static bmp180_constants_t constants;
+static sensor_bmp180_t bmp180 = { &bus[0], &constants, 3 };
+
+static void setup(void)
+{
+    bmp280_params_t params;
+    uint8_t x16 = (5 << 5) | (5 << 2);
+
+    mock_i2c_reset();
+    for (int i = 0; i < BUSES; i++) {
+        bus[i].id = i;
+        for (int j = 0; j < 2; j++) {
+            bmp280_t *dev = &bmp280[2 * i + j];
+            if (i == 0 && j == 1) {
+                mock_bmp180_init(&mock[1], &bus[0]);
+                continue;
+            }
+            mock_bmp280_init(&mock[2 * i + j], &bus[i], BMP280_I2C_ADDRESS_0 + j,
+                             j ? BMP280_CHIP_ID : BME280_CHIP_ID);
+            bmp280_init_default_params(&params);
+            params.mode = BMP280_MODE_FORCED;
+            params.oversampling_humidity = BMP280_ULTRA_HIGH_RES;
+            dev->i2c_addr = BMP280_I2C_ADDRESS_0 + j;
+            bmp280_init_bus(dev, &bus[i], &params);
+            if (!j) {
+                i2c_bus_write_regs(&bus[i], dev->i2c_addr, 0xf4, &x16, 1);
+            }
+        }
+    }
+    bmp180_set_bus(&bus[0]);
+    bmp180_fillInternalConstants(&constants);
+    mock_now_us = mock_busy_us = mock_bus_us = 0;
+}
+
+static void report(const char *name)
+{
+    printf("%-36s %6.1f ms, %5.1f ms busy waiting, %5.1f ms on the buses\n", name,
+           mock_now_us / 1000.0, mock_busy_us / 1000.0, mock_bus_us / 1000.0);
+}
+
+/* Each sensor in turn with the drivers' own functions */
+static void one_by_one(void)
+{
+    int32_t t;
+    uint32_t p, h;
+
+    setup();
+    for (int i = 0; i < 2 * BUSES; i++) {
+        if (i == 1) {
+            bmp180_measure(&constants, &t, &p, 3);
+            continue;
+        }
+        bmp280_force_measurement(&bmp280[i]);
+        while (bmp280_is_measuring(&bmp280[i])) {
+            vTaskDelay(1);
+        }
+        bmp280_read_fixed(&bmp280[i], &t, &p, &h);
+    }
+    report("one after another, drivers");
+}
+
+/* Each sensor in turn through the adapters */
+static void one_by_one_adapters(void)
+{
+    int32_t values[SENSOR_SCHED_MAX_VALUES];
+
+    setup();
+    for (int i = 0; i < 2 * BUSES; i++) {
+        const sensor_ops_t *ops = i == 1 ? &sensor_ops_bmp180 : &sensor_ops_bmp280;
+        void *dev = i == 1 ? (void *)&bmp180 : (void *)&bmp280[i];
+        int ms = ops->trigger(dev);
+        vTaskDelay((ms + portTICK_RATE_MS - 1) / portTICK_RATE_MS + 1);
+        if (ops->step) {
+            ms = ops->step(dev);
+            vTaskDelay((ms + portTICK_RATE_MS - 1) / portTICK_RATE_MS + 1);
+        }
+        ops->read(dev, values);
+    }
+    report("one after another, adapters");
+}
+
+static void scheduled(void)
+{
+    portTickType last = 0;
+    sensor_reading_t r;
+
+    setup();
+    for (int i = 0; i < 2 * BUSES; i++) {
+        if (i == 1) {
+            sensor_sched_add(&sensor_ops_bmp180, &bmp180, &bus[0], 1000);
+        } else {
+            sensor_sched_add(&sensor_ops_bmp280, &bmp280[i], &bus[i / 2], 1000);
+        }
+    }
+    sensor_sched_start(2, 512);
+    // Stop in the sleep after the first round
+    mock_stop_us = 500000;
+    if (!setjmp(mock_stop)) {
+        sched_task_fn(NULL);
+    }
+    for (int i = 0; i < sensor_count; i++) {
+        sensor_sched_get(i, &r);
+        if (!r.valid || r.errors) {
+            printf("sensor %d failed\n", i);
+        }
+        if (r.timestamp > last) {
+            last = r.timestamp;
+        }
+    }
+    mock_now_us = last * portTICK_RATE_MS * 1000;
+    report("scheduled");
+}
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void bench_get(void)
+{
+    sensor_reading_t r;
+    double best = 0;
+    volatile int32_t sink = 0;
+
+    for (int n = 0; n < SAMPLES; n++) {
+        double start = now();
+        for (int i = 0; i < GETS; i++) {
+            if (sensor_sched_get(i % sensor_count, &r)) {
+                sink += r.values[0];
+            }
+        }
+        double elapsed = now() - start;
+        if (n == 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    printf("%-36s %6.1f ns (host)\n", "sensor_sched_get()", best * 1e9 / GETS);
+}
+
+int main(void)
+{
+    one_by_one();
+    one_by_one_adapters();
+    scheduled();
+    bench_get();
+    return 0;
+}
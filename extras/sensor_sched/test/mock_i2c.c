@@ -0,0 +1,286 @@
+/* Mock I2C bus and clock for the sensor_sched host tests, see mock_i2c.h
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <string.h>
+#include "mock_i2c.h"
+#include "task.h"
+#include "espressif/sdk_private.h"
+
+#define TICK_US (portTICK_RATE_MS * 1000)
+// One byte with its ack at 100kHz
+#define BYTE_US 90
+
+uint64_t mock_now_us;
+uint64_t mock_busy_us;
+uint64_t mock_bus_us;
+uint64_t mock_stop_us;
+jmp_buf mock_stop;
+
+static mock_i2c_dev_t *devices;
+
+void mock_i2c_reset(void)
+{
+    devices = NULL;
+    mock_now_us = mock_busy_us = mock_bus_us = mock_stop_us = 0;
+}
+
+portTickType xTaskGetTickCount(void)
+{
+    return mock_now_us / TICK_US;
+}
+
+void vTaskDelay(portTickType ticks)
+{
+    mock_now_us = (mock_now_us / TICK_US + ticks) * TICK_US;
+    if (mock_stop_us && mock_now_us >= mock_stop_us) {
+        longjmp(mock_stop, 1);
+    }
+}
+
+portBASE_TYPE xTaskCreate(void (*fn)(void *), const signed char *name,
+                          unsigned short stack_depth, void *arg,
+                          unsigned priority, xTaskHandle *handle)
+{
+    // The test runs the task function itself
+    if (handle) {
+        *handle = (xTaskHandle)fn;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(xTaskHandle task)
+{
+}
+
+void sdk_os_delay_us(uint16_t us)
+{
+    mock_now_us += us;
+    mock_busy_us += us;
+}
+
+void i2c_init(uint8_t scl_pin, uint8_t sda_pin)
+{
+}
+
+// Find the device and count the transfer, NULL if it isn't acked
+static mock_i2c_dev_t *transfer(i2c_bus_t *bus, uint8_t addr, size_t bytes)
+{
+    mock_now_us += bytes * BYTE_US;
+    mock_bus_us += bytes * BYTE_US;
+
+    for (mock_i2c_dev_t *d = devices; d; d = d->next) {
+        if (d->bus == bus && d->addr == addr) {
+            d->transfers++;
+            if (d->fail_in && --d->fail_in == 0) {
+                return NULL;
+            }
+            if (d->converting && mock_now_us >= d->ready_us) {
+                d->converting = false;
+                d->done(d);
+            }
+            return d;
+        }
+    }
+    return NULL;
+}
+
+bool i2c_bus_write_regs(i2c_bus_t *bus, uint8_t slave_addr, uint8_t reg, const uint8_t *buf, size_t len)
+{
+    mock_i2c_dev_t *d = transfer(bus, slave_addr, len + 2);
+
+    if (!d) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        d->regs[(uint8_t)(reg + i)] = buf[i];
+        d->write(d, reg + i);
+    }
+    return true;
+}
+
+// The first byte sets the register pointer, the rest are written there
+bool i2c_bus_slave_write(i2c_bus_t *bus, uint8_t slave_addr, const uint8_t *buf, size_t len)
+{
+    mock_i2c_dev_t *d = transfer(bus, slave_addr, len + 1);
+
+    if (!d) {
+        return false;
+    }
+    for (size_t i = 1; i < len; i++) {
+        d->regs[(uint8_t)(buf[0] + i - 1)] = buf[i];
+        d->write(d, buf[0] + i - 1);
+    }
+    return true;
+}
+
+bool i2c_bus_read_regs(i2c_bus_t *bus, uint8_t slave_addr, uint8_t reg, uint8_t *buf, size_t len)
+{
+    mock_i2c_dev_t *d = transfer(bus, slave_addr, len + 3);
+
+    if (!d) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = d->regs[(uint8_t)(reg + i)];
+    }
+    return true;
+}
+
+static void attach(mock_i2c_dev_t *d, i2c_bus_t *bus, uint8_t addr)
+{
+    memset(d, 0, sizeof(*d));
+    d->bus = bus;
+    d->addr = addr;
+    d->slow_percent = 100;
+    d->next = devices;
+    devices = d;
+}
+
+static void convert(mock_i2c_dev_t *d, uint32_t max_us)
+{
+    d->converting = true;
+    d->ready_us = mock_now_us + (uint64_t)max_us * d->slow_percent / 100;
+}
+
+/*
+ * BMP280/BME280, with the calibration and ADC values of the example in
+ * the BMP280 datasheet, and typical humidity ones.
+ */
+static const int16_t bmp280_calib[] = {
+    27504, 26435, -1000, (int16_t)36477, -10685, 3024, 2855, 140, -7, 15500, -14600, 6000
+};
+static const uint8_t bme280_hum_calib[] = {
+    0x6a, 0x01, 0x00, 0x13, 0x25, 0x03, 0x1e   // H2 362, H3 0, H4 309, H5 50, H6 30
+};
+#define BMP280_ADC_T 519888
+#define BMP280_ADC_P 415148
+#define BME280_ADC_H 30000
+
+static uint32_t bmp280_samples(uint8_t osrs)
+{
+    return osrs ? 1 << ((osrs > 5 ? 5 : osrs) - 1) : 0;
+}
+
+static void bmp280_write(mock_i2c_dev_t *d, uint8_t reg)
+{
+    if (reg == 0xe0 && d->regs[0xe0] == 0xb6) {
+        // Soft reset, the calibration is copied right away
+        memset(d->regs + 0xf2, 0, 3);
+        memset(d->regs + 0xf7, 0x80, 8);
+        d->converting = false;
+    } else if (reg == 0xf4 && (d->regs[0xf4] & 3) == 1) {
+        uint8_t ctrl = d->regs[0xf4];
+        uint32_t t = bmp280_samples(ctrl >> 5);
+        uint32_t p = bmp280_samples((ctrl >> 2) & 7);
+        uint32_t h = d->regs[0xd0] == 0x60 ? bmp280_samples(d->regs[0xf2] & 7) : 0;
+        // Data registers read as 0x80000 (their reset value) until done
+        memset(d->regs + 0xf7, 0x80, 8);
+        d->regs[0xf3] |= 1 << 3;
+        convert(d, 1250 + 2300 * t + (p ? 2300 * p + 575 : 0) + (h ? 2300 * h + 575 : 0));
+    }
+}
+
+static void bmp280_done(mock_i2c_dev_t *d)
+{
+    uint8_t *r = d->regs;
+
+    r[0xf3] &= ~(1 << 3);
+    r[0xf4] &= ~3;  // back to sleep mode
+    r[0xf7] = BMP280_ADC_P >> 12;
+    r[0xf8] = (BMP280_ADC_P >> 4) & 0xff;
+    r[0xf9] = (BMP280_ADC_P << 4) & 0xff;
+    r[0xfa] = BMP280_ADC_T >> 12;
+    r[0xfb] = (BMP280_ADC_T >> 4) & 0xff;
+    r[0xfc] = (BMP280_ADC_T << 4) & 0xff;
+    r[0xfd] = BME280_ADC_H >> 8;
+    r[0xfe] = BME280_ADC_H & 0xff;
+}
+
+void mock_bmp280_init(mock_i2c_dev_t *d, i2c_bus_t *bus, uint8_t addr, uint8_t chip_id)
+{
+    attach(d, bus, addr);
+    d->write = bmp280_write;
+    d->done = bmp280_done;
+    d->regs[0xd0] = chip_id;
+    for (int i = 0; i < 12; i++) {
+        d->regs[0x88 + 2 * i] = bmp280_calib[i] & 0xff;
+        d->regs[0x89 + 2 * i] = (uint16_t)bmp280_calib[i] >> 8;
+    }
+    d->regs[0xa1] = 75;
+    memcpy(d->regs + 0xe1, bme280_hum_calib, sizeof(bme280_hum_calib));
+    memset(d->regs + 0xf7, 0x80, 8);
+}
+
+/*
+ * BMP180, with the calibration and ADC values of the example in the
+ * datasheet. The ADC returns the same pressure for every oversampling
+ * setting, with more resolution.
+ */
+static const int16_t bmp180_calib[] = {
+    408, -72, -14383, (int16_t)32741, (int16_t)32757, 23153, 6190, 4, -32768, -8711, 2868
+};
+#define BMP180_UT 27898
+#define BMP180_UP 23843
+
+// Bit 5 (SCO) of the control register is set while converting, it is
+// part of the commands too.
+static void bmp180_write(mock_i2c_dev_t *d, uint8_t reg)
+{
+    static const uint16_t pressure_us[] = { 4500, 7500, 13500, 25500 };
+    uint8_t ctrl = d->regs[0xf4];
+
+    if (reg != 0xf4) {
+        return;
+    }
+    // The result registers hold garbage until the conversion is done
+    memset(d->regs + 0xf6, 0xff, 3);
+    if (ctrl == 0x2e) {
+        convert(d, 4500);
+    } else if ((ctrl & 0x3f) == 0x34) {
+        convert(d, pressure_us[ctrl >> 6]);
+    }
+}
+
+static void bmp180_done(mock_i2c_dev_t *d)
+{
+    uint8_t ctrl = d->regs[0xf4];
+    uint32_t v;
+
+    d->regs[0xf4] = ctrl & ~(1 << 5);
+    if (ctrl == 0x2e) {
+        v = BMP180_UT << 8;
+    } else {
+        uint8_t oss = ctrl >> 6;
+        v = (BMP180_UP << oss) << (8 - oss);
+    }
+    d->regs[0xf6] = v >> 16;
+    d->regs[0xf7] = (v >> 8) & 0xff;
+    d->regs[0xf8] = v & 0xff;
+}
+
+void mock_bmp180_init(mock_i2c_dev_t *d, i2c_bus_t *bus)
+{
+    attach(d, bus, 0x77);
+    d->write = bmp180_write;
+    d->done = bmp180_done;
+    d->regs[0xd0] = 0x55;
+    for (int i = 0; i < 11; i++) {
+        d->regs[0xaa + 2 * i] = (uint16_t)bmp180_calib[i] >> 8;
+        d->regs[0xab + 2 * i] = bmp180_calib[i] & 0xff;
+    }
+}
+
+static void ds3231_write(mock_i2c_dev_t *d, uint8_t reg)
+{
+}
+
+void mock_ds3231_init(mock_i2c_dev_t *d, i2c_bus_t *bus)
+{
+    attach(d, bus, 0x68);
+    d->write = ds3231_write;
+    // 25.25 degrees Celsius in the temperature registers
+    d->regs[0x11] = MOCK_DS3231_T >> 2;
+    d->regs[0x12] = (MOCK_DS3231_T & 3) << 6;
+}
@@ -0,0 +1,58 @@
+/* Mock I2C bus and clock for the sensor_sched host tests.
+ *
+ * Time only passes when the code under test waits: vTaskDelay() moves the
+ * clock to the start of a later tick, sdk_os_delay_us() busy waits, and
+ * every I2C transfer takes as long as it would at 100kHz. The sensors are
+ * register models of the BMP280/BME280 and the BMP180 whose conversions
+ * take the datasheet's maximum time (scaled by `slow_percent`), and whose
+ * result registers are only valid after that, and of the DS3231's
+ * temperature registers.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef _MOCK_I2C_H
+#define _MOCK_I2C_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <setjmp.h>
+#include "i2c/i2c.h"
+
+typedef struct mock_i2c_dev mock_i2c_dev_t;
+
+struct mock_i2c_dev {
+    i2c_bus_t *bus;
+    uint8_t addr;
+    uint8_t regs[256];
+    void (*write)(mock_i2c_dev_t *d, uint8_t reg);  // after a register write
+    void (*done)(mock_i2c_dev_t *d);                // conversion finished
+    bool converting;
+    uint64_t ready_us;      // end of the conversion
+    unsigned slow_percent;  // conversion time in percent of the maximum
+    int fail_in;            // the nth transfer from now is not acked
+    unsigned transfers;
+    mock_i2c_dev_t *next;
+};
+
+extern uint64_t mock_now_us;     // the clock
+extern uint64_t mock_busy_us;    // time spent in sdk_os_delay_us()
+extern uint64_t mock_bus_us;     // time the buses were busy
+extern uint64_t mock_stop_us;    // vTaskDelay() past this jumps to mock_stop
+extern jmp_buf mock_stop;
+
+/* Remove all devices and reset the clock and counters */
+void mock_i2c_reset(void);
+
+void mock_bmp280_init(mock_i2c_dev_t *d, i2c_bus_t *bus, uint8_t addr, uint8_t chip_id);
+void mock_bmp180_init(mock_i2c_dev_t *d, i2c_bus_t *bus);
+void mock_ds3231_init(mock_i2c_dev_t *d, i2c_bus_t *bus);
+
+/* Values the models convert to, from the datasheet examples */
+#define MOCK_BMP280_T 2508          // 0.01 degrees Celsius
+#define MOCK_BMP280_P 25767233      // Pa in Q24.8
+#define MOCK_BMP180_T 150           // 0.1 degrees Celsius, oss 0
+#define MOCK_BMP180_P 69964         // Pa, oss 0
+#define MOCK_DS3231_T 101           // 0.25 degrees Celsius
+
+#endif
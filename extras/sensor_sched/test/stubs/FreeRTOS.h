@@ -0,0 +1,19 @@
+/* Host test stand-in for the FreeRTOS headers used by sensor_sched and the
+ * sensor drivers. The clock is the mock one in mock_i2c.c. */
+#ifndef _STUB_FREERTOS_H
+#define _STUB_FREERTOS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uint32_t portTickType;
+typedef long portBASE_TYPE;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define portMAX_DELAY ((portTickType)0xffffffff)
+#define portTICK_RATE_MS 10
+
+#endif
@@ -0,0 +1,8 @@
+/* Host test stand-in for espressif/esp_common.h */
+#ifndef _STUB_ESP_COMMON_H
+#define _STUB_ESP_COMMON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#endif
@@ -0,0 +1,10 @@
+/* Host test stand-in for espressif/sdk_private.h, sdk_os_delay_us() is
+ * implemented by the mock clock in mock_i2c.c */
+#ifndef _STUB_SDK_PRIVATE_H
+#define _STUB_SDK_PRIVATE_H
+
+#include <stdint.h>
+
+void sdk_os_delay_us(uint16_t us);
+
+#endif
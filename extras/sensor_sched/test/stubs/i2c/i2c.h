@@ -0,0 +1,18 @@
+/* Host test stand-in for the I2C driver, the bus is mock_i2c.c */
+#ifndef _STUB_I2C_H
+#define _STUB_I2C_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct {
+    int id;
+} i2c_bus_t;
+
+void i2c_init(uint8_t scl_pin, uint8_t sda_pin);
+bool i2c_bus_slave_write(i2c_bus_t *bus, uint8_t slave_addr, const uint8_t *buf, size_t len);
+bool i2c_bus_write_regs(i2c_bus_t *bus, uint8_t slave_addr, uint8_t reg, const uint8_t *buf, size_t len);
+bool i2c_bus_read_regs(i2c_bus_t *bus, uint8_t slave_addr, uint8_t reg, uint8_t *buf, size_t len);
+
+#endif
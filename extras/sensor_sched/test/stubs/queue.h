@@ -0,0 +1,24 @@
+/* Host test stand-in for queue.h, the bmp180 driver task isn't tested */
+#ifndef _STUB_QUEUE_H
+#define _STUB_QUEUE_H
+
+#include "FreeRTOS.h"
+
+typedef void *xQueueHandle;
+
+static inline xQueueHandle xQueueCreate(unsigned len, unsigned item_size)
+{
+    return NULL;
+}
+
+static inline int xQueueSend(xQueueHandle q, const void *item, portTickType timeout)
+{
+    return pdFALSE;
+}
+
+static inline int xQueueReceive(xQueueHandle q, void *item, portTickType timeout)
+{
+    return pdFALSE;
+}
+
+#endif
@@ -0,0 +1,16 @@
+/* Host test stand-in for task.h, implemented by the mock clock in mock_i2c.c */
+#ifndef _STUB_TASK_H
+#define _STUB_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void *xTaskHandle;
+
+portTickType xTaskGetTickCount(void);
+void vTaskDelay(portTickType ticks);
+portBASE_TYPE xTaskCreate(void (*fn)(void *), const signed char *name,
+                          unsigned short stack_depth, void *arg,
+                          unsigned priority, xTaskHandle *handle);
+void vTaskDelete(xTaskHandle task);
+
+#endif
@@ -0,0 +1,390 @@
+/* Host test for the sensor scheduler and the BMP280, BMP180 and DS3231
+ * adapters, on the mock I2C bus.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "test.h"
+#include "mock_i2c.h"
+#include "../sensor_sched.c"
+#include "bmp280/bmp280.h"
+#include "bmp180/bmp180.h"
+#include "ds3231/ds3231.h"
+
+static i2c_bus_t bus1 = { 1 }, bus2 = { 2 };
+
+static bool setup_bmp280(bmp280_t *dev, mock_i2c_dev_t *mock, uint8_t chip_id,
+                         BMP280_Oversampling oversampling)
+{
+    bmp280_params_t params;
+
+    mock_bmp280_init(mock, &bus1, BMP280_I2C_ADDRESS_0, chip_id);
+    bmp280_init_default_params(&params);
+    params.mode = BMP280_MODE_FORCED;
+    params.oversampling = oversampling;
+    params.oversampling_humidity = oversampling;
+    memset(dev, 0, sizeof(*dev));
+    dev->i2c_addr = BMP280_I2C_ADDRESS_0;
+    return bmp280_init_bus(dev, &bus1, &params);
+}
+
+/* Wait as the scheduler does after a trigger */
+static void sched_wait(int ms)
+{
+    vTaskDelay((ms + portTICK_RATE_MS - 1) / portTICK_RATE_MS + 1);
+}
+
+/* The conversion time follows the oversampling settings */
+int test_bmp280_trigger(void)
+{
+    bmp280_t dev;
+    mock_i2c_dev_t mock;
+
+    mock_i2c_reset();
+    check(setup_bmp280(&dev, &mock, BMP280_CHIP_ID, BMP280_ULTRA_LOW_POWER));
+    check(sensor_ops_bmp280.trigger(&dev) == 7);    // T x1, P x1: 6.4ms
+    check(mock.regs[0xf3] & (1 << 3));
+
+    check(setup_bmp280(&dev, &mock, BMP280_CHIP_ID, BMP280_STANDARD));
+    check(sensor_ops_bmp280.trigger(&dev) == 14);   // T x1, P x4: 13.3ms
+
+    check(setup_bmp280(&dev, &mock, BMP280_CHIP_ID, BMP280_ULTRA_HIGH_RES));
+    check(sensor_ops_bmp280.trigger(&dev) == 44);   // T x2, P x16: 43.2ms
+
+    /* The BME280 adds the humidity, which a BMP280 doesn't have */
+    check(setup_bmp280(&dev, &mock, BME280_CHIP_ID, BMP280_ULTRA_HIGH_RES));
+    check(sensor_ops_bmp280.trigger(&dev) == 81);   // and H x16: 80.6ms
+
+    /* x16 for everything, 112.8ms */
+    uint8_t ctrl = (5 << 5) | (5 << 2);
+    check(i2c_bus_write_regs(&bus1, BMP280_I2C_ADDRESS_0, 0xf4, &ctrl, 1));
+    check(sensor_ops_bmp280.trigger(&dev) == 113);
+
+    mock.fail_in = 1;
+    check(sensor_ops_bmp280.trigger(&dev) == -1);
+    done();
+}
+
+int test_bmp280_read(void)
+{
+    bmp280_t dev;
+    mock_i2c_dev_t mock;
+    int32_t values[SENSOR_SCHED_MAX_VALUES];
+    uint32_t humidity;
+    int ms;
+
+    mock_i2c_reset();
+    check(setup_bmp280(&dev, &mock, BME280_CHIP_ID, BMP280_ULTRA_HIGH_RES));
+    check(bmp280_force_measurement(&dev));
+    vTaskDelay(10);
+    check(bmp280_read_fixed(&dev, &values[0], (uint32_t *)&values[1], &humidity));
+    check(values[0] == MOCK_BMP280_T);
+    check(values[1] == MOCK_BMP280_P);
+
+    memset(values, 0, sizeof(values));
+    ms = sensor_ops_bmp280.trigger(&dev);
+    sched_wait(ms);
+    check(sensor_ops_bmp280.read(&dev, values));
+    check(values[0] == MOCK_BMP280_T);
+    check(values[1] == MOCK_BMP280_P);
+    check(values[2] == humidity);
+
+    /* Not read early wherever in a tick the conversion starts */
+    for (int offset = 0; offset < 10000; offset += 37) {
+        mock_now_us = (mock_now_us / 10000 + 1) * 10000 + offset;
+        ms = sensor_ops_bmp280.trigger(&dev);
+        sched_wait(ms);
+        unsigned transfers = mock.transfers;
+        check(sensor_ops_bmp280.read(&dev, values));
+        check(values[0] == MOCK_BMP280_T);
+        check(mock.transfers == transfers + 2);  // status and data, no polling
+    }
+
+    /* A sensor with a slow clock is waited for */
+    uint8_t ctrl = (5 << 5) | (5 << 2);
+    check(i2c_bus_write_regs(&bus1, BMP280_I2C_ADDRESS_0, 0xf4, &ctrl, 1));
+    mock.slow_percent = 180;
+    memset(values, 0, sizeof(values));
+    ms = sensor_ops_bmp280.trigger(&dev);
+    check(ms == 113);
+    sched_wait(ms);
+    check(sensor_ops_bmp280.read(&dev, values));
+    check(values[0] == MOCK_BMP280_T);
+
+    /* One that never finishes is given up after a measurement time */
+    mock.slow_percent = 1000;
+    ms = sensor_ops_bmp280.trigger(&dev);
+    sched_wait(ms);
+    uint64_t start = mock_now_us;
+    check(!sensor_ops_bmp280.read(&dev, values));
+    check(mock_now_us - start >= 113000);
+    check(mock_now_us - start < 140000);
+    done();
+}
+
+/* A bus error while waiting for the conversion is a failure, not "done" */
+int test_bmp280_bus_error(void)
+{
+    bmp280_t dev;
+    mock_i2c_dev_t mock;
+    int32_t values[SENSOR_SCHED_MAX_VALUES];
+
+    mock_i2c_reset();
+    check(setup_bmp280(&dev, &mock, BME280_CHIP_ID, BMP280_ULTRA_HIGH_RES));
+    for (int fail_in = 1; fail_in <= 4; fail_in++) {
+        check(sensor_ops_bmp280.trigger(&dev) == 81);
+        unsigned transfers = mock.transfers;
+        mock.fail_in = fail_in;
+        check(!sensor_ops_bmp280.read(&dev, values));
+        check(mock.transfers == transfers + fail_in);
+        vTaskDelay(10);
+    }
+    done();
+}
+
+int test_bmp180(void)
+{
+    mock_i2c_dev_t mock;
+    bmp180_constants_t constants;
+    sensor_bmp180_t dev = { &bus1, &constants, 0 };
+    int32_t values[SENSOR_SCHED_MAX_VALUES];
+    int32_t t;
+    uint32_t p;
+
+    mock_i2c_reset();
+    mock_bmp180_init(&mock, &bus1);
+    bmp180_set_bus(&bus1);
+    check(bmp180_is_available());
+    check(bmp180_fillInternalConstants(&constants));
+
+    /* bmp180_measure() busy waits */
+    check(bmp180_measure(&constants, &t, &p, 0));
+    check(t == MOCK_BMP180_T);
+    check(p == MOCK_BMP180_P);
+    check(mock_busy_us == 10000);
+
+    /* The adapter sleeps, and selects the sensor's bus in every call */
+    static const int pressure_ms[] = { 5, 8, 14, 26 };
+    for (uint8_t oss = 0; oss <= 3; oss++) {
+        check(bmp180_measure(&constants, &t, &p, oss));
+        dev.oss = oss;
+        mock_busy_us = 0;
+        bmp180_set_bus(&bus2);
+        int ms = sensor_ops_bmp180.trigger(&dev);
+        check(ms == 5);
+        sched_wait(ms);
+        bmp180_set_bus(&bus2);
+        ms = sensor_ops_bmp180.step(&dev);
+        check(ms == pressure_ms[oss]);
+        sched_wait(ms);
+        bmp180_set_bus(&bus2);
+        check(sensor_ops_bmp180.read(&dev, values));
+        check(mock_busy_us == 0);
+        check(values[0] == t);
+        check(values[1] == p);
+        check(values[1] > MOCK_BMP180_P - 10 && values[1] < MOCK_BMP180_P + 10);
+    }
+
+    /* Not read early wherever in a tick the conversions start */
+    dev.oss = 3;
+    for (int offset = 0; offset < 10000; offset += 37) {
+        mock_now_us = (mock_now_us / 10000 + 1) * 10000 + offset;
+        sched_wait(sensor_ops_bmp180.trigger(&dev));
+        sched_wait(sensor_ops_bmp180.step(&dev));
+        check(sensor_ops_bmp180.read(&dev, values));
+        check(values[0] == t && values[1] == p);
+    }
+
+    mock.fail_in = 1;
+    check(sensor_ops_bmp180.trigger(&dev) == -1);
+    for (int fail_in = 1; fail_in <= 2; fail_in++) {
+        sched_wait(sensor_ops_bmp180.trigger(&dev));
+        mock.fail_in = fail_in;
+        check(sensor_ops_bmp180.step(&dev) == -1);
+    }
+    sched_wait(sensor_ops_bmp180.trigger(&dev));
+    sched_wait(sensor_ops_bmp180.step(&dev));
+    mock.fail_in = 1;
+    check(!sensor_ops_bmp180.read(&dev, values));
+    done();
+}
+
+/* The DS3231 adapter reads from the sensor's bus */
+int test_ds3231(void)
+{
+    mock_i2c_dev_t mock;
+    sensor_ds3231_t dev = { &bus2 };
+    int32_t values[SENSOR_SCHED_MAX_VALUES];
+
+    mock_i2c_reset();
+    mock_ds3231_init(&mock, &bus2);
+    ds3231_setBus(&bus1);
+    check(sensor_ops_ds3231.trigger == NULL);
+    check(sensor_ops_ds3231.read(&dev, values));
+    check(values[0] == MOCK_DS3231_T);
+    mock.fail_in = 1;
+    check(!sensor_ops_ds3231.read(&dev, values));
+    done();
+}
+
+/* A sensor without I2C that counts its triggers and reads */
+typedef struct {
+    int conversion_ms;
+    int triggers, reads;
+    portTickType triggered;
+    bool fail;
+} fake_sensor_t;
+
+static int fake_trigger(void *dev)
+{
+    fake_sensor_t *s = dev;
+    s->triggers++;
+    s->triggered = xTaskGetTickCount();
+    return s->conversion_ms;
+}
+
+static bool fake_read(void *dev, int32_t *values)
+{
+    fake_sensor_t *s = dev;
+    s->reads++;
+    values[0] = s->reads;
+    values[1] = (xTaskGetTickCount() - s->triggered) * portTICK_RATE_MS;
+    return !s->fail;
+}
+
+static const sensor_ops_t fake_ops = { fake_trigger, fake_read };
+static const sensor_ops_t fake_ops_no_trigger = { NULL, fake_read };
+
+static void sched_reset(void)
+{
+    mock_i2c_reset();
+    memset(sensors, 0, sizeof(sensors));
+    sensor_count = 0;
+    sched_task = NULL;
+}
+
+/* Run the scheduler task until the clock passes ms */
+static void sched_run(uint32_t ms)
+{
+    mock_stop_us = (uint64_t)ms * 1000;
+    if (!setjmp(mock_stop)) {
+        sched_task_fn(NULL);
+    }
+    mock_stop_us = 0;
+}
+
+int test_sched_periods(void)
+{
+    fake_sensor_t a = { 20 }, b = { 30 }, c = { 0 };
+    sensor_reading_t r;
+
+    sched_reset();
+    check(sensor_sched_add(&fake_ops, &a, &bus1, 100) == 0);
+    check(sensor_sched_add(&fake_ops, &b, &bus2, 250) == 1);
+    check(sensor_sched_add(&fake_ops_no_trigger, &c, &bus1, 1000) == 2);
+    check(!sensor_sched_get(0, &r) || !r.valid);
+    check(sensor_sched_start(2, 512));
+    check(sensor_sched_add(&fake_ops, &a, &bus1, 100) == -1);
+    check(order[0] == 0 && order[1] == 2 && order[2] == 1);
+
+    sched_run(1000);
+    check(a.triggers == 10 && a.reads == 10);
+    check(b.triggers == 4 && b.reads == 4);
+    check(c.triggers == 0 && c.reads == 1);
+
+    check(sensor_sched_get(0, &r));
+    check(r.valid);
+    check(r.values[0] == 10);
+    check(r.values[1] >= 30);    // waited for b as well when both were due
+    check(r.errors == 0);
+    check(sensor_sched_get(1, &r));
+    check(r.values[0] == 4 && r.values[1] >= 30 && r.values[1] <= 40);
+    check(sensor_sched_get(2, &r));
+    check(r.values[0] == 1 && r.timestamp == 4);
+    check(!sensor_sched_get(3, &r));
+    check(!sensor_sched_get(-1, &r));
+    done();
+}
+
+/* Failed samples count as errors and keep the last good values */
+int test_sched_errors(void)
+{
+    fake_sensor_t a = { 0 };
+    sensor_reading_t r;
+
+    sched_reset();
+    check(sensor_sched_add(&fake_ops, &a, NULL, 100) == 0);
+    check(sensor_sched_start(2, 512));
+    sched_run(250);
+    check(sensor_sched_get(0, &r));
+    check(r.valid && r.values[0] == 3 && r.errors == 0);
+
+    a.fail = true;
+    sched_run(500);
+    check(sensor_sched_get(0, &r));
+    check(r.valid && r.values[0] == 3 && r.errors == 2);
+    check(r.timestamp == 20);
+    done();
+}
+
+/* Conversions of sensors that are due together overlap */
+int test_sched_overlap(void)
+{
+    bmp280_t dev[2];
+    mock_i2c_dev_t mock[4];
+    bmp180_constants_t constants;
+    sensor_bmp180_t bmp180[2] = { { &bus2, &constants, 3 }, { &bus1, &constants, 3 } };
+    sensor_reading_t r;
+
+    sched_reset();
+    check(setup_bmp280(&dev[0], &mock[0], BME280_CHIP_ID, BMP280_ULTRA_HIGH_RES));
+    mock_bmp280_init(&mock[1], &bus2, BMP280_I2C_ADDRESS_0, BMP280_CHIP_ID);
+    bmp280_params_t params;
+    bmp280_init_default_params(&params);
+    params.mode = BMP280_MODE_FORCED;
+    dev[1].i2c_addr = BMP280_I2C_ADDRESS_0;  // the BMP180 is at 0x77
+    check(bmp280_init_bus(&dev[1], &bus2, &params));
+    mock_bmp180_init(&mock[2], &bus2);
+    mock_bmp180_init(&mock[3], &bus1);
+    bmp180_set_bus(&bus2);
+    check(bmp180_fillInternalConstants(&constants));
+    bmp180_set_bus(NULL);
+
+    check(sensor_sched_add(&sensor_ops_bmp280, &dev[0], &bus1, 1000) == 0);
+    check(sensor_sched_add(&sensor_ops_bmp280, &dev[1], &bus2, 1000) == 1);
+    check(sensor_sched_add(&sensor_ops_bmp180, &bmp180[0], &bus2, 1000) == 2);
+    check(sensor_sched_add(&sensor_ops_bmp180, &bmp180[1], &bus1, 1000) == 3);
+    mock_now_us = 0;
+    check(sensor_sched_start(2, 512));
+    sched_run(999);
+
+    /* One after another 81 + 14 + 2 * (5 + 26)ms, in ticks at least 250ms.
+       Overlapped one wait for the BMP180s' temperature conversions, and
+       one for the longest conversion (the BME280's 81ms, the BMP180s'
+       pressure conversions end before it). */
+    for (int i = 0; i < 4; i++) {
+        check(sensor_sched_get(i, &r));
+        check(r.valid && r.errors == 0);
+        check(r.timestamp * portTICK_RATE_MS >= 81);
+        check(r.timestamp * portTICK_RATE_MS <= 110);
+        check(r.values[0] == (i < 2 ? MOCK_BMP280_T : MOCK_BMP180_T));
+    }
+    done();
+}
+
+int main(void)
+{
+    test(test_bmp280_trigger, "bmp280 conversion time from the oversampling");
+    test(test_bmp280_read, "bmp280 read waits for the conversion");
+    test(test_bmp280_bus_error, "bmp280 bus errors while waiting");
+    test(test_bmp180, "bmp180 split conversion");
+    test(test_ds3231, "ds3231 on its own bus");
+    test(test_sched_periods, "scheduler sample periods");
+    test(test_sched_errors, "scheduler error counting");
+    test(test_sched_overlap, "scheduler overlaps conversions");
+    printf("\nPASSED: %d\nFAILED: %d\n", test_passed, test_failed);
+    return (test_failed > 0);
+}
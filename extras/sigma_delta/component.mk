@@ -0,0 +1,9 @@
+# Component makefile for extras/sigma_delta
+
+# expected anyone using sigma_delta includes it as 'sigma_delta/sigma_delta.h'
+INC_DIRS += $(sigma_delta_ROOT)..
+
+# args for passing into compile rule generation
+sigma_delta_SRC_DIR =  $(sigma_delta_ROOT)
+
+$(eval $(call component_compile_rules,sigma_delta))
@@ -0,0 +1,83 @@
+/**
+ * LED dimming with the GPIO sigma-delta modulator.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include "sigma_delta.h"
+#include "esp/gpio.h"
+
+static uint8_t sd_pins[SIGMA_DELTA_MAX_PINS];
+static uint8_t sd_npins;
+static uint16_t sd_duty;
+static bool sd_running;
+
+// Connect the pins to the modulator, or to GPIO.OUT at a constant level
+static void update_pins(void)
+{
+    bool modulate = sd_running && sd_duty > 0 && sd_duty < UINT16_MAX;
+    bool level = sd_running && sd_duty == UINT16_MAX;
+
+    for (uint8_t i = 0; i < sd_npins; i++) {
+        uint8_t pin = sd_pins[i];
+        gpio_write(pin, level);
+        if (modulate) {
+            GPIO.CONF[pin] |= GPIO_CONF_SOURCE_PWM;
+        } else {
+            GPIO.CONF[pin] &= ~GPIO_CONF_SOURCE_PWM;
+        }
+    }
+}
+
+bool sigma_delta_init(uint8_t npins, const uint8_t *pins)
+{
+    if (npins > SIGMA_DELTA_MAX_PINS) {
+        return false;
+    }
+    for (uint8_t i = 0; i < npins; i++) {
+        if (pins[i] > 15) {
+            return false;
+        }
+    }
+
+    sigma_delta_stop();
+    for (uint8_t i = 0; i < npins; i++) {
+        sd_pins[i] = pins[i];
+        gpio_enable(pins[i], GPIO_OUTPUT);
+    }
+    sd_npins = npins;
+    sd_duty = 0;
+    update_pins();
+
+    GPIO.PWM = GPIO_PWM_ENABLE | SET_FIELD(0, GPIO_PWM_PRESCALER, 255);
+    return true;
+}
+
+void sigma_delta_set_prescaler(uint8_t prescaler)
+{
+    GPIO.PWM = SET_FIELD(GPIO.PWM, GPIO_PWM_PRESCALER, prescaler);
+}
+
+void sigma_delta_set_duty(uint16_t duty)
+{
+    uint32_t target = (duty + 128) >> 8;
+
+    if (target > 255) {
+        target = 255;
+    }
+    GPIO.PWM = SET_FIELD(GPIO.PWM, GPIO_PWM_TARGET, target);
+    sd_duty = duty;
+    update_pins();
+}
+
+void sigma_delta_start(void)
+{
+    sd_running = true;
+    update_pins();
+}
+
+void sigma_delta_stop(void)
+{
+    sd_running = false;
+    update_pins();
+}
@@ -0,0 +1,59 @@
+/**
+ * LED dimming with the GPIO sigma-delta modulator.
+ *
+ * The ESP8266 has one sigma-delta modulator that can drive any of GPIO0 to
+ * GPIO15. Once it is set up it runs entirely in hardware, so unlike
+ * extras/pwm there is no interrupt per output edge and no CPU load however
+ * fast the output switches.
+ *
+ * The functions mirror extras/pwm. As with extras/pwm, all pins share the
+ * one duty cycle.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __SIGMA_DELTA_H__
+#define __SIGMA_DELTA_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SIGMA_DELTA_MAX_PINS 8
+
+/**
+ * Configure pins (GPIO0 to GPIO15) as outputs for the modulator. The pins
+ * stay low until sigma_delta_start() is called.
+ *
+ * The prescaler is set to 255, the slowest setting, which still switches
+ * far too fast for visible flicker and is the easiest on LED drivers.
+ *
+ * @return false if there are too many pins or a pin can't be used.
+ */
+bool sigma_delta_init(uint8_t npins, const uint8_t *pins);
+
+/**
+ * Set the prescaler of the modulator clock. Lower values give shorter,
+ * more frequent pulses.
+ */
+void sigma_delta_set_prescaler(uint8_t prescaler);
+
+/**
+ * Set the duty cycle, from 0 to UINT16_MAX like pwm_set_duty().
+ *
+ * The modulator has 256 steps, so only the top 8 bits are used (rounded).
+ * 0 and UINT16_MAX switch the pins to constant low and high outputs, the
+ * modulator itself can't reach 100%.
+ */
+void sigma_delta_set_duty(uint16_t duty);
+
+/**
+ * Connect the pins to the modulator.
+ */
+void sigma_delta_start(void);
+
+/**
+ * Disconnect the pins from the modulator and leave them low.
+ */
+void sigma_delta_stop(void);
+
+#endif  // __SIGMA_DELTA_H__
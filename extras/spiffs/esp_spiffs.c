@@ -11,6 +11,10 @@
 #include <stdbool.h>
 #include <esp/uart.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <vfs.h>
 #include "esp_spiffs_flash.h"
 
 spiffs fs;
@@ -64,6 +68,126 @@ static s32_t esp_spiffs_erase(u32_t addr, u32_t size)
     return SPIFFS_OK;
 }
 
+/* Convert a SPIFFS result to the newlib syscall convention */
+static int spiffs_result(struct _reent *r, int res)
+{
+    if (res >= 0) {
+        return res;
+    }
+    switch (res) {
+        case SPIFFS_ERR_NOT_FOUND:
+            r->_errno = ENOENT;
+            break;
+        case SPIFFS_ERR_FILE_EXISTS:
+            r->_errno = EEXIST;
+            break;
+        case SPIFFS_ERR_FULL:
+            r->_errno = ENOSPC;
+            break;
+        case SPIFFS_ERR_NAME_TOO_LONG:
+            r->_errno = ENAMETOOLONG;
+            break;
+        case SPIFFS_ERR_OUT_OF_FILE_DESCS:
+            r->_errno = ENFILE;
+            break;
+        case SPIFFS_ERR_BAD_DESCRIPTOR:
+        case SPIFFS_ERR_FILE_CLOSED:
+        case SPIFFS_ERR_NOT_WRITABLE:
+        case SPIFFS_ERR_NOT_READABLE:
+            r->_errno = EBADF;
+            break;
+        default:
+            r->_errno = EIO;
+            break;
+    }
+    return -1;
+}
+
+static ssize_t vfs_spiffs_read(struct _reent *r, void *ctx, int fd, void *buf, size_t len)
+{
+    int res = SPIFFS_read(ctx, (spiffs_file)fd, buf, len);
+    if (res == SPIFFS_ERR_END_OF_OBJECT) {
+        return 0;
+    }
+    return spiffs_result(r, res);
+}
+
+static ssize_t vfs_spiffs_write(struct _reent *r, void *ctx, int fd, const void *buf, size_t len)
+{
+    return spiffs_result(r, SPIFFS_write(ctx, (spiffs_file)fd, (void*)buf, len));
+}
+
+static off_t vfs_spiffs_lseek(struct _reent *r, void *ctx, int fd, off_t offset, int whence)
+{
+    return spiffs_result(r, SPIFFS_lseek(ctx, (spiffs_file)fd, offset, whence));
+}
+
+static void spiffs_to_stat(const spiffs_stat *s, struct stat *st)
+{
+    memset(st, 0, sizeof(struct stat));
+    st->st_mode = S_IFREG | 0666;
+    st->st_size = s->size;
+}
+
+static int vfs_spiffs_fstat(struct _reent *r, void *ctx, int fd, struct stat *st)
+{
+    spiffs_stat s;
+    int res = SPIFFS_fstat(ctx, (spiffs_file)fd, &s);
+    if (res == SPIFFS_OK) {
+        spiffs_to_stat(&s, st);
+    }
+    return spiffs_result(r, res);
+}
+
+static int vfs_spiffs_close(struct _reent *r, void *ctx, int fd)
+{
+    return spiffs_result(r, SPIFFS_close(ctx, (spiffs_file)fd));
+}
+
+static int vfs_spiffs_open(struct _reent *r, void *ctx, const char *pathname, int flags, int mode)
+{
+    uint32_t spiffs_flags;
+
+    switch (flags & O_ACCMODE) {
+        case O_WRONLY: spiffs_flags = SPIFFS_WRONLY; break;
+        case O_RDWR:   spiffs_flags = SPIFFS_RDWR; break;
+        default:       spiffs_flags = SPIFFS_RDONLY; break;
+    }
+    if (flags & O_CREAT)    spiffs_flags |= SPIFFS_CREAT;
+    if (flags & O_APPEND)   spiffs_flags |= SPIFFS_APPEND;
+    if (flags & O_TRUNC)    spiffs_flags |= SPIFFS_TRUNC;
+    if (flags & O_EXCL)     spiffs_flags |= SPIFFS_EXCL;
+    /* if (flags & O_DIRECT)   spiffs_flags |= SPIFFS_DIRECT; no support in newlib */
+
+    return spiffs_result(r, SPIFFS_open(ctx, pathname, spiffs_flags, mode));
+}
+
+static int vfs_spiffs_stat(struct _reent *r, void *ctx, const char *pathname, struct stat *st)
+{
+    spiffs_stat s;
+    int res = SPIFFS_stat(ctx, pathname, &s);
+    if (res == SPIFFS_OK) {
+        spiffs_to_stat(&s, st);
+    }
+    return spiffs_result(r, res);
+}
+
+static int vfs_spiffs_unlink(struct _reent *r, void *ctx, const char *path)
+{
+    return spiffs_result(r, SPIFFS_remove(ctx, path));
+}
+
+static const vfs_ops_t spiffs_vfs_ops = {
+    .read = vfs_spiffs_read,
+    .write = vfs_spiffs_write,
+    .lseek = vfs_spiffs_lseek,
+    .fstat = vfs_spiffs_fstat,
+    .close = vfs_spiffs_close,
+    .open = vfs_spiffs_open,
+    .stat = vfs_spiffs_stat,
+    .unlink = vfs_spiffs_unlink,
+};
+
 #if SPIFFS_SINGLETON == 1
 void esp_spiffs_init()
 {
@@ -119,93 +243,10 @@ int32_t esp_spiffs_mount()
 
     if (err != SPIFFS_OK) {
         printf("Error spiffs mount: %d\n", err);
+    } else {
+        /* open(), stat() etc. now go to SPIFFS */
+        vfs_mount(&spiffs_vfs_ops, &fs);
     }
 
     return err;
 }
-
-// This implementation replaces implementation in core/newlib_syscals.c
-long _write_r(struct _reent *r, int fd, const char *ptr, int len )
-{
-    if(fd != r->_stdout->_file) {
-        return SPIFFS_write(&fs, (spiffs_file)fd, (char*)ptr, len);
-    }
-    for(int i = 0; i < len; i++) {
-        /* Auto convert CR to CRLF, ignore other LFs (compatible with Espressif SDK behaviour) */
-        if(ptr[i] == '\r')
-            continue;
-        if(ptr[i] == '\n')
-            uart_putc(0, '\r');
-        uart_putc(0, ptr[i]);
-    }
-    return len;
-}
-
-// This implementation replaces implementation in core/newlib_syscals.c
-long _read_r( struct _reent *r, int fd, char *ptr, int len )
-{
-    int ch, i;
-
-    if(fd != r->_stdin->_file) {
-        return SPIFFS_read(&fs, (spiffs_file)fd, ptr, len);
-    }
-    uart_rxfifo_wait(0, 1);
-    for(i = 0; i < len; i++) {
-        ch = uart_getc_nowait(0);
-        if (ch < 0) break;
-        ptr[i] = ch;
-    }
-    return i;
-}
-
-int _open_r(struct _reent *r, const char *pathname, int flags, int mode)
-{
-    uint32_t spiffs_flags = SPIFFS_RDONLY;
-
-    if (flags & O_CREAT)    spiffs_flags |= SPIFFS_CREAT;
-    if (flags & O_APPEND)   spiffs_flags |= SPIFFS_APPEND;
-    if (flags & O_TRUNC)    spiffs_flags |= SPIFFS_TRUNC;
-    if (flags & O_RDONLY)   spiffs_flags |= SPIFFS_RDONLY;
-    if (flags & O_WRONLY)   spiffs_flags |= SPIFFS_WRONLY;
-    if (flags & O_EXCL)     spiffs_flags |= SPIFFS_EXCL;
-    /* if (flags & O_DIRECT)   spiffs_flags |= SPIFFS_DIRECT; no support in newlib */
-
-    return SPIFFS_open(&fs, pathname, spiffs_flags, mode);
-}
-
-int _close_r(struct _reent *r, int fd)
-{
-    return SPIFFS_close(&fs, (spiffs_file)fd);
-}
-
-int _unlink_r(struct _reent *r, const char *path)
-{
-    return SPIFFS_remove(&fs, path);
-}
-
-int _fstat_r(struct _reent *r, int fd, void *buf)
-{
-    spiffs_stat s;
-    struct stat *sb = (struct stat*)buf;
-
-    int result = SPIFFS_fstat(&fs, (spiffs_file)fd, &s);
-    sb->st_size = s.size;
-
-    return result;
-}
-
-int _stat_r(struct _reent *r, const char *pathname, void *buf)
-{
-    spiffs_stat s;
-    struct stat *sb = (struct stat*)buf;
-
-    int result = SPIFFS_stat(&fs, pathname, &s);
-    sb->st_size = s.size;
-
-    return result;
-}
-
-off_t _lseek_r(struct _reent *r, int fd, off_t offset, int whence)
-{
-    return SPIFFS_lseek(&fs, (spiffs_file)fd, offset, whence);
-}
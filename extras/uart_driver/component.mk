@@ -0,0 +1,14 @@
+# Component makefile for extras/uart_driver
+
+# expected anyone using uart_driver includes it as 'uart_driver/uart_driver.h'
+INC_DIRS += $(uart_driver_ROOT)..
+
+# Set UART_DRIVER_STDIN=0 to keep stdin out of the driver, e.g. to use
+# extras/stdin_uart_interrupt for it (which also defines _read_stdin_r)
+UART_DRIVER_STDIN ?= 1
+uart_driver_CFLAGS = $(CFLAGS) -DUART_DRIVER_STDIN=$(UART_DRIVER_STDIN)
+
+# args for passing into compile rule generation
+uart_driver_SRC_DIR =  $(uart_driver_ROOT)
+
+$(eval $(call component_compile_rules,uart_driver))
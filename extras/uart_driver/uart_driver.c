@@ -0,0 +1,566 @@
+/**
+ * Interrupt driven, buffered UART driver for UART0 and UART1.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include "uart_driver.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <sys/reent.h>
+#include <esp8266.h>
+#include <esp/uart.h>
+#include <esp/interrupts.h>
+#include <esp/iomux.h>
+#include <FreeRTOS.h>
+#include <task.h>
+#include <semphr.h>
+
+/* Read stdin from the UART0 receive buffer, see component.mk */
+#ifndef UART_DRIVER_STDIN
+#define UART_DRIVER_STDIN 1
+#endif
+
+/* Refill the hardware FIFO when fewer than this many bytes are left in it */
+#define TXFIFO_EMPTY_THRESHOLD 16
+
+/* Empty the hardware FIFO when it holds this many bytes, or when nothing has
+   been received for RX_TIMEOUT_THRESHOLD character times. With 64 bytes
+   the interrupt can be up to ~680us late at 921600 baud. */
+#define RXFIFO_FULL_THRESHOLD 64
+#define RX_TIMEOUT_THRESHOLD 2
+
+/* Deassert RTS when the hardware FIFO holds this many bytes */
+#define RX_FLOWCTRL_THRESHOLD 110
+
+#define RX_INTS (UART_INT_ENABLE_RXFIFO_FULL | UART_INT_ENABLE_RXFIFO_TIMEOUT)
+#define RX_ERROR_INTS (UART_INT_ENABLE_RXFIFO_OVERFLOW | UART_INT_ENABLE_FRAMING_ERR \
+                       | UART_INT_ENABLE_PARITY_ERR | UART_INT_ENABLE_BREAK_DETECTED)
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t size;              // one byte more than the usable size
+    volatile uint32_t head;     // next byte to write, only moved by writers
+    volatile uint32_t tail;     // next byte to send, only moved by the ISR
+    uart_tx_policy_t policy;
+    volatile uint32_t dropped;
+    xSemaphoreHandle lock;      // serialises writers
+    xSemaphoreHandle space;     // given by the ISR when it frees space
+} uart_tx_t;
+
+typedef struct {
+    uint8_t *buf;
+    uint32_t size;              // one byte more than the usable size
+    volatile uint32_t head;     // next byte to store, only moved by the ISR
+    volatile uint32_t tail;     // next byte to read, only moved by readers
+    volatile bool stalled;      // ISR stopped emptying the FIFO (flow control)
+    volatile uart_rx_stats_t stats;
+    xSemaphoreHandle lock;      // serialises readers
+    xSemaphoreHandle data;      // given by the ISR when data arrives
+} uart_rx_t;
+
+extern bool esp_in_isr;
+
+static uart_tx_t *tx[2];
+static uart_rx_t *rx[2];
+static bool flow_control[2];
+static bool isr_attached;
+
+static inline uint32_t tx_used(const uart_tx_t *t)
+{
+    return (t->head + t->size - t->tail) % t->size;
+}
+
+static inline uint32_t fifo_space(int uart_num)
+{
+    return UART_FIFO_MAX - FIELD2VAL(UART_STATUS_TXFIFO_COUNT, UART(uart_num).STATUS);
+}
+
+/* Move as much as fits from the ring buffer into the hardware FIFO */
+static IRAM uint32_t tx_fill_fifo(int uart_num, uart_tx_t *t)
+{
+    uint32_t space = fifo_space(uart_num);
+    uint32_t tail = t->tail;
+    uint32_t head = t->head;
+    uint32_t count = 0;
+
+    while (space-- && tail != head) {
+        UART(uart_num).FIFO = t->buf[tail];
+        tail = (tail + 1 == t->size) ? 0 : tail + 1;
+        count++;
+    }
+    t->tail = tail;
+    return count;
+}
+
+/* Move everything from the hardware FIFO into the ring buffer. If the ring
+   is full the rest is either left in the FIFO (flow control, the receive
+   interrupts are disabled until a reader makes space) or dropped. */
+static IRAM void rx_drain_fifo(int uart_num, uart_rx_t *r)
+{
+    uint32_t count = FIELD2VAL(UART_STATUS_RXFIFO_COUNT, UART(uart_num).STATUS);
+    uint32_t head = r->head;
+    uint32_t free = (r->tail + r->size - head - 1) % r->size;
+    uint32_t n = count < free ? count : free;
+
+    for (uint32_t i = 0; i < n; i++) {
+        r->buf[head] = UART(uart_num).FIFO;
+        head = (head + 1 == r->size) ? 0 : head + 1;
+    }
+    r->head = head;
+
+    if (count > n) {
+        if (flow_control[uart_num]) {
+            UART(uart_num).INT_ENABLE &= ~RX_INTS;
+            r->stalled = true;
+        } else {
+            r->stats.overruns += count - n;
+            for (; n < count; n++)
+                (void)UART(uart_num).FIFO;
+        }
+    }
+}
+
+static IRAM void rx_count_errors(uart_rx_t *r, uint32_t status)
+{
+    if (status & UART_INT_STATUS_RXFIFO_OVERFLOW)
+        r->stats.fifo_overflows++;
+    if (status & UART_INT_STATUS_FRAMING_ERR)
+        r->stats.framing_errors++;
+    if (status & UART_INT_STATUS_PARITY_ERR)
+        r->stats.parity_errors++;
+    if (status & UART_INT_STATUS_BREAK_DETECTED)
+        r->stats.breaks++;
+}
+
+static IRAM void uart_isr(void)
+{
+    portBASE_TYPE task_awoken = pdFALSE;
+
+    for (int i = 0; i < 2; i++) {
+        uint32_t status = UART(i).INT_STATUS;
+        uart_tx_t *t = tx[i];
+        uart_rx_t *r = rx[i];
+
+        if (r && (status & (RX_INTS | RX_ERROR_INTS))) {
+            if (status & RX_ERROR_INTS)
+                rx_count_errors(r, status);
+            if (status & RX_INTS)
+                rx_drain_fifo(i, r);
+            UART(i).INT_CLEAR = status & (RX_INTS | RX_ERROR_INTS);
+            if (r->head != r->tail)
+                xSemaphoreGiveFromISR(r->data, &task_awoken);
+        }
+
+        if (t && (status & UART_INT_STATUS_TXFIFO_EMPTY)) {
+            tx_fill_fifo(i, t);
+            if (t->tail == t->head)
+                UART(i).INT_ENABLE &= ~UART_INT_ENABLE_TXFIFO_EMPTY;
+            UART(i).INT_CLEAR = UART_INT_CLEAR_TXFIFO_EMPTY;
+            xSemaphoreGiveFromISR(t->space, &task_awoken);
+        }
+    }
+    portEND_SWITCHING_ISR(task_awoken);
+}
+
+static void attach_isr(void)
+{
+    if (!isr_attached) {
+        _xt_isr_attach(INUM_UART, uart_isr);
+        _xt_isr_unmask(BIT(INUM_UART));
+        isr_attached = true;
+    }
+}
+
+static void write_polled(int uart_num, const uint8_t *data, size_t len)
+{
+    while (len) {
+        uint32_t n = uart_txfifo_wait(uart_num, 1);
+        if (n > len)
+            n = len;
+        len -= n;
+        while (n--)
+            UART(uart_num).FIFO = *data++;
+    }
+}
+
+bool uart_tx_init(int uart_num, uint16_t buf_size, uart_tx_policy_t policy)
+{
+    if (uart_num < 0 || uart_num > 1 || buf_size < 2 || tx[uart_num])
+        return false;
+
+    uart_tx_t *t = calloc(1, sizeof(uart_tx_t));
+    if (!t)
+        return false;
+    t->size = buf_size + 1;
+    t->policy = policy;
+    t->buf = malloc(t->size);
+    t->lock = xSemaphoreCreateMutex();
+    vSemaphoreCreateBinary(t->space);
+    if (!t->buf || !t->lock || !t->space) {
+        if (t->lock)
+            vSemaphoreDelete(t->lock);
+        if (t->space)
+            vSemaphoreDelete(t->space);
+        free(t->buf);
+        free(t);
+        return false;
+    }
+
+    UART(uart_num).CONF1 = SET_FIELD(UART(uart_num).CONF1,
+            UART_CONF1_TXFIFO_EMPTY_THRESHOLD, TXFIFO_EMPTY_THRESHOLD);
+    UART(uart_num).INT_CLEAR = UART_INT_CLEAR_TXFIFO_EMPTY;
+    tx[uart_num] = t;
+    attach_isr();
+    return true;
+}
+
+void uart_tx_deinit(int uart_num)
+{
+    uart_tx_t *t = tx[uart_num];
+    if (!t)
+        return;
+
+    xSemaphoreTake(t->lock, portMAX_DELAY);
+    uart_tx_flush(uart_num);
+    taskENTER_CRITICAL();
+    UART(uart_num).INT_ENABLE &= ~UART_INT_ENABLE_TXFIFO_EMPTY;
+    tx[uart_num] = NULL;
+    taskEXIT_CRITICAL();
+
+    vSemaphoreDelete(t->lock);
+    vSemaphoreDelete(t->space);
+    free(t->buf);
+    free(t);
+}
+
+/* The mutex and semaphores can only be used from a task that is allowed to
+   block: not from an interrupt handler (or the NMI), inside a critical
+   section, or while the scheduler is suspended or not yet started. */
+static inline bool can_block(void)
+{
+    return !esp_in_isr && !sdk_NMIIrqIsOn && !level1_int_disabled
+        && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING;
+}
+
+/* Where the interrupt can't be waited for (see can_block()), send what is
+   queued and the new data with busy waiting. The ring is emptied with
+   interrupts off so the ISR doesn't move tail at the same time. */
+static size_t write_nonblocking(int uart_num, uart_tx_t *t,
+                                const uint8_t *data, size_t len)
+{
+    while (t->tail != t->head) {
+        uart_txfifo_wait(uart_num, 1);
+        uint32_t ps = _xt_disable_interrupts();
+        tx_fill_fifo(uart_num, t);
+        _xt_restore_interrupts(ps);
+    }
+    write_polled(uart_num, data, len);
+    return len;
+}
+
+size_t uart_write(int uart_num, const void *data, size_t len)
+{
+    const uint8_t *p = data;
+    uart_tx_t *t = tx[uart_num];
+    size_t done = 0;
+
+    if (!t) {
+        write_polled(uart_num, p, len);
+        return len;
+    }
+    if (!can_block())
+        return write_nonblocking(uart_num, t, p, len);
+
+    xSemaphoreTake(t->lock, portMAX_DELAY);
+    while (done < len) {
+        uint32_t head = t->head;
+
+        /* Nothing queued, so the interrupt isn't using the FIFO and data
+           can go straight in */
+        if (head == t->tail) {
+            uint32_t n = fifo_space(uart_num);
+            if (n > len - done)
+                n = len - done;
+            for (uint32_t i = 0; i < n; i++)
+                UART(uart_num).FIFO = p[done + i];
+            done += n;
+        }
+
+        /* Queue the rest, as far as it fits. The ISR only moves tail, so
+           the free space can only grow while this copies. */
+        uint32_t n = (t->tail + t->size - head - 1) % t->size;
+        if (n > len - done)
+            n = len - done;
+        if (n) {
+            uint32_t first = t->size - head;
+            if (first > n)
+                first = n;
+            memcpy(t->buf + head, p + done, first);
+            memcpy(t->buf, p + done + first, n - first);
+            t->head = (head + n) % t->size;
+            done += n;
+
+            taskENTER_CRITICAL();
+            UART(uart_num).INT_ENABLE |= UART_INT_ENABLE_TXFIFO_EMPTY;
+            taskEXIT_CRITICAL();
+        }
+
+        if (done < len) {
+            if (t->policy == UART_TX_DROP) {
+                t->dropped += len - done;
+                break;
+            }
+            xSemaphoreTake(t->space, portMAX_DELAY);
+        }
+    }
+    xSemaphoreGive(t->lock);
+    return done;
+}
+
+void uart_tx_flush(int uart_num)
+{
+    uart_tx_t *t = tx[uart_num];
+
+    if (t) {
+        if (!can_block())
+            write_nonblocking(uart_num, t, NULL, 0);
+        while (t->tail != t->head)
+            xSemaphoreTake(t->space, 1);
+    }
+    uart_flush_txfifo(uart_num);
+}
+
+void uart_tx_get_stats(int uart_num, uart_tx_stats_t *stats, bool reset)
+{
+    uart_tx_t *t = tx[uart_num];
+
+    if (!t) {
+        memset(stats, 0, sizeof(uart_tx_stats_t));
+        return;
+    }
+    taskENTER_CRITICAL();
+    stats->dropped = t->dropped;
+    stats->used = tx_used(t);
+    if (reset)
+        t->dropped = 0;
+    taskEXIT_CRITICAL();
+}
+
+bool uart_rx_init(int uart_num, uint16_t buf_size)
+{
+    if (uart_num < 0 || uart_num > 1 || buf_size < 2 || rx[uart_num])
+        return false;
+
+    uart_rx_t *r = calloc(1, sizeof(uart_rx_t));
+    if (!r)
+        return false;
+    r->size = buf_size + 1;
+    r->buf = malloc(r->size);
+    r->lock = xSemaphoreCreateMutex();
+    vSemaphoreCreateBinary(r->data);
+    if (!r->buf || !r->lock || !r->data) {
+        if (r->lock)
+            vSemaphoreDelete(r->lock);
+        if (r->data)
+            vSemaphoreDelete(r->data);
+        free(r->buf);
+        free(r);
+        return false;
+    }
+    /* binary semaphores are created 'given' */
+    xSemaphoreTake(r->data, 0);
+
+    taskENTER_CRITICAL();
+    uint32_t conf1 = UART(uart_num).CONF1;
+    conf1 = SET_FIELD(conf1, UART_CONF1_RXFIFO_FULL_THRESHOLD, RXFIFO_FULL_THRESHOLD);
+    conf1 = SET_FIELD(conf1, UART_CONF1_RX_TIMEOUT_THRESHOLD, RX_TIMEOUT_THRESHOLD);
+    UART(uart_num).CONF1 = conf1 | UART_CONF1_RX_TIMEOUT_ENABLE;
+    UART(uart_num).INT_CLEAR = RX_INTS | RX_ERROR_INTS;
+    UART(uart_num).INT_ENABLE |= RX_INTS | RX_ERROR_INTS;
+    rx[uart_num] = r;
+    taskEXIT_CRITICAL();
+
+    attach_isr();
+    return true;
+}
+
+void uart_rx_deinit(int uart_num)
+{
+    uart_rx_t *r = rx[uart_num];
+    if (!r)
+        return;
+
+    taskENTER_CRITICAL();
+    UART(uart_num).INT_ENABLE &= ~(RX_INTS | RX_ERROR_INTS);
+    rx[uart_num] = NULL;
+    taskEXIT_CRITICAL();
+
+    vSemaphoreDelete(r->lock);
+    vSemaphoreDelete(r->data);
+    free(r->buf);
+    free(r);
+}
+
+void uart_set_flow_control(int uart_num, bool enable)
+{
+    if (uart_num == 0 && enable) {
+        iomux_set_function(gpio_to_iomux(13), IOMUX_GPIO13_FUNC_UART0_CTS);
+        iomux_set_function(gpio_to_iomux(15), IOMUX_GPIO15_FUNC_UART0_RTS);
+    }
+
+    taskENTER_CRITICAL();
+    uint32_t conf1 = SET_FIELD(UART(uart_num).CONF1,
+            UART_CONF1_RX_FLOWCTRL_THRESHOLD, RX_FLOWCTRL_THRESHOLD);
+    if (enable) {
+        UART(uart_num).CONF1 = conf1 | UART_CONF1_RX_FLOWCTRL_ENABLE;
+        UART(uart_num).CONF0 |= UART_CONF0_TX_FLOW_ENABLE;
+    } else {
+        UART(uart_num).CONF1 = conf1 & ~UART_CONF1_RX_FLOWCTRL_ENABLE;
+        UART(uart_num).CONF0 &= ~UART_CONF0_TX_FLOW_ENABLE;
+    }
+    flow_control[uart_num] = enable;
+
+    /* without flow control a stalled FIFO has to be emptied (and the excess
+       dropped) again */
+    uart_rx_t *r = rx[uart_num];
+    bool drained = false;
+    if (r && r->stalled && !enable) {
+        r->stalled = false;
+        rx_drain_fifo(uart_num, r);
+        UART(uart_num).INT_ENABLE |= RX_INTS;
+        drained = true;
+    }
+    taskEXIT_CRITICAL();
+
+    if (drained)
+        xSemaphoreGive(r->data);
+}
+
+static size_t read_polled(int uart_num, uint8_t *buf, size_t len, portTickType timeout)
+{
+    portTickType start = xTaskGetTickCount();
+    bool running = xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED;
+    size_t n = 0;
+
+    while (!FIELD2VAL(UART_STATUS_RXFIFO_COUNT, UART(uart_num).STATUS)) {
+        if (!running)
+            continue;
+        if (timeout != portMAX_DELAY && xTaskGetTickCount() - start >= timeout)
+            return 0;
+        vTaskDelay(1);
+    }
+    while (n < len && FIELD2VAL(UART_STATUS_RXFIFO_COUNT, UART(uart_num).STATUS))
+        buf[n++] = UART(uart_num).FIFO;
+    return n;
+}
+
+size_t uart_read(int uart_num, void *buf, size_t len, portTickType timeout)
+{
+    uart_rx_t *r = rx[uart_num];
+    portTickType start = xTaskGetTickCount();
+    size_t n = 0;
+
+    if (!r)
+        return read_polled(uart_num, buf, len, timeout);
+    if (len == 0)
+        return 0;
+
+    if (!xSemaphoreTake(r->lock, timeout))
+        return 0;
+    for (;;) {
+        uint32_t tail = r->tail;
+        uint32_t used = (r->head + r->size - tail) % r->size;
+        if (used) {
+            n = used < len ? used : len;
+            uint32_t first = r->size - tail;
+            if (first > n)
+                first = n;
+            memcpy(buf, r->buf + tail, first);
+            memcpy((uint8_t *)buf + first, r->buf, n - first);
+            r->tail = (tail + n) % r->size;
+            break;
+        }
+
+        portTickType wait = portMAX_DELAY;
+        if (timeout != portMAX_DELAY) {
+            portTickType elapsed = xTaskGetTickCount() - start;
+            if (elapsed >= timeout)
+                break;
+            wait = timeout - elapsed;
+        }
+        if (!xSemaphoreTake(r->data, wait))
+            break;
+    }
+
+    if (n && r->stalled) {
+        /* There is space again. Empty the FIFO here, as the RX interrupts
+           may not fire again for what is already in it, and only let the
+           ISR take over if it all fitted. */
+        taskENTER_CRITICAL();
+        r->stalled = false;
+        rx_drain_fifo(uart_num, r);
+        if (!r->stalled)
+            UART(uart_num).INT_ENABLE |= RX_INTS;
+        taskEXIT_CRITICAL();
+    }
+    xSemaphoreGive(r->lock);
+    return n;
+}
+
+size_t uart_rx_available(int uart_num)
+{
+    uart_rx_t *r = rx[uart_num];
+
+    if (!r)
+        return FIELD2VAL(UART_STATUS_RXFIFO_COUNT, UART(uart_num).STATUS);
+    return (r->head + r->size - r->tail) % r->size;
+}
+
+void uart_rx_get_stats(int uart_num, uart_rx_stats_t *stats, bool reset)
+{
+    uart_rx_t *r = rx[uart_num];
+
+    if (!r) {
+        memset(stats, 0, sizeof(uart_rx_stats_t));
+        return;
+    }
+    taskENTER_CRITICAL();
+    *stats = r->stats;
+    stats->used = (r->head + r->size - r->tail) % r->size;
+    if (reset)
+        memset((void *)&r->stats, 0, sizeof(uart_rx_stats_t));
+    taskEXIT_CRITICAL();
+}
+
+#if UART_DRIVER_STDIN
+/* Replaces the polled console reader in core/newlib_syscalls.c. Build with
+   UART_DRIVER_STDIN=0 to link extras/stdin_uart_interrupt instead, which
+   defines it too. */
+long _read_stdin_r(struct _reent *r, int fd, char *ptr, int len)
+{
+    return uart_read(0, ptr, len, portMAX_DELAY);
+}
+#endif
+
+/* Replaces the polled console writer in core/newlib_syscalls.c whenever
+   this driver is linked in. CR is dropped and LF becomes CRLF, as there.
+   uart_write() busy waits instead of taking the mutex where blocking isn't
+   allowed, so printf() still works from an interrupt handler or a critical
+   section. */
+long _write_stdout_r(struct _reent *r, int fd, const char *ptr, int len)
+{
+    int start = 0;
+
+    for (int i = 0; i < len; i++) {
+        if (ptr[i] != '\r' && ptr[i] != '\n')
+            continue;
+        uart_write(0, ptr + start, i - start);
+        if (ptr[i] == '\n')
+            uart_write(0, "\r\n", 2);
+        start = i + 1;
+    }
+    uart_write(0, ptr + start, len - start);
+    return len;
+}
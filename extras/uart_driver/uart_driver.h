@@ -0,0 +1,156 @@
+/**
+ * Interrupt driven, buffered UART driver for UART0 and UART1.
+ *
+ * Transmit and receive are started separately with uart_tx_init() and
+ * uart_rx_init().
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#ifndef __UART_DRIVER_H__
+#define __UART_DRIVER_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "FreeRTOS.h"
+
+/**
+ * What uart_write() does when the transmit buffer is full.
+ */
+typedef enum {
+    UART_TX_BLOCK,  ///< wait for the interrupt handler to make space
+    UART_TX_DROP,   ///< queue what fits and drop the rest
+} uart_tx_policy_t;
+
+typedef struct {
+    uint32_t dropped;   ///< bytes dropped because the buffer was full
+    uint16_t used;      ///< bytes waiting in the buffer
+} uart_tx_stats_t;
+
+/**
+ * Start buffered transmission on a UART.
+ *
+ * Data written with uart_write() is copied into a ring buffer of
+ * `buf_size` bytes and fed to the hardware FIFO from the TX FIFO empty
+ * interrupt, so writers only block when the buffer is full (and only if
+ * the policy is UART_TX_BLOCK).
+ *
+ * For UART0 this also makes stdout (printf etc.) buffered.
+ *
+ * @param uart_num 0 or 1
+ * @param buf_size Size of the ring buffer, 2 to 65535 bytes.
+ * @param policy What to do when the buffer is full.
+ * @return false if the buffer couldn't be allocated.
+ */
+bool uart_tx_init(int uart_num, uint16_t buf_size, uart_tx_policy_t policy);
+
+/**
+ * Wait until everything has been sent, then stop buffered transmission
+ * and free the buffer. uart_write() then writes directly to the FIFO.
+ *
+ * No other task may be writing to the UART at the same time.
+ */
+void uart_tx_deinit(int uart_num);
+
+/**
+ * Queue data for transmission.
+ *
+ * If the ring buffer is empty, as much as fits goes straight into the
+ * hardware FIFO. Without uart_tx_init() the data is written to the FIFO
+ * with busy waiting.
+ *
+ * May be called from an interrupt handler, inside a critical section or
+ * while the scheduler is suspended or not started. The buffered data and
+ * then the new data are then written with busy waiting instead.
+ *
+ * @return Number of bytes queued, less than len only if data was dropped.
+ */
+size_t uart_write(int uart_num, const void *data, size_t len);
+
+/**
+ * Wait until the buffer and the hardware FIFO are empty.
+ */
+void uart_tx_flush(int uart_num);
+
+/**
+ * Get transmit statistics.
+ *
+ * @param reset Set the dropped count back to zero.
+ */
+void uart_tx_get_stats(int uart_num, uart_tx_stats_t *stats, bool reset);
+
+typedef struct {
+    uint32_t overruns;       ///< bytes lost because the buffer was full
+    uint32_t fifo_overflows; ///< hardware FIFO overflows (interrupt too late)
+    uint32_t framing_errors;
+    uint32_t parity_errors;
+    uint32_t breaks;         ///< break conditions detected
+    uint16_t used;           ///< bytes waiting in the buffer
+} uart_rx_stats_t;
+
+/**
+ * Start buffered reception on a UART.
+ *
+ * The hardware FIFO is emptied into a ring buffer of `buf_size` bytes
+ * when it is half full or when no byte has been received for a few
+ * character times, so there is one interrupt per burst rather than per
+ * byte.
+ *
+ * For UART0 this also makes stdin read from the buffer.
+ *
+ * Note that the UART1 RX pin is used for the SPI flash on all common
+ * modules.
+ *
+ * @param uart_num 0 or 1
+ * @param buf_size Size of the ring buffer, 2 to 65535 bytes.
+ * @return false if the buffer couldn't be allocated.
+ */
+bool uart_rx_init(int uart_num, uint16_t buf_size);
+
+/**
+ * Stop buffered reception and free the buffer. Data still in the buffer
+ * is lost.
+ *
+ * No other task may be reading from the UART at the same time.
+ */
+void uart_rx_deinit(int uart_num);
+
+/**
+ * Enable or disable RTS/CTS hardware flow control.
+ *
+ * RTS is deasserted when the hardware FIFO is nearly full. If the ring
+ * buffer is full, the interrupt handler stops emptying the FIFO until
+ * uart_read() makes space, so with flow control nothing is lost when the
+ * reader falls behind. Without it the excess is counted as overruns.
+ *
+ * For UART0 this also switches GPIO13 to CTS and GPIO15 to RTS. The UART1
+ * pins are shared with the SPI flash and have to be set up by the caller.
+ */
+void uart_set_flow_control(int uart_num, bool enable);
+
+/**
+ * Read received data.
+ *
+ * Waits until at least one byte is available or the timeout expires, then
+ * returns whatever is available, up to len bytes. Without uart_rx_init()
+ * the hardware FIFO is polled.
+ *
+ * @param timeout Time to wait in ticks, portMAX_DELAY to wait forever.
+ * @return Number of bytes read, 0 on timeout.
+ */
+size_t uart_read(int uart_num, void *buf, size_t len, portTickType timeout);
+
+/**
+ * Number of bytes that can be read without waiting.
+ */
+size_t uart_rx_available(int uart_num);
+
+/**
+ * Get receive statistics.
+ *
+ * @param reset Set the error counts back to zero.
+ */
+void uart_rx_get_stats(int uart_num, uart_rx_stats_t *stats, bool reset);
+
+#endif  // __UART_DRIVER_H__
@@ -0,0 +1,9 @@
+/* Host test stand-in for the FreeRTOS headers used by ws2812_i2s */
+#ifndef _STUB_FREERTOS_H
+#define _STUB_FREERTOS_H
+
+#include <stdint.h>
+
+typedef long portBASE_TYPE;
+
+#endif
@@ -0,0 +1,39 @@
+/* Host test stand-in for i2s_dma, the test provides the functions */
+#ifndef __I2S_DMA_H__
+#define __I2S_DMA_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef void (*i2s_dma_isr_t)(void);
+
+typedef struct dma_descriptor {
+    uint32_t blocksize:12;
+    uint32_t datalen:12;
+    uint32_t unused:5;
+    uint32_t sub_sof:1;
+    uint32_t eof:1;
+    uint32_t owner:1;
+
+    void* buf_ptr;
+    struct dma_descriptor *next_link_ptr;
+} dma_descriptor_t;
+
+typedef struct {
+    uint8_t bclk_div;
+    uint8_t clkm_div;
+} i2s_clock_div_t;
+
+typedef struct {
+    bool data;
+    bool clock;
+    bool ws;
+} i2s_pins_t;
+
+void i2s_dma_init(i2s_dma_isr_t isr, i2s_clock_div_t clock_div, i2s_pins_t pins);
+i2s_clock_div_t i2s_get_clock_div(int32_t freq);
+void i2s_dma_start(dma_descriptor_t *descr);
+void i2s_dma_clear_interrupt(void);
+bool i2s_dma_is_eof_interrupt(void);
+
+#endif /* __I2S_DMA_H__ */
@@ -0,0 +1,10 @@
+/* Host test stand-in for task.h, implemented in test_ws2812_i2s.c */
+#ifndef _STUB_TASK_H
+#define _STUB_TASK_H
+
+#include "FreeRTOS.h"
+
+void vTaskSuspendAll(void);
+portBASE_TYPE xTaskResumeAll(void);
+
+#endif
@@ -0,0 +1,367 @@
+/* Host test for the ws2812_i2s encoder.
+ *
+ * The descriptor list passed to i2s_dma_start() is walked like the DMA
+ * engine would, and the data is decoded the way I2S sends it (the upper
+ * half of each 32-bit word first, most significant bit first), each 4 bit
+ * symbol being 1000 for a WS2812 0 bit and 1110 for a 1 bit.
+ *
+ * Part of esp-open-rtos
+ * BSD Licensed as described in the file LICENSE
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "test.h"
+#include "../ws2812_i2s.c"
+
+#define MAX_PIXELS 400
+
+static i2s_dma_isr_t dma_isr;
+static dma_descriptor_t *started;
+
+void i2s_dma_init(i2s_dma_isr_t isr, i2s_clock_div_t clock_div, i2s_pins_t pins)
+{
+    dma_isr = isr;
+}
+
+i2s_clock_div_t i2s_get_clock_div(int32_t freq)
+{
+    i2s_clock_div_t div = {0, 0};
+    return div;
+}
+
+void i2s_dma_start(dma_descriptor_t *descr)
+{
+    started = descr;
+}
+
+void i2s_dma_clear_interrupt(void)
+{
+}
+
+bool i2s_dma_is_eof_interrupt(void)
+{
+    return true;
+}
+
+static void init(uint32_t pixels_number)
+{
+    free(dma_block_list);
+    free(dma_buffer);
+    started = NULL;
+    ws2812_i2s_init(pixels_number);
+}
+
+/* Bytes sent for the last update, G, R, B for each pixel */
+static uint8_t sent[MAX_PIXELS * 3];
+static uint32_t sent_len;
+
+/* Runs the transfer started by the last update and decodes it into 'sent'.
+ * Returns false if the descriptors or the bitstream are malformed. */
+static bool transmit(void)
+{
+    static uint8_t stream[MAX_PIXELS * DMA_PIXEL_SIZE];
+    uint32_t stream_len = 0;
+    dma_descriptor_t *d = started;
+
+    if (!d || !i2s_dma_processing) {
+        return false;
+    }
+    started = NULL;
+
+    /* data blocks, then the reset block, then the stop block */
+    for (; d->next_link_ptr->next_link_ptr; d = d->next_link_ptr) {
+        if (!d->owner || d->eof || d->datalen > MAX_DMA_BLOCK_SIZE
+                || stream_len + d->datalen > sizeof(stream)) {
+            return false;
+        }
+        memcpy(stream + stream_len, d->buf_ptr, d->datalen);
+        stream_len += d->datalen;
+    }
+    if (d->datalen != WS2812_ZEROES_LENGTH || d->eof) {
+        return false;
+    }
+    for (int i = 0; i < WS2812_ZEROES_LENGTH; i++) {
+        if (((uint8_t *)d->buf_ptr)[i] != 0) {
+            return false;
+        }
+    }
+    d = d->next_link_ptr;
+    if (!d->eof || d->datalen != 0) {
+        return false;
+    }
+    if (stream_len % DMA_PIXEL_SIZE) {
+        return false;
+    }
+
+    /* one colour byte per 32-bit word */
+    sent_len = 0;
+    for (uint32_t i = 0; i < stream_len; i += 4) {
+        uint32_t word;
+        uint8_t v = 0;
+        memcpy(&word, stream + i, 4);
+        for (int bit = 0; bit < 8; bit++) {
+            uint32_t symbol = (word >> (28 - 4 * bit)) & 0xF;
+            if (symbol != 0x8 && symbol != 0xE) {
+                return false;
+            }
+            v = (v << 1) | (symbol == 0xE);
+        }
+        sent[sent_len++] = v;
+    }
+
+    dma_isr();
+    return !i2s_dma_processing;
+}
+
+static bool sent_pixel(uint32_t i, const ws2812_pixel_t *p)
+{
+    return sent[i * 3] == p->green && sent[i * 3 + 1] == p->red
+        && sent[i * 3 + 2] == p->blue;
+}
+
+/* Every byte value, in each colour position */
+int test_encode(void)
+{
+    ws2812_pixel_t pixels[86];
+
+    init(86);
+    for (int i = 0; i < 86; i++) {
+        pixels[i].green = i * 3;
+        pixels[i].red = i * 3 + 1;
+        pixels[i].blue = i * 3 + 2;
+    }
+    ws2812_i2s_update(pixels);
+    check(transmit());
+    check(sent_len == 86 * 3);
+    for (int i = 0; i < 86; i++) {
+        check(sent_pixel(i, &pixels[i]));
+    }
+
+    for (int shift = 1; shift < 3; shift++) {
+        for (int i = 0; i < 86; i++) {
+            pixels[i].green = i * 3 + shift;
+            pixels[i].red = i * 3 + shift + 1;
+            pixels[i].blue = i * 3 + shift + 2;
+        }
+        ws2812_i2s_update(pixels);
+        check(transmit());
+        for (int i = 0; i < 86; i++) {
+            check(sent_pixel(i, &pixels[i]));
+        }
+    }
+    done();
+}
+
+/* More than one DMA block of pixel data */
+int test_encode_blocks(void)
+{
+    static ws2812_pixel_t pixels[MAX_PIXELS];
+
+    init(MAX_PIXELS);
+    check(dma_block_list_size == 4);
+    srand(1);
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < MAX_PIXELS; i++) {
+            pixels[i].red = rand();
+            pixels[i].green = rand();
+            pixels[i].blue = rand();
+        }
+        ws2812_i2s_update(pixels);
+        check(transmit());
+        check(sent_len == MAX_PIXELS * 3);
+        for (int i = 0; i < MAX_PIXELS; i++) {
+            check(sent_pixel(i, &pixels[i]));
+        }
+    }
+    done();
+}
+
+/* Segments are sent back to back, limited to the chain length */
+int test_segments(void)
+{
+    ws2812_pixel_t all[10], a[3], b[20];
+
+    init(10);
+    for (int i = 0; i < 10; i++) {
+        all[i] = (ws2812_pixel_t){ .red = i, .green = 100 + i, .blue = 200 + i };
+    }
+    for (int i = 0; i < 3; i++) {
+        a[i] = (ws2812_pixel_t){ .red = 10 + i, .green = 20 + i, .blue = 30 + i };
+    }
+    for (int i = 0; i < 20; i++) {
+        b[i] = (ws2812_pixel_t){ .red = 50 + i, .green = 80 + i, .blue = 110 + i };
+    }
+    ws2812_i2s_update(all);
+    check(transmit());
+
+    /* shorter than the chain, the rest keeps the previous data */
+    ws2812_i2s_segment_t short_chain[] = { { a, 3 }, { b, 4 } };
+    ws2812_i2s_update_segments(short_chain, 2);
+    check(transmit());
+    check(sent_len == 10 * 3);
+    for (int i = 0; i < 3; i++) {
+        check(sent_pixel(i, &a[i]));
+    }
+    for (int i = 0; i < 4; i++) {
+        check(sent_pixel(3 + i, &b[i]));
+    }
+    for (int i = 7; i < 10; i++) {
+        check(sent_pixel(i, &all[i]));
+    }
+
+    /* longer than the chain, the rest of the segments is dropped */
+    ws2812_i2s_segment_t long_chain[] = { { b, 2 }, { a, 0 }, { a, 3 }, { b, 20 }, { a, 3 } };
+    ws2812_i2s_update_segments(long_chain, 5);
+    check(transmit());
+    check(sent_len == 10 * 3);
+    check(sent_pixel(0, &b[0]));
+    check(sent_pixel(1, &b[1]));
+    for (int i = 0; i < 3; i++) {
+        check(sent_pixel(2 + i, &a[i]));
+    }
+    for (int i = 0; i < 5; i++) {
+        check(sent_pixel(5 + i, &b[i]));
+    }
+
+    /* no segments sends the previous data again */
+    ws2812_i2s_update_segments(NULL, 0);
+    check(transmit());
+    check(sent_pixel(0, &b[0]));
+    check(sent_pixel(9, &b[4]));
+    done();
+}
+
+static void set_grey(ws2812_pixel_t *pixels, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        pixels[i].red = pixels[i].green = pixels[i].blue = i;
+    }
+}
+
+/* Brightness and gamma, rounded to the nearest level */
+int test_correction(void)
+{
+    ws2812_pixel_t pixels[256];
+
+    init(256);
+    set_grey(pixels, 256);
+
+    ws2812_i2s_set_brightness(128);
+    ws2812_i2s_update(pixels);
+    check(transmit());
+    for (int v = 0; v < 256; v++) {
+        check(sent[v * 3] == (int)(v * 129 / 256.0 + 0.5));
+        check(sent[v * 3 + 1] == sent[v * 3] && sent[v * 3 + 2] == sent[v * 3]);
+    }
+
+    ws2812_i2s_set_brightness(255);
+    ws2812_i2s_set_gamma(ws2812_i2s_gamma22);
+    ws2812_i2s_update(pixels);
+    check(transmit());
+    for (int v = 0; v < 256; v++) {
+        check(abs(sent[v * 3] - (int)(255 * pow(v / 255.0, 2.2) + 0.5)) <= 1);
+    }
+    check(sent[0] == 0 && sent[255 * 3] == 255);
+
+    ws2812_i2s_set_gamma(NULL);
+    check(!correction->enabled);
+    ws2812_i2s_update(pixels);
+    check(transmit());
+    for (int v = 0; v < 256; v++) {
+        check(sent_pixel(v, &pixels[v]));
+    }
+    done();
+}
+
+/* Over 8 updates each LED averages the level to 1/8 */
+int test_dither(void)
+{
+    ws2812_pixel_t pixels[256];
+    static int sum[256 * 3];
+
+    init(256);
+    set_grey(pixels, 256);
+    ws2812_i2s_set_gamma(ws2812_i2s_gamma22);
+    ws2812_i2s_set_brightness(100);
+    ws2812_i2s_set_dither(true);
+
+    memset(sum, 0, sizeof(sum));
+    for (int f = 0; f < 8; f++) {
+        ws2812_i2s_update(pixels);
+        check(transmit());
+        for (int i = 0; i < 256 * 3; i++) {
+            sum[i] += sent[i];
+        }
+    }
+    for (int i = 0; i < 256 * 3; i++) {
+        check(abs(sum[i] * 32 - correction->lut[i / 3]) < 32);
+    }
+
+    ws2812_i2s_set_dither(false);
+    ws2812_i2s_set_brightness(255);
+    ws2812_i2s_set_gamma(NULL);
+    check(!correction->enabled);
+    done();
+}
+
+static int suspended, suspend_calls;
+
+void vTaskSuspendAll(void)
+{
+    suspended++;
+    suspend_calls++;
+}
+
+portBASE_TYPE xTaskResumeAll(void)
+{
+    suspended--;
+    return 0;
+}
+
+/* A higher priority task calls the setters while a lower priority one is
+   in the middle of an update. As on the device, the update can't run
+   before the setters return, so they must neither wait for it nor touch
+   the correction it holds. */
+int test_correction_preempted(void)
+{
+    correction_t held;
+    const correction_t *c = start_encoding();
+
+    check(c == correction && encoding == c);
+    memcpy(&held, c, sizeof(held));
+    suspend_calls = 0;
+
+    /* a hang here is a setter waiting for the update */
+    alarm(5);
+    ws2812_i2s_set_brightness(10);
+    check(correction != c && correction->lut[255] == (65280 * 11) >> 8);
+    ws2812_i2s_set_brightness(20);
+    check(correction != c && correction->lut[255] == (65280 * 21) >> 8);
+    alarm(0);
+    check(memcmp(&held, c, sizeof(held)) == 0);
+    check(suspend_calls == 2 && suspended == 0);
+
+    /* once the update is done its buffer is free again */
+    encoding = NULL;
+    ws2812_i2s_set_brightness(30);
+    check(correction == c && c->lut[255] == (65280 * 31) >> 8);
+
+    ws2812_i2s_set_brightness(255);
+    done();
+}
+
+int main(void)
+{
+    test(test_encode, "encoding every colour value");
+    test(test_encode_blocks, "encoding across DMA blocks");
+    test(test_segments, "updating chained segments");
+    test(test_correction, "brightness and gamma correction");
+    test(test_dither, "temporal dithering");
+    test(test_correction_preempted, "correction set while an update is preempted");
+    printf("\nPASSED: %d\nFAILED: %d\n", test_passed, test_failed);
+    return (test_failed > 0);
+}
@@ -23,6 +23,8 @@
  */
 #include "ws2812_i2s.h"
 #include "i2s_dma/i2s_dma.h"
+#include "FreeRTOS.h"
+#include "task.h"
 
 #include <string.h>
 #include <malloc.h>
@@ -148,33 +150,221 @@ void ws2812_i2s_init(uint32_t pixels_number)
     i2s_dma_init(dma_isr_handler, clock_div, i2s_pins);
 }
 
-const IRAM_DATA int16_t bitpatterns[16] =
+/**
+ * Each WS2812 bit is sent as 4 I2S bits, 1000 for 0 and 1110 for 1, so a
+ * nibble becomes 16 I2S bits.
+ */
+#define NIBBLE_PATTERN(v) (0x8888 | ((v) & 8 ? 0x6000 : 0) | ((v) & 4 ? 0x0600 : 0) \
+                                  | ((v) & 2 ? 0x0060 : 0) | ((v) & 1 ? 0x0006 : 0))
+
+/**
+ * I2S sends the upper half of each 32-bit word first, so the high nibble
+ * goes there.
+ */
+#define BYTE_PATTERN(v) (NIBBLE_PATTERN((v) & 0x0F) | (NIBBLE_PATTERN((v) >> 4) << 16))
+
+#define BYTE_PATTERN4(v)   BYTE_PATTERN(v), BYTE_PATTERN(v + 1), BYTE_PATTERN(v + 2), BYTE_PATTERN(v + 3)
+#define BYTE_PATTERN16(v)  BYTE_PATTERN4(v), BYTE_PATTERN4(v + 4), BYTE_PATTERN4(v + 8), BYTE_PATTERN4(v + 12)
+#define BYTE_PATTERN64(v)  BYTE_PATTERN16(v), BYTE_PATTERN16(v + 16), BYTE_PATTERN16(v + 32), BYTE_PATTERN16(v + 48)
+
+/**
+ * DMA data for each colour byte. The encoder only reads whole words, so the
+ * table stays in flash.
+ */
+static const uint32_t bitpatterns[256] __attribute__((aligned(4))) =
 {
-    0b1000100010001000, 0b1000100010001110, 0b1000100011101000, 0b1000100011101110,
-    0b1000111010001000, 0b1000111010001110, 0b1000111011101000, 0b1000111011101110,
-    0b1110100010001000, 0b1110100010001110, 0b1110100011101000, 0b1110100011101110,
-    0b1110111010001000, 0b1110111010001110, 0b1110111011101000, 0b1110111011101110,
+    BYTE_PATTERN64(0), BYTE_PATTERN64(64), BYTE_PATTERN64(128), BYTE_PATTERN64(192)
 };
 
+/**
+ * 255 * (i / 255)^2.2 in 8.8 fixed point.
+ */
+const uint16_t ws2812_i2s_gamma22[256] __attribute__((aligned(4))) =
+{
+        0,     0,     2,     4,     7,    11,    17,    24,
+       32,    42,    53,    65,    78,    94,   110,   128,
+      148,   169,   191,   216,   241,   269,   298,   328,
+      360,   394,   430,   467,   506,   547,   589,   633,
+      679,   726,   776,   827,   880,   934,   991,  1049,
+     1109,  1171,  1235,  1300,  1368,  1437,  1508,  1581,
+     1656,  1733,  1812,  1893,  1975,  2060,  2146,  2235,
+     2325,  2417,  2512,  2608,  2706,  2806,  2908,  3013,
+     3119,  3227,  3337,  3450,  3564,  3680,  3798,  3919,
+     4041,  4166,  4292,  4421,  4552,  4685,  4819,  4956,
+     5096,  5237,  5380,  5525,  5673,  5823,  5974,  6128,
+     6284,  6442,  6603,  6765,  6930,  7097,  7266,  7437,
+     7610,  7786,  7963,  8143,  8325,  8509,  8696,  8885,
+     9075,  9268,  9464,  9661,  9861, 10063, 10267, 10474,
+    10682, 10893, 11107, 11322, 11540, 11760, 11982, 12207,
+    12433, 12663, 12894, 13128, 13363, 13602, 13842, 14085,
+    14330, 14578, 14827, 15080, 15334, 15591, 15850, 16111,
+    16375, 16641, 16909, 17180, 17453, 17729, 18006, 18287,
+    18569, 18854, 19141, 19431, 19723, 20017, 20314, 20613,
+    20915, 21218, 21525, 21833, 22144, 22458, 22774, 23092,
+    23413, 23736, 24062, 24390, 24720, 25053, 25388, 25726,
+    26066, 26408, 26753, 27101, 27451, 27803, 28158, 28515,
+    28875, 29237, 29602, 29969, 30338, 30710, 31085, 31462,
+    31841, 32223, 32608, 32995, 33384, 33776, 34170, 34567,
+    34967, 35369, 35773, 36180, 36589, 37001, 37416, 37833,
+    38252, 38674, 39099, 39526, 39956, 40388, 40823, 41260,
+    41700, 42142, 42587, 43034, 43484, 43937, 44392, 44849,
+    45310, 45772, 46238, 46706, 47176, 47649, 48125, 48603,
+    49084, 49567, 50053, 50542, 51033, 51526, 52023, 52522,
+    53023, 53527, 54034, 54543, 55055, 55570, 56087, 56607,
+    57129, 57654, 58182, 58712, 59245, 59780, 60318, 60859,
+    61402, 61948, 62497, 63048, 63602, 64159, 64718, 65280
+};
+
+/**
+ * Colour correction, applied while encoding.
+ *
+ * The lut combines the gamma table and the brightness, in 8.8 fixed point.
+ * The fraction is used for dithering: every frame a different threshold is
+ * added before dropping it, so over 8 frames each LED shows the fractional
+ * level on average. Neighbouring LEDs use different thresholds so they
+ * don't all flicker together.
+ *
+ * An update uses the correction that was current when it started, and holds
+ * it in 'encoding' until it is done. The setters build the new correction in
+ * the buffer the update isn't holding and switch 'correction' to it, so they
+ * can run while another task is encoding and never wait for it.
+ */
+typedef struct {
+    uint16_t lut[256];
+    bool enabled;
+    bool dither;
+} correction_t;
+
+static correction_t corrections[2];
+static correction_t *volatile correction = &corrections[0];
+static const correction_t *volatile encoding;
+
+static const uint16_t *gamma_table;
+static uint8_t brightness = 255;
+static bool dither_enabled;
+static uint8_t frame;
+
+static const uint8_t dither_thresholds[8] = {0, 128, 64, 192, 32, 160, 96, 224};
+
+/**
+ * The gamma table may be in flash, which can only be read a word at a time.
+ */
+static inline uint16_t gamma_value(uint8_t i)
+{
+    if (!gamma_table) {
+        return i << 8;
+    }
+    return ((const uint32_t *)gamma_table)[i / 2] >> (16 * (i % 2));
+}
+
+static void update_correction_lut(void)
+{
+    correction_t *next;
+
+    // The update holding a buffer may be a lower priority task we preempted,
+    // so rather than waiting for it, rebuild the other one. If that is the
+    // current one, the scheduler stays suspended while it is rebuilt, so no
+    // update can start on it half done.
+    vTaskSuspendAll();
+    next = (correction == &corrections[0]) ? &corrections[1] : &corrections[0];
+    if (encoding == next) {
+        next = correction;
+    }
+    next->enabled = gamma_table || brightness != 255 || dither_enabled;
+    next->dither = dither_enabled;
+    for (int i = 0; i < 256; i++) {
+        next->lut[i] = (gamma_value(i) * (brightness + 1)) >> 8;
+    }
+    correction = next;
+    xTaskResumeAll();
+}
+
+static const correction_t *start_encoding(void)
+{
+    const correction_t *c;
+
+    // if the setter switched in between, it may be rebuilding c already
+    do {
+        c = correction;
+        encoding = c;
+    } while (c != correction);
+    return c;
+}
+
+static inline uint32_t *encode_pixels(uint32_t *p_dma_buf, const correction_t *c,
+        const ws2812_pixel_t *pixels, uint32_t count)
+{
+    if (!c->enabled) {
+        for (uint32_t i = 0; i < count; i++) {
+            *p_dma_buf++ = bitpatterns[pixels[i].green];
+            *p_dma_buf++ = bitpatterns[pixels[i].red];
+            *p_dma_buf++ = bitpatterns[pixels[i].blue];
+        }
+        return p_dma_buf;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t d = 128;  // rounding
+        if (c->dither) {
+            d = dither_thresholds[(frame + i) & 7];
+        }
+        *p_dma_buf++ = bitpatterns[(c->lut[pixels[i].green] + d) >> 8];
+        *p_dma_buf++ = bitpatterns[(c->lut[pixels[i].red] + d) >> 8];
+        *p_dma_buf++ = bitpatterns[(c->lut[pixels[i].blue] + d) >> 8];
+    }
+    return p_dma_buf;
+}
+
+void ws2812_i2s_set_gamma(const uint16_t *table)
+{
+    gamma_table = table;
+    update_correction_lut();
+}
+
+void ws2812_i2s_set_brightness(uint8_t value)
+{
+    brightness = value;
+    update_correction_lut();
+}
+
+void ws2812_i2s_set_dither(bool enable)
+{
+    dither_enabled = enable;
+    update_correction_lut();
+}
+
 void ws2812_i2s_update(ws2812_pixel_t *pixels)
 {
     while (i2s_dma_processing) {};
 
-    uint16_t *p_dma_buf = dma_buffer;
+    const correction_t *c = start_encoding();
+    encode_pixels(dma_buffer, c, pixels, dma_buffer_size / DMA_PIXEL_SIZE);
+    encoding = NULL;
+    frame++;
 
-    for (uint32_t i = 0; i < (dma_buffer_size / DMA_PIXEL_SIZE); i++) {
-        // green
-        *p_dma_buf++ =  bitpatterns[pixels[i].green & 0x0F];
-        *p_dma_buf++ =  bitpatterns[pixels[i].green >> 4];
+    i2s_dma_processing = true;
+    i2s_dma_start(dma_block_list);
+}
 
-        // red
-        *p_dma_buf++ =  bitpatterns[pixels[i].red & 0x0F];
-        *p_dma_buf++ =  bitpatterns[pixels[i].red >> 4];
+void ws2812_i2s_update_segments(const ws2812_i2s_segment_t *segments,
+        uint32_t segment_count)
+{
+    uint32_t *p_dma_buf = dma_buffer;
+    uint32_t pixels_left = dma_buffer_size / DMA_PIXEL_SIZE;
 
-        // blue
-        *p_dma_buf++ =  bitpatterns[pixels[i].blue & 0x0F];
-        *p_dma_buf++ =  bitpatterns[pixels[i].blue >> 4];
+    while (i2s_dma_processing) {};
+
+    const correction_t *c = start_encoding();
+    for (uint32_t i = 0; i < segment_count && pixels_left; i++) {
+        uint32_t count = segments[i].count;
+        if (count > pixels_left) {
+            count = pixels_left;
+        }
+        p_dma_buf = encode_pixels(p_dma_buf, c, segments[i].pixels, count);
+        pixels_left -= count;
     }
+    encoding = NULL;
+    frame++;
 
     i2s_dma_processing = true;
     i2s_dma_start(dma_block_list);
@@ -50,4 +50,67 @@ void ws2812_i2s_init(uint32_t pixels_number);
  */
 void ws2812_i2s_update(ws2812_pixel_t *pixels);
 
+/**
+ * Gamma table for ws2812_i2s_set_gamma(), gamma 2.2.
+ */
+extern const uint16_t ws2812_i2s_gamma22[256];
+
+/**
+ * Set the gamma correction applied to every colour value while encoding.
+ *
+ * This and the other colour correction setters may be called while another
+ * task updates the pixels, which then uses the settings from when it
+ * started. They suspend the scheduler while they build the colour table,
+ * and must not be called from more than one task at a time.
+ *
+ * @param table 256 output levels in 8.8 fixed point (0 to 65280), indexed
+ * by the colour value, e.g. ws2812_i2s_gamma22. NULL for no correction.
+ */
+void ws2812_i2s_set_gamma(const uint16_t *table);
+
+/**
+ * Set the global brightness applied while encoding, after gamma.
+ *
+ * @param value 0 to 255 (full brightness, the default).
+ */
+void ws2812_i2s_set_brightness(uint8_t value);
+
+/**
+ * Enable temporal dithering.
+ *
+ * Gamma and brightness give levels between the 256 the LEDs can show.
+ * Without dithering they are rounded. With dithering each LED alternates
+ * between the two nearest levels over 8 updates, which makes dim colours
+ * and slow fades smoother. The strip has to be updated continuously
+ * (100 times per second or more) for this to work.
+ */
+void ws2812_i2s_set_dither(bool enable);
+
+/**
+ * A segment of the chain of pixels on the data pin.
+ */
+typedef struct {
+    ws2812_pixel_t *pixels;
+    uint32_t count;         ///< number of pixels in the segment
+} ws2812_i2s_segment_t;
+
+/**
+ * Update the chain from several pixel arrays in one DMA transfer.
+ *
+ * The I2S peripheral has one data output, so all the pixels form a single
+ * chain on it. That chain may be made of several strips (DOUT of one to DIN
+ * of the next) or of parts of one strip, each kept in its own array. The
+ * segments are sent one after another in a single bitstream, as if
+ * ws2812_i2s_update() was given their concatenation.
+ *
+ * Their total length should be 'pixels_number'. Pixels past it are not
+ * sent, and if the segments are shorter the rest of the chain keeps the
+ * previous data.
+ *
+ * @param segments Segments in the order they are chained.
+ * @param segment_count Number of segments.
+ */
+void ws2812_i2s_update_segments(const ws2812_i2s_segment_t *segments,
+        uint32_t segment_count);
+
 #endif  // __WS2812_I2S_H__
@@ -357,6 +357,18 @@
  */
 #define SO_REUSE                        1
 
+/**
+ * LWIP_COMPAT_SOCKETS and LWIP_POSIX_SOCKETS_IO_NAMES keep their default of
+ * 1, so lwip/sockets.h defines select() as lwip_select() and read(),
+ * write() and close() as lwip_read(), lwip_write() and lwip_close(). These
+ * only take lwIP socket numbers, not the file descriptors from the VFS
+ * (open(), vfs_pipe(), vfs_socket()). Source files that include
+ * lwip/sockets.h and also use file descriptors should call vfs_select(),
+ * _read_r(), _write_r() and _close_r() for them, see core/include/vfs.h.
+ * Setting LWIP_POSIX_SOCKETS_IO_NAMES to 0 removes the read/write/close
+ * macros but breaks code that closes sockets with close().
+ */
+
 /*
    ----------------------------------------
    ---------- Statistics options ----------
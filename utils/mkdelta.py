@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+#
+# Generate a delta (or just compressed) OTA image that rboot-ota can
+# decode as it is received. See extras/rboot-ota/ota-delta.h for the
+# format.
+#
+# mkdelta.py --source running.bin new.bin new.delta
+#   Encode new.bin against running.bin (the image in the slot the
+#   device is currently running from.) The header carries a CRC-32 of
+#   running.bin, so only a device running exactly running.bin will
+#   accept the result.
+#
+# mkdelta.py new.bin new.delta
+#   No source image, new.bin is only compressed (against itself.)
+#
+# The output is decoded again and compared with new.bin before it is
+# written, so a successful run means the round trip is good.
+#
+import argparse
+import struct
+import sys
+import zlib
+
+MAGIC = b"RBD1"
+HEADER = "<4sIII"
+
+OP_LITERAL = 0
+OP_COPY_SRC = 1
+OP_COPY_OUT = 2
+
+GRAM = 8         # bytes hashed to find match candidates
+MIN_MATCH = 8    # shorter matches are sent as literals
+CANDIDATES = 8   # positions remembered per hash
+
+def varint(v):
+    out = bytearray()
+    while True:
+        b = v & 0x7f
+        v >>= 7
+        if v:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return out
+
+def zigzag(v):
+    return (v << 1) if v >= 0 else ((-v << 1) - 1)
+
+def unzigzag(v):
+    return (v >> 1) if not (v & 1) else -((v + 1) >> 1)
+
+def match_len(a, ai, b, bi, limit):
+    """ Number of bytes a[ai:] and b[bi:] have in common, up to limit """
+    n = 0
+    limit = min(limit, len(a) - ai, len(b) - bi)
+    while n < limit:
+        step = min(64, limit - n)
+        if a[ai+n:ai+n+step] == b[bi+n:bi+n+step]:
+            n += step
+            continue
+        while n < limit and a[ai+n] == b[bi+n]:
+            n += 1
+        break
+    return n
+
+def add_index(index, gram, pos):
+    positions = index.setdefault(gram, [])
+    positions.append(pos)
+    if len(positions) > CANDIDATES:
+        del positions[0]
+
+def emit_op(out, op, length):
+    if length < 64:
+        out.append((op << 6) | length)
+    else:
+        out.append(op << 6)
+        out += varint(length)
+
+def encode(source, target):
+    src_crc = zlib.crc32(source) & 0xffffffff if source else 0
+    out = bytearray(struct.pack(HEADER, MAGIC, len(target), len(source), src_crc))
+
+    src_index = {}
+    for p in range(len(source) - GRAM + 1):
+        add_index(src_index, source[p:p+GRAM], p)
+    out_index = {}
+
+    i = 0
+    lit_start = 0
+    src_pos = 0
+    n = len(target)
+    while i + MIN_MATCH <= n:
+        gram = target[i:i+GRAM]
+        best = (0, None, 0)
+        # carrying on from the last source copy is the cheapest to encode, try it first
+        for p in [src_pos] + src_index.get(gram, []):
+            l = match_len(source, p, target, i, n - i)
+            if l > best[0]:
+                best = (l, OP_COPY_SRC, p)
+        for p in out_index.get(gram, []):
+            l = match_len(target, p, target, i, n - i)
+            if l > best[0]:
+                best = (l, OP_COPY_OUT, p)
+
+        length, op, p = best
+        if length < MIN_MATCH:
+            add_index(out_index, gram, i)
+            i += 1
+            continue
+
+        if lit_start < i:
+            emit_op(out, OP_LITERAL, i - lit_start)
+            out += target[lit_start:i]
+        emit_op(out, op, length)
+        if op == OP_COPY_SRC:
+            out += varint(zigzag(p - src_pos))
+            src_pos = p + length
+        else:
+            out += varint(i - p)
+        for k in range(i, min(i + length, n - GRAM + 1)):
+            add_index(out_index, target[k:k+GRAM], k)
+        i += length
+        lit_start = i
+
+    if lit_start < n:
+        emit_op(out, OP_LITERAL, n - lit_start)
+        out += target[lit_start:n]
+    return out
+
+def decode(source, delta):
+    """ Python version of the device decoder, used to check the round trip """
+    magic, target_len, src_len, src_crc = struct.unpack_from(HEADER, delta)
+    if magic != MAGIC:
+        raise ValueError("Bad delta header")
+    if src_len and (src_len > len(source) or zlib.crc32(source[:src_len]) & 0xffffffff != src_crc):
+        raise ValueError("Delta doesn't match source image")
+    pos = struct.calcsize(HEADER)
+    out = bytearray()
+    src_pos = 0
+
+    def read_varint():
+        v = 0
+        shift = 0
+        while True:
+            b = delta[pos + shift // 7]
+            v |= (b & 0x7f) << shift
+            shift += 7
+            if not b & 0x80:
+                return v, shift // 7
+
+    while len(out) < target_len:
+        op = delta[pos] >> 6
+        length = delta[pos] & 0x3f
+        pos += 1
+        if not length:
+            length, used = read_varint()
+            pos += used
+        if op == OP_LITERAL:
+            out += delta[pos:pos+length]
+            pos += length
+            continue
+        arg, used = read_varint()
+        pos += used
+        if op == OP_COPY_SRC:
+            src_pos += unzigzag(arg)
+            out += source[src_pos:src_pos+length]
+            src_pos += length
+        elif op == OP_COPY_OUT:
+            for _ in range(length):
+                out.append(out[-arg])
+        else:
+            raise ValueError("Bad delta command")
+    if pos != len(delta):
+        raise ValueError("Trailing data after delta")
+    return bytes(out)
+
+def main():
+    parser = argparse.ArgumentParser(description='Generate a delta OTA image for rboot-ota', prog='mkdelta')
+    parser.add_argument('--source', '-s', help='Image the device is currently running (omit to only compress)')
+    parser.add_argument('image', help='New firmware image')
+    parser.add_argument('output', help='Delta image to write')
+    args = parser.parse_args()
+
+    with open(args.image, 'rb') as f:
+        target = f.read()
+    source = b""
+    if args.source:
+        with open(args.source, 'rb') as f:
+            source = f.read()
+
+    delta = encode(source, target)
+    if decode(source, delta) != target:
+        print("Round trip check failed, delta not written")
+        sys.exit(1)
+
+    with open(args.output, 'wb') as f:
+        f.write(delta)
+    print("%s: %d bytes -> %d bytes (%.1f%%)" % (args.output, len(target), len(delta),
+                                                100.0 * len(delta) / max(len(target), 1)))
+
+if __name__ == "__main__":
+    main()